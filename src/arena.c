@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* arena.c: a region allocator for the data of one trace. */
+
+#include "arena.h"
+#include "array.h"
+#include <string.h>
+
+/* Small allocations are carved out of chunks of this size.  */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+/* Allocations larger than this get a block of their own, which can be
+   reallocated when the array in it grows.  */
+#define ARENA_LARGE_SIZE (ARENA_CHUNK_SIZE / 4)
+
+/* Every allocation is aligned to this many bytes.  */
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(gsize)(ARENA_ALIGN - 1))
+
+/* A chunk, or a large allocation.  The blocks of an arena are kept in a
+   doubly linked list, so that a large one can be moved by g_realloc.  */
+typedef struct arena_block {
+  struct arena_block *prev;
+  struct arena_block *next;
+  gsize size;
+} arena_block_type;
+
+#define BLOCK_HEADER_SIZE ARENA_ROUND(sizeof(arena_block_type))
+#define BLOCK_DATA(block) ((gchar *)(block) + BLOCK_HEADER_SIZE)
+#define DATA_BLOCK(data) ((arena_block_type *)((gchar *)(data) - BLOCK_HEADER_SIZE))
+
+struct _arena_type {
+  arena_block_type *blocks;
+  /* The chunk small allocations are carved from, how much of it is
+     used, and where the latest allocation in it starts.  */
+  arena_block_type *chunk;
+  gsize used;
+  gchar *last;
+};
+
+static arena_block_type *new_block(arena_type *arena, gsize size)
+{
+  arena_block_type *block = g_malloc(BLOCK_HEADER_SIZE + size);
+
+  block->size = size;
+  block->prev = NULL;
+  block->next = arena->blocks;
+  if (arena->blocks)
+    arena->blocks->prev = block;
+  arena->blocks = block;
+  return block;
+}
+
+arena_type *new_arena(void)
+{
+  return g_new0(arena_type, 1);
+}
+
+void free_arena(arena_type *arena)
+{
+  arena_block_type *block = arena->blocks;
+
+  while (block) {
+    arena_block_type *next = block->next;
+    g_free(block);
+    block = next;
+  }
+  g_free(arena);
+}
+
+gpointer arena_alloc(arena_type *arena, gsize size)
+{
+  size = ARENA_ROUND(size);
+
+  if (size > ARENA_LARGE_SIZE)
+    return BLOCK_DATA(new_block(arena, size));
+
+  if (!arena->chunk || arena->used + size > arena->chunk->size) {
+    arena->chunk = new_block(arena, ARENA_CHUNK_SIZE);
+    arena->used = 0;
+  }
+  arena->last = BLOCK_DATA(arena->chunk) + arena->used;
+  arena->used += size;
+  return arena->last;
+}
+
+gpointer arena_grow(arena_type *arena, gpointer data, unsigned *capacity, unsigned length,
+                   gsize elt_size)
+{
+  gsize old_size, new_size;
+  gpointer new_data;
+
+  if (length <= *capacity)
+    return data;
+
+  old_size = ARENA_ROUND((gsize)*capacity * elt_size);
+  *capacity = array_next_capacity(*capacity, length);
+  new_size = ARENA_ROUND(elt_size * *capacity);
+  if (new_size / elt_size < *capacity)
+    g_error("arena_grow: overflow allocating %u*%" G_GSIZE_FORMAT " bytes", *capacity, elt_size);
+
+  if (data && old_size > ARENA_LARGE_SIZE) {
+    /* The array has its own block.  */
+    arena_block_type *block = g_realloc(DATA_BLOCK(data), BLOCK_HEADER_SIZE + new_size);
+
+    block->size = new_size;
+    if (block->prev)
+      block->prev->next = block;
+    else
+      arena->blocks = block;
+    if (block->next)
+      block->next->prev = block;
+    return BLOCK_DATA(block);
+  }
+
+  if (data && data == arena->last && new_size <= ARENA_LARGE_SIZE &&
+      arena->used - old_size + new_size <= arena->chunk->size) {
+    /* The array is the end of the chunk.  */
+    arena->used += new_size - old_size;
+    return data;
+  }
+
+  new_data = arena_alloc(arena, new_size);
+  if (data)
+    memcpy(new_data, data, old_size);
+  return new_data;
+}
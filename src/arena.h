@@ -0,0 +1,36 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* arena.h: a region allocator for the data of one trace. */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <glib.h>
+
+/* The pixel outlines, curves, tangents and index lists that are built
+   while tracing a bitmap all die together when the trace is done.
+   Instead of being allocated and freed one by one, they are carved out
+   of large chunks of an arena, which are given back at once by
+   `free_arena'.  An arena must not be used by two threads at the same
+   time.  */
+typedef struct _arena_type arena_type;
+
+extern arena_type *new_arena(void);
+extern void free_arena(arena_type *arena);
+
+/* Return SIZE bytes of uninitialized memory, suitably aligned for any
+   type, that live as long as ARENA.  */
+extern gpointer arena_alloc(arena_type *arena, gsize size);
+
+/* Like `array_grow' (see array.h), for an array allocated in ARENA.
+   The array is extended in place when it is the last allocation, or
+   when it is large enough to have a block of its own; otherwise it is
+   copied, and the old copy is left to the arena.  */
+extern gpointer arena_grow(arena_type *arena, gpointer data, unsigned *capacity, unsigned length,
+                           gsize elt_size);
+
+#endif /* not ARENA_H */
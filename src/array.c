@@ -0,0 +1,41 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* array.c: growable arrays for the outline, curve and spline lists. */
+
+#include "array.h"
+
+/* The capacity of the first allocation.  */
+#define ARRAY_MIN_CAPACITY 4
+
+unsigned array_next_capacity(unsigned capacity, unsigned length)
+{
+  unsigned new_capacity = capacity ? capacity : ARRAY_MIN_CAPACITY;
+
+  while (new_capacity < length && new_capacity <= G_MAXUINT / 2)
+    new_capacity *= 2;
+  return new_capacity < length ? length : new_capacity;
+}
+
+gpointer array_grow(gpointer data, unsigned *capacity, unsigned length, gsize elt_size)
+{
+  if (length <= *capacity)
+    return data;
+
+  *capacity = array_next_capacity(*capacity, length);
+  return g_realloc_n(data, *capacity, elt_size);
+}
+
+unsigned array_implicit_capacity(unsigned length)
+{
+  unsigned capacity = 1;
+
+  if (length == 0)
+    return 0;
+  while (capacity < length && capacity <= G_MAXUINT / 2)
+    capacity *= 2;
+  return capacity < length ? length : capacity;
+}
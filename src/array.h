@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* array.h: growable arrays for the outline, curve and spline lists. */
+
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include <glib.h>
+
+/* Return DATA, an array of elements of ELT_SIZE bytes with room for
+   *CAPACITY of them, reallocated if needed to hold LENGTH elements.
+   The capacity is doubled each time it runs out, so that appending N
+   elements one at a time costs O(N) instead of O(N^2), and takes only
+   O(log N) reallocations.  */
+extern gpointer array_grow(gpointer data, unsigned *capacity, unsigned length, gsize elt_size);
+
+/* The capacity `array_grow' gives an array with room for CAPACITY
+   elements that must hold LENGTH (more than CAPACITY).  */
+extern unsigned array_next_capacity(unsigned capacity, unsigned length);
+
+/* The capacity of an array of LENGTH elements which does not record
+   its own: such arrays are only ever allocated by `array_grow' starting
+   from this value, which keeps their size a power of two.  */
+extern unsigned array_implicit_capacity(unsigned length);
+
+#endif /* not ARRAY_H */
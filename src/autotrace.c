@@ -25,17 +25,57 @@
 #include "input.h"
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include "image-header.h"
 #include "image-proc.h"
+#include "medial-axis.h"
 #include "quantize.h"
 #include "thin-image.h"
 #include "despeckle.h"
+#include "trace-stats.h"
 
 #include <locale.h>
 #include <string.h>
 
 #define AT_DEFAULT_DPI 72
 
+static at_splines_type *trace_bitmap(at_bitmap *, gboolean, at_tracer *, at_fitting_opts_type *,
+                                     spline_list_func, gpointer, at_trace_stats *, at_msg_func,
+                                     gpointer, at_progress_func, gpointer, at_testcancel_func,
+                                     gpointer);
+
+/* The numeric locale of the calling thread, switched to "C" while
+   writers to a FILE run: writers to a sink do not depend on it */
+typedef struct {
+#ifdef HAVE_USELOCALE
+  locale_t c_locale, old_locale;
+#else
+  int unused;
+#endif /* Def: HAVE_USELOCALE */
+} numeric_locale_type;
+
+static void use_c_numeric_locale(numeric_locale_type *);
+static void restore_numeric_locale(numeric_locale_type *);
+
+/* A streaming writer being fed spline lists */
+typedef struct {
+  at_spline_writer *writer;
+  at_sink *sink;
+  gchar *name;
+  at_output_opts_type *opts;
+  at_msg_func msg_func;
+  gpointer msg_data;
+  gboolean begun;
+  /* What the writer's begin function returned */
+  gpointer state;
+  /* Where the time spent writing is counted, if not NULL */
+  at_trace_stats *stats;
+} output_stream_type;
+
+static void begin_output_stream(output_stream_type *, at_splines_type *);
+static void emit_spline_list(spline_list_array_type *, spline_list_type *, gpointer);
+static int end_output_stream(output_stream_type *, at_splines_type *);
+
 at_fitting_opts_type *at_fitting_opts_new(void)
 {
   at_fitting_opts_type *opts = g_malloc(sizeof(at_fitting_opts_type));
@@ -88,6 +128,7 @@ at_output_opts_type *at_output_opts_new(void)
 {
   at_output_opts_type *opts = g_malloc(sizeof(at_output_opts_type));
   opts->dpi = AT_DEFAULT_DPI;
+  opts->compress = FALSE;
   return opts;
 }
 
@@ -118,28 +159,100 @@ at_bitmap *at_bitmap_read(at_bitmap_reader *reader, gchar *filename, at_input_op
   return bitmap;
 }
 
-at_bitmap *at_bitmap_new(unsigned short width, unsigned short height, unsigned int planes)
+/* Have READER, which only reads files, read the SIZE bytes at DATA
+   from a temporary file.  */
+static at_bitmap read_through_file(at_bitmap_reader *reader, const guchar *data, gsize size,
+                                   at_input_opts_type *opts, at_msg_func msg_func,
+                                   gpointer msg_data)
+{
+  at_bitmap bitmap = at_bitmap_init(NULL, 0, 0, 1);
+  gchar *name = NULL;
+  GError *error = NULL;
+  int fd = g_file_open_tmp("autotrace-XXXXXX", &name, &error);
+
+  if (fd >= 0) {
+    g_close(fd, NULL);
+    if (g_file_set_contents(name, (const gchar *)data, size, &error))
+      bitmap = (*reader->func)(name, opts, msg_func, msg_data, reader->data);
+  }
+  if (error) {
+    at_exception_type exp = at_exception_new(msg_func, msg_data);
+
+    at_exception_fatal(&exp, error->message);
+    g_error_free(error);
+  }
+  if (name) {
+    g_unlink(name);
+    g_free(name);
+  }
+  return bitmap;
+}
+
+at_bitmap *at_bitmap_read_memory(at_bitmap_reader *reader, const guchar *data, gsize size,
+                                 at_input_opts_type *opts, at_msg_func msg_func,
+                                 gpointer msg_data)
+{
+  gboolean new_opts = FALSE;
+  at_bitmap *bitmap = g_malloc(sizeof(at_bitmap));
+  if (opts == NULL) {
+    opts = at_input_opts_new();
+    new_opts = TRUE;
+  }
+  if (reader->memory_func)
+    *bitmap = (*reader->memory_func)(data, size, opts, msg_func, msg_data, reader->data);
+  else
+    *bitmap = read_through_file(reader, data, size, opts, msg_func, msg_data);
+  if (new_opts)
+    at_input_opts_free(opts);
+  return bitmap;
+}
+
+at_bitmap *at_bitmap_new(unsigned int width, unsigned int height, unsigned int planes)
 {
   at_bitmap *bitmap = g_malloc(sizeof(at_bitmap));
   *bitmap = at_bitmap_init(NULL, width, height, planes);
   return bitmap;
 }
 
+at_bitmap *at_bitmap_wrap(unsigned char *data, unsigned int width, unsigned int height,
+                          unsigned int planes, unsigned int stride,
+                          GDestroyNotify destroy_notify)
+{
+  at_bitmap *bitmap;
+
+  if (stride == 0)
+    stride = width * planes;
+  g_return_val_if_fail(data || width == 0 || height == 0, NULL);
+  g_return_val_if_fail(stride >= width * planes, NULL);
+
+  bitmap = g_malloc(sizeof(at_bitmap));
+  bitmap->bitmap = data;
+  bitmap->width = width;
+  bitmap->height = height;
+  bitmap->np = planes;
+  bitmap->stride = stride;
+  bitmap->destroy = destroy_notify;
+  return bitmap;
+}
+
 at_bitmap *at_bitmap_copy(const at_bitmap *src)
 {
   at_bitmap *dist;
-  unsigned short width, height, planes;
+  unsigned int width, height, planes;
+  unsigned row;
 
   width = at_bitmap_get_width(src);
   height = at_bitmap_get_height(src);
   planes = at_bitmap_get_planes(src);
 
   dist = at_bitmap_new(width, height, planes);
-  memcpy(dist->bitmap, src->bitmap, width * height * planes * sizeof(unsigned char));
+  for (row = 0; row < height; row++)
+    memcpy(AT_BITMAP_PIXEL(dist, row, 0), AT_BITMAP_PIXEL(src, row, 0),
+           width * planes * sizeof(unsigned char));
   return dist;
 }
 
-at_bitmap at_bitmap_init(unsigned char *area, unsigned short width, unsigned short height,
+at_bitmap at_bitmap_init(unsigned char *area, unsigned int width, unsigned int height,
                          unsigned int planes)
 {
   at_bitmap bitmap;
@@ -147,7 +260,7 @@ at_bitmap at_bitmap_init(unsigned char *area, unsigned short width, unsigned sho
   if (area)
     bitmap.bitmap = area;
   else {
-    if (0 == (width * height))
+    if (0 == width || 0 == height)
       bitmap.bitmap = NULL;
     else
       bitmap.bitmap = g_malloc0((gsize)width * height * planes * sizeof(unsigned char));
@@ -156,21 +269,24 @@ at_bitmap at_bitmap_init(unsigned char *area, unsigned short width, unsigned sho
   bitmap.width = width;
   bitmap.height = height;
   bitmap.np = planes;
+  bitmap.stride = width * planes;
+  bitmap.destroy = g_free;
   return bitmap;
 }
 
 void at_bitmap_free(at_bitmap *bitmap)
 {
-  g_free(bitmap->bitmap);
+  if (bitmap->destroy)
+    bitmap->destroy(bitmap->bitmap);
   g_free(bitmap);
 }
 
-unsigned short at_bitmap_get_width(const at_bitmap *bitmap)
+unsigned int at_bitmap_get_width(const at_bitmap *bitmap)
 {
   return bitmap->width;
 }
 
-unsigned short at_bitmap_get_height(const at_bitmap *bitmap)
+unsigned int at_bitmap_get_height(const at_bitmap *bitmap)
 {
   return bitmap->height;
 }
@@ -220,6 +336,140 @@ at_splines_type *at_splines_new_full(at_bitmap *bitmap, at_fitting_opts_type *op
                                      at_msg_func msg_func, gpointer msg_data,
                                      at_progress_func notify_progress, gpointer progress_data,
                                      at_testcancel_func test_cancel, gpointer testcancel_data)
+{
+  return trace_bitmap(bitmap, TRUE, NULL, opts, NULL, NULL, NULL, msg_func, msg_data,
+                      notify_progress, progress_data, test_cancel, testcancel_data);
+}
+
+at_splines_type *at_splines_new_stats(at_bitmap *bitmap, at_fitting_opts_type *opts,
+                                      at_trace_stats *stats, at_msg_func msg_func,
+                                      gpointer msg_data, at_progress_func notify_progress,
+                                      gpointer progress_data, at_testcancel_func test_cancel,
+                                      gpointer testcancel_data)
+{
+  g_return_val_if_fail(stats, NULL);
+
+  return trace_bitmap(bitmap, TRUE, NULL, opts, NULL, NULL, stats, msg_func, msg_data,
+                      notify_progress, progress_data, test_cancel, testcancel_data);
+}
+
+at_splines_type *at_tracer_trace(at_tracer *tracer, at_bitmap *bitmap, at_fitting_opts_type *opts,
+                                 at_trace_stats *stats, at_msg_func msg_func, gpointer msg_data,
+                                 at_progress_func notify_progress, gpointer progress_data,
+                                 at_testcancel_func test_cancel, gpointer testcancel_data)
+{
+  g_return_val_if_fail(tracer, NULL);
+
+  return trace_bitmap(bitmap, TRUE, tracer, opts, NULL, NULL, stats, msg_func, msg_data,
+                      notify_progress, progress_data, test_cancel, testcancel_data);
+}
+
+at_splines_type *at_splines_new_const(const at_bitmap *bitmap, at_fitting_opts_type *opts,
+                                      at_msg_func msg_func, gpointer msg_data,
+                                      at_progress_func notify_progress, gpointer progress_data,
+                                      at_testcancel_func test_cancel, gpointer testcancel_data)
+{
+  /* BITMAP is only written to when IN_PLACE is true */
+  return trace_bitmap((at_bitmap *)bitmap, FALSE, NULL, opts, NULL, NULL, NULL, msg_func, msg_data,
+                      notify_progress, progress_data, test_cancel, testcancel_data);
+}
+
+gboolean at_splines_new_write(at_bitmap *bitmap, at_fitting_opts_type *opts,
+                              at_spline_writer *writer, FILE *writeto, gchar *file_name,
+                              at_output_opts_type *output_opts, at_trace_stats *stats,
+                              at_msg_func msg_func, gpointer msg_data,
+                              at_progress_func notify_progress, gpointer progress_data,
+                              at_testcancel_func test_cancel, gpointer testcancel_data)
+{
+  at_sink *sink = at_sink_new_file(writeto);
+  gboolean written;
+
+  written = at_splines_new_write_sink(bitmap, opts, writer, sink, file_name, output_opts, stats,
+                                      msg_func, msg_data, notify_progress, progress_data,
+                                      test_cancel, testcancel_data);
+  at_sink_free(sink);
+  return written;
+}
+
+gboolean at_splines_new_write_sink(at_bitmap *bitmap, at_fitting_opts_type *opts,
+                                   at_spline_writer *writer, at_sink *sink, gchar *file_name,
+                                   at_output_opts_type *output_opts, at_trace_stats *stats,
+                                   at_msg_func msg_func, gpointer msg_data,
+                                   at_progress_func notify_progress, gpointer progress_data,
+                                   at_testcancel_func test_cancel, gpointer testcancel_data)
+{
+  gboolean new_opts = FALSE;
+  output_stream_type stream;
+  at_splines_type *splines;
+  stage_mark_type mark;
+  int result = -1;
+
+  if (!writer->begin) {
+    splines = trace_bitmap(bitmap, TRUE, NULL, opts, NULL, NULL, stats, msg_func, msg_data,
+                           notify_progress, progress_data, test_cancel, testcancel_data);
+    if (!splines)
+      return FALSE;
+    stage_begin(stats, &mark);
+    at_splines_write_sink(writer, sink, file_name, output_opts, splines, msg_func, msg_data);
+    stage_end(stats, AT_STAGE_WRITE, &mark);
+    at_splines_free(splines);
+    return !at_sink_failed(sink);
+  }
+
+  if (output_opts == NULL) {
+    new_opts = TRUE;
+    output_opts = at_output_opts_new();
+  }
+  stream.writer = writer;
+  stream.sink = sink;
+  stream.name = file_name ? file_name : "";
+  stream.opts = output_opts;
+  stream.msg_func = msg_func;
+  stream.msg_data = msg_data;
+  stream.begun = FALSE;
+  stream.state = NULL;
+  stream.stats = stats;
+
+  splines = trace_bitmap(bitmap, TRUE, NULL, opts, emit_spline_list, &stream, stats, msg_func,
+                         msg_data, notify_progress, progress_data, test_cancel, testcancel_data);
+  if (splines) {
+    stage_begin(stats, &mark);
+    result = end_output_stream(&stream, splines);
+    stage_end(stats, AT_STAGE_WRITE, &mark);
+    at_splines_free(splines);
+  } else if (stream.state)
+    /* Let the writer release its state, leaving what it has written */
+    writer->end(stream.state);
+  at_sink_flush(sink);
+
+  if (new_opts)
+    at_output_opts_free(output_opts);
+  return splines != NULL && result == 0 && !at_sink_failed(sink);
+}
+
+/* The color centerline tracing leaves out, white if OPTS has none */
+static at_color centerline_background(const at_fitting_opts_type *opts)
+{
+  at_color background_color = {0xff, 0xff, 0xff};
+
+  if (opts->background_color)
+    background_color = *opts->background_color;
+  return background_color;
+}
+
+/* Trace BITMAP.  The preprocessing stages work on BITMAP itself if
+   IN_PLACE, and otherwise on a copy made the first time one of them
+   is to run, so that BITMAP is only read.  The stages take their
+   scratch buffers from TRACER, or allocate them if it is NULL.  If
+   EMIT is not NULL, the spline lists are handed to it as they are
+   fitted rather than returned; if what EMIT does is counted in the
+   write stage of STATS, it is left out of the fitting.  */
+static at_splines_type *trace_bitmap(at_bitmap *bitmap, gboolean in_place, at_tracer *tracer,
+                                     at_fitting_opts_type *opts, spline_list_func emit,
+                                     gpointer emit_data, at_trace_stats *stats,
+                                     at_msg_func msg_func, gpointer msg_data,
+                                     at_progress_func notify_progress, gpointer progress_data,
+                                     at_testcancel_func test_cancel, gpointer testcancel_data)
 {
   image_header_type image_header;
   at_splines_type *splines = g_malloc(sizeof(at_splines_type));
@@ -227,6 +477,9 @@ at_splines_type *at_splines_new_full(at_bitmap *bitmap, at_fitting_opts_type *op
   QuantizeObj *myQuant = NULL; /* curently not used */
   at_exception_type exp = at_exception_new(msg_func, msg_data);
   at_distance_map dist_map, *dist = NULL;
+  arena_type *arena;
+  at_bitmap *copy = NULL;
+  stage_mark_type mark;
 
 #define CANCELP (test_cancel && test_cancel(testcancel_data))
 #define FATALP (at_exception_got_fatal(&exp))
@@ -237,74 +490,127 @@ at_splines_type *at_splines_new_full(at_bitmap *bitmap, at_fitting_opts_type *op
       splines = NULL;                                                                              \
     }                                                                                              \
   } while (0)
+/* Before fitted_splines has filled SPLINES, only the block itself
+   can be released.  */
+#define DROP_SPLINE()                                                                              \
+  do {                                                                                             \
+    g_free(splines);                                                                               \
+    splines = NULL;                                                                                \
+  } while (0)
 
-#define CANCEL_THEN_CLEANUP_DIST()                                                                 \
-  if (CANCELP)                                                                                     \
-    goto cleanup_dist;
 #define CANCEL_THEN_CLEANUP_PIXELS()                                                               \
   if (CANCELP) {                                                                                   \
     FREE_SPLINE();                                                                                 \
     goto cleanup_pixels;                                                                           \
   }
 
-#define FATAL_THEN_RETURN()                                                                        \
-  if (FATALP)                                                                                      \
-    return splines;
+#define FATAL_THEN_CLEANUP_COPY()                                                                  \
+  if (FATALP) {                                                                                    \
+    DROP_SPLINE();                                                                                 \
+    goto cleanup_copy;                                                                             \
+  }
 #define FATAL_THEN_CLEANUP_DIST()                                                                  \
-  if (FATALP)                                                                                      \
-    goto cleanup_dist;
+  if (FATALP) {                                                                                    \
+    DROP_SPLINE();                                                                                 \
+    goto cleanup_dist;                                                                             \
+  }
 #define FATAL_THEN_CLEANUP_PIXELS()                                                                \
   if (FATALP) {                                                                                    \
     FREE_SPLINE();                                                                                 \
     goto cleanup_pixels;                                                                           \
   }
 
+  if (stats)
+    memset(stats, 0, sizeof(at_trace_stats));
+
+  /* Despeckling, quantizing and thinning rewrite the pixels as one
+     contiguous array.  A bitmap whose rows are further apart, which
+     may be a buffer the caller shares with other code, is left as it
+     is and they work on a packed copy.  The medial axis is found
+     without touching the pixels.  */
+  if (opts->despeckle_level > 0 || opts->color_count > 0 ||
+      (opts->centerline && !opts->medial_axis)) {
+    if (!in_place ||
+        AT_BITMAP_STRIDE(bitmap) != AT_BITMAP_WIDTH(bitmap) * AT_BITMAP_PLANES(bitmap))
+      bitmap = copy = at_bitmap_copy(bitmap);
+  }
+
   if (opts->despeckle_level > 0) {
-    despeckle(bitmap, opts->despeckle_level, opts->despeckle_tightness, opts->noise_removal, &exp);
-    FATAL_THEN_RETURN();
+    stage_begin(stats, &mark);
+    despeckle(bitmap, opts->despeckle_level, opts->despeckle_tightness, opts->noise_removal,
+              tracer, &exp);
+    stage_end(stats, AT_STAGE_DESPECKLE, &mark);
+    FATAL_THEN_CLEANUP_COPY();
   }
 
   image_header.width = at_bitmap_get_width(bitmap);
   image_header.height = at_bitmap_get_height(bitmap);
 
   if (opts->color_count > 0) {
-    quantize(bitmap, opts->color_count, opts->background_color, &myQuant, &exp);
+    stage_begin(stats, &mark);
+    quantize(bitmap, opts->color_count, opts->background_color, &myQuant, tracer, &exp);
     if (myQuant)
       quantize_object_free(myQuant); /* curently not used */
-    FATAL_THEN_RETURN();
+    stage_end(stats, AT_STAGE_QUANTIZE, &mark);
+    FATAL_THEN_CLEANUP_COPY();
   }
 
-  if (opts->centerline) {
+  if (opts->centerline && opts->medial_axis) {
+    /* The distances give the medial axis, and the width of the lines
+       with preserve_width.  */
+    stage_begin(stats, &mark);
+    dist_map = new_color_distance_map(bitmap, centerline_background(opts), tracer, &exp);
+    stage_end(stats, AT_STAGE_DISTANCE_MAP, &mark);
+    dist = &dist_map;
+    FATAL_THEN_CLEANUP_DIST();
+  } else if (opts->centerline) {
     if (opts->preserve_width) {
       /* Preserve line width prior to thinning. */
-      dist_map = new_distance_map(bitmap, 255, /*padded= */ TRUE, &exp);
+      stage_begin(stats, &mark);
+      dist_map = new_distance_map(bitmap, 255, /*padded= */ TRUE, tracer, &exp);
+      stage_end(stats, AT_STAGE_DISTANCE_MAP, &mark);
       dist = &dist_map;
-      FATAL_THEN_RETURN();
+      FATAL_THEN_CLEANUP_COPY();
     }
     /* Hereafter, dist is allocated. dist must be freed if
        the execution is canceled or exception is raised;
        use FATAL_THEN_CLEANUP_DIST. */
-    thin_image(bitmap, opts->background_color, &exp);
+    stage_begin(stats, &mark);
+    thin_image(bitmap, opts->background_color, tracer, &exp);
+    stage_end(stats, AT_STAGE_THIN, &mark);
     FATAL_THEN_CLEANUP_DIST()
   }
 
-  /* Hereafter, pixels is allocated. pixels must be freed if
-     the execution is canceled; use CANCEL_THEN_CLEANUP_PIXELS. */
-  if (opts->centerline) {
-    at_color background_color = {0xff, 0xff, 0xff};
-    if (opts->background_color)
-      background_color = *opts->background_color;
-
-    pixels = find_centerline_pixels(bitmap, background_color, notify_progress, progress_data,
-                                    test_cancel, testcancel_data, &exp);
-  } else
-    pixels = find_outline_pixels(bitmap, opts->background_color, notify_progress, progress_data,
-                                 test_cancel, testcancel_data, &exp);
-  FATAL_THEN_CLEANUP_DIST();
-  CANCEL_THEN_CLEANUP_DIST();
-
-  *splines = fitted_splines(pixels, opts, dist, image_header.width, image_header.height, &exp,
+  /* Hereafter, the arena is allocated.  It holds the pixel outlines
+     and the curves fitted_splines makes of them, and must be freed
+     whatever happens; use the *_CLEANUP_PIXELS macros.  */
+  arena = new_arena();
+  stage_begin(stats, &mark);
+  if (opts->centerline && opts->medial_axis)
+    pixels = find_medial_axis_pixels(bitmap, centerline_background(opts), dist, notify_progress,
+                                     progress_data, test_cancel, testcancel_data, tracer, arena,
+                                     &exp);
+  else if (opts->centerline)
+    pixels = find_centerline_pixels(bitmap, centerline_background(opts), notify_progress,
+                                    progress_data, test_cancel, testcancel_data, tracer, arena,
+                                    &exp);
+  else
+    pixels = find_outline_pixels(bitmap, opts->background_color, opts->threads, notify_progress,
+                                 progress_data, test_cancel, testcancel_data, tracer, arena, &exp);
+  stage_end(stats, AT_STAGE_OUTLINES, &mark);
+  if (FATALP || CANCELP) {
+    DROP_SPLINE();
+    goto cleanup_pixels;
+  }
+  if (stats) {
+    stats->pixels_scanned = (guint64)image_header.width * image_header.height;
+    stats->outlines = O_LIST_LENGTH(pixels);
+  }
+
+  *splines = fitted_splines(pixels, opts, opts->preserve_width ? dist : NULL, image_header.width,
+                            image_header.height, arena, emit, emit_data, stats, &exp,
                             notify_progress, progress_data, test_cancel, testcancel_data);
+  stage_exclude(stats, AT_STAGE_FIT, AT_STAGE_WRITE);
   FATAL_THEN_CLEANUP_PIXELS();
   CANCEL_THEN_CLEANUP_PIXELS();
 
@@ -312,18 +618,21 @@ at_splines_type *at_splines_new_full(at_bitmap *bitmap, at_fitting_opts_type *op
     notify_progress(1.0, progress_data);
 
 cleanup_pixels:
-  free_pixel_outline_list(&pixels);
+  free_arena(arena);
 cleanup_dist:
   if (dist)
     free_distance_map(dist);
+cleanup_copy:
+  if (copy)
+    at_bitmap_free(copy);
   return splines;
 #undef CANCELP
 #undef FATALP
 #undef FREE_SPLINE
-#undef CANCEL_THEN_CLEANUP_DIST
+#undef DROP_SPLINE
 #undef CANCEL_THEN_CLEANUP_PIXELS
 
-#undef FATAL_THEN_RETURN
+#undef FATAL_THEN_CLEANUP_COPY
 #undef FATAL_THEN_CLEANUP_DIST
 #undef FATAL_THEN_CLEANUP_PIXELS
 }
@@ -331,9 +640,45 @@ cleanup_dist:
 void at_splines_write(at_spline_writer *writer, FILE *writeto, gchar *file_name,
                       at_output_opts_type *opts, at_splines_type *splines, at_msg_func msg_func,
                       gpointer msg_data)
+{
+  at_sink *sink = at_sink_new_file(writeto);
+
+  at_splines_write_sink(writer, sink, file_name, opts, splines, msg_func, msg_data);
+  at_sink_free(sink);
+}
+
+/* Have WRITER, which only writes to a FILE, write SPLINES to SINK,
+   which has none, through a temporary file.  */
+static void write_through_file(at_spline_writer *writer, at_sink *sink, gchar *file_name,
+                               at_output_opts_type *opts, at_splines_type *splines,
+                               at_msg_func msg_func, gpointer msg_data)
+{
+  FILE *file = tmpfile();
+  guchar buffer[BUFSIZ];
+  size_t n;
+
+  if (!file) {
+    at_exception_type exp = at_exception_new(msg_func, msg_data);
+
+    at_exception_fatal(&exp, "cannot make a temporary file for the output");
+    return;
+  }
+  (*writer->func)(file, file_name, 0, 0, splines->width, splines->height, opts, *splines,
+                  msg_func, msg_data, writer->data);
+  rewind(file);
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    at_sink_write(sink, buffer, n);
+  fclose(file);
+}
+
+void at_splines_write_sink(at_spline_writer *writer, at_sink *sink, gchar *file_name,
+                           at_output_opts_type *opts, at_splines_type *splines,
+                           at_msg_func msg_func, gpointer msg_data)
 {
   gboolean new_opts = FALSE;
   int llx, lly, urx, ury;
+  numeric_locale_type locale;
+
   llx = 0;
   lly = 0;
   urx = splines->width;
@@ -347,13 +692,109 @@ void at_splines_write(at_spline_writer *writer, FILE *writeto, gchar *file_name,
     opts = at_output_opts_new();
   }
 
-  setlocale(LC_NUMERIC, "C");
-  (*writer->func)(writeto, file_name, llx, lly, urx, ury, opts, *splines, msg_func, msg_data,
-                  writer->data);
+  if (writer->begin) {
+    output_stream_type stream;
+
+    stream.writer = writer;
+    stream.sink = sink;
+    stream.name = file_name;
+    stream.opts = opts;
+    stream.msg_func = msg_func;
+    stream.msg_data = msg_data;
+    stream.begun = FALSE;
+    stream.state = NULL;
+    stream.stats = NULL;
+    end_output_stream(&stream, splines);
+  } else if (writer->sink_func)
+    (*writer->sink_func)(sink, file_name, llx, lly, urx, ury, opts, *splines, msg_func, msg_data,
+                         writer->data);
+  else {
+    use_c_numeric_locale(&locale);
+    if (at_sink_get_file(sink)) {
+      /* What the sink holds goes first */
+      at_sink_flush(sink);
+      (*writer->func)(at_sink_get_file(sink), file_name, llx, lly, urx, ury, opts, *splines,
+                      msg_func, msg_data, writer->data);
+    } else
+      write_through_file(writer, sink, file_name, opts, splines, msg_func, msg_data);
+    restore_numeric_locale(&locale);
+  }
+  at_sink_flush(sink);
   if (new_opts)
     at_output_opts_free(opts);
 }
 
+static void use_c_numeric_locale(numeric_locale_type *locale)
+{
+#ifdef HAVE_USELOCALE
+  /* Switch only the calling thread to the C locale, so that writers
+     running concurrently in other threads are not affected.  */
+  locale->old_locale = (locale_t)0;
+  locale->c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+  if (locale->c_locale != (locale_t)0)
+    locale->old_locale = uselocale(locale->c_locale);
+#else
+  setlocale(LC_NUMERIC, "C");
+#endif /* Def: HAVE_USELOCALE */
+}
+
+static void restore_numeric_locale(numeric_locale_type *locale)
+{
+#ifdef HAVE_USELOCALE
+  if (locale->c_locale != (locale_t)0) {
+    uselocale(locale->old_locale);
+    freelocale(locale->c_locale);
+  }
+#endif /* Def: HAVE_USELOCALE */
+}
+
+static void begin_output_stream(output_stream_type *stream, at_splines_type *shape)
+{
+  at_spline_writer *writer = stream->writer;
+
+  stream->state = writer->begin(stream->sink, stream->name, 0, 0, shape->width, shape->height,
+                                stream->opts, shape, stream->msg_func, stream->msg_data,
+                                writer->data);
+  stream->begun = TRUE;
+}
+
+/* The spline_list_func feeding a streaming writer while fitting */
+static void emit_spline_list(spline_list_array_type *shape, spline_list_type *list,
+                             gpointer data)
+{
+  output_stream_type *stream = data;
+  stage_mark_type mark;
+
+  stage_begin(stream->stats, &mark);
+  if (!stream->begun)
+    begin_output_stream(stream, shape);
+  if (stream->state)
+    stream->writer->list(stream->state, list);
+  stage_end(stream->stats, AT_STAGE_WRITE, &mark);
+}
+
+/* Write the spline lists of SPLINES, beginning the stream if nothing
+   has been written yet, and end it.  Return what the writer's end
+   function does, or -1 if it could not begin.  */
+static int end_output_stream(output_stream_type *stream, at_splines_type *splines)
+{
+  unsigned this_list;
+
+  if (!stream->begun) {
+    at_splines_type shape = *splines;
+
+    /* Writers are promised no lists at the beginning */
+    SPLINE_LIST_ARRAY_LENGTH(shape) = 0;
+    shape.data = NULL;
+    begin_output_stream(stream, &shape);
+  }
+  if (!stream->state)
+    return -1;
+  for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(*splines); this_list++)
+    stream->writer->list(stream->state, &SPLINE_LIST_ARRAY_ELT(*splines, this_list));
+  return stream->writer->end(stream->state);
+}
+
 void at_splines_free(at_splines_type *splines)
 {
   free_spline_list_array(splines);
@@ -377,8 +818,8 @@ const char *at_home_site(void)
 
 void autotrace_init(void)
 {
-  static int initialized = 0;
-  if (!initialized) {
+  static gsize initialized = 0;
+  if (g_once_init_enter(&initialized)) {
 #ifdef ENABLE_NLS
     setlocale(LC_ALL, "");
     bindtextdomain(PACKAGE, LOCALEDIR);
@@ -389,7 +830,7 @@ void autotrace_init(void)
     at_output_init();
     at_module_init();
 
-    initialized = 1;
+    g_once_init_leave(&initialized, 1);
   }
 }
 
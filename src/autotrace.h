@@ -47,6 +47,20 @@ enum _at_msg_type {
   AT_MSG_WARNING,
 };
 
+/* The stages of a trace, in the order they run; see at_trace_stats.
+   The first four run only when the options ask for them.  */
+enum _at_trace_stage {
+  AT_STAGE_DESPECKLE,
+  AT_STAGE_QUANTIZE,
+  AT_STAGE_DISTANCE_MAP, /* centerline with preserve_width or medial_axis */
+  AT_STAGE_THIN,         /* centerline without medial_axis */
+  AT_STAGE_OUTLINES,
+  AT_STAGE_SPLIT,
+  AT_STAGE_FIT,
+  AT_STAGE_WRITE, /* at_splines_new_write only */
+  AT_N_STAGES
+};
+
 typedef struct _at_fitting_opts_type at_fitting_opts_type;
 typedef struct _at_input_opts_type at_input_opts_type;
 typedef struct _at_output_opts_type at_output_opts_type;
@@ -57,6 +71,11 @@ typedef struct _at_spline_list_type at_spline_list_type;
 typedef struct _at_spline_list_array_type at_spline_list_array_type;
 #define at_splines_type at_spline_list_array_type
 typedef enum _at_msg_type at_msg_type;
+typedef enum _at_trace_stage at_trace_stage;
+typedef struct _at_stage_stats at_stage_stats;
+typedef struct _at_trace_stats at_trace_stats;
+typedef struct _at_tracer at_tracer;
+typedef struct _at_sink at_sink;
 
 /* A Bezier spline can be represented as four points in the real plane:
    a starting point, ending point, and two control points.  The
@@ -86,7 +105,7 @@ struct _at_spline_list_array_type {
   unsigned length;
 
   /* splines bbox */
-  unsigned short height, width;
+  unsigned int height, width;
 
   /* the values for following members are inherited from
      at_fitting_opts_type */
@@ -189,6 +208,23 @@ struct _at_fitting_opts_type {
 #define at_doc__width_weight_factor                                                                \
   N_("width-weight-factor <real>: weight factor for fitting the linewidth.")
   gfloat width_weight_factor;
+
+#define at_doc__threads                                                                            \
+  N_("threads <unsigned>: number of threads used to find and fit the "                             \
+     "outlines; 0 means one per processor; default is 1.")
+  unsigned threads;
+
+#define at_doc__medial_axis                                                                        \
+  N_("medial-axis: with centerline, find the center lines on the medial "                          \
+     "axis of a distance map, rather than by thinning each color; "                                \
+     "default thins.")
+  gboolean medial_axis;
+
+#define at_doc__reparameterize_iterations                                                          \
+  N_("reparameterize-iterations <unsigned>: when a fit is off by not much "                        \
+     "more than error-threshold, move the points along it toward the "                             \
+     "spline and fit again this many times before subdividing; default is 0.")
+  unsigned reparameterize_iterations;
 };
 
 struct _at_input_opts_type {
@@ -198,13 +234,52 @@ struct _at_input_opts_type {
 
 struct _at_output_opts_type {
   int dpi; /* DPI is used only in MIF output. */
+  gboolean compress; /* Compress the content of PDF output, if zlib is there. */
 };
 
+/* Up to libautotrace.so.3 the dimensions, here and in
+   at_spline_list_array_type, were unsigned short.  Widening them breaks
+   the ABI: there are no compatibility entry points, and binaries built
+   against libautotrace.so.3 must be rebuilt, or keep that library
+   installed.  Code that goes through at_bitmap_get_width and friends
+   rebuilds unchanged; it can tell which it is built against by
+   AT_BITMAP_MAX_DIMENSION.  */
+#define AT_BITMAP_MAX_DIMENSION G_MAXUINT
+
 struct _at_bitmap {
-  unsigned short height;
-  unsigned short width;
+  unsigned int height;
+  unsigned int width;
   unsigned char *bitmap;
   unsigned int np;
+  /* Bytes from the start of a row to the start of the next one */
+  unsigned int stride;
+  /* Releases BITMAP in at_bitmap_free; NULL if the caller keeps it */
+  GDestroyNotify destroy;
+};
+
+/* What one stage of a trace cost.  CPU time and peak memory are
+   those of the whole process, so they include the worker threads of
+   the stage, but also whatever else the process does meanwhile.  */
+struct _at_stage_stats {
+  gboolean run; /* FALSE if the options skipped the stage */
+  gint64 wall_usec;
+  gint64 cpu_usec;
+  /* How much the stage raised the peak resident memory of the
+     process.  0 if an earlier stage had already used as much, or if
+     the platform cannot tell.  */
+  guint64 peak_bytes;
+};
+
+/* Filled in by at_splines_new_stats and at_splines_new_write.  */
+struct _at_trace_stats {
+  at_stage_stats stages[AT_N_STAGES];
+  guint64 pixels_scanned; /* for outlines */
+  unsigned outlines;
+  unsigned curves;       /* after splitting the outlines at corners */
+  unsigned subdivisions; /* curves split again because no spline fitted */
+  unsigned splines;      /* emitted, of which... */
+  unsigned lines;
+  unsigned cubics;
 };
 
 typedef void (*at_msg_func)(const gchar *msg, at_msg_type msg_type, gpointer client_data);
@@ -215,6 +290,25 @@ typedef void (*at_msg_func)(const gchar *msg, at_msg_type msg_type, gpointer cli
 #define AUTOTRACE_INIT
 void autotrace_init(void);
 
+/*
+ * Thread safety
+ *
+ * Once autotrace_init has returned, reading a bitmap (at_bitmap_read),
+ * tracing it (at_splines_new, at_splines_new_full) and writing the
+ * result (at_splines_write) may be called from several threads at the
+ * same time, as long as the threads don't share the bitmap, spline,
+ * FILE or sink objects they work on.  Option objects are only read and may be
+ * shared.  The writers built in write numbers as in the C locale
+ * without touching the locale; for the writers to a FILE registered
+ * with at_output_add_handler, at_splines_write switches the numeric
+ * locale of the calling thread only, where the platform supports
+ * uselocale().
+ *
+ * Exceptions: the "ugs" writer takes font metrics left behind by the
+ * "gf" reader, and registering readers or writers
+ * (at_input_add_handler, at_output_add_handler) is not synchronized.
+ */
+
 /*
  * IO Handler typedefs
  */
@@ -279,26 +373,59 @@ void at_output_opts_free(at_output_opts_type *opts);
  * TODO: internal data access
  * --------------------------------------------------------------------- */
 
-/* There is two way to build at_bitmap.
+/* There is three way to build at_bitmap.
    1. Using input reader
-      Use at_bitmap_read.
-      at_input_get_handler_by_suffix or
-      at_input_get_handler will help you to get at_bitmap_reader.
+      Use at_bitmap_read, or at_bitmap_read_memory for an image
+      file already in memory.
+      at_input_get_handler_by_suffix,
+      at_input_get_handler or at_input_get_handler_by_magic
+      will help you to get at_bitmap_reader.
    2. Allocating a bitmap and rendering an image on it by yourself
       Use at_bitmap_new.
+   3. Wrapping pixels you already have in memory
+      Use at_bitmap_wrap.
 
-   In both case, you have to call at_bitmap_free when at_bitmap *
+   In all cases, you have to call at_bitmap_free when at_bitmap *
    data are no longer needed. */
 at_bitmap *at_bitmap_read(at_bitmap_reader *reader, gchar *filename, at_input_opts_type *opts,
                           at_msg_func msg_func, gpointer msg_data);
-at_bitmap *at_bitmap_new(unsigned short width, unsigned short height, unsigned int planes);
+
+/* at_bitmap_read_memory
+
+   Same as at_bitmap_read, but decode the SIZE bytes at DATA, which
+   hold what the file would.  The native readers and the Magick
+   readers decode DATA where it is; other readers are given a
+   temporary file holding it.  */
+at_bitmap *at_bitmap_read_memory(at_bitmap_reader *reader, const guchar *data, gsize size,
+                                 at_input_opts_type *opts, at_msg_func msg_func,
+                                 gpointer msg_data);
+at_bitmap *at_bitmap_new(unsigned int width, unsigned int height, unsigned int planes);
+
+/* at_bitmap_wrap
+
+   Return a bitmap using DATA as its pixels, without copying them.
+   Row N starts at DATA + N * STRIDE; each pixel is PLANES bytes
+   (1 for gray scale, 3 for RGB).  A STRIDE of 0 means rows are
+   tightly packed.
+
+   at_bitmap_free calls DESTROY_NOTIFY on DATA, if it is not NULL;
+   otherwise DATA stays owned by the caller and must outlive the
+   bitmap.
+
+   at_splines_new modifies the pixels like it does for any bitmap if
+   its rows are tightly packed.  Otherwise despeckling, color
+   reduction and centerline tracing work on a packed copy, and DATA is
+   left as it is.  */
+at_bitmap *at_bitmap_wrap(unsigned char *data, unsigned int width, unsigned int height,
+                          unsigned int planes, unsigned int stride,
+                          GDestroyNotify destroy_notify);
 at_bitmap *at_bitmap_copy(const at_bitmap *src);
 
 /* We have to export functions that supports internal datum
    access. Such functions might be useful for
    at_bitmap_new user. */
-unsigned short at_bitmap_get_width(const at_bitmap *bitmap);
-unsigned short at_bitmap_get_height(const at_bitmap *bitmap);
+unsigned int at_bitmap_get_width(const at_bitmap *bitmap);
+unsigned int at_bitmap_get_height(const at_bitmap *bitmap);
 unsigned short at_bitmap_get_planes(const at_bitmap *bitmap);
 void at_bitmap_get_color(const at_bitmap *bitmap, unsigned int row, unsigned int col,
                          at_color *color);
@@ -317,7 +444,7 @@ void at_bitmap_free(at_bitmap *bitmap);
 
    BITMAP is modified in at_splines_new according to opts. Therefore
    if you need the original bitmap image, you have to make a backup of
-   BITMAP with using at_bitmap_copy.
+   BITMAP with using at_bitmap_copy, or use at_splines_new_const.
 
    MSG_FUNC and MSG_DATA are used to notify a client errors and
    warning from autotrace. NULL is valid value for MSG_FUNC if
@@ -353,10 +480,107 @@ at_splines_type *at_splines_new_full(at_bitmap *bitmap, at_fitting_opts_type *op
                                      at_progress_func notify_progress, gpointer progress_data,
                                      at_testcancel_func test_cancel, gpointer testcancel_data);
 
+/* at_splines_new_const
+
+   Same as at_splines_new_full, but BITMAP is left untouched.  When
+   despeckling, color reduction or centerline tracing are asked for,
+   they work on a copy of BITMAP made for the time of the call;
+   otherwise nothing is copied.  Use this instead of at_bitmap_copy
+   followed by at_splines_new_full when you need the original image
+   afterwards.  */
+at_splines_type *at_splines_new_const(const at_bitmap *bitmap, at_fitting_opts_type *opts,
+                                      at_msg_func msg_func, gpointer msg_data,
+                                      at_progress_func notify_progress, gpointer progress_data,
+                                      at_testcancel_func test_cancel, gpointer testcancel_data);
+
+/* at_splines_new_stats
+
+   Same as at_splines_new_full, and fill STATS in with what each stage
+   of the trace cost.  Stages that did not run are left zero.  Keeping
+   the figures costs a few system calls per stage; at_splines_new_full
+   does not.  */
+at_splines_type *at_splines_new_stats(at_bitmap *bitmap, at_fitting_opts_type *opts,
+                                      at_trace_stats *stats, at_msg_func msg_func,
+                                      gpointer msg_data, at_progress_func notify_progress,
+                                      gpointer progress_data, at_testcancel_func test_cancel,
+                                      gpointer testcancel_data);
+
+/* Return the name of STAGE, such as "fit", or NULL.  */
+const char *at_trace_stage_name(at_trace_stage stage);
+
+/* at_tracer_new
+
+   Make a tracer, which keeps the large buffers a trace works in (the
+   marks of the outline scan, the despeckling mask, the color
+   histogram, the thinning copy and the distance map) from one
+   at_tracer_trace to the next, instead of allocating and clearing
+   them anew for each image.  The buffers grow to fit the largest
+   image traced, and are released by at_tracer_free.
+
+   A tracer must not be used by two threads at the same time; give
+   each thread its own.  */
+at_tracer *at_tracer_new(void);
+void at_tracer_free(at_tracer *tracer);
+
+/* at_tracer_trace
+
+   Same as at_splines_new_full, with the buffers of TRACER.  If STATS
+   is not NULL, it is filled in as at_splines_new_stats does.  */
+at_splines_type *at_tracer_trace(at_tracer *tracer, at_bitmap *bitmap, at_fitting_opts_type *opts,
+                                 at_trace_stats *stats, at_msg_func msg_func, gpointer msg_data,
+                                 at_progress_func notify_progress, gpointer progress_data,
+                                 at_testcancel_func test_cancel, gpointer testcancel_data);
+
 void at_splines_write(at_spline_writer *writer, FILE *writeto, gchar *file_name,
                       at_output_opts_type *opts, at_splines_type *splines, at_msg_func msg_func,
                       gpointer msg_data);
 
+/* at_splines_write_sink
+
+   Same as at_splines_write, to SINK (see sink.h), which is flushed at
+   the end.  With a buffer or callback sink, nothing touches the file
+   system unless WRITER was registered with at_output_add_handler and
+   only writes to a FILE.  at_sink_failed tells whether all of the
+   output was taken.  */
+void at_splines_write_sink(at_spline_writer *writer, at_sink *sink, gchar *file_name,
+                           at_output_opts_type *opts, at_splines_type *splines,
+                           at_msg_func msg_func, gpointer msg_data);
+
+/* at_splines_new_write
+
+   Trace BITMAP as at_splines_new_full does and write the result with
+   WRITER to WRITETO as at_splines_write does, without keeping the
+   whole result in memory.  With a streaming writer (svg, eps, ai,
+   pdf and p2e), each spline list is written as soon as it is fitted
+   and freed right after; other writers get the full result at the end.
+
+   If tracing fails or is canceled after the first spline list, the
+   output is ended where it has got to.
+
+   If STATS is not NULL, it is filled in as at_splines_new_stats does,
+   with the time spent in WRITER counted in the write stage rather
+   than in the fitting.
+
+   return value:
+   TRUE if BITMAP was traced and written. */
+gboolean at_splines_new_write(at_bitmap *bitmap, at_fitting_opts_type *opts,
+                              at_spline_writer *writer, FILE *writeto, gchar *file_name,
+                              at_output_opts_type *output_opts, at_trace_stats *stats,
+                              at_msg_func msg_func, gpointer msg_data,
+                              at_progress_func notify_progress, gpointer progress_data,
+                              at_testcancel_func test_cancel, gpointer testcancel_data);
+
+/* at_splines_new_write_sink
+
+   Same as at_splines_new_write, to SINK, as at_splines_write_sink
+   writes.  Also returns FALSE if SINK has failed.  */
+gboolean at_splines_new_write_sink(at_bitmap *bitmap, at_fitting_opts_type *opts,
+                                   at_spline_writer *writer, at_sink *sink, gchar *file_name,
+                                   at_output_opts_type *output_opts, at_trace_stats *stats,
+                                   at_msg_func msg_func, gpointer msg_data,
+                                   at_progress_func notify_progress, gpointer progress_data,
+                                   at_testcancel_func test_cancel, gpointer testcancel_data);
+
 void at_splines_free(at_splines_type *splines);
 
 /* --------------------------------------------------------------------- *
@@ -365,6 +589,12 @@ void at_splines_free(at_splines_type *splines);
 at_bitmap_reader *at_input_get_handler(gchar *filename);
 at_bitmap_reader *at_input_get_handler_by_suffix(gchar *suffix);
 
+/* at_input_get_handler_by_magic
+   Return the reader for the format of the SIZE bytes at DATA, the
+   start of an image file, as told by its magic number; or NULL if
+   no format is recognized or none of its readers is installed. */
+at_bitmap_reader *at_input_get_handler_by_magic(const guchar *data, gsize size);
+
 const char **at_input_list_new(void);
 void at_input_list_free(const char **list);
 
@@ -0,0 +1,692 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* batch.c: converting many files in one run of autotrace. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* Def: HAVE_CONFIG_H */
+
+#include "batch.h"
+#include "filename.h"
+#include "trace-stats.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* How a file of the batch fared */
+typedef enum { JOB_PENDING, JOB_OK, JOB_FAILED } job_status_type;
+
+/* The stages of the pipeline */
+typedef enum { PIPE_READ, PIPE_TRACE, PIPE_WRITE, N_PIPE_STAGES } pipe_stage_type;
+
+typedef struct {
+  const char *input;
+  gchar *output;
+  job_status_type status;
+  /* Why the file failed: the first fatal message */
+  gchar *error;
+  gdouble seconds;
+  unsigned width, height;
+  gboolean traced;
+  at_trace_stats stats;
+  /* In the pipeline: what is passed on to the next stage, how many
+     stages the file went through, and the time each took on it.  */
+  at_bitmap *bitmap;
+  at_splines_type *splines;
+  unsigned stages_done;
+  gint64 stage_usec[N_PIPE_STAGES];
+} batch_job_type;
+
+typedef struct {
+  batch_opts_type *opts;
+  batch_job_type *jobs;
+} batch_type;
+
+/* A queue of at most CAPACITY jobs between two stages of the
+   pipeline.  It is closed once all of the PRODUCERS feeding it are
+   done.  */
+typedef struct {
+  GQueue jobs;
+  unsigned capacity;
+  unsigned producers;
+  GMutex lock;
+  GCond not_empty;
+  GCond not_full;
+  /* For the report: the length of the queue summed over time since
+     START, in job microseconds, the longest it got, and how long the
+     stages before and after it waited on it being full or empty.  */
+  gint64 start, since, length_usec;
+  unsigned max_length;
+  gint64 full_usec, empty_usec;
+} stage_queue_type;
+
+typedef struct {
+  batch_opts_type *opts;
+  batch_job_type *jobs;
+  unsigned n_jobs;
+  stage_queue_type decoded; /* from the reader to the tracers */
+  stage_queue_type traced;  /* from the tracers to the writer */
+} pipeline_type;
+
+const char *batch_check_template(const char *template)
+{
+  const char *c;
+
+  if (!template || !*template)
+    return "the output name template is empty";
+  for (c = template; *c; c++) {
+    if (*c != '%')
+      continue;
+    c++;
+    if (*c != 'n' && *c != 'f' && *c != 'i' && *c != '%')
+      return "the output name template may only use %n, %f, %i and %%";
+  }
+  return NULL;
+}
+
+/* Return the output name TEMPLATE gives for INPUT, the INDEXth file of
+   the batch, counting from 0.  */
+static gchar *expand_template(const char *template, const char *input, unsigned index,
+                              const char *suffix)
+{
+  GString *name = g_string_new(NULL);
+  const char *c;
+
+  for (c = template; *c; c++) {
+    if (*c != '%') {
+      g_string_append_c(name, *c);
+      continue;
+    }
+    switch (*++c) {
+    case 'n': {
+      gchar *root = remove_suffix(input);
+
+      g_string_append(name, root);
+      g_free(root);
+      break;
+    }
+    case 'f':
+      g_string_append(name, suffix);
+      break;
+    case 'i':
+      g_string_append_printf(name, "%u", index + 1);
+      break;
+    default:
+      g_string_append_c(name, '%');
+      break;
+    }
+  }
+  return g_string_free(name, FALSE);
+}
+
+static gboolean can_read(const char *name, at_bitmap_reader *input_reader)
+{
+  gchar *name_copy;
+  gboolean readable;
+
+  if (input_reader)
+    return TRUE;
+  name_copy = g_strdup(name);
+  readable = at_input_get_handler(name_copy) != NULL;
+  g_free(name_copy);
+  return readable;
+}
+
+static gint compare_names(gconstpointer a, gconstpointer b)
+{
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+gboolean batch_add_input(GPtrArray *inputs, const char *arg, at_bitmap_reader *input_reader)
+{
+  GPtrArray *files;
+  GDir *dir;
+  const gchar *entry;
+  unsigned i;
+
+  /* A file that cannot be read fails on its own, like any other */
+  if (!g_file_test(arg, G_FILE_TEST_IS_DIR)) {
+    g_ptr_array_add(inputs, g_strdup(arg));
+    return TRUE;
+  }
+
+  dir = g_dir_open(arg, 0, NULL);
+  if (!dir)
+    return FALSE;
+  /* Only the files that can be read: a directory of scans may well
+     hold a few notes or thumbnails too.  */
+  files = g_ptr_array_new();
+  while ((entry = g_dir_read_name(dir)) != NULL) {
+    gchar *path = g_build_filename(arg, entry, NULL);
+
+    if (g_file_test(path, G_FILE_TEST_IS_REGULAR) && can_read(path, input_reader))
+      g_ptr_array_add(files, path);
+    else
+      g_free(path);
+  }
+  g_dir_close(dir);
+  g_ptr_array_sort(files, compare_names);
+  for (i = 0; i < files->len; i++)
+    g_ptr_array_add(inputs, g_ptr_array_index(files, i));
+  g_ptr_array_free(files, TRUE);
+  return TRUE;
+}
+
+gboolean batch_add_manifest(GPtrArray *inputs, const char *manifest)
+{
+  FILE *file = strcmp(manifest, "-") ? fopen(manifest, "r") : stdin;
+  char *line = NULL;
+  size_t size = 0;
+  ssize_t length;
+  gboolean ok;
+
+  if (!file)
+    return FALSE;
+  while ((length = getline(&line, &size, file)) != -1) {
+    /* Only the line terminator: names may end in spaces */
+    if (length > 0 && line[length - 1] == '\n')
+      line[--length] = '\0';
+    if (length > 0 && line[length - 1] == '\r')
+      line[--length] = '\0';
+    if (line[0] == '\0' || line[0] == '#')
+      continue;
+    g_ptr_array_add(inputs, g_strdup(line));
+  }
+  free(line);
+  ok = !ferror(file);
+  if (file != stdin)
+    fclose(file);
+  return ok;
+}
+
+/* Keep the first fatal message of a job, and pass warnings on.  */
+static void job_message(const gchar *msg, at_msg_type msg_type, gpointer client_data)
+{
+  batch_job_type *job = client_data;
+
+  if (msg_type == AT_MSG_FATAL) {
+    if (!job->error)
+      job->error = g_strdup(msg);
+  } else
+    fprintf(stderr, "%s: %s\n", job->input, msg);
+}
+
+static void fail_job(batch_job_type *job, const char *error)
+{
+  if (!job->error)
+    job->error = g_strdup(error);
+  job->status = JOB_FAILED;
+}
+
+/* Return the bitmap read from the input of JOB, or NULL if JOB
+   failed.  */
+static at_bitmap *read_input(batch_opts_type *opts, batch_job_type *job)
+{
+  at_bitmap_reader *reader = opts->input_reader;
+  at_bitmap *bitmap;
+
+  if (!reader) {
+    gchar *input = g_strdup(job->input);
+
+    reader = at_input_get_handler(input);
+    g_free(input);
+    if (!reader) {
+      fail_job(job, "unsupported input format");
+      return NULL;
+    }
+  }
+
+  bitmap = at_bitmap_read(reader, (gchar *)job->input, opts->input_opts, job_message, job);
+  if (job->error) {
+    at_bitmap_free(bitmap);
+    fail_job(job, NULL);
+    return NULL;
+  }
+  job->width = at_bitmap_get_width(bitmap);
+  job->height = at_bitmap_get_height(bitmap);
+  return bitmap;
+}
+
+/* Close FILE, the output of JOB, which was WRITTEN in full or not.  */
+static void close_output(batch_job_type *job, FILE *file, gboolean written)
+{
+  job->traced = written && !job->error;
+  if (fclose(file) != 0 && !job->error)
+    job->error = g_strdup(g_strerror(errno));
+  if (!job->traced || job->error) {
+    /* Leave no truncated output behind */
+    remove(job->output);
+    fail_job(job, "cannot trace or write the image");
+  } else
+    job->status = JOB_OK;
+}
+
+/* Read, trace and write the input of JOB.  */
+static void convert(batch_opts_type *opts, batch_job_type *job)
+{
+  at_bitmap *bitmap = read_input(opts, job);
+  FILE *file;
+  gboolean written;
+
+  if (!bitmap)
+    return;
+  file = fopen(job->output, "wb");
+  if (!file) {
+    at_bitmap_free(bitmap);
+    fail_job(job, g_strerror(errno));
+    return;
+  }
+  written = at_splines_new_write(bitmap, opts->fitting_opts, opts->output_writer, file,
+                                 job->output, opts->output_opts,
+                                 opts->stats_name ? &job->stats : NULL, job_message, job, NULL,
+                                 NULL, NULL, NULL);
+  at_bitmap_free(bitmap);
+  close_output(job, file, written);
+}
+
+static void batch_worker(gpointer data, gpointer user_data)
+{
+  batch_type *batch = user_data;
+  batch_job_type *job = &batch->jobs[GPOINTER_TO_UINT(data) - 1];
+  gint64 start = g_get_monotonic_time();
+
+  convert(batch->opts, job);
+  job->seconds = (g_get_monotonic_time() - start) / (gdouble)G_USEC_PER_SEC;
+}
+
+static void queue_init(stage_queue_type *queue, unsigned capacity, unsigned producers)
+{
+  g_queue_init(&queue->jobs);
+  queue->capacity = capacity;
+  queue->producers = producers;
+  g_mutex_init(&queue->lock);
+  g_cond_init(&queue->not_empty);
+  g_cond_init(&queue->not_full);
+  queue->start = queue->since = g_get_monotonic_time();
+  queue->length_usec = 0;
+  queue->max_length = 0;
+  queue->full_usec = queue->empty_usec = 0;
+}
+
+static void queue_clear(stage_queue_type *queue)
+{
+  g_queue_clear(&queue->jobs);
+  g_mutex_clear(&queue->lock);
+  g_cond_clear(&queue->not_empty);
+  g_cond_clear(&queue->not_full);
+}
+
+/* Add the time the queue has had its present length to LENGTH_USEC,
+   before the length changes.  Called with the lock held.  */
+static void queue_tally(stage_queue_type *queue)
+{
+  gint64 now = g_get_monotonic_time();
+
+  queue->length_usec += (now - queue->since) * queue->jobs.length;
+  queue->since = now;
+}
+
+/* Add JOB to QUEUE, once there is room for it.  */
+static void queue_push(stage_queue_type *queue, batch_job_type *job)
+{
+  g_mutex_lock(&queue->lock);
+  if (queue->jobs.length >= queue->capacity) {
+    gint64 start = g_get_monotonic_time();
+
+    while (queue->jobs.length >= queue->capacity)
+      g_cond_wait(&queue->not_full, &queue->lock);
+    queue->full_usec += g_get_monotonic_time() - start;
+  }
+  queue_tally(queue);
+  g_queue_push_tail(&queue->jobs, job);
+  queue->max_length = MAX(queue->max_length, queue->jobs.length);
+  g_cond_signal(&queue->not_empty);
+  g_mutex_unlock(&queue->lock);
+}
+
+/* Take the next job out of QUEUE, waiting for one if need be.  Return
+   NULL once QUEUE is closed and empty.  */
+static batch_job_type *queue_pop(stage_queue_type *queue)
+{
+  batch_job_type *job = NULL;
+
+  g_mutex_lock(&queue->lock);
+  if (!queue->jobs.length && queue->producers) {
+    gint64 start = g_get_monotonic_time();
+
+    while (!queue->jobs.length && queue->producers)
+      g_cond_wait(&queue->not_empty, &queue->lock);
+    queue->empty_usec += g_get_monotonic_time() - start;
+  }
+  if (queue->jobs.length) {
+    queue_tally(queue);
+    job = g_queue_pop_head(&queue->jobs);
+    g_cond_signal(&queue->not_full);
+  }
+  g_mutex_unlock(&queue->lock);
+  return job;
+}
+
+/* Tell QUEUE that one of its producers is done.  */
+static void queue_close(stage_queue_type *queue)
+{
+  g_mutex_lock(&queue->lock);
+  if (--queue->producers == 0)
+    g_cond_broadcast(&queue->not_empty);
+  g_mutex_unlock(&queue->lock);
+}
+
+/* The first stage of the pipeline: read the inputs in order.  */
+static gpointer pipeline_read(gpointer data)
+{
+  pipeline_type *pipeline = data;
+  unsigned i;
+
+  for (i = 0; i < pipeline->n_jobs; i++) {
+    batch_job_type *job = &pipeline->jobs[i];
+    gint64 start;
+
+    if (job->status != JOB_PENDING)
+      continue;
+    start = g_get_monotonic_time();
+    job->bitmap = read_input(pipeline->opts, job);
+    job->stage_usec[PIPE_READ] = g_get_monotonic_time() - start;
+    if (job->bitmap) {
+      job->stages_done++;
+      queue_push(&pipeline->decoded, job);
+    }
+  }
+  queue_close(&pipeline->decoded);
+  return NULL;
+}
+
+/* The second stage, run by as many threads as OPTS->jobs says: trace
+   the bitmaps that have been read.  */
+static gpointer pipeline_trace(gpointer data)
+{
+  pipeline_type *pipeline = data;
+  batch_opts_type *opts = pipeline->opts;
+  batch_job_type *job;
+  /* The files of a batch are often of one size: keep the scratch
+     buffers of each trace for the next */
+  at_tracer *tracer = at_tracer_new();
+
+  while ((job = queue_pop(&pipeline->decoded)) != NULL) {
+    gint64 start = g_get_monotonic_time();
+
+    job->splines = at_tracer_trace(tracer, job->bitmap, opts->fitting_opts,
+                                   opts->stats_name ? &job->stats : NULL, job_message, job, NULL,
+                                   NULL, NULL, NULL);
+    at_bitmap_free(job->bitmap);
+    job->bitmap = NULL;
+    job->stage_usec[PIPE_TRACE] = g_get_monotonic_time() - start;
+    if (!job->splines || job->error) {
+      if (job->splines)
+        at_splines_free(job->splines);
+      job->splines = NULL;
+      fail_job(job, "cannot trace the image");
+      continue;
+    }
+    job->stages_done++;
+    queue_push(&pipeline->traced, job);
+  }
+  queue_close(&pipeline->traced);
+  at_tracer_free(tracer);
+  return NULL;
+}
+
+/* The last stage: write what has been traced.  */
+static void pipeline_write(pipeline_type *pipeline)
+{
+  batch_opts_type *opts = pipeline->opts;
+  batch_job_type *job;
+
+  while ((job = queue_pop(&pipeline->traced)) != NULL) {
+    gint64 start = g_get_monotonic_time();
+    FILE *file = fopen(job->output, "wb");
+
+    if (!file)
+      fail_job(job, g_strerror(errno));
+    else {
+      at_trace_stats *stats = opts->stats_name ? &job->stats : NULL;
+      stage_mark_type mark;
+
+      stage_begin(stats, &mark);
+      at_splines_write(opts->output_writer, file, job->output, opts->output_opts, job->splines,
+                       job_message, job);
+      stage_end(stats, AT_STAGE_WRITE, &mark);
+      close_output(job, file, TRUE);
+    }
+    at_splines_free(job->splines);
+    job->splines = NULL;
+    job->stage_usec[PIPE_WRITE] = g_get_monotonic_time() - start;
+    if (job->status == JOB_OK)
+      job->stages_done++;
+  }
+}
+
+/* Convert the N_JOBS JOBS in a pipeline of a reading thread, N_TRACERS
+   tracing threads and a writing one, which is the calling thread.
+   Return the time it took, in microseconds.  */
+static gint64 run_pipeline(pipeline_type *pipeline, batch_opts_type *opts, batch_job_type *jobs,
+                           unsigned n_jobs, unsigned n_tracers)
+{
+  GThread *reader, **tracers = g_new(GThread *, n_tracers);
+  gint64 start = g_get_monotonic_time();
+  unsigned i;
+
+  pipeline->opts = opts;
+  pipeline->jobs = jobs;
+  pipeline->n_jobs = n_jobs;
+  queue_init(&pipeline->decoded, opts->decode_queue, 1);
+  queue_init(&pipeline->traced, opts->write_queue, n_tracers);
+
+  reader = g_thread_new("batch-read", pipeline_read, pipeline);
+  for (i = 0; i < n_tracers; i++)
+    tracers[i] = g_thread_new("batch-trace", pipeline_trace, pipeline);
+  pipeline_write(pipeline);
+  g_thread_join(reader);
+  for (i = 0; i < n_tracers; i++)
+    g_thread_join(tracers[i]);
+  g_free(tracers);
+
+  queue_clear(&pipeline->decoded);
+  queue_clear(&pipeline->traced);
+  for (i = 0; i < n_jobs; i++) {
+    batch_job_type *job = &jobs[i];
+    gint64 busy = job->stage_usec[PIPE_READ] + job->stage_usec[PIPE_TRACE] +
+                  job->stage_usec[PIPE_WRITE];
+
+    job->seconds = busy / (gdouble)G_USEC_PER_SEC;
+  }
+  return MAX(g_get_monotonic_time() - start, 1);
+}
+
+/* Print how many files each stage of PIPELINE passed on, and how
+   fast, how much of the ELAPSED time its N_THREADS threads were busy,
+   and how full each queue was on average and at most, and how long
+   the stages on either side waited on it.  */
+static void report_pipeline(pipeline_type *pipeline, unsigned n_tracers, gint64 elapsed)
+{
+  static const char *const stage_names[N_PIPE_STAGES] = {"read", "trace", "write"};
+  const unsigned n_threads[N_PIPE_STAGES] = {1, n_tracers, 1};
+  stage_queue_type *queues[2] = {&pipeline->decoded, &pipeline->traced};
+  static const char *const queue_names[2] = {"decoded", "traced"};
+  gdouble seconds = elapsed / (gdouble)G_USEC_PER_SEC;
+  unsigned stage, i;
+
+  printf("\nstage    threads  files  files/s  Mpixel/s  busy\n");
+  for (stage = 0; stage < N_PIPE_STAGES; stage++) {
+    unsigned n_files = 0;
+    gdouble pixels = 0;
+    gint64 busy = 0;
+
+    for (i = 0; i < pipeline->n_jobs; i++) {
+      batch_job_type *job = &pipeline->jobs[i];
+
+      busy += job->stage_usec[stage];
+      if (job->stages_done > stage) {
+        n_files++;
+        pixels += (gdouble)job->width * job->height;
+      }
+    }
+    printf("%-8s %7u  %5u  %7.2f  %8.2f  %3.0f%%\n", stage_names[stage], n_threads[stage],
+           n_files, n_files / seconds, pixels / 1e6 / seconds,
+           100.0 * busy / ((gdouble)elapsed * n_threads[stage]));
+  }
+  printf("\nqueue    depth   mean  max  full s  empty s\n");
+  for (i = 0; i < 2; i++)
+    printf("%-8s %5u  %5.2f  %3u  %6.3f  %7.3f\n", queue_names[i], queues[i]->capacity,
+           queues[i]->length_usec / (gdouble)elapsed, queues[i]->max_length,
+           queues[i]->full_usec / (gdouble)G_USEC_PER_SEC,
+           queues[i]->empty_usec / (gdouble)G_USEC_PER_SEC);
+  printf("\n");
+}
+
+void write_json_string(FILE *file, const char *string)
+{
+  const unsigned char *c;
+
+  fputc('"', file);
+  for (c = (const unsigned char *)string; *c; c++) {
+    if (*c == '"' || *c == '\\')
+      fprintf(file, "\\%c", *c);
+    else if (*c < 0x20)
+      fprintf(file, "\\u%04x", *c);
+    else
+      fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+void write_stats_members(FILE *file, const char *indent, unsigned width, unsigned height,
+                         gboolean traced, at_trace_stats *stats)
+{
+  const char *separator = "";
+  int stage;
+
+  fprintf(file, ",\n%s\"width\": %u,\n%s\"height\": %u", indent, width, indent, height);
+  fprintf(file, ",\n%s\"traced\": %s", indent, traced ? "true" : "false");
+  fprintf(file, ",\n%s\"pixels_scanned\": %" G_GUINT64_FORMAT, indent, stats->pixels_scanned);
+  fprintf(file, ",\n%s\"outlines\": %u,\n%s\"curves\": %u,\n%s\"subdivisions\": %u", indent,
+          stats->outlines, indent, stats->curves, indent, stats->subdivisions);
+  fprintf(file, ",\n%s\"splines\": %u,\n%s\"lines\": %u,\n%s\"cubics\": %u", indent,
+          stats->splines, indent, stats->lines, indent, stats->cubics);
+  fprintf(file, ",\n%s\"stages\": {", indent);
+  for (stage = 0; stage < AT_N_STAGES; stage++) {
+    at_stage_stats *stage_stats = &stats->stages[stage];
+
+    if (!stage_stats->run)
+      continue;
+    fprintf(file,
+            "%s\n%s  \"%s\": {\"wall_usec\": %" G_GINT64_FORMAT ", \"cpu_usec\": %" G_GINT64_FORMAT
+            ", \"peak_bytes\": %" G_GUINT64_FORMAT "}",
+            separator, indent, at_trace_stage_name(stage), stage_stats->wall_usec,
+            stage_stats->cpu_usec, stage_stats->peak_bytes);
+    separator = ",";
+  }
+  fprintf(file, "\n%s}", indent);
+}
+
+/* Write the figures of the N_JOBS JOBS to the -stats-json file, as an
+   array of objects in the order of the inputs.  */
+static gboolean write_batch_stats(const char *name, batch_job_type *jobs, unsigned n_jobs)
+{
+  FILE *file = fopen(name, "w");
+  unsigned i;
+
+  if (!file)
+    return FALSE;
+  fputs("[", file);
+  for (i = 0; i < n_jobs; i++) {
+    batch_job_type *job = &jobs[i];
+
+    fputs(i ? ",\n  {\n    \"input\": " : "\n  {\n    \"input\": ", file);
+    write_json_string(file, job->input);
+    fputs(",\n    \"output\": ", file);
+    write_json_string(file, job->output);
+    fprintf(file, ",\n    \"status\": \"%s\"", job->status == JOB_OK ? "ok" : "failed");
+    if (job->error) {
+      fputs(",\n    \"error\": ", file);
+      write_json_string(file, job->error);
+    }
+    fprintf(file, ",\n    \"seconds\": %.6f", job->seconds);
+    write_stats_members(file, "    ", job->width, job->height, job->traced, &job->stats);
+    fputs("\n  }", file);
+  }
+  fputs("\n]\n", file);
+  return fclose(file) == 0;
+}
+
+unsigned run_batch(batch_opts_type *opts, GPtrArray *inputs)
+{
+  unsigned n_jobs = inputs->len, i, n_failed = 0;
+  unsigned n_threads = opts->jobs ? opts->jobs : g_get_num_processors();
+  GHashTable *outputs = g_hash_table_new(g_str_hash, g_str_equal);
+  GThreadPool *workers;
+  batch_type batch;
+  pipeline_type pipeline;
+  gint64 elapsed = 0;
+
+  batch.opts = opts;
+  batch.jobs = g_new0(batch_job_type, n_jobs);
+
+  for (i = 0; i < n_jobs; i++) {
+    batch_job_type *job = &batch.jobs[i];
+    gchar *name = expand_template(opts->name_template, g_ptr_array_index(inputs, i), i,
+                                  opts->output_suffix);
+
+    job->input = g_ptr_array_index(inputs, i);
+    job->output = g_build_filename(opts->output_dir, name, NULL);
+    g_free(name);
+    /* Two inputs must not overwrite each other's output */
+    if (g_hash_table_contains(outputs, job->output))
+      fail_job(job, "another input has the same output name");
+    else
+      g_hash_table_add(outputs, job->output);
+  }
+  g_hash_table_destroy(outputs);
+
+  n_threads = MAX(1, MIN(n_threads, n_jobs));
+  if (opts->pipeline)
+    elapsed = run_pipeline(&pipeline, opts, batch.jobs, n_jobs, n_threads);
+  else {
+    workers = g_thread_pool_new(batch_worker, &batch, n_threads, TRUE, NULL);
+    for (i = 0; i < n_jobs; i++) {
+      if (batch.jobs[i].status == JOB_PENDING)
+        g_thread_pool_push(workers, GUINT_TO_POINTER(i + 1), NULL);
+    }
+    g_thread_pool_free(workers, FALSE, TRUE);
+  }
+
+  for (i = 0; i < n_jobs; i++) {
+    batch_job_type *job = &batch.jobs[i];
+
+    if (job->status == JOB_OK)
+      printf("ok      %8.3fs  %s -> %s\n", job->seconds, job->input, job->output);
+    else {
+      printf("FAILED  %8.3fs  %s: %s\n", job->seconds, job->input, job->error);
+      n_failed++;
+    }
+  }
+  if (opts->pipeline)
+    report_pipeline(&pipeline, n_threads, elapsed);
+  printf("%u files: %u converted, %u failed\n", n_jobs, n_jobs - n_failed, n_failed);
+
+  if (opts->stats_name && !write_batch_stats(opts->stats_name, batch.jobs, n_jobs)) {
+    perror(opts->stats_name);
+    n_failed++;
+  }
+
+  for (i = 0; i < n_jobs; i++) {
+    g_free(batch.jobs[i].output);
+    g_free(batch.jobs[i].error);
+  }
+  g_free(batch.jobs);
+  return n_failed;
+}
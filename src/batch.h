@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* batch.h: converting many files in one run of autotrace. */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <glib.h>
+
+#include "autotrace.h"
+
+/* What a batch is to do with each of its inputs.  Everything is only
+   read, by all the workers at once.  */
+typedef struct {
+  at_fitting_opts_type *fitting_opts;
+  at_input_opts_type *input_opts;
+  at_output_opts_type *output_opts;
+  /* NULL to choose by the suffix of each input */
+  at_bitmap_reader *input_reader;
+  at_spline_writer *output_writer;
+  /* The suffix of the output format, for %f */
+  const char *output_suffix;
+  const char *output_dir;
+  /* See batch_check_template */
+  const char *name_template;
+  /* Files converted at the same time; 0 means one per processor.
+     With PIPELINE, the number of files traced at the same time.  */
+  unsigned jobs;
+  /* Read, trace and write in stages of their own, which pass the
+     files on through queues of at most DECODE_QUEUE bitmaps and
+     WRITE_QUEUE traced results.  */
+  gboolean pipeline;
+  unsigned decode_queue;
+  unsigned write_queue;
+  /* Where to write the figures of each trace as JSON, or NULL */
+  const char *stats_name;
+} batch_opts_type;
+
+/* Return an error message if TEMPLATE is not a valid output name
+   template, or NULL.  In a template, %n stands for the name of the
+   input without its directory and suffix, %f for the suffix of the
+   output format, %i for the position of the input in the batch,
+   counting from 1, and %% for %.  */
+extern const char *batch_check_template(const char *template);
+
+/* Add the inputs named by ARG to INPUTS: the files in it that can be
+   read, in sorted order, if it is a directory, and otherwise ARG
+   itself.  Return FALSE if the directory cannot be listed.  */
+extern gboolean batch_add_input(GPtrArray *inputs, const char *arg,
+                                at_bitmap_reader *input_reader);
+
+/* Add the inputs listed in MANIFEST, one per line of any length, to
+   INPUTS.  Only the line terminator is taken off, so names may begin
+   or end with spaces.  Empty lines and lines starting with # are
+   skipped.  A MANIFEST of "-" is read from the standard input.  Return
+   FALSE if it cannot be opened or a read fails.  */
+extern gboolean batch_add_manifest(GPtrArray *inputs, const char *manifest);
+
+/* Convert each of INPUTS as OPTS say, carrying on past the files that
+   fail, and print the status of each file when all are done, followed
+   by how busy each stage and queue was if OPTS->pipeline.  Return the
+   number of files that failed.  */
+extern unsigned run_batch(batch_opts_type *opts, GPtrArray *inputs);
+
+/* Write STRING as a JSON string.  */
+extern void write_json_string(FILE *file, const char *string);
+
+/* Write the members of a JSON object for STATS, the figures of
+   tracing a WIDTH x HEIGHT bitmap, each after a comma and a new line
+   and indented by INDENT.  */
+extern void write_stats_members(FILE *file, const char *indent, unsigned width, unsigned height,
+                                gboolean traced, at_trace_stats *stats);
+
+#endif /* not BATCH_H */
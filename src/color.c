@@ -95,9 +95,11 @@ void at_color_free(at_color *color)
 
 GType at_color_get_type(void)
 {
-  static GType our_type = 0;
-  if (our_type == 0)
-    our_type = g_boxed_type_register_static("AtColor", (GBoxedCopyFunc)at_color_copy,
-                                            (GBoxedFreeFunc)at_color_free);
+  static gsize our_type = 0;
+  if (g_once_init_enter(&our_type)) {
+    GType type = g_boxed_type_register_static("AtColor", (GBoxedCopyFunc)at_color_copy,
+                                              (GBoxedFreeFunc)at_color_free);
+    g_once_init_leave(&our_type, type);
+  }
   return our_type;
 }
@@ -12,15 +12,14 @@
 #include "curve.h"
 #include <glib.h>
 
-static at_real_coord int_to_real_coord(at_coord);
-
 /* Return an entirely empty curve.  */
 
-curve_type new_curve(void)
+curve_type new_curve(arena_type *arena)
 {
-  curve_type curve = g_malloc(sizeof(struct curve));
+  curve_type curve = arena_alloc(arena, sizeof(struct curve));
   curve->point_list = NULL;
   CURVE_LENGTH(curve) = 0;
+  curve->capacity = 0;
   CURVE_CYCLIC(curve) = FALSE;
   CURVE_START_TANGENT(curve) = CURVE_END_TANGENT(curve) = NULL;
   PREVIOUS_CURVE(curve) = NEXT_CURVE(curve) = NULL;
@@ -30,9 +29,9 @@ curve_type new_curve(void)
 
 /* Don't copy the points or tangents, but copy everything else.  */
 
-curve_type copy_most_of_curve(curve_type old_curve)
+curve_type copy_most_of_curve(arena_type *arena, curve_type old_curve)
 {
-  curve_type curve = new_curve();
+  curve_type curve = new_curve(arena);
 
   CURVE_CYCLIC(curve) = CURVE_CYCLIC(old_curve);
   PREVIOUS_CURVE(curve) = PREVIOUS_CURVE(old_curve);
@@ -41,31 +40,43 @@ curve_type copy_most_of_curve(curve_type old_curve)
   return curve;
 }
 
-/* The length of CURVE will be zero if we ended up not being able to fit
-   it (which in turn implies a problem elsewhere in the program, but at
-   any rate, we shouldn't try here to free the nonexistent curve).  */
-
-void free_curve(curve_type curve)
+void append_point(arena_type *arena, curve_type curve, at_real_coord coord)
 {
-  if (CURVE_LENGTH(curve) > 0)
-    g_free(curve->point_list);
-  if (CURVE_START_TANGENT(curve))
-    g_free(CURVE_START_TANGENT(curve));
-  if (CURVE_END_TANGENT(curve))
-    g_free(CURVE_END_TANGENT(curve));
+  curve->point_list = arena_grow(arena, curve->point_list, &curve->capacity,
+                                 CURVE_LENGTH(curve) + 1, sizeof(point_type));
+  CURVE_LENGTH(curve)++;
+  LAST_CURVE_POINT(curve) = coord;
+  /* The t value does not need to be set.  */
 }
 
-void append_pixel(curve_type curve, at_coord coord)
+void gather_curve_points(curve_points_type *points, curve_type curve)
 {
-  append_point(curve, int_to_real_coord(coord));
+  unsigned n = CURVE_LENGTH(curve), i;
+
+  if (n > points->capacity) {
+    /* The six arrays share one block */
+    points->capacity = MAX(n, points->capacity * 2);
+    points->x = g_renew(gfloat, points->x, (gsize)points->capacity * 6);
+    points->y = points->x + points->capacity;
+    points->z = points->y + points->capacity;
+    points->t = points->z + points->capacity;
+    points->result = points->t + points->capacity;
+    points->next_t = points->result + points->capacity;
+  }
+  for (i = 0; i < n; i++) {
+    points->x[i] = CURVE_POINT(curve, i).x;
+    points->y[i] = CURVE_POINT(curve, i).y;
+    points->z[i] = CURVE_POINT(curve, i).z;
+    points->t[i] = CURVE_T(curve, i);
+  }
+  points->length = n;
 }
 
-void append_point(curve_type curve, at_real_coord coord)
+void free_curve_points(curve_points_type *points)
 {
-  CURVE_LENGTH(curve)++;
-  curve->point_list = g_realloc(curve->point_list, CURVE_LENGTH(curve) * sizeof(point_type));
-  LAST_CURVE_POINT(curve) = coord;
-  /* The t value does not need to be set.  */
+  g_free(points->x);
+  points->x = points->y = points->z = points->t = points->result = points->next_t = NULL;
+  points->length = points->capacity = 0;
 }
 
 /* Print a curve in human-readable form.  It turns out we never care
@@ -86,6 +97,9 @@ void log_curve(curve_type curve, gboolean print_t)
 {
   unsigned this_point;
 
+  if (!LOG_ENABLED(G_LOG_LEVEL_DEBUG))
+    return;
+
   DEBUG("curve id = %lx:\n", (unsigned long)(uintptr_t)curve);
   DEBUG("  length = %u.\n", CURVE_LENGTH(curve));
   if (CURVE_CYCLIC(curve))
@@ -134,6 +148,9 @@ void log_entire_curve(curve_type curve)
 {
   unsigned this_point;
 
+  if (!LOG_ENABLED(G_LOG_LEVEL_DEBUG))
+    return;
+
   DEBUG("curve id = %lx:\n", (unsigned long)(uintptr_t)curve);
   DEBUG("  length = %u.\n", CURVE_LENGTH(curve));
   if (CURVE_CYCLIC(curve))
@@ -164,32 +181,19 @@ curve_list_type new_curve_list(void)
   curve_list_type curve_list;
 
   curve_list.length = 0;
+  curve_list.capacity = 0;
   curve_list.data = NULL;
 
   return curve_list;
 }
 
-/* Free a curve list and all the curves it contains.  */
-
-void free_curve_list(curve_list_type *curve_list)
-{
-  unsigned this_curve;
-
-  for (this_curve = 0; this_curve < curve_list->length; this_curve++) {
-    free_curve(curve_list->data[this_curve]);
-    g_free(curve_list->data[this_curve]);
-  }
-
-  /* If the character was empty, it won't have any curves.  */
-  g_free(curve_list->data);
-}
-
 /* Add an element to a curve list.  */
 
-void append_curve(curve_list_type *curve_list, curve_type curve)
+void append_curve(arena_type *arena, curve_list_type *curve_list, curve_type curve)
 {
+  curve_list->data = arena_grow(arena, curve_list->data, &curve_list->capacity,
+                                curve_list->length + 1, sizeof(curve_type));
   curve_list->length++;
-  curve_list->data = g_realloc(curve_list->data, curve_list->length * sizeof(curve_type));
   curve_list->data[curve_list->length - 1] = curve;
 }
 
@@ -200,50 +204,20 @@ curve_list_array_type new_curve_list_array(void)
   curve_list_array_type curve_list_array;
 
   CURVE_LIST_ARRAY_LENGTH(curve_list_array) = 0;
+  curve_list_array.capacity = 0;
   curve_list_array.data = NULL;
 
   return curve_list_array;
 }
 
-/* Free a curve list array and all the curve lists it contains.  */
-
-void free_curve_list_array(curve_list_array_type *curve_list_array,
-                           at_progress_func notify_progress, gpointer client_data)
-{
-  unsigned this_list;
-
-  for (this_list = 0; this_list < CURVE_LIST_ARRAY_LENGTH(*curve_list_array); this_list++) {
-    if (notify_progress)
-      notify_progress(((gfloat)this_list) /
-                              (CURVE_LIST_ARRAY_LENGTH(*curve_list_array) * (gfloat)3.0) +
-                          (gfloat)0.666,
-                      client_data);
-    free_curve_list(&CURVE_LIST_ARRAY_ELT(*curve_list_array, this_list));
-  }
-
-  /* If the character was empty, it won't have any curves.  */
-  g_free(curve_list_array->data);
-}
-
 /* Add an element to a curve list array.  */
 
-void append_curve_list(curve_list_array_type *curve_list_array, curve_list_type curve_list)
+void append_curve_list(arena_type *arena, curve_list_array_type *curve_list_array,
+                       curve_list_type curve_list)
 {
+  curve_list_array->data =
+      arena_grow(arena, curve_list_array->data, &curve_list_array->capacity,
+                 CURVE_LIST_ARRAY_LENGTH(*curve_list_array) + 1, sizeof(curve_list_type));
   CURVE_LIST_ARRAY_LENGTH(*curve_list_array)++;
-  curve_list_array->data = g_realloc(
-      curve_list_array->data, CURVE_LIST_ARRAY_LENGTH(*curve_list_array) * sizeof(curve_list_type));
   LAST_CURVE_LIST_ARRAY_ELT(*curve_list_array) = curve_list;
 }
-
-/* Turn an integer point into a real one.  */
-
-static at_real_coord int_to_real_coord(at_coord int_coord)
-{
-  at_real_coord real_coord;
-
-  real_coord.x = int_coord.x;
-  real_coord.y = int_coord.y;
-  real_coord.z = 0.0;
-
-  return real_coord;
-}
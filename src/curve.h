@@ -12,6 +12,7 @@
 #define CURVE_H
 
 #include "autotrace.h"
+#include "arena.h"
 #include "vector.h"
 
 /* We are simultaneously manipulating two different representations of
@@ -27,11 +28,19 @@ typedef struct {
 
 /* It turns out to be convenient to break the list of all the pixels in
    the outline into sublists, divided at ``corners''.  Then each of the
-   sublists is treated independently.  Each of these sublists is a `curve'.  */
+   sublists is treated independently.  Each of these sublists is a `curve'.
+
+   Curves, their points and tangents, and the lists of curves are all
+   allocated in the arena of the trace, and freed along with it.  */
 
 struct curve {
   point_type *point_list;
   unsigned length;
+  /* Number of points `point_list' has room for; zero when it points
+     into a list it does not own: the points of its outline, which the
+     curves between its corners share, or the list of the curve it was
+     split from.  Nothing can be appended to such a curve.  */
+  unsigned capacity;
   gboolean cyclic;
   vector_type *start_tangent;
   vector_type *end_tangent;
@@ -72,19 +81,34 @@ typedef struct curve *curve_type;
 #define NEXT_CURVE(c) ((c)->next)
 
 /* Return an entirely empty curve.  */
-extern curve_type new_curve(void);
+extern curve_type new_curve(arena_type *arena);
 
 /* Return a curve the same as C, except without any points.  */
-extern curve_type copy_most_of_curve(curve_type c);
-
-/* Free the memory C uses.  */
-extern void free_curve(curve_type c);
+extern curve_type copy_most_of_curve(arena_type *arena, curve_type c);
+
+/* Append the point P to the end of C's list.  C must own its list: a
+   curve that is a view over the points of others has a capacity of 0,
+   and growing it would write over their points.  */
+extern void append_point(arena_type *arena, curve_type c, at_real_coord p);
+
+/* The points of a curve one coordinate at a time, as the fitting loops
+   of fit-kernels.h go through them, with room for one more number per
+   point that the loops give back, and for the next t value of each
+   point when the fit reparameterizes.  Made from the list of a curve
+   by `gather_curve_points', and kept from one curve to the next.  */
+typedef struct {
+  gfloat *x, *y, *z, *t;
+  gfloat *result;
+  gfloat *next_t;
+  unsigned length;
+  unsigned capacity;
+} curve_points_type;
 
-/* Append the point P to the end of C's list.  */
-extern void append_pixel(curve_type c, at_coord p);
+#define EMPTY_CURVE_POINTS {NULL, NULL, NULL, NULL, NULL, NULL, 0, 0}
 
-/* Like `append_pixel', for a point in real coordinates.  */
-extern void append_point(curve_type c, at_real_coord p);
+/* Copy the points of C and their t values to POINTS.  */
+extern void gather_curve_points(curve_points_type *points, curve_type c);
+extern void free_curve_points(curve_points_type *points);
 
 /* Write some or all, respectively, of the curve C in human-readable
    form to the log file, if logging is enabled.  */
@@ -98,6 +122,7 @@ extern void display_curve(curve_type);
 typedef struct {
   curve_type *data;
   unsigned length;
+  unsigned capacity;
   gboolean clockwise;
   gboolean open;
 } curve_list_type;
@@ -114,8 +139,7 @@ typedef struct {
 #define CURVE_LIST_CLOCKWISE(c_l) ((c_l).clockwise)
 
 extern curve_list_type new_curve_list(void);
-extern void free_curve_list(curve_list_type *);
-extern void append_curve(curve_list_type *, curve_type);
+extern void append_curve(arena_type *, curve_list_type *, curve_type);
 
 /* And a character is a list of outlines.  I named this
    `curve_list_array_type' because `curve_list_list_type' seemed pretty
@@ -123,6 +147,7 @@ extern void append_curve(curve_list_type *, curve_type);
 typedef struct {
   curve_list_type *data;
   unsigned length;
+  unsigned capacity;
 } curve_list_array_type;
 
 /* Turns out we can use the same definitions for lists of lists as for
@@ -132,7 +157,6 @@ typedef struct {
 #define LAST_CURVE_LIST_ARRAY_ELT LAST_CURVE_LIST_ELT
 
 extern curve_list_array_type new_curve_list_array(void);
-extern void free_curve_list_array(curve_list_array_type *, at_progress_func, gpointer);
-extern void append_curve_list(curve_list_array_type *, curve_list_type);
+extern void append_curve_list(arena_type *, curve_list_array_type *, curve_list_type);
 
 #endif /* not CURVE_H */
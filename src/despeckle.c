@@ -10,8 +10,10 @@
 
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 #include "logreport.h"
 #include "despeckle.h"
+#include "tracer.h"
 #include <glib.h>
 
 /* Calculate Error - compute the error between two colors
@@ -574,7 +576,8 @@ static gboolean recolor_8(/* in */ double adaptive_tightness,
  *   tightness and noise removal
  *
  * Modified Parameters:
- *   The 24 bit pixbuf is despeckled
+ *   The 24 bit pixbuf is despeckled; the mask, all zero on entry, is
+ *   left dirty
  */
 
 static void despeckle_iteration(/* in */ int level,
@@ -582,7 +585,8 @@ static void despeckle_iteration(/* in */ int level,
                                 /* in */ double noise_max,
                                 /* in */ int width,
                                 /* in */ int height,
-                                /* in/out */ unsigned char *bitmap)
+                                /* in/out */ unsigned char *bitmap,
+                                /* in/out */ unsigned char *mask)
 {
   int x, y;
   int current_size;
@@ -592,7 +596,6 @@ static void despeckle_iteration(/* in */ int level,
   current_size = 1 << level;
   tightness = (int)(noise_max / (1.0 + adaptive_tightness * level));
 
-  g_autofree unsigned char *mask = g_malloc0((gsize)width * height * sizeof(unsigned char));
   for (y = 0; y < height; y++) {
     for (x = 0; x < width; x++) {
       if (mask[y * width + x] == 0) {
@@ -620,7 +623,8 @@ static void despeckle_iteration(/* in */ int level,
  *   tightness and noise removal
  *
  * Modified Parameters:
- *   The 8 bit pixbuf is despeckled
+ *   The 8 bit pixbuf is despeckled; the mask, all zero on entry, is
+ *   left dirty
  */
 
 static void despeckle_iteration_8(/* in */ int level,
@@ -628,7 +632,8 @@ static void despeckle_iteration_8(/* in */ int level,
                                   /* in */ double noise_max,
                                   /* in */ int width,
                                   /* in */ int height,
-                                  /* in/out */ unsigned char *bitmap)
+                                  /* in/out */ unsigned char *bitmap,
+                                  /* in/out */ unsigned char *mask)
 {
   int x, y;
   int current_size;
@@ -638,7 +643,6 @@ static void despeckle_iteration_8(/* in */ int level,
   current_size = 1 << level;
   tightness = (int)(noise_max / (1.0 + adaptive_tightness * level));
 
-  g_autofree unsigned char *mask = g_malloc0((gsize)width * height * sizeof(unsigned char));
   for (y = 0; y < height; y++) {
     for (x = 0; x < width; x++) {
       if (mask[y * width + x] == 0) {
@@ -679,6 +683,9 @@ static void despeckle_iteration_8(/* in */ int level,
  *     You should always use the highest value, only if certain parts of the image
  *     disappear you should lower it.
  *
+ * Scratch buffers:
+ *   Taken from tracer, which may be NULL
+ *
  * Modified Parameters:
  *   The bitmap is despeckled.
  */
@@ -687,11 +694,13 @@ void despeckle(/* in/out */ at_bitmap *bitmap,
                /* in */ int level,
                /* in */ gfloat tightness,
                /* in */ gfloat noise_removal,
+               /* scratch buffers */ at_tracer *tracer,
                /* exception handling */ at_exception_type *excep)
 {
   int i, planes, max_level;
-  short width, height;
-  unsigned char *bits;
+  int width, height;
+  unsigned char *bits, *mask;
+  gsize mask_size;
   double noise_max, adaptive_tightness;
 
   planes = AT_BITMAP_PLANES(bitmap);
@@ -699,20 +708,26 @@ void despeckle(/* in/out */ at_bitmap *bitmap,
   width = AT_BITMAP_WIDTH(bitmap);
   height = AT_BITMAP_HEIGHT(bitmap);
   bits = AT_BITMAP_BITS(bitmap);
-  max_level = (int)(log(width * height) / log(2.0) - 0.5);
+  max_level = (int)(log((double)width * height) / log(2.0) - 0.5);
   if (level > max_level)
     level = max_level;
   adaptive_tightness = (noise_removal * (1.0 + tightness * level) - 1.0) / level;
 
-  if (planes == 3) {
-    for (i = 0; i < level; i++)
-      despeckle_iteration(i, adaptive_tightness, noise_max, width, height, bits);
-  } else if (planes == 1) {
-    for (i = 0; i < level; i++)
-      despeckle_iteration_8(i, adaptive_tightness, noise_max, width, height, bits);
-  } else {
+  if (planes != 3 && planes != 1) {
     LOG("despeckle: %u-plane images are not supported", planes);
     at_exception_fatal(excep, "despeckle: wrong plane images are passed");
     return;
   }
+
+  /* One mask serves all the levels, cleared before each */
+  mask_size = (gsize)width * height;
+  mask = tracer_scratch(tracer, SCRATCH_DESPECKLE_MASK, mask_size, FALSE);
+  for (i = 0; i < level; i++) {
+    memset(mask, 0, mask_size);
+    if (planes == 3)
+      despeckle_iteration(i, adaptive_tightness, noise_max, width, height, bits, mask);
+    else
+      despeckle_iteration_8(i, adaptive_tightness, noise_max, width, height, bits, mask);
+  }
+  tracer_release(tracer, mask);
 }
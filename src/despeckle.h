@@ -37,11 +37,14 @@
  *     You should always use the highest value, only if certain parts of the image
  *     disappear you should lower it.
  *
+ * Scratch buffers:
+ *   Taken from tracer, which may be NULL
+ *
  * Modified Parameters:
  *   The bitmap is despeckled.
  */
 
 extern void despeckle(at_bitmap *bitmap, int level, gfloat tightness, gfloat noise_removal,
-                      at_exception_type *exp);
+                      at_tracer *tracer, at_exception_type *exp);
 
 #endif /* not DESPECKLE_H */
@@ -0,0 +1,525 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* fit-kernels.c: the inner loops of least-squares fitting. */
+
+#include "fit-kernels.h"
+#include <math.h>
+
+/* GCC ignores this pragma, and is given -ffp-contract=off instead by
+   Makefile.am.  */
+#if !defined(__GNUC__) || defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FIT_KERNELS_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/* Each point is worked out with the same operations, in the same
+   order, as fit.c did it one point at a time with the functions of
+   vector.c, so that each lane of a vector gives the same number as
+   the loop without vectors.  Floating-point multiplications and
+   additions are not fused into one: contraction is turned off for
+   this file, by the pragma above or by -ffp-contract=off, as C17
+   leaves its default to the compiler and GCC fuses them in its GNU
+   modes whenever the target has FMA.  AVX2 is used without FMA.
+
+   The sums of fit_normal_equations are kept apart for every eighth
+   point, the LANES of an AVX2 vector, or of two SSE2 vectors, and
+   added up at the end in one order, so the sums do not depend on the
+   instructions either.  */
+
+#define LANES 8
+
+enum { SUM_C00, SUM_C01, SUM_C11, SUM_X0, SUM_X1, N_SUMS };
+
+/* What a fit is made of, one coordinate at a time */
+typedef struct {
+  gfloat t1[3], t2[3]; /* the tangents at the ends */
+  gfloat start[3], end[3];
+} fit_frame_type;
+
+/* The control points of a cubic, one coordinate at a time */
+typedef struct {
+  gfloat p[3][4];
+} cubic_type;
+
+static cubic_type make_cubic(const spline_type *spline)
+{
+  cubic_type cubic;
+  unsigned i;
+
+  for (i = 0; i < 4; i++) {
+    cubic.p[0][i] = spline->v[i].x;
+    cubic.p[1][i] = spline->v[i].y;
+    cubic.p[2][i] = spline->v[i].z;
+  }
+  return cubic;
+}
+
+/* One point at a time.  */
+
+/* Add what the point P at T adds to the sums of LANE.  */
+static void add_point_sums(gfloat sums[N_SUMS][LANES], unsigned lane, const fit_frame_type *f,
+                           gfloat t, const gfloat p[3])
+{
+  gfloat u = (gfloat)1.0 - t;
+  gfloat b0 = u * u * u, b1 = (gfloat)3.0 * t * (u * u);
+  gfloat b2 = (gfloat)3.0 * (t * t) * u, b3 = t * t * t;
+  gfloat a0[3], a1[3], r[3];
+  unsigned k;
+
+  for (k = 0; k < 3; k++) {
+    a0[k] = f->t1[k] * b1;
+    a1[k] = f->t2[k] * b2;
+    r[k] = p[k] - (f->start[k] * b0 + (f->start[k] * b1 + (f->end[k] * b2 + f->end[k] * b3)));
+  }
+  sums[SUM_C00][lane] += a0[0] * a0[0] + a0[1] * a0[1] + a0[2] * a0[2];
+  sums[SUM_C01][lane] += a0[0] * a1[0] + a0[1] * a1[1] + a0[2] * a1[2];
+  sums[SUM_C11][lane] += a1[0] * a1[0] + a1[1] * a1[1] + a1[2] * a1[2];
+  sums[SUM_X0][lane] += r[0] * a0[0] + r[1] * a0[1] + r[2] * a0[2];
+  sums[SUM_X1][lane] += r[0] * a1[0] + r[1] * a1[1] + r[2] * a1[2];
+}
+
+/* One coordinate of CUBIC at T, by de Casteljau's algorithm, as
+   evaluate_spline does it.  */
+static gfloat cubic_at(const gfloat p[4], gfloat t)
+{
+  gfloat u = (gfloat)1.0 - t;
+  gfloat a0 = p[0] * u + p[1] * t, a1 = p[1] * u + p[2] * t, a2 = p[2] * u + p[3] * t;
+  gfloat b0 = a0 * u + a1 * t, b1 = a1 * u + a2 * t;
+
+  return b0 * u + b1 * t;
+}
+
+static void point_errors_scalar(curve_points_type *points, const cubic_type *c, unsigned i)
+{
+  for (; i < points->length; i++) {
+    gfloat t = points->t[i];
+    gfloat dx = points->x[i] - cubic_at(c->p[0], t), dy = points->y[i] - cubic_at(c->p[1], t);
+    gfloat dz = points->z[i] - cubic_at(c->p[2], t);
+
+    points->result[i] = sqrtf(dx * dx + dy * dy + dz * dz);
+  }
+}
+
+static void line_distances_scalar(curve_points_type *points, const cubic_type *c, unsigned i)
+{
+  gfloat A = c->p[0][3] - c->p[0][0], B = c->p[1][3] - c->p[1][0], C = c->p[2][3] - c->p[2][0];
+  gfloat start_end_dist = A * A + B * B + C * C;
+
+  for (; i < points->length; i++) {
+    gfloat t = points->t[i];
+    gfloat a = cubic_at(c->p[0], t) - c->p[0][0], b = cubic_at(c->p[1], t) - c->p[1][0];
+    gfloat cz = cubic_at(c->p[2], t) - c->p[2][0];
+    gfloat w = (A * a + B * b + C * cz) / start_end_dist;
+    gfloat ea = a - A * w, eb = b - B * w, ec = cz - C * w;
+
+    points->result[i] = sqrtf(ea * ea + eb * eb + ec * ec);
+  }
+}
+
+/* Each of these does what it can of the points, and returns how many
+   it did.  */
+typedef struct {
+  unsigned (*normal_sums)(const curve_points_type *, const fit_frame_type *,
+                          gfloat[N_SUMS][LANES]);
+  unsigned (*point_errors)(curve_points_type *, const cubic_type *);
+  unsigned (*line_distances)(curve_points_type *, const cubic_type *);
+} fit_kernels_type;
+
+static unsigned normal_sums_none(const curve_points_type *points, const fit_frame_type *f,
+                                 gfloat sums[N_SUMS][LANES])
+{
+  return 0;
+}
+
+static unsigned points_none(curve_points_type *points, const cubic_type *c)
+{
+  return 0;
+}
+
+#ifdef FIT_KERNELS_X86
+
+/* SSE2, four points at a time.  */
+
+TARGET_SSE2 static inline __m128 sse2_dot(const __m128 a[3], const __m128 b[3])
+{
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])),
+                    _mm_mul_ps(a[2], b[2]));
+}
+
+TARGET_SSE2 static inline __m128 sse2_lerp(__m128 a, __m128 b, __m128 t, __m128 u)
+{
+  return _mm_add_ps(_mm_mul_ps(a, u), _mm_mul_ps(b, t));
+}
+
+TARGET_SSE2 static inline __m128 sse2_cubic_at(const gfloat p[4], __m128 t, __m128 u)
+{
+  __m128 p0 = _mm_set1_ps(p[0]), p1 = _mm_set1_ps(p[1]);
+  __m128 p2 = _mm_set1_ps(p[2]), p3 = _mm_set1_ps(p[3]);
+  __m128 a0 = sse2_lerp(p0, p1, t, u), a1 = sse2_lerp(p1, p2, t, u), a2 = sse2_lerp(p2, p3, t, u);
+
+  return sse2_lerp(sse2_lerp(a0, a1, t, u), sse2_lerp(a1, a2, t, u), t, u);
+}
+
+TARGET_SSE2 static inline void sse2_add_sums(__m128 acc[N_SUMS], const fit_frame_type *f,
+                                             const curve_points_type *points, unsigned i)
+{
+  __m128 t = _mm_loadu_ps(points->t + i), u = _mm_sub_ps(_mm_set1_ps(1.0F), t);
+  __m128 uu = _mm_mul_ps(u, u), tt = _mm_mul_ps(t, t), three = _mm_set1_ps(3.0F);
+  __m128 b0 = _mm_mul_ps(uu, u), b1 = _mm_mul_ps(_mm_mul_ps(three, t), uu);
+  __m128 b2 = _mm_mul_ps(_mm_mul_ps(three, tt), u), b3 = _mm_mul_ps(tt, t);
+  __m128 p[3], a0[3], a1[3], r[3];
+  unsigned k;
+
+  p[0] = _mm_loadu_ps(points->x + i);
+  p[1] = _mm_loadu_ps(points->y + i);
+  p[2] = _mm_loadu_ps(points->z + i);
+  for (k = 0; k < 3; k++) {
+    __m128 start = _mm_set1_ps(f->start[k]), end = _mm_set1_ps(f->end[k]);
+
+    a0[k] = _mm_mul_ps(_mm_set1_ps(f->t1[k]), b1);
+    a1[k] = _mm_mul_ps(_mm_set1_ps(f->t2[k]), b2);
+    r[k] = _mm_sub_ps(p[k],
+                      _mm_add_ps(_mm_mul_ps(start, b0),
+                                 _mm_add_ps(_mm_mul_ps(start, b1),
+                                            _mm_add_ps(_mm_mul_ps(end, b2), _mm_mul_ps(end, b3)))));
+  }
+  acc[SUM_C00] = _mm_add_ps(acc[SUM_C00], sse2_dot(a0, a0));
+  acc[SUM_C01] = _mm_add_ps(acc[SUM_C01], sse2_dot(a0, a1));
+  acc[SUM_C11] = _mm_add_ps(acc[SUM_C11], sse2_dot(a1, a1));
+  acc[SUM_X0] = _mm_add_ps(acc[SUM_X0], sse2_dot(r, a0));
+  acc[SUM_X1] = _mm_add_ps(acc[SUM_X1], sse2_dot(r, a1));
+}
+
+/* The lanes of the first register are the first four of LANES, those
+   of the second the last four.  */
+TARGET_SSE2 static unsigned normal_sums_sse2(const curve_points_type *points,
+                                             const fit_frame_type *f, gfloat sums[N_SUMS][LANES])
+{
+  __m128 low[N_SUMS], high[N_SUMS];
+  unsigned i, q;
+
+  for (q = 0; q < N_SUMS; q++)
+    low[q] = high[q] = _mm_setzero_ps();
+  for (i = 0; i + LANES <= points->length; i += LANES) {
+    sse2_add_sums(low, f, points, i);
+    sse2_add_sums(high, f, points, i + 4);
+  }
+  for (q = 0; q < N_SUMS; q++) {
+    _mm_storeu_ps(sums[q], low[q]);
+    _mm_storeu_ps(sums[q] + 4, high[q]);
+  }
+  return i;
+}
+
+TARGET_SSE2 static unsigned point_errors_sse2(curve_points_type *points, const cubic_type *c)
+{
+  unsigned i;
+
+  for (i = 0; i + 4 <= points->length; i += 4) {
+    __m128 t = _mm_loadu_ps(points->t + i), u = _mm_sub_ps(_mm_set1_ps(1.0F), t);
+    __m128 d[3];
+
+    d[0] = _mm_sub_ps(_mm_loadu_ps(points->x + i), sse2_cubic_at(c->p[0], t, u));
+    d[1] = _mm_sub_ps(_mm_loadu_ps(points->y + i), sse2_cubic_at(c->p[1], t, u));
+    d[2] = _mm_sub_ps(_mm_loadu_ps(points->z + i), sse2_cubic_at(c->p[2], t, u));
+    _mm_storeu_ps(points->result + i, _mm_sqrt_ps(sse2_dot(d, d)));
+  }
+  return i;
+}
+
+TARGET_SSE2 static unsigned line_distances_sse2(curve_points_type *points, const cubic_type *c)
+{
+  gfloat A = c->p[0][3] - c->p[0][0], B = c->p[1][3] - c->p[1][0], C = c->p[2][3] - c->p[2][0];
+  __m128 line[3], start_end_dist = _mm_set1_ps(A * A + B * B + C * C);
+  unsigned i, k;
+
+  line[0] = _mm_set1_ps(A);
+  line[1] = _mm_set1_ps(B);
+  line[2] = _mm_set1_ps(C);
+  for (i = 0; i + 4 <= points->length; i += 4) {
+    __m128 t = _mm_loadu_ps(points->t + i), u = _mm_sub_ps(_mm_set1_ps(1.0F), t);
+    __m128 a[3], w;
+
+    for (k = 0; k < 3; k++)
+      a[k] = _mm_sub_ps(sse2_cubic_at(c->p[k], t, u), _mm_set1_ps(c->p[k][0]));
+    w = _mm_div_ps(sse2_dot(line, a), start_end_dist);
+    for (k = 0; k < 3; k++)
+      a[k] = _mm_sub_ps(a[k], _mm_mul_ps(line[k], w));
+    _mm_storeu_ps(points->result + i, _mm_sqrt_ps(sse2_dot(a, a)));
+  }
+  return i;
+}
+
+/* AVX2, eight points at a time.  */
+
+TARGET_AVX2 static inline __m256 avx2_dot(const __m256 a[3], const __m256 b[3])
+{
+  return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])),
+                       _mm256_mul_ps(a[2], b[2]));
+}
+
+TARGET_AVX2 static inline __m256 avx2_lerp(__m256 a, __m256 b, __m256 t, __m256 u)
+{
+  return _mm256_add_ps(_mm256_mul_ps(a, u), _mm256_mul_ps(b, t));
+}
+
+TARGET_AVX2 static inline __m256 avx2_cubic_at(const gfloat p[4], __m256 t, __m256 u)
+{
+  __m256 p0 = _mm256_set1_ps(p[0]), p1 = _mm256_set1_ps(p[1]);
+  __m256 p2 = _mm256_set1_ps(p[2]), p3 = _mm256_set1_ps(p[3]);
+  __m256 a0 = avx2_lerp(p0, p1, t, u), a1 = avx2_lerp(p1, p2, t, u), a2 = avx2_lerp(p2, p3, t, u);
+
+  return avx2_lerp(avx2_lerp(a0, a1, t, u), avx2_lerp(a1, a2, t, u), t, u);
+}
+
+TARGET_AVX2 static unsigned normal_sums_avx2(const curve_points_type *points,
+                                             const fit_frame_type *f, gfloat sums[N_SUMS][LANES])
+{
+  __m256 acc[N_SUMS], three = _mm256_set1_ps(3.0F), one = _mm256_set1_ps(1.0F);
+  __m256 t1[3], t2[3], start[3], end[3];
+  unsigned i, k, q;
+
+  for (k = 0; k < 3; k++) {
+    t1[k] = _mm256_set1_ps(f->t1[k]);
+    t2[k] = _mm256_set1_ps(f->t2[k]);
+    start[k] = _mm256_set1_ps(f->start[k]);
+    end[k] = _mm256_set1_ps(f->end[k]);
+  }
+  for (q = 0; q < N_SUMS; q++)
+    acc[q] = _mm256_setzero_ps();
+  for (i = 0; i + LANES <= points->length; i += LANES) {
+    __m256 t = _mm256_loadu_ps(points->t + i), u = _mm256_sub_ps(one, t);
+    __m256 uu = _mm256_mul_ps(u, u), tt = _mm256_mul_ps(t, t);
+    __m256 b0 = _mm256_mul_ps(uu, u), b1 = _mm256_mul_ps(_mm256_mul_ps(three, t), uu);
+    __m256 b2 = _mm256_mul_ps(_mm256_mul_ps(three, tt), u), b3 = _mm256_mul_ps(tt, t);
+    __m256 p[3], a0[3], a1[3], r[3];
+
+    p[0] = _mm256_loadu_ps(points->x + i);
+    p[1] = _mm256_loadu_ps(points->y + i);
+    p[2] = _mm256_loadu_ps(points->z + i);
+    for (k = 0; k < 3; k++) {
+      a0[k] = _mm256_mul_ps(t1[k], b1);
+      a1[k] = _mm256_mul_ps(t2[k], b2);
+      r[k] = _mm256_sub_ps(
+          p[k], _mm256_add_ps(_mm256_mul_ps(start[k], b0),
+                              _mm256_add_ps(_mm256_mul_ps(start[k], b1),
+                                            _mm256_add_ps(_mm256_mul_ps(end[k], b2),
+                                                          _mm256_mul_ps(end[k], b3)))));
+    }
+    acc[SUM_C00] = _mm256_add_ps(acc[SUM_C00], avx2_dot(a0, a0));
+    acc[SUM_C01] = _mm256_add_ps(acc[SUM_C01], avx2_dot(a0, a1));
+    acc[SUM_C11] = _mm256_add_ps(acc[SUM_C11], avx2_dot(a1, a1));
+    acc[SUM_X0] = _mm256_add_ps(acc[SUM_X0], avx2_dot(r, a0));
+    acc[SUM_X1] = _mm256_add_ps(acc[SUM_X1], avx2_dot(r, a1));
+  }
+  for (q = 0; q < N_SUMS; q++)
+    _mm256_storeu_ps(sums[q], acc[q]);
+  return i;
+}
+
+TARGET_AVX2 static unsigned point_errors_avx2(curve_points_type *points, const cubic_type *c)
+{
+  unsigned i;
+
+  for (i = 0; i + 8 <= points->length; i += 8) {
+    __m256 t = _mm256_loadu_ps(points->t + i), u = _mm256_sub_ps(_mm256_set1_ps(1.0F), t);
+    __m256 d[3];
+
+    d[0] = _mm256_sub_ps(_mm256_loadu_ps(points->x + i), avx2_cubic_at(c->p[0], t, u));
+    d[1] = _mm256_sub_ps(_mm256_loadu_ps(points->y + i), avx2_cubic_at(c->p[1], t, u));
+    d[2] = _mm256_sub_ps(_mm256_loadu_ps(points->z + i), avx2_cubic_at(c->p[2], t, u));
+    _mm256_storeu_ps(points->result + i, _mm256_sqrt_ps(avx2_dot(d, d)));
+  }
+  return i;
+}
+
+TARGET_AVX2 static unsigned line_distances_avx2(curve_points_type *points, const cubic_type *c)
+{
+  gfloat A = c->p[0][3] - c->p[0][0], B = c->p[1][3] - c->p[1][0], C = c->p[2][3] - c->p[2][0];
+  __m256 line[3], start_end_dist = _mm256_set1_ps(A * A + B * B + C * C);
+  unsigned i, k;
+
+  line[0] = _mm256_set1_ps(A);
+  line[1] = _mm256_set1_ps(B);
+  line[2] = _mm256_set1_ps(C);
+  for (i = 0; i + 8 <= points->length; i += 8) {
+    __m256 t = _mm256_loadu_ps(points->t + i), u = _mm256_sub_ps(_mm256_set1_ps(1.0F), t);
+    __m256 a[3], w;
+
+    for (k = 0; k < 3; k++)
+      a[k] = _mm256_sub_ps(avx2_cubic_at(c->p[k], t, u), _mm256_set1_ps(c->p[k][0]));
+    w = _mm256_div_ps(avx2_dot(line, a), start_end_dist);
+    for (k = 0; k < 3; k++)
+      a[k] = _mm256_sub_ps(a[k], _mm256_mul_ps(line[k], w));
+    _mm256_storeu_ps(points->result + i, _mm256_sqrt_ps(avx2_dot(a, a)));
+  }
+  return i;
+}
+
+#endif /* FIT_KERNELS_X86 */
+
+static const fit_kernels_type kernels[FIT_KERNELS_N_LEVELS] = {
+    {normal_sums_none, points_none, points_none},
+#ifdef FIT_KERNELS_X86
+    {normal_sums_sse2, point_errors_sse2, line_distances_sse2},
+    {normal_sums_avx2, point_errors_avx2, line_distances_avx2},
+#else
+    {normal_sums_none, points_none, points_none},
+    {normal_sums_none, points_none, points_none},
+#endif
+};
+
+static const char *level_names[FIT_KERNELS_N_LEVELS] = {"scalar", "sse2", "avx2"};
+
+/* -1 until the first loop runs */
+static gint current_level = -1;
+
+static gboolean level_supported(fit_kernels_level level)
+{
+  switch (level) {
+  case FIT_KERNELS_SCALAR:
+    return TRUE;
+#ifdef FIT_KERNELS_X86
+  case FIT_KERNELS_SSE2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+  case FIT_KERNELS_AVX2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return FALSE;
+  }
+}
+
+fit_kernels_level fit_kernels_get_level(void)
+{
+  gint level = g_atomic_int_get(&current_level);
+
+  if (level < 0) {
+    /* Threads that get here at once all find the same */
+    for (level = FIT_KERNELS_N_LEVELS - 1; !level_supported(level); level--)
+      ;
+    g_atomic_int_set(&current_level, level);
+  }
+  return level;
+}
+
+gboolean fit_kernels_set_level(fit_kernels_level level)
+{
+  if (level >= FIT_KERNELS_N_LEVELS || !level_supported(level))
+    return FALSE;
+  g_atomic_int_set(&current_level, level);
+  return TRUE;
+}
+
+const char *fit_kernels_level_name(fit_kernels_level level)
+{
+  return level < FIT_KERNELS_N_LEVELS ? level_names[level] : NULL;
+}
+
+void fit_normal_equations(const curve_points_type *points, vector_type t1_hat, vector_type t2_hat,
+                          at_real_coord start, at_real_coord end, gfloat C[2][2], gfloat X[2])
+{
+  fit_frame_type f = {{t1_hat.dx, t1_hat.dy, t1_hat.dz},
+                      {t2_hat.dx, t2_hat.dy, t2_hat.dz},
+                      {start.x, start.y, start.z},
+                      {end.x, end.y, end.z}};
+  gfloat sums[N_SUMS][LANES] = {{0}}, total[N_SUMS];
+  unsigned i, q;
+
+  i = kernels[fit_kernels_get_level()].normal_sums(points, &f, sums);
+  for (; i < points->length; i++) {
+    gfloat p[3] = {points->x[i], points->y[i], points->z[i]};
+
+    add_point_sums(sums, i % LANES, &f, points->t[i], p);
+  }
+  /* As the halves of a vector are added, then the halves of that */
+  for (q = 0; q < N_SUMS; q++) {
+    const gfloat *s = sums[q];
+
+    total[q] = ((s[0] + s[4]) + (s[2] + s[6])) + ((s[1] + s[5]) + (s[3] + s[7]));
+  }
+  C[0][0] = total[SUM_C00];
+  C[0][1] = C[1][0] = total[SUM_C01];
+  C[1][1] = total[SUM_C11];
+  X[0] = total[SUM_X0];
+  X[1] = total[SUM_X1];
+}
+
+void fit_point_errors(curve_points_type *points, const spline_type *spline)
+{
+  cubic_type c = make_cubic(spline);
+
+  point_errors_scalar(points, &c, kernels[fit_kernels_get_level()].point_errors(points, &c));
+}
+
+void fit_point_errors_part(curve_points_type *points, const spline_type *spline, unsigned first,
+                           unsigned count)
+{
+  cubic_type c = make_cubic(spline);
+  curve_points_type part = *points;
+
+  part.x += first;
+  part.y += first;
+  part.z += first;
+  part.t += first;
+  part.result += first;
+  part.length = count;
+  point_errors_scalar(&part, &c, kernels[fit_kernels_get_level()].point_errors(&part, &c));
+}
+
+void fit_line_distances(curve_points_type *points, const spline_type *spline)
+{
+  cubic_type c = make_cubic(spline);
+
+  line_distances_scalar(points, &c, kernels[fit_kernels_get_level()].line_distances(points, &c));
+}
+
+void fit_reparameterize(curve_points_type *points, const spline_type *spline)
+{
+  cubic_type c = make_cubic(spline);
+  gfloat d1[3][3], d2[3][2];
+  unsigned i, k;
+
+  /* The control points of the first and second derivatives */
+  for (k = 0; k < 3; k++) {
+    const gfloat *p = c.p[k];
+
+    d1[k][0] = 3 * (p[1] - p[0]);
+    d1[k][1] = 3 * (p[2] - p[1]);
+    d1[k][2] = 3 * (p[3] - p[2]);
+    d2[k][0] = 2 * (d1[k][1] - d1[k][0]);
+    d2[k][1] = 2 * (d1[k][2] - d1[k][1]);
+  }
+
+  for (i = 0; i < points->length; i++) {
+    gfloat t = points->t[i], u = (gfloat)1.0 - t;
+    gfloat p[3] = {points->x[i], points->y[i], points->z[i]};
+    gfloat numerator = 0, denominator = 0;
+
+    for (k = 0; k < 3; k++) {
+      gfloat q = cubic_at(c.p[k], t) - p[k];
+      gfloat q1 = (d1[k][0] * u + d1[k][1] * t) * u + (d1[k][1] * u + d1[k][2] * t) * t;
+      gfloat q2 = d2[k][0] * u + d2[k][1] * t;
+
+      numerator += q * q1;
+      denominator += q1 * q1 + q * q2;
+    }
+    /* With no slope to follow, there is no step to take */
+    if (denominator != 0)
+      t -= numerator / denominator;
+    /* Where the step would leave the curve, stop at its end */
+    points->next_t[i] = t < 0 ? 0 : t > 1 ? 1 : t;
+  }
+}
@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* fit-kernels.h: the inner loops of least-squares fitting. */
+
+#ifndef FIT_KERNELS_H
+#define FIT_KERNELS_H
+
+#include "curve.h"
+#include "spline.h"
+#include "vector.h"
+
+/* The loops that fit a spline to the points of a curve, and measure
+   how far the points are from it, run over the coordinates of many
+   points at once with the vector instructions of the processor: SSE2
+   or AVX2 on x86, chosen when the first loop runs.  Elsewhere they run
+   one point at a time.  Each point gives the same numbers either way;
+   the sums over the points are added in the same order either way, so
+   the fit does not depend on the processor.  */
+typedef enum {
+  FIT_KERNELS_SCALAR,
+  FIT_KERNELS_SSE2,
+  FIT_KERNELS_AVX2,
+  FIT_KERNELS_N_LEVELS
+} fit_kernels_level;
+
+/* The instructions the loops use.  */
+extern fit_kernels_level fit_kernels_get_level(void);
+
+/* Use the instructions of LEVEL from now on, in every thread, if the
+   processor has them; return FALSE otherwise.  For tests and
+   benchmarks.  */
+extern gboolean fit_kernels_set_level(fit_kernels_level level);
+
+/* Return the name of LEVEL, such as "avx2".  */
+extern const char *fit_kernels_level_name(fit_kernels_level level);
+
+/* The normal equations of the least-squares fit of a cubic from START
+   to END, with its control points on the tangents T1_HAT and T2_HAT,
+   to POINTS at their t values: the 2x2 matrix in C, and the right-hand
+   side in X.  See fit_one_spline.  */
+extern void fit_normal_equations(const curve_points_type *points, vector_type t1_hat,
+                                 vector_type t2_hat, at_real_coord start, at_real_coord end,
+                                 gfloat C[2][2], gfloat X[2]);
+
+/* Put the distance from each of POINTS to the cubic SPLINE at its t
+   value in POINTS->result.  */
+extern void fit_point_errors(curve_points_type *points, const spline_type *spline);
+
+/* Like `fit_point_errors', for only the COUNT of POINTS from FIRST on.
+   Each distance is the very same as `fit_point_errors' gives.  */
+extern void fit_point_errors_part(curve_points_type *points, const spline_type *spline,
+                                  unsigned first, unsigned count);
+
+/* Put the distance from the cubic SPLINE at the t value of each of
+   POINTS to the line through the ends of SPLINE in POINTS->result.  */
+extern void fit_line_distances(curve_points_type *points, const spline_type *spline);
+
+/* Put in POINTS->next_t the t value of each of POINTS moved by one
+   Newton-Raphson step toward the point of the cubic SPLINE nearest to
+   it, kept between 0 and 1.  This runs one point at a time at every
+   level, as it runs only when a fit is nearly good enough.  */
+extern void fit_reparameterize(curve_points_type *points, const spline_type *spline);
+
+#endif /* not FIT_KERNELS_H */
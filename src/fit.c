@@ -12,12 +12,15 @@
 
 #include "autotrace.h"
 #include "fit.h"
+#include "arena.h"
 #include "logreport.h"
 #include "spline.h"
 #include "vector.h"
 #include "curve.h"
+#include "fit-kernels.h"
 #include "pxl-outline.h"
 #include "epsilon-equal.h"
+#include "trace-stats.h"
 #include <glib.h>
 #include <math.h>
 #ifndef FLT_MAX
@@ -32,13 +35,14 @@
 #include <assert.h>
 
 #define SQUARE(x) ((x) * (x))
-#define CUBE(x) ((x) * (x) * (x))
 
-/* We need to manipulate lists of array indices.  */
+/* We need to manipulate lists of array indices.  Like the curves, they
+   are allocated in the arena of the trace.  */
 
 typedef struct index_list {
   unsigned *data;
   unsigned length;
+  unsigned capacity;
 } index_list_type;
 
 /* The usual accessor macros.  */
@@ -46,31 +50,44 @@ typedef struct index_list {
 #define INDEX_LIST_LENGTH(i_l) ((i_l).length)
 #define GET_LAST_INDEX(i_l) ((i_l).data[INDEX_LIST_LENGTH(i_l) - 1])
 
-static void append_index(index_list_type *, unsigned);
-static void free_index_list(index_list_type *);
+/* What find_corners knows of an outline: the sums of its coordinates
+   before each pixel, and the angle at each pixel once it is found
+   (negative until then).  Kept from one outline to the next.  */
+
+typedef struct {
+  gint64 *sum_x, *sum_y;
+  gfloat *angle;
+  unsigned capacity;
+} corner_scratch_type;
+
+static void append_index(arena_type *, index_list_type *, unsigned);
 static index_list_type new_index_list(void);
-static void remove_adjacent_corners(index_list_type *, unsigned, gboolean,
+static void remove_adjacent_corners(index_list_type *, unsigned, gboolean, arena_type *,
                                     at_exception_type *exception);
 static void change_bad_lines(spline_list_type *, fitting_opts_type *);
-static void filter(curve_type, fitting_opts_type *);
-static void find_vectors(unsigned, pixel_outline_type, vector_type *, vector_type *, unsigned);
-static index_list_type find_corners(pixel_outline_type, fitting_opts_type *,
-                                    at_exception_type *exception);
-static gfloat find_error(curve_type, spline_type, unsigned *, at_exception_type *exception);
+static void filter(curve_type, point_type *, fitting_opts_type *);
+static void find_vectors(unsigned, pixel_outline_type, corner_scratch_type *, vector_type *,
+                         vector_type *, unsigned);
+static gfloat find_angle(unsigned, pixel_outline_type, corner_scratch_type *, unsigned,
+                         at_exception_type *exception);
+static index_list_type find_corners(pixel_outline_type, fitting_opts_type *, corner_scratch_type *,
+                                    arena_type *, at_exception_type *exception);
+static gfloat find_error(curve_type, curve_points_type *, spline_type, gfloat bound, unsigned *,
+                         at_exception_type *exception);
 static vector_type find_half_tangent(curve_type, gboolean start, unsigned *, unsigned);
-static void find_tangent(curve_type, gboolean, gboolean, unsigned);
-static spline_type fit_one_spline(curve_type, at_exception_type *exception);
-static spline_list_type *fit_curve(curve_type, fitting_opts_type *, at_exception_type *exception);
-static spline_list_type fit_curve_list(curve_list_type, fitting_opts_type *, at_distance_map *,
-                                       at_exception_type *exception);
-static spline_list_type *fit_with_least_squares(curve_type, fitting_opts_type *,
+static void find_tangent(curve_type, gboolean, gboolean, unsigned, arena_type *);
+static spline_type fit_one_spline(curve_type, curve_points_type *, at_exception_type *exception);
+static spline_list_type *fit_curve(curve_type, fitting_opts_type *, arena_type *,
+                                   curve_points_type *, unsigned *subdivisions,
+                                   at_exception_type *exception);
+static spline_list_type *fit_with_least_squares(curve_type, fitting_opts_type *, arena_type *,
+                                                curve_points_type *, unsigned *subdivisions,
                                                 at_exception_type *exception);
 static spline_list_type *fit_with_line(curve_type);
-static void remove_knee_points(curve_type, gboolean);
+static void remove_knee_points(curve_type, gboolean, arena_type *);
 static void set_initial_parameter_values(curve_type);
-static gboolean spline_linear_enough(spline_type *, curve_type, fitting_opts_type *);
-static curve_list_array_type split_at_corners(pixel_outline_list_type, fitting_opts_type *,
-                                              at_exception_type *exception);
+static gboolean spline_linear_enough(spline_type *, curve_type, curve_points_type *,
+                                     fitting_opts_type *);
 static at_coord real_to_int_coord(at_real_coord);
 static gfloat distance(at_real_coord, at_real_coord);
 
@@ -95,27 +112,243 @@ fitting_opts_type new_fitting_opts(void)
   fitting_opts.despeckle_tightness = 2.0;
   fitting_opts.noise_removal = (gfloat)0.99;
   fitting_opts.centerline = FALSE;
+  fitting_opts.medial_axis = FALSE;
   fitting_opts.preserve_width = FALSE;
   fitting_opts.width_weight_factor = 6.0;
+  fitting_opts.threads = 1;
+  fitting_opts.reparameterize_iterations = 0;
 
   return (fitting_opts);
 }
 
+/* Fitting the curve lists in parallel.
+
+   Every curve list is fitted on its own, so `fitted_splines' can hand
+   them to a pool of worker threads.  The results are still merged by
+   the calling thread in the original order, and the messages raised
+   while fitting a list are buffered and replayed at merge time: the
+   output and the calls to the client's callbacks are then the same as
+   with the serial loop.  */
+
+typedef struct {
+  at_msg_type msg_type;
+  gchar *msg;
+} fit_message_type;
+
+typedef struct {
+  spline_list_type splines;
+  GArray *messages; /* of fit_message_type */
+  unsigned subdivisions;
+  gboolean done;
+} fit_job_type;
+
+typedef struct {
+  curve_list_array_type *curve_array;
+  fitting_opts_type *fitting_opts;
+  at_distance_map *dist;
+  fit_job_type *jobs;
+  gint abort;
+  GMutex lock;
+  GCond cond;
+} fit_pool_type;
+
+/* How long the merging thread waits for a curve list before it checks
+   for cancellation again, in microseconds.  */
+#define FIT_POLL_INTERVAL (100 * G_TIME_SPAN_MILLISECOND)
+
+static void buffer_message(const gchar *msg, at_msg_type msg_type, gpointer client_data)
+{
+  fit_job_type *job = client_data;
+  fit_message_type message;
+
+  if (!job->messages)
+    job->messages = g_array_new(FALSE, FALSE, sizeof(fit_message_type));
+  message.msg_type = msg_type;
+  message.msg = g_strdup(msg);
+  g_array_append_val(job->messages, message);
+}
+
+static void free_messages(fit_job_type *job)
+{
+  unsigned i;
+
+  if (!job->messages)
+    return;
+  for (i = 0; i < job->messages->len; i++)
+    g_free(g_array_index(job->messages, fit_message_type, i).msg);
+  g_array_free(job->messages, TRUE);
+  job->messages = NULL;
+}
+
+static void fit_curve_list_job(gpointer data, gpointer user_data)
+{
+  fit_pool_type *pool = user_data;
+  unsigned this_list = GPOINTER_TO_UINT(data) - 1;
+  fit_job_type *job = &pool->jobs[this_list];
+  at_exception_type exception = at_exception_new(buffer_message, job);
+
+  if (!g_atomic_int_get(&pool->abort)) {
+    /* The arena of the trace is not shared between threads: what is
+       built while fitting the list goes to one of the job's own, which
+       is done with once the list is fitted.  */
+    arena_type *arena = new_arena();
+
+    LOG("\nFitting curve list #%u:\n", this_list);
+    job->splines = fit_curve_list(CURVE_LIST_ARRAY_ELT(*pool->curve_array, this_list),
+                                  pool->fitting_opts, pool->dist, arena, &job->subdivisions,
+                                  &exception);
+    free_arena(arena);
+    /* Lists after a fatal one would be thrown away anyway */
+    if (at_exception_got_fatal(&exception))
+      g_atomic_int_set(&pool->abort, TRUE);
+  }
+
+  g_mutex_lock(&pool->lock);
+  job->done = TRUE;
+  g_cond_signal(&pool->cond);
+  g_mutex_unlock(&pool->lock);
+}
+
+/* Append LIST to CHAR_SPLINES, or hand it to EMIT if there is one,
+   counting its splines in STATS.  */
+
+static void keep_spline_list(spline_list_array_type *char_splines, spline_list_type list,
+                             spline_list_func emit, gpointer emit_data, at_trace_stats *stats)
+{
+  if (stats) {
+    unsigned this_spline;
+
+    stats->splines += SPLINE_LIST_LENGTH(list);
+    for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(list); this_spline++) {
+      if (SPLINE_DEGREE(SPLINE_LIST_ELT(list, this_spline)) == LINEARTYPE)
+        stats->lines++;
+      else if (SPLINE_DEGREE(SPLINE_LIST_ELT(list, this_spline)) == CUBICTYPE)
+        stats->cubics++;
+    }
+  }
+  if (emit) {
+    emit(char_splines, &list, emit_data);
+    free_spline_list(list);
+  } else
+    append_spline_list(char_splines, list);
+}
+
+/* Fit the curve lists of CURVE_ARRAY with N_THREADS worker threads and
+   keep the results in CHAR_SPLINES, in order.  */
+
+static void fit_curve_lists_in_parallel(spline_list_array_type *char_splines,
+                                        spline_list_func emit, gpointer emit_data,
+                                        at_trace_stats *stats, curve_list_array_type *curve_array,
+                                        pixel_outline_list_type pixel_outline_list,
+                                        fitting_opts_type *fitting_opts, at_distance_map *dist,
+                                        unsigned n_threads, at_exception_type *exception,
+                                        at_progress_func notify_progress, gpointer progress_data,
+                                        at_testcancel_func test_cancel, gpointer testcancel_data)
+{
+  unsigned this_list, i;
+  unsigned length = CURVE_LIST_ARRAY_LENGTH(*curve_array);
+  fit_pool_type pool;
+  GThreadPool *workers;
+
+  pool.curve_array = curve_array;
+  pool.fitting_opts = fitting_opts;
+  pool.dist = dist;
+  pool.jobs = g_new0(fit_job_type, length);
+  pool.abort = FALSE;
+  g_mutex_init(&pool.lock);
+  g_cond_init(&pool.cond);
+
+  workers = g_thread_pool_new(fit_curve_list_job, &pool, MIN(n_threads, length), TRUE, NULL);
+  for (this_list = 0; this_list < length; this_list++)
+    g_thread_pool_push(workers, GUINT_TO_POINTER(this_list + 1), NULL);
+
+  for (this_list = 0; this_list < length; this_list++) {
+    fit_job_type *job = &pool.jobs[this_list];
+    gboolean cancelled = FALSE;
+
+    if (notify_progress)
+      notify_progress((((gfloat)this_list) / ((gfloat)length * (gfloat)3.0) + (gfloat)0.333),
+                      progress_data);
+    if (test_cancel && test_cancel(testcancel_data))
+      break;
+
+    /* Wait for the list, still honouring a cancel request meanwhile */
+    g_mutex_lock(&pool.lock);
+    while (!job->done && !cancelled) {
+      if (!g_cond_wait_until(&pool.cond, &pool.lock, g_get_monotonic_time() + FIT_POLL_INTERVAL)
+          && test_cancel) {
+        g_mutex_unlock(&pool.lock);
+        cancelled = test_cancel(testcancel_data);
+        g_mutex_lock(&pool.lock);
+      }
+    }
+    g_mutex_unlock(&pool.lock);
+    if (cancelled)
+      break;
+
+    if (job->messages) {
+      for (i = 0; i < job->messages->len; i++) {
+        fit_message_type *message = &g_array_index(job->messages, fit_message_type, i);
+        if (message->msg_type == AT_MSG_FATAL)
+          at_exception_fatal(exception, message->msg);
+        else
+          at_exception_warning(exception, message->msg);
+      }
+    }
+    if (at_exception_got_fatal(exception))
+      break;
+
+    job->splines.clockwise = CURVE_LIST_ARRAY_ELT(*curve_array, this_list).clockwise;
+    memcpy(&(job->splines.color), &(O_LIST_OUTLINE(pixel_outline_list, this_list).color),
+           sizeof(at_color));
+    if (stats)
+      stats->subdivisions += job->subdivisions;
+    keep_spline_list(char_splines, job->splines, emit, emit_data, stats);
+  }
+
+  /* Drop the lists not started yet and wait for the running ones */
+  g_atomic_int_set(&pool.abort, TRUE);
+  g_thread_pool_free(workers, TRUE, TRUE);
+
+  for (i = 0; i < length; i++) {
+    if (i >= this_list && pool.jobs[i].done)
+      free_spline_list(pool.jobs[i].splines);
+    free_messages(&pool.jobs[i]);
+  }
+  g_free(pool.jobs);
+  g_mutex_clear(&pool.lock);
+  g_cond_clear(&pool.cond);
+}
+
 /* The top-level call that transforms the list of pixels in the outlines
    of the original character to a list of spline lists fitted to those
    pixels.  */
 
 spline_list_array_type fitted_splines(pixel_outline_list_type pixel_outline_list,
                                       fitting_opts_type *fitting_opts, at_distance_map *dist,
-                                      unsigned short width, unsigned short height,
+                                      unsigned int width, unsigned int height,
+                                      arena_type *arena, spline_list_func emit,
+                                      gpointer emit_data, at_trace_stats *stats,
                                       at_exception_type *exception,
                                       at_progress_func notify_progress, gpointer progress_data,
                                       at_testcancel_func test_cancel, gpointer testcancel_data)
 {
   unsigned this_list;
+  unsigned n_threads = fitting_opts->threads ? fitting_opts->threads : g_get_num_processors();
+  unsigned *subdivisions = stats ? &stats->subdivisions : NULL;
+  stage_mark_type mark;
 
   spline_list_array_type char_splines = new_spline_list_array();
-  curve_list_array_type curve_array = split_at_corners(pixel_outline_list, fitting_opts, exception);
+  curve_list_array_type curve_array;
+
+  stage_begin(stats, &mark);
+  curve_array = split_at_corners(pixel_outline_list, fitting_opts, arena, exception);
+  stage_end(stats, AT_STAGE_SPLIT, &mark);
+  if (stats) {
+    for (this_list = 0; this_list < CURVE_LIST_ARRAY_LENGTH(curve_array); this_list++)
+      stats->curves += CURVE_LIST_LENGTH(CURVE_LIST_ARRAY_ELT(curve_array, this_list));
+  }
+  stage_begin(stats, &mark);
 
   char_splines.centerline = fitting_opts->centerline;
   char_splines.preserve_width = fitting_opts->preserve_width;
@@ -129,6 +362,17 @@ spline_list_array_type fitted_splines(pixel_outline_list_type pixel_outline_list
   char_splines.width = width;
   char_splines.height = height;
 
+  if (n_threads > 1 && CURVE_LIST_ARRAY_LENGTH(curve_array) > 1) {
+    fit_curve_lists_in_parallel(&char_splines, emit, emit_data, stats, &curve_array,
+                                pixel_outline_list, fitting_opts, dist, n_threads, exception,
+                                notify_progress, progress_data, test_cancel, testcancel_data);
+    if (at_exception_got_fatal(exception) && char_splines.background_color) {
+      at_color_free(char_splines.background_color);
+      char_splines.background_color = NULL;
+    }
+    goto cleanup;
+  }
+
   for (this_list = 0; this_list < CURVE_LIST_ARRAY_LENGTH(curve_array); this_list++) {
     spline_list_type curve_list_splines;
     curve_list_type curves = CURVE_LIST_ARRAY_ELT(curve_array, this_list);
@@ -143,21 +387,23 @@ spline_list_array_type fitted_splines(pixel_outline_list_type pixel_outline_list
 
     LOG("\nFitting curve list #%u:\n", this_list);
 
-    curve_list_splines = fit_curve_list(curves, fitting_opts, dist, exception);
+    curve_list_splines = fit_curve_list(curves, fitting_opts, dist, arena, subdivisions, exception);
     if (at_exception_got_fatal(exception)) {
-      if (char_splines.background_color)
+      free_spline_list(curve_list_splines);
+      if (char_splines.background_color) {
         at_color_free(char_splines.background_color);
+        char_splines.background_color = NULL;
+      }
       goto cleanup;
     }
     curve_list_splines.clockwise = curves.clockwise;
 
     memcpy(&(curve_list_splines.color), &(O_LIST_OUTLINE(pixel_outline_list, this_list).color),
            sizeof(at_color));
-    append_spline_list(&char_splines, curve_list_splines);
+    keep_spline_list(&char_splines, curve_list_splines, emit, emit_data, stats);
   }
 cleanup:
-  free_curve_list_array(&curve_array, notify_progress, progress_data);
-
+  stage_end(stats, AT_STAGE_FIT, &mark);
   return char_splines;
 }
 
@@ -165,13 +411,16 @@ cleanup:
    it.  CURVE_LIST represents a single closed paths, e.g., either the
    inside or outside outline of an `o'.  */
 
-static spline_list_type fit_curve_list(curve_list_type curve_list, fitting_opts_type *fitting_opts,
-                                       at_distance_map *dist, at_exception_type *exception)
+spline_list_type fit_curve_list(curve_list_type curve_list, fitting_opts_type *fitting_opts,
+                                at_distance_map *dist, arena_type *arena, unsigned *subdivisions,
+                                at_exception_type *exception)
 {
   curve_type curve;
-  unsigned this_curve, this_spline;
+  point_type *scratch;
+  unsigned this_curve, this_spline, scratch_length = 0;
   unsigned curve_list_length = CURVE_LIST_LENGTH(curve_list);
   spline_list_type curve_list_splines = empty_spline_list();
+  curve_points_type points = EMPTY_CURVE_POINTS;
 
   curve_list_splines.open = curve_list.open;
 
@@ -182,7 +431,8 @@ static spline_list_type fit_curve_list(curve_list_type curve_list, fitting_opts_
   LOG("\nRemoving knees:\n");
   for (this_curve = 0; this_curve < curve_list_length; this_curve++) {
     LOG("#%u:", this_curve);
-    remove_knee_points(CURVE_LIST_ELT(curve_list, this_curve), CURVE_LIST_CLOCKWISE(curve_list));
+    remove_knee_points(CURVE_LIST_ELT(curve_list, this_curve), CURVE_LIST_CLOCKWISE(curve_list),
+                       arena);
   }
 
   if (dist != NULL) {
@@ -235,10 +485,14 @@ static spline_list_type fit_curve_list(curve_list_type curve_list, fitting_opts_
      look at an unfiltered curve when computing tangents.  */
 
   DEBUG("\nFiltering curves:\n");
+  for (this_curve = 0; this_curve < curve_list_length; this_curve++)
+    scratch_length = MAX(scratch_length, CURVE_LENGTH(CURVE_LIST_ELT(curve_list, this_curve)));
+  scratch = g_new(point_type, scratch_length);
   for (this_curve = 0; this_curve < curve_list.length; this_curve++) {
     DEBUG("#%u: ", this_curve);
-    filter(CURVE_LIST_ELT(curve_list, this_curve), fitting_opts);
+    filter(CURVE_LIST_ELT(curve_list, this_curve), scratch, fitting_opts);
   }
+  g_free(scratch);
 
   /* Make the first point in the first curve also be the last point in
      the last curve, so the fit to the whole curve list will begin and
@@ -253,7 +507,7 @@ static spline_list_type fit_curve_list(curve_list_type curve_list, fitting_opts_
      the fitting will fail.  */
   curve = CURVE_LIST_ELT(curve_list, 0);
   if (CURVE_CYCLIC(curve) == TRUE)
-    append_point(curve, CURVE_POINT(curve, 0));
+    append_point(arena, curve, CURVE_POINT(curve, 0));
 
   /* Finally, fit each curve in the list to a list of splines.  */
   for (this_curve = 0; this_curve < curve_list_length; this_curve++) {
@@ -262,7 +516,8 @@ static spline_list_type fit_curve_list(curve_list_type curve_list, fitting_opts_
 
     LOG("\nFitting curve #%u:\n", this_curve);
 
-    curve_splines = fit_curve(current_curve, fitting_opts, exception);
+    curve_splines =
+        fit_curve(current_curve, fitting_opts, arena, &points, subdivisions, exception);
     if (at_exception_got_fatal(exception))
       goto cleanup;
     else if (curve_splines == NULL) {
@@ -292,6 +547,7 @@ static spline_list_type fit_curve_list(curve_list_type curve_list, fitting_opts_
     print_spline(SPLINE_LIST_ELT(curve_list_splines, this_spline));
   }
 cleanup:
+  free_curve_points(&points);
   return curve_list_splines;
 }
 
@@ -300,7 +556,8 @@ cleanup:
    We return NULL if we cannot fit the points at all.  */
 
 static spline_list_type *fit_curve(curve_type curve, fitting_opts_type *fitting_opts,
-                                   at_exception_type *exception)
+                                   arena_type *arena, curve_points_type *points,
+                                   unsigned *subdivisions, at_exception_type *exception)
 {
   spline_list_type *fittedsplines;
 
@@ -311,12 +568,33 @@ static spline_list_type *fit_curve(curve_type curve, fitting_opts_type *fitting_
   }
 
   /* Do we have enough points to fit with a spline?  */
-  fittedsplines = CURVE_LENGTH(curve) < 4 ? fit_with_line(curve)
-                                          : fit_with_least_squares(curve, fitting_opts, exception);
+  fittedsplines = CURVE_LENGTH(curve) < 4
+                      ? fit_with_line(curve)
+                      : fit_with_least_squares(curve, fitting_opts, arena, points, subdivisions,
+                                               exception);
 
   return fittedsplines;
 }
 
+/* Return a list of N_POINTS points, allocated in ARENA, of the pixels of
+   OUTLINE from the one whose index is FIRST on, going round to the
+   start of OUTLINE after its end.  */
+
+static point_type *outline_points(pixel_outline_type outline, unsigned first, unsigned n_points,
+                                  arena_type *arena)
+{
+  point_type *points = arena_alloc(arena, (gsize)n_points * sizeof(point_type));
+  unsigned p, i = first;
+
+  for (p = 0; p < n_points; p++) {
+    points[p].coord.x = (gfloat)O_COORDINATE(outline, i).x;
+    points[p].coord.y = (gfloat)O_COORDINATE(outline, i).y;
+    points[p].coord.z = 0.0;
+    i = O_NEXT(outline, i);
+  }
+  return points;
+}
+
 /* As mentioned above, the first step is to find the corners in
    PIXEL_LIST, the list of points.  (Presumably we can't fit a single
    spline around a corner.)  The general strategy is to look through all
@@ -342,19 +620,20 @@ static spline_list_type *fit_curve(curve_type curve, fitting_opts_type *fitting_
    element (which in turn consists of several curves, one between each
    pair of corners) for each element in PIXEL_LIST.  */
 
-static curve_list_array_type split_at_corners(pixel_outline_list_type pixel_list,
-                                              fitting_opts_type *fitting_opts,
-                                              at_exception_type *exception)
+curve_list_array_type split_at_corners(pixel_outline_list_type pixel_list,
+                                       fitting_opts_type *fitting_opts, arena_type *arena,
+                                       at_exception_type *exception)
 {
   unsigned this_pixel_o;
   curve_list_array_type curve_array = new_curve_list_array();
+  corner_scratch_type scratch = {NULL, NULL, NULL, 0};
 
   LOG("\nFinding corners:\n");
 
   for (this_pixel_o = 0; this_pixel_o < O_LIST_LENGTH(pixel_list); this_pixel_o++) {
     curve_type curve, first_curve;
     index_list_type corner_list;
-    unsigned p, this_corner;
+    unsigned this_corner;
     curve_list_type curve_list = new_curve_list();
     pixel_outline_type pixel_o = O_LIST_OUTLINE(pixel_list, this_pixel_o);
 
@@ -369,47 +648,57 @@ static curve_list_array_type split_at_corners(pixel_outline_list_type pixel_list
        either side of a point before it is conceivable that we might
        want another corner.  */
     if (O_LENGTH(pixel_o) > fitting_opts->corner_surround * 2 + 2)
-      corner_list = find_corners(pixel_o, fitting_opts, exception);
+      corner_list = find_corners(pixel_o, fitting_opts, &scratch, arena, exception);
 
     else {
       int surround;
       if ((surround = (int)(O_LENGTH(pixel_o) - 3) / 2) >= 2) {
-        unsigned save_corner_surround = fitting_opts->corner_surround;
-        fitting_opts->corner_surround = surround;
-        corner_list = find_corners(pixel_o, fitting_opts, exception);
-        fitting_opts->corner_surround = save_corner_surround;
+        /* Work on a copy: the caller's options may be shared with
+           other traces running at the same time.  */
+        fitting_opts_type short_opts = *fitting_opts;
+        short_opts.corner_surround = surround;
+        corner_list = find_corners(pixel_o, &short_opts, &scratch, arena, exception);
       } else {
-        corner_list.length = 0;
-        corner_list.data = NULL;
+        corner_list = new_index_list();
       }
     }
 
     /* Remember the first curve so we can make it be the `next' of the
        last one.  (And vice versa.)  */
-    first_curve = new_curve();
+    first_curve = new_curve(arena);
 
     curve = first_curve;
 
     if (corner_list.length == 0) { /* No corners.  Use all of the pixel outline as the curve.  */
-      for (p = 0; p < O_LENGTH(pixel_o); p++)
-        append_pixel(curve, O_COORDINATE(pixel_o, p));
+      /* With room for the first point again at the end, which
+         `fit_curve_list' appends to a cyclic curve.  */
+      curve->point_list = outline_points(pixel_o, 0, O_LENGTH(pixel_o) + 1, arena);
+      CURVE_LENGTH(curve) = O_LENGTH(pixel_o);
+      curve->capacity = O_LENGTH(pixel_o) + 1;
 
       if (curve_list.open == TRUE)
         CURVE_CYCLIC(curve) = FALSE;
       else
         CURVE_CYCLIC(curve) = TRUE;
     } else { /* Each curve consists of the points between (inclusive) each pair
-                of corners.  */
+                of corners.  The curves are all in one list of the points
+                of the outline, from the first corner on, and round to it
+                again if the outline is closed; each curve shares its
+                last point with the next one.  */
+      unsigned first = pixel_o.open ? 0 : GET_INDEX(corner_list, 0);
+      unsigned n_points = O_LENGTH(pixel_o) + (pixel_o.open ? 0 : 1);
+      point_type *points = outline_points(pixel_o, first, n_points, arena);
+
       for (this_corner = 0; this_corner < corner_list.length - 1; this_corner++) {
         curve_type previous_curve = curve;
         unsigned corner = GET_INDEX(corner_list, this_corner);
         unsigned next_corner = GET_INDEX(corner_list, this_corner + 1);
 
-        for (p = corner; p <= next_corner; p++)
-          append_pixel(curve, O_COORDINATE(pixel_o, p));
+        curve->point_list = points + (corner - first);
+        CURVE_LENGTH(curve) = next_corner - corner + 1;
 
-        append_curve(&curve_list, curve);
-        curve = new_curve();
+        append_curve(arena, &curve_list, curve);
+        curve = new_curve(arena);
         NEXT_CURVE(previous_curve) = curve;
         PREVIOUS_CURVE(curve) = previous_curve;
       }
@@ -417,13 +706,10 @@ static curve_list_array_type split_at_corners(pixel_outline_list_type pixel_list
       /* The last curve is different.  It consists of the points
          (inclusive) between the last corner and the end of the list,
          and the beginning of the list and the first corner.  */
-      for (p = GET_LAST_INDEX(corner_list); p < O_LENGTH(pixel_o); p++)
-        append_pixel(curve, O_COORDINATE(pixel_o, p));
+      curve->point_list = points + (GET_LAST_INDEX(corner_list) - first);
+      CURVE_LENGTH(curve) = n_points - (GET_LAST_INDEX(corner_list) - first);
 
-      if (!pixel_o.open) {
-        for (p = 0; p <= GET_INDEX(corner_list, 0); p++)
-          append_pixel(curve, O_COORDINATE(pixel_o, p));
-      } else {
+      if (pixel_o.open) {
         curve_type last_curve = PREVIOUS_CURVE(curve);
         PREVIOUS_CURVE(first_curve) = NULL;
         if (last_curve)
@@ -432,18 +718,20 @@ static curve_list_array_type split_at_corners(pixel_outline_list_type pixel_list
     }
 
     LOG(" [%u].\n", corner_list.length);
-    free_index_list(&corner_list);
 
     /* Add `curve' to the end of the list, updating the pointers in
        the chain.  */
-    append_curve(&curve_list, curve);
+    append_curve(arena, &curve_list, curve);
     NEXT_CURVE(curve) = first_curve;
     PREVIOUS_CURVE(first_curve) = curve;
 
     /* And now add the just-completed curve list to the array.  */
-    append_curve_list(&curve_array, curve_list);
+    append_curve_list(arena, &curve_array, curve_list);
   } /* End of considering each pixel outline.  */
 
+  g_free(scratch.sum_x);
+  g_free(scratch.sum_y);
+  g_free(scratch.angle);
   return curve_array;
 }
 
@@ -460,16 +748,31 @@ static curve_list_array_type split_at_corners(pixel_outline_list_type pixel_list
 
 #define APPEND_CORNER(index, angle, c)                                                             \
   do {                                                                                             \
-    append_index(&corner_list, index);                                                             \
-    LOG(" (%d,%d)%c%.3f", O_COORDINATE(pixel_outline, index).x,                                    \
+    append_index(arena, &corner_list, index);                                                      \
+    LOG(" (%u,%u)%c%.3f", O_COORDINATE(pixel_outline, index).x,                                    \
         O_COORDINATE(pixel_outline, index).y, c, angle);                                           \
   } while (0)
 
 static index_list_type find_corners(pixel_outline_type pixel_outline,
-                                    fitting_opts_type *fitting_opts, at_exception_type *exception)
+                                    fitting_opts_type *fitting_opts, corner_scratch_type *scratch,
+                                    arena_type *arena, at_exception_type *exception)
 {
   unsigned p, start_p, end_p;
   index_list_type corner_list = new_index_list();
+  unsigned n = O_LENGTH(pixel_outline);
+
+  if (n > scratch->capacity) {
+    scratch->capacity = MAX(n, scratch->capacity * 2);
+    scratch->sum_x = g_renew(gint64, scratch->sum_x, scratch->capacity + 1);
+    scratch->sum_y = g_renew(gint64, scratch->sum_y, scratch->capacity + 1);
+    scratch->angle = g_renew(gfloat, scratch->angle, scratch->capacity);
+  }
+  scratch->sum_x[0] = scratch->sum_y[0] = 0;
+  for (p = 0; p < n; p++) {
+    scratch->sum_x[p + 1] = scratch->sum_x[p] + O_COORDINATE(pixel_outline, p).x;
+    scratch->sum_y[p + 1] = scratch->sum_y[p] + O_COORDINATE(pixel_outline, p).y;
+    scratch->angle[p] = -1;
+  }
 
   start_p = 0;
   end_p = O_LENGTH(pixel_outline) - 1;
@@ -484,11 +787,9 @@ static index_list_type find_corners(pixel_outline_type pixel_outline,
   /* Consider each pixel on the outline in turn.  */
   for (p = start_p; p <= end_p; p++) {
     gfloat corner_angle;
-    vector_type in_vector, out_vector;
 
     /* Check if the angle is small enough.  */
-    find_vectors(p, pixel_outline, &in_vector, &out_vector, fitting_opts->corner_surround);
-    corner_angle = Vangle(in_vector, out_vector, exception);
+    corner_angle = find_angle(p, pixel_outline, scratch, fitting_opts->corner_surround, exception);
     if (at_exception_got_fatal(exception))
       goto cleanup;
 
@@ -527,8 +828,8 @@ static index_list_type find_corners(pixel_outline_type pixel_outline,
 
         /* Check the angle.  */
         q = i % O_LENGTH(pixel_outline);
-        find_vectors(q, pixel_outline, &in_vector, &out_vector, fitting_opts->corner_surround);
-        corner_angle = Vangle(in_vector, out_vector, exception);
+        corner_angle =
+            find_angle(q, pixel_outline, scratch, fitting_opts->corner_surround, exception);
         if (at_exception_got_fatal(exception))
           goto cleanup;
 
@@ -537,15 +838,14 @@ static index_list_type find_corners(pixel_outline_type pixel_outline,
            happens, for example, at the points on the `W' in some
            typefaces, where the ``points'' are flat.  */
         if (epsilon_equal(corner_angle, best_corner_angle))
-          append_index(&equally_good_list, q);
+          append_index(arena, &equally_good_list, q);
 
         else if (corner_angle < best_corner_angle) {
           best_corner_angle = corner_angle;
           /* We want to check `corner_surround' pixels beyond the
              new best corner.  */
           i = best_corner_index = q;
-          free_index_list(&equally_good_list);
-          equally_good_list = new_index_list();
+          INDEX_LIST_LENGTH(equally_good_list) = 0;
         }
 
         i++;
@@ -564,7 +864,6 @@ static index_list_type find_corners(pixel_outline_type pixel_outline,
         for (j = 0; j < INDEX_LIST_LENGTH(equally_good_list); j++)
           APPEND_CORNER(GET_INDEX(equally_good_list, j), best_corner_angle, '@');
       }
-      free_index_list(&equally_good_list);
 
       /* If we wrapped around in our search, we're done; otherwise,
          we don't want the outer loop to look at the pixels that we
@@ -578,39 +877,83 @@ static index_list_type find_corners(pixel_outline_type pixel_outline,
        only way to fit such a ``curve'' would be with a straight
        line, which usually interrupts the continuity dreadfully.  */
     remove_adjacent_corners(&corner_list, O_LENGTH(pixel_outline) - (pixel_outline.open ? 2 : 1),
-                            fitting_opts->remove_adjacent_corners, exception);
+                            fitting_opts->remove_adjacent_corners, arena, exception);
 cleanup:
   return corner_list;
 }
 
+/* Put the sums of the coordinates of COUNT points of an outline of N
+   points, from the one whose index is START on, going round as often
+   as it takes, in SUM_X and SUM_Y.  */
+
+static void cyclic_sums(corner_scratch_type *scratch, unsigned n, unsigned start, unsigned count,
+                        gint64 *sum_x, gint64 *sum_y)
+{
+  unsigned end = start + count % n;
+
+  *sum_x = (gint64)(count / n) * scratch->sum_x[n];
+  *sum_y = (gint64)(count / n) * scratch->sum_y[n];
+  if (end <= n) {
+    *sum_x += scratch->sum_x[end] - scratch->sum_x[start];
+    *sum_y += scratch->sum_y[end] - scratch->sum_y[start];
+  } else {
+    *sum_x += scratch->sum_x[n] - scratch->sum_x[start] + scratch->sum_x[end - n];
+    *sum_y += scratch->sum_y[n] - scratch->sum_y[start] + scratch->sum_y[end - n];
+  }
+}
+
 /* Return the difference vectors coming in and going out of the outline
    OUTLINE at the point whose index is TEST_INDEX.  In Phoenix,
    Schneider looks at a single point on either side of the point we're
    considering.  That works for him because his points are not touching.
    But our points *are* touching, and so we have to look at
    `corner_surround' points on either side, to get a better picture of
-   the outline's shape.  */
+   the outline's shape.
 
-static void find_vectors(unsigned test_index, pixel_outline_type outline, vector_type *in,
-                         vector_type *out, unsigned corner_surround)
+   The sum of the differences is the sum of the points less
+   `corner_surround' times the point, and the sums of the points are
+   differences of the sums in SCRATCH, so it does not matter how many
+   there are.  The sums are whole numbers, as adding up the differences
+   one at a time gave them.  */
+
+static void find_vectors(unsigned test_index, pixel_outline_type outline,
+                         corner_scratch_type *scratch, vector_type *in, vector_type *out,
+                         unsigned corner_surround)
 {
-  int i;
-  unsigned n_done;
+  unsigned n = O_LENGTH(outline);
   at_coord candidate = O_COORDINATE(outline, test_index);
+  gint64 in_x, in_y, out_x, out_y;
 
-  in->dx = in->dy = in->dz = 0.0;
-  out->dx = out->dy = out->dz = 0.0;
+  /* The `corner_surround' points before p, going round as often as it
+     takes, end at the point before p.  */
+  cyclic_sums(scratch, n, (test_index + n - corner_surround % n) % n, corner_surround, &in_x,
+              &in_y);
+  /* And the points after p.  */
+  cyclic_sums(scratch, n, O_NEXT(outline, test_index), corner_surround, &out_x, &out_y);
+
+  in->dx = (gfloat)(in_x - (gint64)corner_surround * candidate.x);
+  in->dy = (gfloat)(in_y - (gint64)corner_surround * candidate.y);
+  in->dz = 0.0;
+  out->dx = (gfloat)(out_x - (gint64)corner_surround * candidate.x);
+  out->dy = (gfloat)(out_y - (gint64)corner_surround * candidate.y);
+  out->dz = 0.0;
+}
 
-  /* Add up the differences from p of the `corner_surround' points
-     before p.  */
-  for (i = O_PREV(outline, test_index), n_done = 0; n_done < corner_surround;
-       i = O_PREV(outline, i), n_done++)
-    *in = Vadd(*in, IPsubtract(O_COORDINATE(outline, i), candidate));
+/* Return the angle at the point of OUTLINE whose index is TEST_INDEX,
+   from the vectors of find_vectors, working it out only the first
+   time.  */
 
-  /* And the points after p.  */
-  for (i = O_NEXT(outline, test_index), n_done = 0; n_done < corner_surround;
-       i = O_NEXT(outline, i), n_done++)
-    *out = Vadd(*out, IPsubtract(O_COORDINATE(outline, i), candidate));
+static gfloat find_angle(unsigned test_index, pixel_outline_type outline,
+                         corner_scratch_type *scratch, unsigned corner_surround,
+                         at_exception_type *exception)
+{
+  if (scratch->angle[test_index] < 0) {
+    vector_type in_vector, out_vector;
+
+    find_vectors(test_index, outline, scratch, &in_vector, &out_vector, corner_surround);
+    scratch->angle[test_index] = Vangle(in_vector, out_vector, exception);
+  }
+  return scratch->angle[test_index];
 }
 
 /* Remove adjacent points from the index list LIST.  We do this by first
@@ -624,7 +967,8 @@ static void find_vectors(unsigned test_index, pixel_outline_type outline, vector
    two-pixel-long curves, which can only be fit by straight lines.  */
 
 static void remove_adjacent_corners(index_list_type *list, unsigned last_index,
-                                    gboolean remove_adj_corners, at_exception_type *exception)
+                                    gboolean remove_adj_corners, arena_type *arena,
+                                    at_exception_type *exception)
 {
   unsigned j;
   unsigned last;
@@ -664,7 +1008,7 @@ static void remove_adjacent_corners(index_list_type *list, unsigned last_index,
     if ((remove_adj_corners) && ((next == current + 1) || (next == current)))
       j++;
 
-    append_index(&new_list, current);
+    append_index(arena, &new_list, current);
   }
 
   /* Don't append the last element if it is 1) adjacent to the previous
@@ -672,9 +1016,8 @@ static void remove_adjacent_corners(index_list_type *list, unsigned last_index,
   last = GET_LAST_INDEX(*list);
   if (INDEX_LIST_LENGTH(new_list) == 0 ||
       !(last == GET_LAST_INDEX(new_list) + 1 || (last == last_index && GET_INDEX(*list, 0) == 0)))
-    append_index(&new_list, last);
+    append_index(arena, &new_list, last);
 
-  free_index_list(list);
   *list = new_list;
 }
 
@@ -713,51 +1056,79 @@ static void remove_adjacent_corners(index_list_type *list, unsigned last_index,
    (prev_delta.dy == -1.0 && next_delta.dx == 1.0) ||                                              \
    (prev_delta.dx == -1.0 && next_delta.dy == -1.0))
 
-static void remove_knee_points(curve_type curve, gboolean clockwise)
+/* The kept points are moved down in place, so the curve is only ever
+   read at or ahead of where it is written.  Kept points are rounded to
+   pixels, as the rest of the knee test sees them.  Only the last point
+   of a one point open curve can need more room; as the curve shares
+   its list of points with the next one (see `split_at_corners'), it
+   gets a list of its own then.  */
+
+#define KEEP_PIXEL(curve, n, p)                                                                    \
+  do {                                                                                             \
+    CURVE_POINT(curve, n).x = (p).x;                                                               \
+    CURVE_POINT(curve, n).y = (p).y;                                                               \
+    CURVE_POINT(curve, n).z = 0.0;                                                                 \
+    n++;                                                                                           \
+  } while (0)
+
+static void remove_knee_points(curve_type curve, gboolean clockwise, arena_type *arena)
 {
-  unsigned i;
+  unsigned i, n_kept = 0, length = CURVE_LENGTH(curve);
   unsigned offset = (CURVE_CYCLIC(curve) == TRUE) ? 0 : 1;
   at_coord previous = real_to_int_coord(CURVE_POINT(curve, CURVE_PREV(curve, offset)));
-  curve_type trimmed_curve = copy_most_of_curve(curve);
+  at_coord first = real_to_int_coord(CURVE_POINT(curve, 0));
+  at_coord last = real_to_int_coord(LAST_CURVE_POINT(curve));
 
   if (CURVE_CYCLIC(curve) == FALSE)
-    append_pixel(trimmed_curve, real_to_int_coord(CURVE_POINT(curve, 0)));
+    KEEP_PIXEL(curve, n_kept, first);
 
-  for (i = offset; i < CURVE_LENGTH(curve) - offset; i++) {
+  for (i = offset; i < length - offset; i++) {
     at_coord current = real_to_int_coord(CURVE_POINT(curve, i));
-    at_coord next = real_to_int_coord(CURVE_POINT(curve, CURVE_NEXT(curve, i)));
+    at_coord next = (i + 1 == length) ? first : real_to_int_coord(CURVE_POINT(curve, i + 1));
     vector_type prev_delta = IPsubtract(previous, current);
     vector_type next_delta = IPsubtract(next, current);
 
     if (ONLY_ONE_ZERO(prev_delta) && ONLY_ONE_ZERO(next_delta) &&
         ((clockwise && CLOCKWISE_KNEE(prev_delta, next_delta)) ||
          (!clockwise && COUNTERCLOCKWISE_KNEE(prev_delta, next_delta))))
-      LOG(" (%d,%d)", current.x, current.y);
+      LOG(" (%u,%u)", current.x, current.y);
     else {
       previous = current;
-      append_pixel(trimmed_curve, current);
+      KEEP_PIXEL(curve, n_kept, current);
     }
   }
 
-  if (CURVE_CYCLIC(curve) == FALSE)
-    append_pixel(trimmed_curve, real_to_int_coord(LAST_CURVE_POINT(curve)));
+  if (CURVE_CYCLIC(curve) == FALSE) {
+    if (n_kept == length) {
+      point_type *points = arena_alloc(arena, (gsize)(n_kept + 1) * sizeof(point_type));
 
-  if (CURVE_LENGTH(trimmed_curve) == CURVE_LENGTH(curve))
+      memcpy(points, curve->point_list, n_kept * sizeof(point_type));
+      curve->point_list = points;
+      curve->capacity = n_kept + 1;
+    }
+    KEEP_PIXEL(curve, n_kept, last);
+  }
+  CURVE_LENGTH(curve) = n_kept;
+
+  if (CURVE_LENGTH(curve) == length)
     LOG(" (none)");
 
   LOG(".\n");
-
-  free_curve(curve);
-  *curve = *trimmed_curve;
-  g_free(trimmed_curve); /* free_curve? --- Masatake */
 }
 
+#undef KEEP_PIXEL
+
 /* Smooth the curve by adding in neighboring points.  Do this
-   `filter_iterations' times.  But don't change the corners.  */
+   `filter_iterations' times.  But don't change the corners.  Each
+   iteration reads the points the last one wrote, and writes the other
+   of the list of CURVE and SCRATCH, which has room for all the points
+   of CURVE.  The points end up in the list of CURVE, so SCRATCH can be
+   shared by all the curves being filtered.  */
 
-static void filter(curve_type curve, fitting_opts_type *fitting_opts)
+static void filter(curve_type curve, point_type *scratch, fitting_opts_type *fitting_opts)
 {
   unsigned iteration, this_point;
+  point_type *points = curve->point_list, *to = scratch;
   unsigned offset = (CURVE_CYCLIC(curve) == TRUE) ? 0 : 1;
   at_real_coord prev_new_point;
 
@@ -775,12 +1146,12 @@ static void filter(curve_type curve, fitting_opts_type *fitting_opts)
   prev_new_point.z = FLT_MAX;
 
   for (iteration = 0; iteration < fitting_opts->filter_iterations; iteration++) {
-    curve_type newcurve = copy_most_of_curve(curve);
     gboolean collapsed = FALSE;
+    unsigned n_new = 0;
 
     /* Keep the first point on the curve.  */
     if (offset)
-      append_point(newcurve, CURVE_POINT(curve, 0));
+      to[n_new++].coord = CURVE_POINT(curve, 0);
 
     for (this_point = offset; this_point < CURVE_LENGTH(curve) - offset; this_point++) {
       vector_type in, out, sum;
@@ -829,23 +1200,26 @@ static void filter(curve_type curve, fitting_opts_type *fitting_opts)
         break;
       }
 
-      /* Put the newly computed point into a separate curve, so it
+      /* Put the newly computed point into a separate list, so it
          doesn't affect future computation (on this iteration).  */
-      append_point(newcurve, prev_new_point = new_point);
+      to[n_new++].coord = prev_new_point = new_point;
     }
 
-    if (collapsed)
-      free_curve(newcurve);
-    else {
+    if (!collapsed) {
+      point_type *from = curve->point_list;
+
       /* Just as with the first point, we have to keep the last point.  */
       if (offset)
-        append_point(newcurve, LAST_CURVE_POINT(curve));
+        to[n_new++].coord = LAST_CURVE_POINT(curve);
 
       /* Set the original curve to the newly filtered one, and go again.  */
-      free_curve(curve);
-      *curve = *newcurve;
+      curve->point_list = to;
+      to = from;
     }
-    g_free(newcurve);
+  }
+  if (curve->point_list != points) {
+    memcpy(points, curve->point_list, CURVE_LENGTH(curve) * sizeof(point_type));
+    curve->point_list = points;
   }
 
   log_curve(curve, FALSE);
@@ -875,18 +1249,36 @@ static spline_list_type *fit_with_line(curve_type curve)
   return new_spline_list_with_spline(line);
 }
 
+/* Fits off by more than this many times the error threshold are
+   subdivided without reparameterizing: moving the points along the
+   spline seldom brings them close enough.  */
+#define REPARAMETERIZE_LIMIT 4
+
+/* find_error with a bound looks for an error past it after every so
+   many points, a multiple of the lanes of fit-kernels.c */
+#define ERROR_BLOCK 32
+
+/* Make the next t values of POINTS the current ones, and back.  */
+#define SWAP_T(points)                                                                             \
+  do {                                                                                             \
+    gfloat *swap_t = (points)->t;                                                                  \
+    (points)->t = (points)->next_t;                                                                \
+    (points)->next_t = swap_t;                                                                     \
+  } while (0)
+
 /* The least squares method is well described in Schneider's thesis.
    Briefly, we try to fit the entire curve with one spline. If that
    fails, we subdivide the curve.  */
 
 static spline_list_type *fit_with_least_squares(curve_type curve, fitting_opts_type *fitting_opts,
+                                                arena_type *arena, curve_points_type *points,
+                                                unsigned *subdivisions,
                                                 at_exception_type *exception)
 {
-  gfloat error = 0, best_error = FLT_MAX;
+  gfloat error = 0, best_error;
   spline_type spline, best_spline;
   spline_list_type *spline_list = NULL;
-  unsigned worst_point = 0;
-  gfloat previous_error = FLT_MAX;
+  unsigned worst_point = 0, this_worst_point, iteration;
 
   LOG("\nFitting with least squares:\n");
 
@@ -899,37 +1291,25 @@ static spline_list_type *fit_with_least_squares(curve_type curve, fitting_opts_t
      more coherent.  */
 
   LOG("Finding tangents:\n");
-  find_tangent(curve, /* to_start */ TRUE, /* cross_curve */ FALSE, fitting_opts->tangent_surround);
+  find_tangent(curve, /* to_start */ TRUE, /* cross_curve */ FALSE, fitting_opts->tangent_surround,
+               arena);
   find_tangent(curve, /* to_start */ FALSE, /* cross_curve */ FALSE,
-               fitting_opts->tangent_surround);
+               fitting_opts->tangent_surround, arena);
 
   set_initial_parameter_values(curve);
+  gather_curve_points(points, curve);
 
-  /* Now we loop, subdividing, until CURVE has
-     been fit.  */
-  while (TRUE) {
-    spline = best_spline = fit_one_spline(curve, exception);
-    if (at_exception_got_fatal(exception))
-      goto cleanup;
-
-    if (SPLINE_DEGREE(spline) == LINEARTYPE)
-      LOG("  fitted to line:\n");
-    else
-      LOG("  fitted to spline:\n");
-
-    LOG("    ");
-    print_spline(spline);
+  spline = fit_one_spline(curve, points, exception);
+  if (at_exception_got_fatal(exception))
+    goto cleanup;
 
-    if (SPLINE_DEGREE(spline) == LINEARTYPE)
-      break;
+  if (SPLINE_DEGREE(spline) == LINEARTYPE)
+    LOG("  fitted to line:\n");
+  else
+    LOG("  fitted to spline:\n");
 
-    error = find_error(curve, spline, &worst_point, exception);
-    if (error <= previous_error) {
-      best_error = error;
-      best_spline = spline;
-    }
-    break;
-  }
+  LOG("    ");
+  print_spline(spline);
 
   if (SPLINE_DEGREE(spline) == LINEARTYPE) {
     spline_list = new_spline_list_with_spline(spline);
@@ -937,6 +1317,40 @@ static spline_list_type *fit_with_least_squares(curve_type curve, fitting_opts_t
     return (spline_list);
   }
 
+  best_spline = spline;
+  best_error = find_error(curve, points, spline, INFINITY, &worst_point, exception);
+
+  /* A fit that misses by not much more than the threshold may only have
+     put the points at the wrong places along the spline.  Move each
+     point's t value toward the nearest point of the spline, by
+     Newton-Raphson, and fit again, for as long as that helps; this
+     saves subdividing the curve.  The t values in POINTS stay those of
+     the best fit, for `spline_linear_enough'.  */
+  for (iteration = 0; iteration < fitting_opts->reparameterize_iterations &&
+                      best_error >= fitting_opts->error_threshold &&
+                      best_error < fitting_opts->error_threshold * REPARAMETERIZE_LIMIT;
+       iteration++) {
+    fit_reparameterize(points, &best_spline);
+    SWAP_T(points);
+
+    spline = fit_one_spline(curve, points, exception);
+    if (at_exception_got_fatal(exception))
+      goto cleanup;
+    LOG("  reparameterized and fitted to spline:\n    ");
+    print_spline(spline);
+
+    /* A step that does not help is thrown away, so stop looking once
+       it is clear it does not.  */
+    error = find_error(curve, points, spline, best_error, &this_worst_point, exception);
+    if (error >= best_error) {
+      SWAP_T(points);
+      break;
+    }
+    best_error = error;
+    best_spline = spline;
+    worst_point = this_worst_point;
+  }
+
   /* Go back to the best fit.  */
   spline = best_spline;
   error = best_error;
@@ -946,7 +1360,7 @@ static spline_list_type *fit_with_least_squares(curve_type curve, fitting_opts_t
        spline.  We end up here whenever a fit is accepted.  We have
        one more job: see if the ``curve'' that was fit should really
        be a straight line. */
-    if (spline_linear_enough(&spline, curve, fitting_opts)) {
+    if (spline_linear_enough(&spline, curve, points, fitting_opts)) {
       SPLINE_DEGREE(spline) = LINEARTYPE;
       LOG("Changed to line.\n");
     }
@@ -957,8 +1371,8 @@ static spline_list_type *fit_with_least_squares(curve_type curve, fitting_opts_t
     unsigned subdivision_index;
     spline_list_type *left_spline_list;
     spline_list_type *right_spline_list;
-    curve_type left_curve = new_curve();
-    curve_type right_curve = new_curve();
+    curve_type left_curve = new_curve(arena);
+    curve_type right_curve = new_curve(arena);
 
     /* Keep the linked list of curves intact.  */
     NEXT_CURVE(right_curve) = NEXT_CURVE(curve);
@@ -967,6 +1381,8 @@ static spline_list_type *fit_with_least_squares(curve_type curve, fitting_opts_t
     PREVIOUS_CURVE(left_curve) = curve;
     NEXT_CURVE(curve) = left_curve;
 
+    if (subdivisions)
+      (*subdivisions)++;
     LOG("\nSubdividing (error %.3f):\n", error);
     LOG("  Original point: (%.3f,%.3f), #%u.\n", CURVE_POINT(curve, worst_point).x,
         CURVE_POINT(curve, worst_point).y, worst_point);
@@ -993,21 +1409,24 @@ static spline_list_type *fit_with_least_squares(curve_type curve, fitting_opts_t
        character.  But we want to use information on both sides of the
        point to compute the tangent, hence cross_curve = true.  */
     find_tangent(left_curve, /* to_start_point: */ FALSE,
-                 /* cross_curve: */ TRUE, fitting_opts->tangent_surround);
+                 /* cross_curve: */ TRUE, fitting_opts->tangent_surround, arena);
     CURVE_START_TANGENT(right_curve) = CURVE_END_TANGENT(left_curve);
 
     /* Now that we've set up the curves, we can fit them.  */
-    left_spline_list = fit_curve(left_curve, fitting_opts, exception);
+    left_spline_list =
+        fit_curve(left_curve, fitting_opts, arena, points, subdivisions, exception);
     if (at_exception_got_fatal(exception))
-      /* TODO: Memory allocated for left_curve and right_curve
-         will leak. */
       goto cleanup;
 
-    right_spline_list = fit_curve(right_curve, fitting_opts, exception);
-    /* TODO: Memory allocated for left_curve and right_curve
-       will leak. */
-    if (at_exception_got_fatal(exception))
+    right_spline_list =
+        fit_curve(right_curve, fitting_opts, arena, points, subdivisions, exception);
+    if (at_exception_got_fatal(exception)) {
+      if (left_spline_list) {
+        free_spline_list(*left_spline_list);
+        g_free(left_spline_list);
+      }
       goto cleanup;
+    }
 
     /* Neither of the subdivided curves could be fit, so fail.  */
     if (left_spline_list == NULL && right_spline_list == NULL)
@@ -1033,10 +1452,6 @@ static spline_list_type *fit_with_least_squares(curve_type curve, fitting_opts_t
       free_spline_list(*right_spline_list);
       g_free(right_spline_list);
     }
-    if (CURVE_END_TANGENT(left_curve))
-      g_free(CURVE_END_TANGENT(left_curve));
-    g_free(left_curve);
-    g_free(right_curve);
   }
 cleanup:
   return spline_list;
@@ -1053,65 +1468,30 @@ cleanup:
 
    See pp.57--59 of the Phoenix thesis.
 
-   The B?(t) here corresponds to B_i^3(U_i) there.
    The Bernshte\u in polynomials of degree n are defined by
-   B_i^n(t) = { n \choose i } t^i (1-t)^{n-i}, i = 0..n  */
+   B_i^n(t) = { n \choose i } t^i (1-t)^{n-i}, i = 0..n; the sums over
+   the points are in fit_normal_equations.  */
 
-#define B0(t) CUBE((gfloat)1.0 - (t))
-#define B1(t) ((gfloat)3.0 * (t) * SQUARE((gfloat)1.0 - (t)))
-#define B2(t) ((gfloat)3.0 * SQUARE(t) * ((gfloat)1.0 - (t)))
-#define B3(t) CUBE(t)
-
-static spline_type fit_one_spline(curve_type curve, at_exception_type *exception)
+static spline_type fit_one_spline(curve_type curve, curve_points_type *points,
+                                  at_exception_type *exception)
 {
   /* Since our arrays are zero-based, the `C0' and `C1' here correspond
      to `C1' and `C2' in the paper.  */
   gfloat X_C1_det, C0_X_det, C0_C1_det;
   gfloat alpha1, alpha2;
   spline_type spline = {0};
-  vector_type start_vector, end_vector;
-  unsigned i;
-  g_autofree vector_type *A = NULL;
   vector_type t1_hat = *CURVE_START_TANGENT(curve);
   vector_type t2_hat = *CURVE_END_TANGENT(curve);
-  gfloat C[2][2] = {{0.0, 0.0}, {0.0, 0.0}};
-  gfloat X[2] = {0.0, 0.0};
-
-  A = g_malloc(CURVE_LENGTH(curve) * 2 * sizeof(vector_type)); /* A dynamically allocated array. */
+  gfloat C[2][2];
+  gfloat X[2];
 
   START_POINT(spline) = CURVE_POINT(curve, 0);
   END_POINT(spline) = LAST_CURVE_POINT(curve);
-  start_vector = make_vector(START_POINT(spline));
-  end_vector = make_vector(END_POINT(spline));
-
-  for (i = 0; i < CURVE_LENGTH(curve); i++) {
-    A[(i << 1) + 0] = Vmult_scalar(t1_hat, B1(CURVE_T(curve, i)));
-    A[(i << 1) + 1] = Vmult_scalar(t2_hat, B2(CURVE_T(curve, i)));
-  }
-
-  for (i = 0; i < CURVE_LENGTH(curve); i++) {
-    vector_type temp, temp0, temp1, temp2, temp3;
-    vector_type *Ai = A + (i << 1);
 
-    C[0][0] += Vdot(Ai[0], Ai[0]);
-    C[0][1] += Vdot(Ai[0], Ai[1]);
-    /* C[1][0] = C[0][1] (this is assigned outside the loop)  */
-    C[1][1] += Vdot(Ai[1], Ai[1]);
-
-    /* Now the right-hand side of the equation in the paper.  */
-    temp0 = Vmult_scalar(start_vector, B0(CURVE_T(curve, i)));
-    temp1 = Vmult_scalar(start_vector, B1(CURVE_T(curve, i)));
-    temp2 = Vmult_scalar(end_vector, B2(CURVE_T(curve, i)));
-    temp3 = Vmult_scalar(end_vector, B3(CURVE_T(curve, i)));
-
-    temp = make_vector(
-        Vsubtract_point(CURVE_POINT(curve, i), Vadd(temp0, Vadd(temp1, Vadd(temp2, temp3)))));
-
-    X[0] += Vdot(temp, Ai[0]);
-    X[1] += Vdot(temp, Ai[1]);
-  }
-
-  C[1][0] = C[0][1];
+  /* Row I of the matrix A of the paper is B1 and B2 of the t value of
+     point I times T1_HAT and T2_HAT; C is A^T A, and X is A^T times
+     each point less the spline through the ends with no tangents.  */
+  fit_normal_equations(points, t1_hat, t2_hat, START_POINT(spline), END_POINT(spline), C, X);
 
   X_C1_det = X[0] * C[1][1] - X[1] * C[0][1];
   C0_X_det = C[0][0] * X[1] - C[0][1] * X[0];
@@ -1170,7 +1550,7 @@ static void set_initial_parameter_values(curve_type curve)
    endpoints...and we never recompute the tangent after this.  */
 
 static void find_tangent(curve_type curve, gboolean to_start_point, gboolean cross_curve,
-                         unsigned tangent_surround)
+                         unsigned tangent_surround, arena_type *arena)
 {
   vector_type tangent;
   vector_type **curve_tangent =
@@ -1180,7 +1560,7 @@ static void find_tangent(curve_type curve, gboolean to_start_point, gboolean cro
   LOG("  tangent to %s: ", (to_start_point == TRUE) ? "start" : "end");
 
   if (*curve_tangent == NULL) {
-    *curve_tangent = g_malloc(sizeof(vector_type));
+    *curve_tangent = arena_alloc(arena, sizeof(vector_type));
     do {
       tangent = find_half_tangent(curve, to_start_point, &n_points, tangent_surround);
 
@@ -1253,27 +1633,40 @@ static vector_type find_half_tangent(curve_type c, gboolean to_start_point, unsi
    point, and then WORST_POINT becomes irrelevant.  But normally, we
    return the error at the worst point, and the index of that point in
    WORST_POINT.  The error computation itself is the Euclidean distance
-   from the original curve CURVE to the fitted spline SPLINE.  */
+   from the original curve CURVE to the fitted spline SPLINE.
 
-static gfloat find_error(curve_type curve, spline_type spline, unsigned *worst_point,
-                         at_exception_type *exception)
+   When a worse error than BOUND means the fit will be thrown away, we
+   stop looking soon after one turns up, and return it; WORST_POINT is
+   then only the worst of the points looked at.  Pass INFINITY to look
+   at every point.  */
+
+static gfloat find_error(curve_type curve, curve_points_type *points, spline_type spline,
+                         gfloat bound, unsigned *worst_point, at_exception_type *exception)
 {
-  unsigned this_point;
+  unsigned this_point, n_points = CURVE_LENGTH(curve);
+  unsigned block = isinf(bound) ? n_points : ERROR_BLOCK;
   gfloat total_error = 0.0;
   gfloat worst_error = FLT_MIN;
 
   *worst_point = CURVE_LENGTH(curve) + 1; /* A sentinel value.  */
 
-  for (this_point = 0; this_point < CURVE_LENGTH(curve); this_point++) {
-    at_real_coord curve_point = CURVE_POINT(curve, this_point);
-    gfloat t = CURVE_T(curve, this_point);
-    at_real_coord spline_point = evaluate_spline(spline, t);
-    gfloat this_error = distance(curve_point, spline_point);
-    if (this_error >= worst_error) {
-      *worst_point = this_point;
-      worst_error = this_error;
+  for (this_point = 0; this_point < n_points;) {
+    unsigned end = MIN(this_point + block, n_points);
+
+    fit_point_errors_part(points, &spline, this_point, end - this_point);
+    for (; this_point < end; this_point++) {
+      gfloat this_error = points->result[this_point];
+      if (this_error >= worst_error) {
+        *worst_point = this_point;
+        worst_error = this_error;
+      }
+      total_error += this_error;
+    }
+    if (worst_error > bound) {
+      LOG("  Error of %.3f, past %.3f, after %u of %u points.\n", worst_error, bound, this_point,
+          n_points);
+      return worst_error;
     }
-    total_error += this_error;
   }
 
   if (*worst_point ==
@@ -1304,7 +1697,7 @@ static gfloat find_error(curve_type curve, spline_type spline, unsigned *worst_p
    would we be better off just using a straight line?  */
 
 static gboolean spline_linear_enough(spline_type *spline, curve_type curve,
-                                     fitting_opts_type *fitting_opts)
+                                     curve_points_type *points, fitting_opts_type *fitting_opts)
 {
   gfloat A, B, C;
   unsigned this_point;
@@ -1325,18 +1718,9 @@ static gboolean spline_linear_enough(spline_type *spline, curve_type curve,
 
   /* LOG ("  Line is %.3fx + %.3fy + %.3f = 0.\n", A, B, C); */
 
-  for (this_point = 0; this_point < CURVE_LENGTH(curve); this_point++) {
-    gfloat a, b, c, w;
-    gfloat t = CURVE_T(curve, this_point);
-    at_real_coord spline_point = evaluate_spline(*spline, t);
-
-    a = spline_point.x - START_POINT(*spline).x;
-    b = spline_point.y - START_POINT(*spline).y;
-    c = spline_point.z - START_POINT(*spline).z;
-    w = (A * a + B * b + C * c) / start_end_dist;
-
-    dist += (gfloat)sqrt(SQUARE(a - A * w) + SQUARE(b - B * w) + SQUARE(c - C * w));
-  }
+  fit_line_distances(points, spline);
+  for (this_point = 0; this_point < CURVE_LENGTH(curve); this_point++)
+    dist += points->result[this_point];
   LOG("  Total distance is %.3f, ", dist);
 
   dist /= (CURVE_LENGTH(curve) - 1);
@@ -1410,23 +1794,16 @@ static index_list_type new_index_list(void)
 
   index_list.data = NULL;
   INDEX_LIST_LENGTH(index_list) = 0;
+  index_list.capacity = 0;
 
   return index_list;
 }
 
-static void free_index_list(index_list_type *index_list)
-{
-  if (INDEX_LIST_LENGTH(*index_list) > 0) {
-    g_free(index_list->data);
-    index_list->data = NULL;
-    INDEX_LIST_LENGTH(*index_list) = 0;
-  }
-}
-
-static void append_index(index_list_type *list, unsigned new_index)
+static void append_index(arena_type *arena, index_list_type *list, unsigned new_index)
 {
+  list->data = arena_grow(arena, list->data, &list->capacity, INDEX_LIST_LENGTH(*list) + 1,
+                          sizeof(unsigned));
   INDEX_LIST_LENGTH(*list)++;
-  list->data = g_realloc(list->data, INDEX_LIST_LENGTH(*list) * sizeof(unsigned));
   list->data[INDEX_LIST_LENGTH(*list) - 1] = new_index;
 }
 
@@ -11,7 +11,9 @@
 #ifndef FIT_H
 #define FIT_H
 
+#include "arena.h"
 #include "autotrace.h"
+#include "curve.h"
 #include "image-proc.h"
 #include "pxl-outline.h"
 #include "spline.h"
@@ -21,13 +23,36 @@
    set using options.  */
 typedef at_fitting_opts_type fitting_opts_type;
 
-/* Fit splines and lines to LIST.  */
+/* Receives the spline lists of fitted_splines one by one, in order,
+   as soon as each is fitted.  SHAPE is the array fitted_splines
+   returns, with everything set but the lists.  LIST is freed after
+   the call.  */
+typedef void (*spline_list_func)(spline_list_array_type *shape, spline_list_type *list,
+                                 gpointer data);
+
+/* Fit splines and lines to LIST.  The curves and everything else
+   built on the way are allocated in ARENA; only the splines are not.
+   If EMIT is not NULL, the spline lists are handed to it rather than
+   kept in the array returned.  The split and fit stages and their
+   counts are added to STATS, if it is not NULL.  */
 extern spline_list_array_type fitted_splines(pixel_outline_list_type, fitting_opts_type *,
-                                             at_distance_map *, unsigned short width,
-                                             unsigned short height, at_exception_type *exception,
+                                             at_distance_map *, unsigned int width,
+                                             unsigned int height, arena_type *arena,
+                                             spline_list_func emit, gpointer emit_data,
+                                             at_trace_stats *stats, at_exception_type *exception,
                                              at_progress_func, gpointer, at_testcancel_func,
                                              gpointer);
 
+/* The two halves of fitted_splines, for the benchmarks: split each
+   outline of the list into curves at its corners, allocated in ARENA,
+   then fit one of the resulting curve lists, adding the number of
+   subdivisions to SUBDIVISIONS if it is not NULL.  */
+extern curve_list_array_type split_at_corners(pixel_outline_list_type, fitting_opts_type *,
+                                              arena_type *arena, at_exception_type *exception);
+extern spline_list_type fit_curve_list(curve_list_type, fitting_opts_type *, at_distance_map *,
+                                       arena_type *arena, unsigned *subdivisions,
+                                       at_exception_type *exception);
+
 /* Get a new set of fitting options */
 extern fitting_opts_type new_fitting_opts(void);
 
@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* format.c: real numbers as text, as printf writes them in the C locale. */
+
+#include "format.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+/* Most numbers are written here from their digits, which is much
+   faster than printf.  The digits come from rounding the number,
+   scaled by a power of ten, to an integer.  The powers of ten are
+   exact up to 1e22, so the scaled number is off by half a unit in its
+   last place at most, and the rounding is the one printf does unless
+   the scaled number falls too close to half-way between two integers.
+   Then, and for numbers too large or too small, the text comes from
+   g_ascii_formatd.  */
+
+static const double powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                       1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                       1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* The most digits worked out without g_ascii_formatd */
+#define MAX_PRECISION 15
+
+/* Below this, a double has all the bits of its fractional part */
+#define SCALED_MAX 4503599627370496.0 /* 2^52 */
+
+static const gchar digit_pairs[] = "00010203040506070809"
+                                   "10111213141516171819"
+                                   "20212223242526272829"
+                                   "30313233343536373839"
+                                   "40414243444546474849"
+                                   "50515253545556575859"
+                                   "60616263646566676869"
+                                   "70717273747576777879"
+                                   "80818283848586878889"
+                                   "90919293949596979899";
+
+/* Write the digits of N backwards from END, and return where they
+   begin.  */
+static gchar *put_digits(gchar *end, guint64 n)
+{
+  while (n >= 100) {
+    unsigned pair = (n % 100) * 2;
+
+    n /= 100;
+    *--end = digit_pairs[pair + 1];
+    *--end = digit_pairs[pair];
+  }
+  if (n >= 10) {
+    *--end = digit_pairs[n * 2 + 1];
+    *--end = digit_pairs[n * 2];
+  } else
+    *--end = '0' + n;
+  return end;
+}
+
+gsize format_unsigned(gchar *buffer, guint64 value)
+{
+  gchar digits[FORMAT_INTEGER_SIZE];
+  gchar *end = digits + sizeof(digits);
+  gchar *start = put_digits(end, value);
+
+  memcpy(buffer, start, end - start);
+  return end - start;
+}
+
+gsize format_integer(gchar *buffer, gint64 value)
+{
+  if (value < 0) {
+    buffer[0] = '-';
+    return 1 + format_unsigned(buffer + 1, -(guint64)value);
+  }
+  return format_unsigned(buffer, value);
+}
+
+/* Copy the LENGTH bytes of TEXT to the SIZE bytes at BUFFER, as much
+   as there is room for with a 0 after them, and return LENGTH.  */
+static gsize put_text(gchar *buffer, gsize size, const gchar *text, gsize length)
+{
+  gsize n;
+
+  if (size == 0)
+    return length;
+  n = MIN(length, size - 1);
+  memcpy(buffer, text, n);
+  buffer[n] = '\0';
+  return length;
+}
+
+/* Whatever g_ascii_formatd makes of VALUE with the conversion
+   CONVERSION and PRECISION.  */
+static gsize format_slowly(gchar *buffer, gsize size, gdouble value, gchar conversion,
+                           int precision)
+{
+  gchar format[16], *text;
+  gsize room = 400, length;
+
+  g_snprintf(format, sizeof(format), "%%.%d%c", precision, conversion);
+  /* The text might have been cut short if it fills the room */
+  for (;;) {
+    text = g_malloc(room);
+    g_ascii_formatd(text, room, format, value);
+    length = strlen(text);
+    if (length < room - 1)
+      break;
+    g_free(text);
+    room *= 2;
+  }
+  put_text(buffer, size, text, length);
+  g_free(text);
+  return length;
+}
+
+/* Round SCALED, which is positive and below SCALED_MAX, to the nearest
+   integer in *N.  Return FALSE if SCALED, whose error is half a unit
+   in its last place at most, is too close to half-way to tell.  */
+static gboolean round_scaled(double scaled, guint64 *n)
+{
+  double whole = floor(scaled), part = scaled - whole;
+
+  if (fabs(part - 0.5) <= scaled * DBL_EPSILON)
+    return FALSE;
+  *n = (guint64)whole + (part > 0.5);
+  return TRUE;
+}
+
+/* Write N divided by 10 to the DECIMALS, with DECIMALS digits after
+   the point, to TEXT, after a minus if NEGATIVE.  N is below
+   SCALED_MAX and DECIMALS 20 at most.  Return the length.  */
+static gsize put_decimal(gchar *text, gboolean negative, guint64 n, int decimals)
+{
+  gchar digits[32];
+  gchar *end = digits + sizeof(digits);
+  gchar *start = put_digits(end, n);
+  gchar *p = text;
+  gsize whole;
+
+  while (end - start <= decimals)
+    *--start = '0';
+  if (negative)
+    *p++ = '-';
+  whole = (end - start) - decimals;
+  memcpy(p, start, whole);
+  p += whole;
+  if (decimals > 0) {
+    *p++ = '.';
+    memcpy(p, start + whole, decimals);
+    p += decimals;
+  }
+  return p - text;
+}
+
+gsize format_fixed(gchar *buffer, gsize size, gdouble value, int precision)
+{
+  gchar text[64];
+  double scaled;
+  guint64 n;
+
+  if (precision < 0)
+    precision = 6;
+  if (precision <= MAX_PRECISION && isfinite(value)) {
+    scaled = fabs(value) * powers_of_ten[precision];
+    if (scaled < SCALED_MAX && round_scaled(scaled, &n))
+      return put_text(buffer, size, text, put_decimal(text, signbit(value), n, precision));
+  }
+  return format_slowly(buffer, size, value, 'f', precision);
+}
+
+gsize format_general(gchar *buffer, gsize size, gdouble value, int precision)
+{
+  double magnitude = fabs(value), scaled;
+  gchar text[64];
+  int exponent, shift, tries;
+  guint64 n, low, high;
+  gsize length;
+
+  if (precision < 0)
+    precision = 6;
+  else if (precision == 0)
+    precision = 1;
+
+  if (value == 0) {
+    length = 0;
+    if (signbit(value))
+      text[length++] = '-';
+    text[length++] = '0';
+    return put_text(buffer, size, text, length);
+  }
+  if (precision > MAX_PRECISION || !(magnitude >= 1e-5 && magnitude < 1e16))
+    return format_slowly(buffer, size, value, 'g', precision);
+
+  /* A first guess at the exponent, put right below if need be */
+  exponent = 0;
+  if (magnitude >= 1)
+    while (magnitude >= powers_of_ten[exponent + 1])
+      exponent++;
+  else
+    while (magnitude * powers_of_ten[-exponent] < 1)
+      exponent--;
+
+  low = (guint64)powers_of_ten[precision - 1];
+  high = (guint64)powers_of_ten[precision];
+  for (tries = 0; tries < 2; tries++) {
+    shift = precision - 1 - exponent;
+    if (shift >= 0)
+      scaled = magnitude * powers_of_ten[shift];
+    else
+      scaled = magnitude / powers_of_ten[-shift];
+    if (!round_scaled(scaled, &n))
+      break;
+    if (n < low)
+      exponent--;
+    else if (n > high)
+      exponent++;
+    else {
+      if (n == high) {
+        /* Rounded up to the next power of ten */
+        n = low;
+        exponent++;
+      }
+      /* Otherwise printf writes an exponent */
+      if (exponent < -4 || exponent >= precision)
+        break;
+      length = put_decimal(text, signbit(value), n, precision - 1 - exponent);
+      /* Without the zeros at the end, nor the point if nothing is
+         left after it */
+      if (exponent < precision - 1) {
+        while (text[length - 1] == '0')
+          length--;
+        if (text[length - 1] == '.')
+          length--;
+      }
+      return put_text(buffer, size, text, length);
+    }
+  }
+  return format_slowly(buffer, size, value, 'g', precision);
+}
@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* format.h: real numbers as text, as printf writes them in the C locale. */
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <glib.h>
+
+/* Room for the text of any number that fits in a `long long', with
+   its sign and the 0 after it.  */
+#define FORMAT_INTEGER_SIZE 24
+
+/* Write VALUE with PRECISION digits after the point, as "%.*f" does,
+   to the SIZE bytes at BUFFER, followed by a 0, as g_snprintf does.
+   Return the length of the whole text, which is SIZE or more if it
+   was cut short.  Whatever the locale, the point is a `.'.  */
+extern gsize format_fixed(gchar *buffer, gsize size, gdouble value, int precision);
+
+/* The same as "%.*g" does: PRECISION significant digits, without the
+   zeros at the end.  */
+extern gsize format_general(gchar *buffer, gsize size, gdouble value, int precision);
+
+/* Write VALUE in decimal to BUFFER, which must hold
+   FORMAT_INTEGER_SIZE bytes, without a 0 after it, and return its
+   length.  */
+extern gsize format_integer(gchar *buffer, gint64 value);
+extern gsize format_unsigned(gchar *buffer, guint64 value);
+
+#endif /* not FORMAT_H */
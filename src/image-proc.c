@@ -9,8 +9,10 @@
 
 #include <assert.h>
 #include <glib.h>
+#include <math.h>
 #include "logreport.h"
 #include "image-proc.h"
+#include "tracer.h"
 
 #define BLACK 0
 #define WHITE 0xff
@@ -37,13 +39,14 @@ static void check(int v1, int v2, int v3, struct etyp *t);
    as BITMAP and initialize it so that pixels in BITMAP with value
    TARGET_VALUE are at distance zero and all other pixels are at
    distance infinity.  Then compute the gray-weighted distance from
-   every non-target point to the nearest target point. */
+   every non-target point to the nearest target point.  The map is
+   kept in scratch buffers of TRACER, which may be NULL. */
 
 at_distance_map new_distance_map(at_bitmap *bitmap, unsigned char target_value, gboolean padded,
-                                 at_exception_type *exp)
+                                 at_tracer *tracer, at_exception_type *exp)
 {
   signed x, y;
-  float d, min;
+  float d, min, *distances, *weights;
   at_distance_map dist;
   unsigned char *b = AT_BITMAP_BITS(bitmap);
   unsigned w = AT_BITMAP_WIDTH(bitmap);
@@ -52,11 +55,16 @@ at_distance_map new_distance_map(at_bitmap *bitmap, unsigned char target_value,
 
   dist.height = h;
   dist.width = w;
-  dist.d = g_malloc(h * sizeof(float *));
-  dist.weight = g_malloc(h * sizeof(float *));
+  dist.tracer = tracer;
+  /* The rows are cut out of one block for the distances and one for
+     the weights; all of both is set below.  */
+  dist.d = tracer_scratch(tracer, SCRATCH_DISTANCE_ROWS, h * sizeof(float *), FALSE);
+  dist.weight = tracer_scratch(tracer, SCRATCH_WEIGHT_ROWS, h * sizeof(float *), FALSE);
+  distances = tracer_scratch(tracer, SCRATCH_DISTANCE, (gsize)w * h * sizeof(float), FALSE);
+  weights = tracer_scratch(tracer, SCRATCH_WEIGHT, (gsize)w * h * sizeof(float), FALSE);
   for (y = 0; y < (signed)h; y++) {
-    dist.d[y] = g_malloc0(w * sizeof(float));
-    dist.weight[y] = g_malloc(w * sizeof(float));
+    dist.d[y] = distances + (gsize)y * w;
+    dist.weight[y] = weights + (gsize)y * w;
   }
 
   if (spp == 3) {
@@ -176,26 +184,152 @@ at_distance_map new_distance_map(at_bitmap *bitmap, unsigned char target_value,
   return dist;
 }
 
+/* Squared distance along a row: for each of the N pixels of F, the
+   squared distance to the nearest pixel of the row, each of which is
+   F[i] squared away from its nearest feature in its column, goes into
+   D.  This is the lower envelope of parabolas of Felzenszwalb and
+   Huttenlocher, which takes linear time.  V and Z hold N and N + 1
+   numbers.  */
+static void distance_along_row(const float *f, float *d, unsigned n, unsigned *v, double *z)
+{
+  unsigned i, k = 0;
+
+  v[0] = 0;
+  z[0] = -G_MAXDOUBLE;
+  z[1] = G_MAXDOUBLE;
+  for (i = 1; i < n; i++) {
+    double s;
+
+    /* Drop the parabolas the one of I is under, from the last */
+    for (;;) {
+      s = ((f[i] + (double)i * i) - (f[v[k]] + (double)v[k] * v[k])) / (2.0 * (i - v[k]));
+      if (s > z[k])
+        break;
+      k--;
+    }
+    k++;
+    v[k] = i;
+    z[k] = s;
+    z[k + 1] = G_MAXDOUBLE;
+  }
+  for (i = 0, k = 0; i < n; i++) {
+    float dx;
+
+    while (z[k + 1] < i)
+      k++;
+    dx = (float)i - (float)v[k];
+    d[i] = dx * dx + f[v[k]];
+  }
+}
+
+/* The distances are exact, taken between the centers of the pixels:
+   first the distance to the nearest feature, a pixel at distance
+   zero, in the same column, and then the distance through the nearest
+   column.  The pixels out of BITMAP are features as well.  */
+
+at_distance_map new_color_distance_map(at_bitmap *bitmap, at_color bg_color, at_tracer *tracer,
+                                       at_exception_type *exp)
+{
+  at_distance_map dist;
+  unsigned w = AT_BITMAP_WIDTH(bitmap);
+  unsigned h = AT_BITMAP_HEIGHT(bitmap);
+  unsigned spp = AT_BITMAP_PLANES(bitmap);
+  guint32 bg = COLOR_CODE(bg_color);
+  float *distances, *below, *row;
+  unsigned x, y, *v;
+  double *z;
+
+  dist.height = h;
+  dist.width = w;
+  dist.tracer = tracer;
+  dist.weight = NULL;
+  dist.d = tracer_scratch(tracer, SCRATCH_DISTANCE_ROWS, h * sizeof(float *), FALSE);
+  distances = tracer_scratch(tracer, SCRATCH_DISTANCE, (gsize)w * h * sizeof(float), FALSE);
+  for (y = 0; y < h; y++)
+    dist.d[y] = distances + (gsize)y * w;
+
+  /* Top to bottom: the number of rows up to a feature above, or up
+     and out of the bitmap.  */
+#define OTHER_COLOR(q) (PIXEL_COLOR_CODE(q, spp) != color && PIXEL_COLOR_CODE(q, spp) != bg)
+  for (y = 0; y < h; y++) {
+    unsigned char *p = AT_BITMAP_PIXEL(bitmap, y, 0);
+    gsize stride = AT_BITMAP_STRIDE(bitmap);
+
+    for (x = 0; x < w; x++, p += spp) {
+      guint32 color = PIXEL_COLOR_CODE(p, spp);
+      gboolean feature = color == bg || (x > 0 && OTHER_COLOR(p - spp)) ||
+                         (x + 1 < w && OTHER_COLOR(p + spp)) ||
+                         (y > 0 && OTHER_COLOR(p - stride)) ||
+                         (y + 1 < h && OTHER_COLOR(p + stride));
+
+      dist.d[y][x] = feature ? 0 : (y > 0 ? dist.d[y - 1][x] : 0) + 1;
+    }
+  }
+#undef OTHER_COLOR
+
+  /* Bottom to top, the same below, and the square of the nearer */
+  below = g_new(float, w);
+  for (x = 0; x < w; x++)
+    below[x] = 0;
+  for (y = h; y-- > 0;)
+    for (x = 0; x < w; x++) {
+      float d = dist.d[y][x] == 0 ? 0 : below[x] + 1;
+
+      below[x] = d;
+      d = MIN(d, dist.d[y][x]);
+      dist.d[y][x] = d * d;
+    }
+  g_free(below);
+
+  /* Across the rows.  Nothing beyond a feature, or beyond the pixels
+     out on either side, is nearer than the feature, so each run of
+     pixels between two of them is done on its own, and the features,
+     most of the pixels of line art, are left as they are.  */
+  row = g_new(float, w);
+  v = g_new(unsigned, w);
+  z = g_new(double, w + 1);
+  for (y = 0; y < h; y++) {
+    float *d = dist.d[y];
+
+    for (x = 0; x < w;) {
+      unsigned start, i;
+
+      if (d[x] == 0) {
+        x++;
+        continue;
+      }
+      for (start = x; x < w && d[x] != 0; x++)
+        ;
+      distance_along_row(d + start, row, x - start, v, z);
+      for (i = start; i < x; i++) {
+        float side = MIN(i - start + 1, x - i);
+
+        d[i] = sqrtf(MIN(row[i - start], side * side));
+      }
+    }
+  }
+  g_free(row);
+  g_free(v);
+  g_free(z);
+  return dist;
+}
+
 /* Free the dynamically-allocated storage associated with a distance map. */
 
 void free_distance_map(at_distance_map *dist)
 {
-  unsigned y, h;
-
   if (!dist)
     return;
 
-  h = dist->height;
-
   if (dist->d != NULL) {
-    for (y = 0; y < h; y++)
-      g_free((gpointer *)dist->d[y]);
-    g_free((gpointer *)dist->d);
+    if (dist->height > 0)
+      tracer_release(dist->tracer, dist->d[0]);
+    tracer_release(dist->tracer, dist->d);
   }
   if (dist->weight != NULL) {
-    for (y = 0; y < h; y++)
-      g_free((gpointer *)dist->weight[y]);
-    g_free((gpointer *)dist->weight);
+    if (dist->height > 0)
+      tracer_release(dist->tracer, dist->weight[0]);
+    tracer_release(dist->tracer, dist->weight);
   }
 }
 
@@ -295,7 +429,8 @@ void medial_axis(bitmap_type * bitmap, at_distance_map * dist, const at_color *
 
 void binarize(at_bitmap *bitmap)
 {
-  unsigned i, npixels, spp;
+  unsigned spp;
+  gsize i, npixels;
   unsigned char *b;
 
   assert(bitmap != NULL);
@@ -303,7 +438,7 @@ void binarize(at_bitmap *bitmap)
 
   b = AT_BITMAP_BITS(bitmap);
   spp = AT_BITMAP_PLANES(bitmap);
-  npixels = AT_BITMAP_WIDTH(bitmap) * AT_BITMAP_HEIGHT(bitmap);
+  npixels = (gsize)AT_BITMAP_WIDTH(bitmap) * AT_BITMAP_HEIGHT(bitmap);
 
   if (spp == 1) {
     for (i = 0; i < npixels; i++)
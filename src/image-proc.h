@@ -15,15 +15,33 @@
 #include "input.h"
 #include <glib.h>
 
+/* The color of the pixel P, of a bitmap of SPP planes, as 0xRRGGBB;
+   the gray level of a gray bitmap gives the same three components.  */
+#define PIXEL_COLOR_CODE(p, spp)                                                                   \
+  ((spp) >= 3 ? (guint32)(p)[0] << 16 | (guint32)(p)[1] << 8 | (p)[2] : (guint32)(p)[0] * 0x010101)
+
+#define COLOR_CODE(c) ((guint32)(c).r << 16 | (guint32)(c).g << 8 | (c).b)
+
 typedef struct {
   unsigned height, width;
-  float **weight;
+  float **weight; /* NULL from new_color_distance_map */
   float **d;
+  at_tracer *tracer; /* that lent the rows, or NULL */
 } at_distance_map;
 
-/* Allocate and compute a new distance map. */
+/* Allocate and compute a new distance map, in scratch buffers of
+   TRACER if it is not NULL. */
 extern at_distance_map new_distance_map(at_bitmap *, unsigned char target_value, gboolean padded,
-                                        at_exception_type *exp);
+                                        at_tracer *tracer, at_exception_type *exp);
+
+/* Allocate and compute a new distance map with the same dimensions
+   as BITMAP, giving for each pixel the Euclidean distance to the
+   nearest pixel of BG_COLOR, out of BITMAP, or on the border of
+   another color.  Pixels of BG_COLOR, and those of other colors next
+   to one that differs, are at distance zero.  There are no weights.
+   The map is kept in scratch buffers of TRACER, which may be NULL.  */
+extern at_distance_map new_color_distance_map(at_bitmap *bitmap, at_color bg_color,
+                                              at_tracer *tracer, at_exception_type *exp);
 
 /* Free the dynamically-allocated storage associated with a distance map. */
 extern void free_distance_map(at_distance_map *);
@@ -35,7 +35,7 @@ struct Bitmap_File_Head_Struct {
   unsigned short zzHotY; /* 08 */
   unsigned long bfOffs;  /* 0A */
   unsigned long biSize;  /* 0E */
-} Bitmap_File_Head;
+};
 
 struct Bitmap_Head_Struct {
   unsigned long biWidth;   /* 12 */
@@ -50,7 +50,7 @@ struct Bitmap_Head_Struct {
   unsigned long biClrImp;  /* 32 */
   unsigned long masks[4];  /* 36 */
   /* 3A */
-} Bitmap_Head;
+};
 
 typedef struct {
   unsigned long mask;
@@ -111,6 +111,7 @@ static void setMasksDefault(unsigned short biBitCnt, Bitmap_Channel *masks)
   }
 }
 
+static at_bitmap read_bmp(FILE *, const gchar *, at_msg_func, gpointer);
 static long ToL(unsigned char *);
 static short ToS(unsigned char *);
 static int ReadColorMap(FILE *, unsigned char[256][3], int, int, gboolean *, at_exception_type *);
@@ -121,7 +122,42 @@ static unsigned char *ReadImage(FILE *, int, int, unsigned char[256][3], int, in
 at_bitmap input_bmp_reader(gchar *filename, at_input_opts_type *opts, at_msg_func msg_func,
                            gpointer msg_data, gpointer user_data)
 {
-  FILE *fd;
+  FILE *fd = fopen(filename, "rb");
+  at_bitmap image;
+
+  if (!fd) {
+    at_exception_type exp = at_exception_new(msg_func, msg_data);
+
+    LOG("Can't open \"%s\"\n", filename);
+    at_exception_fatal(&exp, "bmp: cannot open input file");
+    return at_bitmap_init(0, 0, 0, 1);
+  }
+  image = read_bmp(fd, filename, msg_func, msg_data);
+  fclose(fd);
+  return image;
+}
+
+at_bitmap input_bmp_memory_reader(const guchar *data, gsize size, at_input_opts_type *opts,
+                                  at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+{
+  FILE *fd = at_input_open_memory(data, size);
+  at_bitmap image;
+
+  if (!fd) {
+    at_exception_type exp = at_exception_new(msg_func, msg_data);
+
+    at_exception_fatal(&exp, "bmp: cannot read input data");
+    return at_bitmap_init(0, 0, 0, 1);
+  }
+  image = read_bmp(fd, "(memory)", msg_func, msg_data);
+  fclose(fd);
+  return image;
+}
+
+/* Read a BMP image from FD; FILENAME is only for the log.  */
+static at_bitmap read_bmp(FILE *fd, const gchar *filename, at_msg_func msg_func,
+                          gpointer msg_data)
+{
   unsigned char buffer[128];
   int ColormapSize, rowbytes, Maps;
   gboolean Grey = FALSE;
@@ -131,14 +167,8 @@ at_bitmap input_bmp_reader(gchar *filename, at_input_opts_type *opts, at_msg_fun
   at_exception_type exp = at_exception_new(msg_func, msg_data);
   char magick[2];
   Bitmap_Channel masks[4];
-
-  fd = fopen(filename, "rb");
-
-  if (!fd) {
-    LOG("Can't open \"%s\"\n", filename);
-    at_exception_fatal(&exp, "bmp: cannot open input file");
-    goto cleanup;
-  }
+  struct Bitmap_File_Head_Struct Bitmap_File_Head = {0};
+  struct Bitmap_Head_Struct Bitmap_Head = {0};
 
   /* It is a File. Now is it a Bitmap? Read the shortest possible header. */
 
@@ -424,10 +454,8 @@ at_bitmap input_bmp_reader(gchar *filename, at_input_opts_type *opts, at_msg_fun
       ReadImage(fd, Bitmap_Head.biWidth, Bitmap_Head.biHeight, ColorMap, Bitmap_Head.biClrUsed,
                 Bitmap_Head.biBitCnt, Bitmap_Head.biCompr, rowbytes, Grey, masks, &exp);
 
-  image = at_bitmap_init(image_storage, (unsigned short)Bitmap_Head.biWidth,
-                         (unsigned short)Bitmap_Head.biHeight, Grey ? 1 : 3);
+  image = at_bitmap_init(image_storage, Bitmap_Head.biWidth, Bitmap_Head.biHeight, Grey ? 1 : 3);
 cleanup:
-  fclose(fd);
   return (image);
 }
 
@@ -539,12 +567,12 @@ static unsigned char *ReadImage(FILE *fd, int width, int height, unsigned char c
   } else { /* indexed image */
     channels = 1;
   }
-  image = g_malloc(width * height * channels * sizeof(unsigned char));
+  image = g_malloc((gsize)width * height * channels * sizeof(unsigned char));
 
   /* use g_malloc0 to initialize the dest row_buf so that unspecified
          pixels in RLE bitmaps show up as the zeroth element in the palette.
   */
-  dest = g_malloc0(width * height * channels);
+  dest = g_malloc0((gsize)width * height * channels);
   row_buf = g_malloc(rowbytes);
   rowstride = width * channels;
 
@@ -734,7 +762,7 @@ static unsigned char *ReadImage(FILE *fd, int width, int height, unsigned char c
     unsigned char *temp2, *temp3;
     unsigned char index;
     temp2 = temp = image;
-    image = g_malloc(width * height * 3 * sizeof(unsigned char)); //???
+    image = g_malloc((gsize)width * height * 3 * sizeof(unsigned char)); //???
     temp3 = image;
     for (ypos = 0; ypos < height; ypos++) {
       for (xpos = 0; xpos < width; xpos++) {
@@ -60,7 +60,7 @@ typedef struct _gf_char_t {
 } gf_locator_t;
 
 typedef struct _gf_font_t {
-  char *input_filename;
+  const char *input_filename;
   FILE *input_file;
   double design_size;
   unsigned long checksum;
@@ -454,17 +454,14 @@ static void deblank(gf_char_t *sym)
   }
 }
 
-static int gf_open(gf_font_t *font, char *filename)
+/* Read the font header from FILE, which stays open for the font. */
+static int gf_open(gf_font_t *font, FILE *file, const char *filename)
 {
   unsigned char b, c;
   unsigned long post_ptr;
 
   font->input_filename = filename;
-  font->input_file = fopen(filename, "r");
-  if (!font->input_file) {
-    perror(filename);
-    return 0;
-  }
+  font->input_file = file;
 
   if (fseek(font->input_file, 0, SEEK_END) < 0) {
     perror(filename);
@@ -631,8 +628,48 @@ static int gf_get_char(gf_font_t *font, gf_char_t *sym, unsigned char charcode)
   return 1;
 }
 
+static at_bitmap read_gf(FILE *file, const gchar *filename, at_input_opts_type *opts,
+                         at_msg_func msg_func, gpointer msg_data);
+
 at_bitmap input_gf_reader(gchar *filename, at_input_opts_type *opts, at_msg_func msg_func,
                           gpointer msg_data, gpointer user_data)
+{
+  FILE *file = fopen(filename, "r");
+  at_bitmap bitmap;
+
+  if (!file) {
+    at_exception_type exp = at_exception_new(msg_func, msg_data);
+
+    perror(filename);
+    at_exception_fatal(&exp, "Cannot open input GF file");
+    return at_bitmap_init(NULL, 0, 0, 0);
+  }
+  bitmap = read_gf(file, filename, opts, msg_func, msg_data);
+  fclose(file);
+  return bitmap;
+}
+
+at_bitmap input_gf_memory_reader(const guchar *data, gsize size, at_input_opts_type *opts,
+                                 at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+{
+  FILE *file = at_input_open_memory(data, size);
+  at_bitmap bitmap;
+
+  if (!file) {
+    at_exception_type exp = at_exception_new(msg_func, msg_data);
+
+    at_exception_fatal(&exp, "Cannot read input GF data");
+    return at_bitmap_init(NULL, 0, 0, 0);
+  }
+  bitmap = read_gf(file, "(memory)", opts, msg_func, msg_data);
+  fclose(file);
+  return bitmap;
+}
+
+/* Read the character OPTS->charcode, or the first one, of the GF font
+   in FILE; FILENAME is only for messages.  */
+static at_bitmap read_gf(FILE *file, const gchar *filename, at_input_opts_type *opts,
+                         at_msg_func msg_func, gpointer msg_data)
 {
   at_exception_type exp = at_exception_new(msg_func, msg_data);
   at_bitmap bitmap = at_bitmap_init(NULL, 0, 0, 0);
@@ -640,7 +677,7 @@ at_bitmap input_gf_reader(gchar *filename, at_input_opts_type *opts, at_msg_func
   gf_char_t chardata, *sym = &chardata;
   unsigned int i, j, ptr;
 
-  if (!gf_open(font, filename)) {
+  if (!gf_open(font, file, filename)) {
     at_exception_fatal(&exp, "Cannot open input GF file");
     return bitmap;
   }
@@ -656,7 +693,6 @@ at_bitmap input_gf_reader(gchar *filename, at_input_opts_type *opts, at_msg_func
     opts->charcode = i;
   }
   if (!gf_get_char(font, sym, (unsigned char)opts->charcode)) {
-    fclose(font->input_file);
     at_exception_fatal(&exp, "Error reading character from GF file");
     return bitmap;
   }
@@ -676,6 +712,5 @@ at_bitmap input_gf_reader(gchar *filename, at_input_opts_type *opts, at_msg_func
     }
   }
   g_free(sym->bitmap);
-  fclose(font->input_file);
   return bitmap;
 }
@@ -25,15 +25,17 @@
 #include <magick/api.h>
 #endif
 
-static at_bitmap input_magick_reader(gchar *filename, at_input_opts_type *opts,
-                                     at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+/* Read the image in FILENAME, or if DATA is not NULL, the SIZE bytes
+   at DATA in the format MAGICK.  */
+static at_bitmap read_magick(const gchar *filename, const guchar *data, gsize size,
+                             const gchar *magick, at_msg_func msg_func, gpointer msg_data)
 {
   Image *image = NULL;
   ImageInfo *image_info;
   ImageType image_type;
   unsigned int i, j, point, np, runcount;
   unsigned char red, green, blue;
-  at_bitmap bitmap;
+  at_bitmap bitmap = at_bitmap_init(NULL, 0, 0, 1);
 #if defined(HAVE_IMAGEMAGICK7)
   Quantum q[MaxPixelChannels];
 #else
@@ -50,10 +52,17 @@ static at_bitmap input_magick_reader(gchar *filename, at_input_opts_type *opts,
   GetExceptionInfo(exception_ptr);
 #endif
   image_info = CloneImageInfo((ImageInfo *)NULL);
-  (void)strcpy(image_info->filename, filename);
   image_info->antialias = 0;
 
-  image = ReadImage(image_info, exception_ptr);
+  if (data) {
+    /* There is no suffix to go by: name the format */
+    g_snprintf(image_info->filename, sizeof(image_info->filename), "%s:", magick);
+    g_strlcpy(image_info->magick, magick, sizeof(image_info->magick));
+    image = BlobToImage(image_info, data, size, exception_ptr);
+  } else {
+    (void)strcpy(image_info->filename, filename);
+    image = ReadImage(image_info, exception_ptr);
+  }
   if (image == (Image *)NULL) {
     /* MagickError(exception.severity,exception.reason,exception.description); */
     if (msg_func)
@@ -114,6 +123,19 @@ cleanup:
   return (bitmap);
 }
 
+static at_bitmap input_magick_reader(gchar *filename, at_input_opts_type *opts,
+                                     at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+{
+  return read_magick(filename, NULL, 0, user_data, msg_func, msg_data);
+}
+
+static at_bitmap input_magick_memory_reader(const guchar *data, gsize size,
+                                            at_input_opts_type *opts, at_msg_func msg_func,
+                                            gpointer msg_data, gpointer user_data)
+{
+  return read_magick("(memory)", data, size, user_data, msg_func, msg_data);
+}
+
 int install_input_magick_readers(void)
 {
   size_t n = 0;
@@ -137,8 +159,8 @@ int install_input_magick_readers(void)
   info = GetMagickInfo("*", &exception);
   while (info) {
     if (info->name && info->description) {
-      at_input_add_handler_full(info->name, info->description, input_magick_reader, 0, info->name,
-                                NULL);
+      at_input_add_memory_handler(info->name, info->description, input_magick_reader,
+                                  input_magick_memory_reader, (gpointer)info->name);
     }
     info = info->next;
   }
@@ -147,8 +169,8 @@ int install_input_magick_readers(void)
   for (int i = 0; i < n; i++) {
     info = infos[i];
     if (info->name && info->description)
-      at_input_add_handler_full(info->name, info->description, input_magick_reader, 0, info->name,
-                                NULL);
+      at_input_add_memory_handler(info->name, info->description, input_magick_reader,
+                                  input_magick_memory_reader, (gpointer)info->name);
   }
 #endif // HAVE_GRAPHICSMAGICK
 
@@ -80,7 +80,7 @@ static int load_image(at_bitmap *image, FILE *stream, at_input_opts_type *opts,
   png_structp png;
   png_infop info, end_info;
   png_bytep *rows;
-  unsigned short width, height, row;
+  unsigned int width, height, row;
   int pixel_size;
   int result = 1;
 
@@ -92,8 +92,8 @@ static int load_image(at_bitmap *image, FILE *stream, at_input_opts_type *opts,
 
   rows = read_png(png, info, opts);
 
-  width = (unsigned short)png_get_image_width(png, info);
-  height = (unsigned short)png_get_image_height(png, info);
+  width = png_get_image_width(png, info);
+  height = png_get_image_height(png, info);
   if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY) {
     pixel_size = 1;
   } else {
@@ -129,6 +129,25 @@ at_bitmap input_png_reader(gchar *filename, at_input_opts_type *opts, at_msg_fun
   return image;
 }
 
+at_bitmap input_png_memory_reader(const guchar *data, gsize size, at_input_opts_type *opts,
+                                  at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+{
+  FILE *stream;
+  at_bitmap image = at_bitmap_init(0, 0, 0, 1);
+  at_exception_type exp = at_exception_new(msg_func, msg_data);
+
+  stream = at_input_open_memory(data, size);
+  if (!stream) {
+    at_exception_fatal(&exp, "Cannot read input png data");
+    return image;
+  }
+
+  load_image(&image, stream, opts, &exp);
+  fclose(stream);
+
+  return image;
+}
+
 static png_bytep *read_image(png_structp png_ptr, png_infop info_ptr)
 {
   unsigned width, height, y;
@@ -16,5 +16,7 @@
 
 at_bitmap input_png_reader(gchar *filename, at_input_opts_type *opts, at_msg_func msg_func,
                            gpointer msg_data, gpointer user_data);
+at_bitmap input_png_memory_reader(const guchar *data, gsize size, at_input_opts_type *opts,
+                                  at_msg_func msg_func, gpointer msg_data, gpointer user_data);
 
 #endif /* not INPUT_PNG_H */
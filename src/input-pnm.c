@@ -70,6 +70,8 @@ static void pnmscanner_gettoken(PNMScanner *s, unsigned char *buf, unsigned int
 static void pnmscanner_getsmalltoken(PNMScanner *s, unsigned char *buf);
 
 static PNMScanner *pnmscanner_create(FILE *fd);
+static at_bitmap read_pnm(FILE *fd, const gchar *filename, at_msg_func msg_func,
+                          gpointer msg_data);
 
 #define pnmscanner_eof(s) ((s)->eof)
 #define pnmscanner_fd(s) ((s)->fd)
@@ -92,22 +94,55 @@ static struct struct_pnm_types {
 at_bitmap input_pnm_reader(gchar *filename, at_input_opts_type *opts, at_msg_func msg_func,
                            gpointer msg_data, gpointer user_data)
 {
-  char buf[BUFLEN]; /* buffer for random things like scanning */
-  PNMInfo *pnminfo;
-  PNMScanner *volatile scan;
-  int ctr;
   FILE *fd;
-  at_bitmap bitmap = at_bitmap_init(NULL, 0, 0, 0);
-  at_exception_type excep = at_exception_new(msg_func, msg_data);
+  at_bitmap bitmap;
 
   /* open the file */
   fd = fopen(filename, "rb");
 
   if (fd == NULL) {
+    at_exception_type excep = at_exception_new(msg_func, msg_data);
+
     LOG("pnm filter: can't open file\n");
     at_exception_fatal(&excep, "pnm filter: can't open file");
-    return (bitmap);
+    return at_bitmap_init(NULL, 0, 0, 0);
+  }
+
+  bitmap = read_pnm(fd, filename, msg_func, msg_data);
+
+  /* close the file */
+  fclose(fd);
+
+  return (bitmap);
+}
+
+at_bitmap input_pnm_memory_reader(const guchar *data, gsize size, at_input_opts_type *opts,
+                                  at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+{
+  FILE *fd = at_input_open_memory(data, size);
+  at_bitmap bitmap;
+
+  if (fd == NULL) {
+    at_exception_type excep = at_exception_new(msg_func, msg_data);
+
+    at_exception_fatal(&excep, "pnm filter: can't read data");
+    return at_bitmap_init(NULL, 0, 0, 0);
   }
+  bitmap = read_pnm(fd, "(memory)", msg_func, msg_data);
+  fclose(fd);
+  return (bitmap);
+}
+
+/* Read a PNM image from FD; FILENAME is only for the log.  */
+static at_bitmap read_pnm(FILE *fd, const gchar *filename, at_msg_func msg_func,
+                          gpointer msg_data)
+{
+  char buf[BUFLEN]; /* buffer for random things like scanning */
+  PNMInfo *pnminfo;
+  PNMScanner *volatile scan;
+  int ctr;
+  at_bitmap bitmap = at_bitmap_init(NULL, 0, 0, 0);
+  at_exception_type excep = at_exception_new(msg_func, msg_data);
 
   /* allocate the necessary structures */
   pnminfo = g_malloc(sizeof(PNMInfo));
@@ -186,8 +221,7 @@ at_bitmap input_pnm_reader(gchar *filename, at_input_opts_type *opts, at_msg_fun
     }
   }
 
-  bitmap = at_bitmap_init(NULL, (unsigned short)pnminfo->xres, (unsigned short)pnminfo->yres,
-                          (pnminfo->np) ? (pnminfo->np) : 1);
+  bitmap = at_bitmap_init(NULL, pnminfo->xres, pnminfo->yres, (pnminfo->np) ? (pnminfo->np) : 1);
   pnminfo->loader(scan, pnminfo, AT_BITMAP_BITS(&bitmap), &excep);
 
 cleanup:
@@ -197,9 +231,6 @@ cleanup:
   /* free the structures */
   g_free(pnminfo);
 
-  /* close the file */
-  fclose(fd);
-
   return (bitmap);
 }
 
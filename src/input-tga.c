@@ -75,30 +75,63 @@ struct tga_header {
   unsigned char descriptor;
 };
 
-static struct {
+struct tga_footer {
   unsigned int extensionAreaOffset;
   unsigned int developerDirectoryOffset;
 #define TGA_SIGNATURE "TRUEVISION-XFILE"
   char signature[16];
   char dot;
   char null;
-} tga_footer;
+};
 
 static at_bitmap ReadImage(FILE *fp, struct tga_header *hdr, at_exception_type *exp);
+static at_bitmap read_tga(FILE *fp, const gchar *filename, at_msg_func msg_func,
+                          gpointer msg_data);
+
 at_bitmap input_tga_reader(gchar *filename, at_input_opts_type *opts, at_msg_func msg_func,
                            gpointer msg_data, gpointer user_data)
 {
-  FILE *fp;
-  struct tga_header hdr;
+  FILE *fp = fopen(filename, "rb");
+  at_bitmap image;
 
-  at_bitmap image = at_bitmap_init(0, 0, 0, 1);
-  at_exception_type exp = at_exception_new(msg_func, msg_data);
-
-  fp = fopen(filename, "rb");
   if (!fp) {
+    at_exception_type exp = at_exception_new(msg_func, msg_data);
+
     LOG("TGA: can't open \"%s\"\n", filename);
     at_exception_fatal(&exp, "Cannot open input tga file");
+    return at_bitmap_init(0, 0, 0, 1);
+  }
+  image = read_tga(fp, filename, msg_func, msg_data);
+  fclose(fp);
+  return image;
+}
+
+at_bitmap input_tga_memory_reader(const guchar *data, gsize size, at_input_opts_type *opts,
+                                  at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+{
+  FILE *fp = at_input_open_memory(data, size);
+  at_bitmap image;
+
+  if (!fp) {
+    at_exception_type exp = at_exception_new(msg_func, msg_data);
+
+    at_exception_fatal(&exp, "Cannot read input tga data");
+    return at_bitmap_init(0, 0, 0, 1);
   }
+  image = read_tga(fp, "(memory)", msg_func, msg_data);
+  fclose(fp);
+  return image;
+}
+
+/* Read a Targa image from FP; FILENAME is only for the log.  */
+static at_bitmap read_tga(FILE *fp, const gchar *filename, at_msg_func msg_func,
+                          gpointer msg_data)
+{
+  struct tga_header hdr;
+  struct tga_footer tga_footer;
+
+  at_bitmap image = at_bitmap_init(0, 0, 0, 1);
+  at_exception_type exp = at_exception_new(msg_func, msg_data);
 
   /* Check the footer. */
   if (fseek(fp, 0L - (sizeof(tga_footer)), SEEK_END) ||
@@ -125,7 +158,6 @@ at_bitmap input_tga_reader(gchar *filename, at_input_opts_type *opts, at_msg_fun
 
   image = ReadImage(fp, &hdr, &exp);
 cleanup:
-  fclose(fp);
   return image;
 }
 
@@ -137,12 +169,14 @@ static int std_fread(unsigned char *buf, int datasize, int nelems, FILE *fp)
 
 #define RLE_PACKETSIZE 0x80
 
-/* Decode a bufferful of file. */
+/* Decode a bufferful of file.  ReadImage() reads the whole image with a
+   single call, so the state of a packet running past the end of the
+   buffer does not need to outlive the call.  */
 static int rle_fread(unsigned char *buf, int datasize, int nelems, FILE *fp)
 {
-  static unsigned char *statebuf = 0;
-  static int statelen = 0;
-  static int laststate = 0;
+  g_autofree unsigned char *statebuf = NULL;
+  int statelen = 0;
+  int laststate = 0;
 
   int j, k;
   int buflen, count, bytes;
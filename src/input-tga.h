@@ -14,5 +14,7 @@
 
 at_bitmap input_tga_reader(gchar *filename, at_input_opts_type *opts, at_msg_func msg_func,
                            gpointer msg_data, gpointer user_data);
+at_bitmap input_tga_memory_reader(const guchar *data, gsize size, at_input_opts_type *opts,
+                                  at_msg_func msg_func, gpointer msg_data, gpointer user_data);
 
 #endif /* not INPUT_TGA_H */
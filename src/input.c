@@ -10,6 +10,10 @@
  * SPDX-License-Identifier: LGPL-2.1-or-later
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* Def: HAVE_CONFIG_H */
+
 #include "autotrace.h"
 #include "private.h"
 #include "input.h"
@@ -26,9 +30,13 @@ struct _at_input_format_entry {
 
 static GHashTable *at_input_formats = NULL;
 static at_input_format_entry *at_input_format_new(const char *descr, at_input_func reader,
+                                                  at_input_memory_func memory_reader,
                                                   gpointer user_data,
                                                   GDestroyNotify user_data_destroy_func);
 static void at_input_format_free(at_input_format_entry *entry);
+static int add_handler(const gchar *suffix, const gchar *description, at_input_func reader,
+                       at_input_memory_func memory_reader, gboolean override, gpointer user_data,
+                       GDestroyNotify user_data_destroy_func);
 
 /*
  * Helper functions
@@ -56,6 +64,7 @@ int at_input_init(void)
 }
 
 static at_input_format_entry *at_input_format_new(const gchar *descr, at_input_func reader,
+                                                  at_input_memory_func memory_reader,
                                                   gpointer user_data,
                                                   GDestroyNotify user_data_destroy_func)
 {
@@ -63,6 +72,7 @@ static at_input_format_entry *at_input_format_new(const gchar *descr, at_input_f
   entry = g_malloc(sizeof(at_input_format_entry));
   if (entry) {
     entry->reader.func = reader;
+    entry->reader.memory_func = memory_reader;
     entry->reader.data = user_data;
     entry->descr = g_strdup(descr);
     entry->user_data_destroy_func = user_data_destroy_func;
@@ -86,6 +96,23 @@ int at_input_add_handler(const gchar *suffix, const gchar *description, at_input
 int at_input_add_handler_full(const gchar *suffix, const gchar *description, at_input_func reader,
                               gboolean override, gpointer user_data,
                               GDestroyNotify user_data_destroy_func)
+{
+  return add_handler(suffix, description, reader, NULL, override, user_data,
+                     user_data_destroy_func);
+}
+
+int at_input_add_memory_handler(const gchar *suffix, const gchar *description,
+                                at_input_func reader, at_input_memory_func memory_reader,
+                                gpointer user_data)
+{
+  g_return_val_if_fail(memory_reader, 0);
+
+  return add_handler(suffix, description, reader, memory_reader, 0, user_data, NULL);
+}
+
+static int add_handler(const gchar *suffix, const gchar *description, at_input_func reader,
+                       at_input_memory_func memory_reader, gboolean override, gpointer user_data,
+                       GDestroyNotify user_data_destroy_func)
 {
   gchar *gsuffix;
   const gchar *gdescription;
@@ -108,7 +135,8 @@ int at_input_add_handler_full(const gchar *suffix, const gchar *description, at_
     return 1;
   }
 
-  new_entry = at_input_format_new(gdescription, reader, user_data, user_data_destroy_func);
+  new_entry = at_input_format_new(gdescription, reader, memory_reader, user_data,
+                                  user_data_destroy_func);
   g_return_val_if_fail(new_entry, 0);
 
   g_hash_table_replace(at_input_formats, gsuffix, new_entry);
@@ -142,6 +170,81 @@ at_bitmap_reader *at_input_get_handler_by_suffix(gchar *suffix)
     return NULL;
 }
 
+/* The first bytes of the formats that have them, and the suffix of
+   the handler for each.  The Magick readers add those not read
+   natively.  */
+static const struct {
+  const char *magic;
+  gsize length;
+  const char *suffix;
+} input_magics[] = {{"\211PNG\r\n\032\n", 8, "png"},
+                    {"GIF87a", 6, "gif"},
+                    {"GIF89a", 6, "gif"},
+                    {"\377\330\377", 3, "jpeg"},
+                    {"II*\0", 4, "tiff"},
+                    {"MM\0*", 4, "tiff"},
+                    {"BM", 2, "bmp"},
+                    {"BA", 2, "bmp"},
+                    {"P1", 2, "pbm"},
+                    {"P4", 2, "pbm"},
+                    {"P2", 2, "pgm"},
+                    {"P5", 2, "pgm"},
+                    {"P3", 2, "ppm"},
+                    {"P6", 2, "ppm"},
+                    {"\367\203", 2, "gf"}, /* pre, then the GF id */
+                    {NULL, 0, NULL}};
+
+#define TGA_HEADER_SIZE 18
+#define TGA_FOOTER_SIGNATURE "TRUEVISION-XFILE.\0"
+
+/* Targa files have no magic number at their start: tell them by the
+   footer of version 2, or else by a header that makes sense.  */
+static gboolean looks_like_tga(const guchar *data, gsize size)
+{
+  gsize footer = sizeof(TGA_FOOTER_SIGNATURE) - 1;
+
+  if (size < TGA_HEADER_SIZE)
+    return FALSE;
+  if (size >= TGA_HEADER_SIZE + footer &&
+      memcmp(data + size - footer, TGA_FOOTER_SIGNATURE, footer) == 0)
+    return TRUE;
+  /* The color map type, the image type and the bits per pixel */
+  return data[1] <= 1 && (data[2] & ~8) >= 1 && (data[2] & ~8) <= 3 &&
+         (data[16] == 8 || data[16] == 15 || data[16] == 16 || data[16] == 24 || data[16] == 32);
+}
+
+at_bitmap_reader *at_input_get_handler_by_magic(const guchar *data, gsize size)
+{
+  at_bitmap_reader *reader;
+  int i;
+
+  for (i = 0; input_magics[i].magic; i++)
+    if (size >= input_magics[i].length &&
+        memcmp(data, input_magics[i].magic, input_magics[i].length) == 0 &&
+        (reader = at_input_get_handler_by_suffix((gchar *)input_magics[i].suffix)) != NULL)
+      return reader;
+  if (looks_like_tga(data, size))
+    return at_input_get_handler_by_suffix("tga");
+  return NULL;
+}
+
+FILE *at_input_open_memory(const guchar *data, gsize size)
+{
+  FILE *stream;
+
+#ifdef HAVE_FMEMOPEN
+  /* fmemopen refuses an empty buffer */
+  if (size > 0)
+    return fmemopen((void *)data, size, "rb");
+#endif /* HAVE_FMEMOPEN */
+  stream = tmpfile();
+  if (stream && (fwrite(data, 1, size, stream) != size || fseek(stream, 0, SEEK_SET) != 0)) {
+    fclose(stream);
+    stream = NULL;
+  }
+  return stream;
+}
+
 const char **at_input_list_new(void)
 {
   char **list, **tmp;
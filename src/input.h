@@ -13,6 +13,7 @@
 #include "autotrace.h"
 #include "exception.h"
 
+#include <stdio.h>
 #include <glib.h>
 
 #ifdef __cplusplus
@@ -25,6 +26,11 @@ extern "C" {
 typedef at_bitmap (*at_input_func)(gchar *name, at_input_opts_type *opts, at_msg_func msg_func,
                                    gpointer msg_data, gpointer user_data);
 
+/* A reader that decodes the SIZE bytes at DATA, for at_bitmap_read_memory. */
+typedef at_bitmap (*at_input_memory_func)(const guchar *data, gsize size, at_input_opts_type *opts,
+                                          at_msg_func msg_func, gpointer msg_data,
+                                          gpointer user_data);
+
 /* at_input_add_handler
    Register an input handler to autotrace.
    If a handler for the suffix is already existed, do nothing. */
@@ -38,6 +44,20 @@ extern int at_input_add_handler_full(const gchar *suffix, const gchar *descripti
                                      at_input_func reader, gboolean override, gpointer user_data,
                                      GDestroyNotify user_data_destroy_func);
 
+/* at_input_add_memory_handler
+   Register an input handler that can also decode an image held in
+   memory with MEMORY_READER.  Handlers added without one are given a
+   temporary file by at_bitmap_read_memory. */
+extern int at_input_add_memory_handler(const gchar *suffix, const gchar *description,
+                                       at_input_func reader, at_input_memory_func memory_reader,
+                                       gpointer user_data);
+
+/* at_input_open_memory
+   Return a stream reading the SIZE bytes at DATA, which must stay
+   valid until the stream is closed with fclose, or NULL.  A handler
+   that reads its files with stdio can read memory through it. */
+extern FILE *at_input_open_memory(const guchar *data, gsize size);
+
 /* at_bitmap_init
    Return initialized at_bitmap value.
 
@@ -48,6 +68,8 @@ extern int at_input_add_handler_full(const gchar *suffix, const gchar *descripti
    is automatically calculated by WIDTH, HEIGHT and PLANES.
 
    PLANES must be 1(gray scale) or 3(RGB color).
+   The rows of the storage are contiguous, and at_bitmap_free
+   releases it with g_free.
 
    return value:
    The return value is not newly allocated.
@@ -58,7 +80,7 @@ extern int at_input_add_handler_full(const gchar *suffix, const gchar *descripti
    at_bitmap_new is for autotrace library user.
    at_bitmap_init is for input-handler developer.
    Don't use at_bitmap_new in your input-handler. */
-extern at_bitmap at_bitmap_init(unsigned char *area, unsigned short width, unsigned short height,
+extern at_bitmap at_bitmap_init(unsigned char *area, unsigned int width, unsigned int height,
                                 unsigned int planes);
 
 /* TODO: free storage */
@@ -66,9 +88,12 @@ extern at_bitmap at_bitmap_init(unsigned char *area, unsigned short width, unsig
 /* The number of color planes of each pixel */
 #define AT_BITMAP_PLANES(b) ((b)->np)
 
-/* The pixels, represented as an array of bytes (in contiguous storage).
-   Each pixel is represented by np bytes.  */
+/* The pixels, represented as an array of bytes.  Each pixel is
+   represented by np bytes; rows are AT_BITMAP_STRIDE bytes apart,
+   which is only AT_BITMAP_PLANES * AT_BITMAP_WIDTH for a bitmap whose
+   rows are contiguous.  */
 #define AT_BITMAP_BITS(b) ((b)->bitmap)
+#define AT_BITMAP_STRIDE(b) ((b)->stride)
 
 /* These are convenient abbreviations for geting inside the members.  */
 #define AT_BITMAP_WIDTH(b) ((b)->width)
@@ -76,8 +101,7 @@ extern at_bitmap at_bitmap_init(unsigned char *area, unsigned short width, unsig
 
 /* This is the pixel at [ROW,COL].  */
 #define AT_BITMAP_PIXEL(b, row, col)                                                               \
-  ((AT_BITMAP_BITS(b) + (row) * AT_BITMAP_PLANES(b) * AT_BITMAP_WIDTH(b) +                         \
-    (col) * AT_BITMAP_PLANES(b)))
+  ((AT_BITMAP_BITS(b) + (gsize)(row) * AT_BITMAP_STRIDE(b) + (col) * AT_BITMAP_PLANES(b)))
 
 /* at_ prefix removed version */
 #define AT_BITMAP_VALID_PIXEL(b, row, col)                                                         \
@@ -15,9 +15,37 @@
 
 #define LOG_DOMAIN "autotrace"
 
+/* The most verbose level compiled in.  LOG and DEBUG are called per
+   point and per spline while fitting; building with
+   -DLOG_FLOOR=G_LOG_LEVEL_WARNING (configure --disable-trace-log)
+   removes them altogether.  */
+#ifndef LOG_FLOOR
+#define LOG_FLOOR G_LOG_LEVEL_DEBUG
+#endif
+
+/* The most verbose level shown, a GLogLevelFlags set by set_log_level.
+   GLib levels are bit flags where lower values = higher severity.  It
+   is read from the worker threads too, so it is only read and written
+   atomically.  Internal to the library: programs go through
+   set_log_level.  */
+G_GNUC_INTERNAL extern gint at_log_level;
+
+/* Whether messages of LEVEL are shown.  Messages that are not are
+   dropped before their arguments are even evaluated.  */
+#define LOG_ENABLED(level)                                                                         \
+  ((level) <= LOG_FLOOR && (gint)(level) <= g_atomic_int_get(&at_log_level))
+
 /* Simple macros using GLib logging */
-#define DEBUG(...) g_debug(__VA_ARGS__)
-#define LOG(...) g_message(__VA_ARGS__)
+#define DEBUG(...)                                                                                 \
+  do {                                                                                             \
+    if (LOG_ENABLED(G_LOG_LEVEL_DEBUG))                                                            \
+      g_debug(__VA_ARGS__);                                                                        \
+  } while (0)
+#define LOG(...)                                                                                   \
+  do {                                                                                             \
+    if (LOG_ENABLED(G_LOG_LEVEL_MESSAGE))                                                          \
+      g_message(__VA_ARGS__);                                                                      \
+  } while (0)
 #define WARNING(...) g_warning(__VA_ARGS__)
 #define FATAL(...) g_error(__VA_ARGS__)
 
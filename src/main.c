@@ -24,10 +24,15 @@
 #include "filename.h"
 #include "atou.h"
 #include "input.h"
+#include "batch.h"
 
 #include <strings.h>
 #include <assert.h>
 #include <errno.h>
+#ifdef _WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #undef N_
 #include "intl.h"
@@ -45,6 +50,27 @@ static char *output_name = (char *)"";
 
 /* The output function. (-output-format) */
 static at_spline_writer *output_writer = NULL;
+static const char *output_suffix = NULL;
+
+/* Batch mode: where to write the output files, and how to name them.
+   (-output-dir, -output-name) */
+static const char *output_dir = NULL;
+static const char *output_template = "%n.%f";
+
+/* Batch mode: a file listing more inputs (-input-list), the number of
+   files converted at the same time (-jobs), and the inputs given on
+   the command line.  */
+static const char *input_list = NULL;
+static unsigned batch_jobs = 1;
+static char **batch_args;
+static int n_batch_args;
+
+/* Batch mode: whether to read, trace and write in stages of their own
+   (-pipeline), and how many files may wait between them (-decode-queue,
+   -write-queue).  */
+static gboolean batch_pipeline = FALSE;
+static unsigned decode_queue = 2;
+static unsigned write_queue = 2;
 
 /* Whether to print version information */
 static gboolean printed_version;
@@ -52,6 +78,9 @@ static gboolean printed_version;
 /* Whether to dump a bitmap file */
 static gboolean dumping_bitmap = FALSE;
 
+/* Where to write what tracing took, as JSON.  (-stats-json) */
+static char *stats_name = NULL;
+
 /* Report tracing status in real time (--report-progress) */
 static gboolean report_progress = FALSE;
 #define dot_printer_max_column 50
@@ -68,6 +97,13 @@ static void output_list_formats(FILE *file);
 
 static void exception_handler(const gchar *msg, at_msg_type type, gpointer data);
 
+static void write_stats(const char *input_name, at_bitmap *bitmap, gboolean traced,
+                        at_trace_stats *stats);
+
+static int batch_main(at_fitting_opts_type *, at_input_opts_type *, at_output_opts_type *);
+
+static GByteArray *read_stdin(void);
+
 #define DEFAULT_FORMAT "eps"
 
 int main(int argc, char *argv[])
@@ -76,10 +112,12 @@ int main(int argc, char *argv[])
   at_input_opts_type *input_opts;
   at_output_opts_type *output_opts;
   char *input_name;
-  at_splines_type *splines;
   at_bitmap *bitmap;
   FILE *output_file;
   FILE *dump_file;
+  at_trace_stats stats;
+  gboolean traced;
+  GByteArray *input_data = NULL;
 
   at_progress_func progress_reporter = NULL;
   int progress_stat = 0;
@@ -100,12 +138,22 @@ int main(int argc, char *argv[])
   output_opts = at_output_opts_new();
 
   input_name = read_command_line(argc, argv, fitting_opts, input_opts, output_opts);
+  if (output_dir)
+    return batch_main(fitting_opts, input_opts, output_opts);
 
   if (output_name != NULL && input_name != NULL && 0 == strcasecmp(output_name, input_name))
     FATAL(_("Input and output file may not be the same\n"));
 
+  /* An input of - is read from the standard input, whose format is
+     told by its first bytes unless it is given.  */
+  if (!strcmp(input_name, "-")) {
+    input_data = read_stdin();
+    if (!input_reader)
+      input_reader = at_input_get_handler_by_magic(input_data->data, input_data->len);
+  }
+
   /* Set input_reader if it is not set in command line args */
-  if (!input_reader)
+  if (!input_reader && !input_data)
     input_reader = at_input_get_handler(input_name);
 
   /* Set output_writer if it is not set in command line args
@@ -120,9 +168,13 @@ int main(int argc, char *argv[])
   }
 
   /* Open output file */
-  if (!strcmp(output_name, ""))
+  if (!strcmp(output_name, "")) {
     output_file = stdout;
-  else {
+#ifdef _WINDOWS
+    /* As with the files opened below, no line ends are to be translated */
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  } else {
     output_file = fopen(output_name, "wb");
     if (output_file == NULL) {
       perror(output_name);
@@ -132,7 +184,12 @@ int main(int argc, char *argv[])
 
   /* Open the main input file.  */
   if (input_reader != NULL) {
-    bitmap = at_bitmap_read(input_reader, input_name, input_opts, exception_handler, NULL);
+    if (input_data) {
+      bitmap = at_bitmap_read_memory(input_reader, input_data->data, input_data->len, input_opts,
+                                     exception_handler, NULL);
+      g_byte_array_free(input_data, TRUE);
+    } else
+      bitmap = at_bitmap_read(input_reader, input_name, input_opts, exception_handler, NULL);
 
     at_input_opts_free(input_opts);
   } else
@@ -143,14 +200,19 @@ int main(int argc, char *argv[])
     fprintf(stderr, "%-15s", input_name);
   };
 
-  splines = at_splines_new_full(bitmap, fitting_opts, exception_handler, NULL, progress_reporter,
-                                &progress_stat, NULL, NULL);
+  /* Each spline list is written out as soon as it is fitted */
+  traced = at_splines_new_write(bitmap, fitting_opts, output_writer, output_file, output_name,
+                                output_opts, stats_name ? &stats : NULL, exception_handler, NULL,
+                                progress_reporter, &progress_stat, NULL, NULL);
+  at_output_opts_free(output_opts);
+  if (stats_name)
+    write_stats(input_name, bitmap, traced, &stats);
 
   /* Dump loaded bitmap if needed */
   if (dumping_bitmap) {
     char *dumpfile_name = NULL;
     char *input_rootname = NULL;
-    char *basename = g_path_get_basename(input_name);
+    char *basename = g_path_get_basename(strcmp(input_name, "-") ? input_name : "stdin");
     if ((input_rootname = remove_suffix(basename)) == NULL)
       FATAL(_("Not a valid input file name %s"), input_name);
 
@@ -178,14 +240,9 @@ int main(int argc, char *argv[])
     fclose(dump_file);
   }
 
-  at_splines_write(output_writer, output_file, output_name, output_opts, splines, exception_handler,
-                   NULL);
-  at_output_opts_free(output_opts);
-
   if (output_file != stdout)
     fclose(output_file);
 
-  at_splines_free(splines);
   at_bitmap_free(bitmap);
   at_fitting_opts_free(fitting_opts);
 
@@ -199,7 +256,8 @@ int main(int argc, char *argv[])
 
 #define USAGE1                                                                                     \
   "Options:\
-<input_name> must be a supported image file.\n\
+<input_name> must be a supported image file, or - to read one from the\n\
+  standard input; its format is then told by its first bytes.\n\
   You can use '--' or '-' to start an option.\n\
   You can use any unambiguous abbreviation for an option name.\n\
   You can separate option names and values with '=' or ' '.\n\
@@ -211,6 +269,7 @@ int main(int argc, char *argv[])
 -color-count <unsigned>: number of colors a color bitmap is reduced to,\n\
     it does not work on grayscale, allowed are 1..256;\n\
     default is 0, that means no color reduction is done.\n\n\
+-compress: compress the content of PDF output with Flate.\n\n\
 -corner-always-threshold <angle-in-degrees>: if the angle at a pixel is\n\
     less than this, it is considered a corner, even if it is within\n\
     `corner-surround' pixels of another corner; default is 60.\n\n\
@@ -220,6 +279,8 @@ int main(int argc, char *argv[])
 -corner-threshold <angle-in-degrees>: if a pixel, its predecessor(s),\n\
     and its successor(s) meet at an angle smaller than this, it's a\n\
     corner; default is 100.\n\n\
+-decode-queue <unsigned>: batch mode with -pipeline: number of read\n\
+    files that may wait to be traced; default is 2.\n\n\
 -despeckle-level <unsigned>: 0..20; default is 0: no despeckling.\n\n\
 -despeckle-tightness <real>: 0.0..8.0; default is 2.0.\n\n\
 -dpi <unsigned>: The dots per inch value in the input image, affects scaling\n\
@@ -231,7 +292,11 @@ int main(int argc, char *argv[])
 -filter-iterations <unsigned>: smooth the curve this many times\n\
     before fitting; default is 4.\n\n\
 -input-format: Available formats: %s.\n\n\
+-input-list <filename>: batch mode: also convert the files listed in\n\
+    <filename>, one per line, or in the standard input if it is '-'.\n\n\
 -help: print this message.\n\n\
+-jobs <unsigned>: batch mode: number of files converted at the same\n\
+    time; 0 means one per processor; default is 1.\n\n\
 -line-reversion-threshold <real>: if a spline is closer to a straight\n\
     line than this, weighted by the square of the curve length, keep it a\n\
     straight line even if it is a list with curves; default is .01.\n\n\
@@ -241,18 +306,46 @@ int main(int argc, char *argv[])
 -list-output-formats: print a list of supported output formats to stderr.\n\n\
 -list-input-formats: print a list of supported input formats to stderr.\n\n\
 -log: write detailed progress reports to <input_name>.log.\n\n\
+-medial-axis: with -centerline, find the center lines on the medial axis\n\
+    of a distance map, in one pass, rather than by thinning each color.\n\n\
 -noise-removal <real>:: 0.0..1.0; default is 0.99.\n\n\
+-output-dir <directory>: convert all the files given, and those in the\n\
+    directories given, into <directory>; see Batch mode below.\n\n\
 -output-file <filename>: write to <filename>\n\n\
 -output-format <format>: use format <format> for the output file. Available formats:\n\
     %s\n\n\
+-output-name <template>: batch mode: name of each output file, where %%n\n\
+    is the input name without its directory and suffix, %%f the output\n\
+    format, %%i the position of the input, and %%%% a %%; default is %%n.%%f.\n\n\
 -preserve-width: preserve line width prior to thinning.\n\n\
+-pipeline: batch mode: read, trace and write in stages of their own\n\
+    that run at the same time; see Batch mode below.\n\n\
 -remove-adjacent-corners: remove corners that are adjacent.\n\n\
+-reparameterize-iterations <unsigned>: when a fit is off by not much more\n\
+    than the error threshold, move the points along it toward the spline\n\
+    and fit again this many times before subdividing; default is 0.\n\n\
+-stats-json <filename>: write the time and memory each stage of the\n\
+    trace took, and what it found, to <filename> as JSON.\n\n\
 -tangent-surround <unsigned>: number of points on either side of a\n\
     point to consider when computing the tangent at that point; default is 3.\n\n\
+-threads <unsigned>: number of threads used to find and fit the outlines;\n\
+    0 means one per processor; default is 1.\n\n\
 -report-progress: report tracing status in real time.\n\n\
 -debug-bitmap: dump loaded bitmap to <input_name>.bitmap.ppm or pgm.\n\n\
 -version: print the version number of this program.\n\n\
 -width-weight-factor <real>: weight factor for fitting the linewidth.\n\n\
+-write-queue <unsigned>: batch mode with -pipeline: number of traced\n\
+    files that may wait to be written; default is 2.\n\n\
+Batch mode:\n\
+  With -output-dir, any number of files and directories may be given,\n\
+  and all are converted in one run.  A file that fails does not stop\n\
+  the others; a line per file tells how each fared at the end, and\n\
+  the exit status is 1 if any failed.  -stats-json then writes an array\n\
+  with an object per file.\n\
+  With -pipeline, a thread reads the files one after the other, -jobs\n\
+  threads trace them and another thread writes them, so that reading\n\
+  and writing overlap with tracing.  At the end, a table tells how\n\
+  fast each stage went and how full each queue between them was.\n\
 "
 
 /* We return the name of the image to process.  */
@@ -266,10 +359,12 @@ static char *read_command_line(int argc, char *argv[], at_fitting_opts_type *fit
                                   {"centerline", 0, 0, 0},
                                   {"charcode", 1, 0, 0},
                                   {"color-count", 1, 0, 0},
+                                  {"compress", 0, 0, 0},
                                   {"corner-always-threshold", 1, 0, 0},
                                   {"corner-surround", 1, 0, 0},
                                   {"corner-threshold", 1, 0, 0},
                                   {"debug-bitmap", 0, (int *)&dumping_bitmap, 1},
+                                  {"decode-queue", 1, 0, 0},
                                   {"despeckle-level", 1, 0, 0},
                                   {"despeckle-tightness", 1, 0, 0},
                                   {"dpi", 1, 0, 0},
@@ -277,20 +372,30 @@ static char *read_command_line(int argc, char *argv[], at_fitting_opts_type *fit
                                   {"filter-iterations", 1, 0, 0},
                                   {"help", 0, 0, 0},
                                   {"input-format", 1, 0, 0},
+                                  {"input-list", 1, 0, 0},
+                                  {"jobs", 1, 0, 0},
                                   {"line-reversion-threshold", 1, 0, 0},
                                   {"line-threshold", 1, 0, 0},
                                   {"list-input-formats", 0, 0, 0},
                                   {"list-output-formats", 0, 0, 0},
                                   {"log", 1, 0, 0},
+                                  {"medial-axis", 0, 0, 0},
                                   {"noise-removal", 1, 0, 0},
+                                  {"output-dir", 1, 0, 0},
                                   {"output-file", 1, 0, 0},
                                   {"output-format", 1, 0, 0},
+                                  {"output-name", 1, 0, 0},
+                                  {"pipeline", 0, (int *)&batch_pipeline, 1},
                                   {"preserve-width", 0, 0, 0},
                                   {"remove-adjacent-corners", 0, 0, 0},
+                                  {"reparameterize-iterations", 1, 0, 0},
                                   {"report-progress", 0, (int *)&report_progress, 1},
+                                  {"stats-json", 1, 0, 0},
                                   {"tangent-surround", 1, 0, 0},
+                                  {"threads", 1, 0, 0},
                                   {"version", 0, (int *)&printed_version, 1},
                                   {"width-weight-factor", 1, 0, 0},
+                                  {"write-queue", 1, 0, 0},
                                   {0, 0, 0, 0}};
 
   /* Test whether getopt found an option ``A''.
@@ -327,6 +432,9 @@ static char *read_command_line(int argc, char *argv[], at_fitting_opts_type *fit
     else if (ARGUMENT_IS("color-count"))
       fitting_opts->color_count = atou(optarg);
 
+    else if (ARGUMENT_IS("compress"))
+      output_opts->compress = TRUE;
+
     else if (ARGUMENT_IS("corner-always-threshold"))
       fitting_opts->corner_always_threshold = (gfloat)atof(optarg);
 
@@ -336,6 +444,9 @@ static char *read_command_line(int argc, char *argv[], at_fitting_opts_type *fit
     else if (ARGUMENT_IS("corner-threshold"))
       fitting_opts->corner_threshold = (gfloat)atof(optarg);
 
+    else if (ARGUMENT_IS("decode-queue"))
+      decode_queue = atou(optarg);
+
     else if (ARGUMENT_IS("despeckle-level"))
       fitting_opts->despeckle_level = atou(optarg);
 
@@ -369,6 +480,12 @@ static char *read_command_line(int argc, char *argv[], at_fitting_opts_type *fit
         FATAL(_("Input format %s is not supported\n"), optarg);
     }
 
+    else if (ARGUMENT_IS("input-list"))
+      input_list = optarg;
+
+    else if (ARGUMENT_IS("jobs"))
+      batch_jobs = atou(optarg);
+
     else if (ARGUMENT_IS("log"))
       set_log_level(optarg);
 
@@ -378,6 +495,9 @@ static char *read_command_line(int argc, char *argv[], at_fitting_opts_type *fit
     else if (ARGUMENT_IS("line-threshold"))
       fitting_opts->line_threshold = (gfloat)atof(optarg);
 
+    else if (ARGUMENT_IS("medial-axis"))
+      fitting_opts->medial_axis = TRUE;
+
     else if (ARGUMENT_IS("list-input-formats")) {
       fprintf(stderr, _("Supported input formats:\n"));
       input_list_formats(stderr);
@@ -393,6 +513,9 @@ static char *read_command_line(int argc, char *argv[], at_fitting_opts_type *fit
     else if (ARGUMENT_IS("noise-removal"))
       fitting_opts->noise_removal = (gfloat)atof(optarg);
 
+    else if (ARGUMENT_IS("output-dir"))
+      output_dir = optarg;
+
     else if (ARGUMENT_IS("output-file"))
       output_name = optarg;
 
@@ -400,29 +523,52 @@ static char *read_command_line(int argc, char *argv[], at_fitting_opts_type *fit
       output_writer = at_output_get_handler_by_suffix(optarg);
       if (output_writer == NULL)
         FATAL(_("Output format %s is not supported"), optarg);
+      output_suffix = optarg;
     }
 
+    else if (ARGUMENT_IS("output-name"))
+      output_template = optarg;
+
     else if (ARGUMENT_IS("preserve-width"))
       fitting_opts->preserve_width = TRUE;
 
     else if (ARGUMENT_IS("remove-adjacent-corners"))
       fitting_opts->remove_adjacent_corners = TRUE;
 
+    else if (ARGUMENT_IS("reparameterize-iterations"))
+      fitting_opts->reparameterize_iterations = atou(optarg);
+
+    else if (ARGUMENT_IS("stats-json"))
+      stats_name = optarg;
+
     else if (ARGUMENT_IS("tangent-surround"))
       fitting_opts->tangent_surround = atou(optarg);
 
+    else if (ARGUMENT_IS("threads"))
+      fitting_opts->threads = atou(optarg);
+
     else if (ARGUMENT_IS("version"))
       printf(_("AutoTrace version %s.\n"), at_version(FALSE));
 
     else if (ARGUMENT_IS("width-weight-factor"))
       fitting_opts->width_weight_factor = (gfloat)atof(optarg);
 
+    else if (ARGUMENT_IS("write-queue"))
+      write_queue = atou(optarg);
+
     /* Else it was just a flag; getopt has already done the assignment.  */
   }
   /* Just wanted to know the version number?  */
   if (printed_version && optind == argc)
     exit(0);
 
+  /* Any number of inputs, as long as there is one */
+  if (output_dir && (optind < argc || input_list)) {
+    batch_args = argv + optind;
+    n_batch_args = argc - optind;
+    return NULL;
+  }
+
   /* Exactly one (non-empty) argument left?  */
   if (optind + 1 == argc && *argv[optind] != 0)
     return (argv[optind]);
@@ -471,6 +617,20 @@ static void output_list_formats(FILE *file)
   at_output_list_free(tmp);
 }
 
+/* All of the standard input.  */
+static GByteArray *read_stdin(void)
+{
+  GByteArray *data = g_byte_array_new();
+  guint8 buffer[65536];
+  size_t n;
+
+  while ((n = fread(buffer, 1, sizeof(buffer), stdin)) > 0)
+    g_byte_array_append(data, buffer, n);
+  if (ferror(stdin))
+    FATAL(_("Cannot read the standard input: %s"), g_strerror(errno));
+  return data;
+}
+
 static void dot_printer(gfloat percentage, gpointer client_data)
 {
   int *current = (int *)client_data;
@@ -485,14 +645,14 @@ static void dot_printer(gfloat percentage, gpointer client_data)
 
 static void dump(at_bitmap *bitmap, FILE *fp)
 {
-  unsigned short width, height;
+  unsigned int width, height;
   unsigned int np;
 
   width = at_bitmap_get_width(bitmap);
   height = at_bitmap_get_height(bitmap);
   np = at_bitmap_get_planes(bitmap);
 
-  fwrite(AT_BITMAP_BITS(bitmap), sizeof(unsigned char), width * height * np, fp);
+  fwrite(AT_BITMAP_BITS(bitmap), sizeof(unsigned char), (gsize)width * height * np, fp);
 }
 
 static void exception_handler(const gchar *msg, at_msg_type type, gpointer data)
@@ -505,3 +665,82 @@ static void exception_handler(const gchar *msg, at_msg_type type, gpointer data)
   else
     exception_handler(_("Wrong type of msg"), AT_MSG_FATAL, NULL);
 }
+
+/* Write STATS, the figures of tracing BITMAP read from INPUT_NAME, to
+   the -stats-json file.  TRACED tells whether the trace and the output
+   succeeded.  */
+static void write_stats(const char *input_name, at_bitmap *bitmap, gboolean traced,
+                        at_trace_stats *stats)
+{
+  FILE *file = fopen(stats_name, "w");
+
+  if (file == NULL) {
+    perror(stats_name);
+    exit(errno);
+  }
+  fputs("{\n  \"input\": ", file);
+  write_json_string(file, input_name);
+  write_stats_members(file, "  ", at_bitmap_get_width(bitmap), at_bitmap_get_height(bitmap),
+                      traced, stats);
+  fputs("\n}\n", file);
+  if (fclose(file) != 0) {
+    perror(stats_name);
+    exit(errno);
+  }
+}
+
+/* Convert the inputs of the command line into -output-dir.  */
+static int batch_main(at_fitting_opts_type *fitting_opts, at_input_opts_type *input_opts,
+                      at_output_opts_type *output_opts)
+{
+  GPtrArray *inputs = g_ptr_array_new_with_free_func(g_free);
+  batch_opts_type opts;
+  const char *error;
+  unsigned n_failed;
+  int i;
+
+  if (strcmp(output_name, "") != 0)
+    FATAL(_("-output-file cannot be used with -output-dir"));
+  if (dumping_bitmap)
+    FATAL(_("-debug-bitmap cannot be used with -output-dir"));
+  if ((error = batch_check_template(output_template)) != NULL)
+    FATAL("%s", error);
+  if (decode_queue == 0 || write_queue == 0)
+    FATAL(_("-decode-queue and -write-queue must be at least 1"));
+  if (!g_file_test(output_dir, G_FILE_TEST_IS_DIR))
+    FATAL(_("%s is not a directory"), output_dir);
+  if (!output_writer) {
+    output_suffix = DEFAULT_FORMAT;
+    output_writer = at_output_get_handler_by_suffix(DEFAULT_FORMAT);
+    if (output_writer == NULL)
+      FATAL(_("Default format %s is not supported"), DEFAULT_FORMAT);
+  }
+
+  for (i = 0; i < n_batch_args; i++) {
+    if (!batch_add_input(inputs, batch_args[i], input_reader))
+      FATAL(_("Cannot list directory %s"), batch_args[i]);
+  }
+  if (input_list && !batch_add_manifest(inputs, input_list))
+    FATAL(_("Cannot read %s"), input_list);
+
+  opts.fitting_opts = fitting_opts;
+  opts.input_opts = input_opts;
+  opts.output_opts = output_opts;
+  opts.input_reader = input_reader;
+  opts.output_writer = output_writer;
+  opts.output_suffix = output_suffix;
+  opts.output_dir = output_dir;
+  opts.name_template = output_template;
+  opts.jobs = batch_jobs;
+  opts.pipeline = batch_pipeline;
+  opts.decode_queue = decode_queue;
+  opts.write_queue = write_queue;
+  opts.stats_name = stats_name;
+  n_failed = run_batch(&opts, inputs);
+
+  g_ptr_array_free(inputs, TRUE);
+  at_input_opts_free(input_opts);
+  at_output_opts_free(output_opts);
+  at_fitting_opts_free(fitting_opts);
+  return n_failed ? 1 : 0;
+}
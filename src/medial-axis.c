@@ -0,0 +1,408 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* medial-axis.c: center lines on the medial axis of a distance map. */
+
+#include "medial-axis.h"
+#include "input.h"
+#include "logreport.h"
+#include "tracer.h"
+
+/* The pixels of each color but the background are thinned in the
+   order of their distance to the border of the color, the nearest
+   first, as the distance map gives it.  A pixel is taken out if it is
+   simple, that is if taking it out makes no more and no fewer pieces
+   of its color or of what is around, unless it is the end of a line
+   and lies on the medial axis, where the disc of radius its distance
+   is in no disc of a neighbor.  Since the pixels go in the order of
+   their distance, the line of pixels left lies where the distance is
+   highest, halfway between the borders, and the distance there is
+   half the width of the line.  This is the distance-ordered thinning
+   of Pudney (1998).  Each pixel is looked at once, and again only if
+   a neighbor nearer to the border goes after it.
+
+   What is left, the skeleton, is walked once as a graph.  Its pixels
+   with two neighbors make up chains, which run between the nodes: the
+   ends, with one neighbor, and the junctions, with more.  A chain from
+   an end to a junction shorter than the distance at the junction is a
+   branch made by a bump on the border, and is taken out first.  Chains
+   that nothing starts from are loops.  */
+
+/* The neighbors of a pixel, one bit each, counterclockwise from the
+   east: east, northeast, north, northwest, west, southwest, south and
+   southeast.  */
+static const int row_delta[8] = {0, -1, -1, -1, 0, 1, 1, 1};
+static const int col_delta[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const float step_length[8] = {1, G_SQRT2, 1, G_SQRT2, 1, G_SQRT2, 1, G_SQRT2};
+
+/* Whether a pixel whose neighbors of its color are the bits of the
+   index is simple: those neighbors make one 8-connected piece, and the
+   others one 4-connected piece that touches the pixel.  */
+static const unsigned char simple[256] = {
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1, 1, 1,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1, 1, 1,
+    1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1, 1, 0, 1, 1, 0, 1, 0,
+    1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1, 1, 0, 1, 1, 0, 1, 0,
+    1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1,
+    1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1, 1, 0, 1, 1, 0, 1, 0,
+    1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1, 1, 0, 1, 1, 0, 1, 0};
+
+/* The distances are sorted in buckets this wide */
+#define BUCKETS_PER_PIXEL 4
+
+/* A neighbor whose distance grows by its step less this much covers
+   the disc of a pixel: the distances are those of pixel centers, so
+   even the neighbor of a pixel straight across from the border may
+   not grow by the whole step.  */
+#define MEDIAL_SLACK 0.5F
+
+/* The state of a pixel */
+#define IN_SKELETON 1 /* of a color, and not taken out yet */
+#define QUEUED 2      /* to be looked at again */
+#define VISITED 4     /* in a chain already found */
+
+typedef struct {
+  at_bitmap *bitmap;
+  unsigned width, height;
+  const float *d;   /* the distances, row after row */
+  guint8 *same;     /* the neighbors of the same color of each pixel */
+  guint8 *state;    /* the state of each pixel */
+  gssize offset[8]; /* from a pixel to each neighbor */
+  GArray *queue;    /* the pixels to look at again */
+  unsigned bucket;  /* of the pixels being looked at */
+} skeleton_type;
+
+#define BUCKET(sk, i) ((unsigned)((sk)->d[i] * BUCKETS_PER_PIXEL))
+
+/* The neighbors of the pixel I still in the skeleton */
+static unsigned skeleton_neighbors(const skeleton_type *sk, gsize i)
+{
+  unsigned dir, neighbors = 0, same = sk->same[i];
+
+  for (dir = 0; dir < 8; dir++)
+    if (same & 1 << dir && sk->state[i + sk->offset[dir]] & IN_SKELETON)
+      neighbors |= 1 << dir;
+  return neighbors;
+}
+
+static unsigned count_neighbors(unsigned neighbors)
+{
+  unsigned count = 0;
+
+  for (; neighbors; neighbors &= neighbors - 1)
+    count++;
+  return count;
+}
+
+/* Whether no neighbor of the pixel I of its color covers its disc */
+static gboolean on_medial_axis(const skeleton_type *sk, gsize i)
+{
+  unsigned dir;
+
+  for (dir = 0; dir < 8; dir++)
+    if (sk->same[i] & 1 << dir &&
+        sk->d[i + sk->offset[dir]] - sk->d[i] >= step_length[dir] - MEDIAL_SLACK)
+      return FALSE;
+  return TRUE;
+}
+
+/* Take the pixel I out of the skeleton if it is simple, and not the
+   end of a line on the medial axis.  Its neighbors that have been
+   looked at already are queued to be looked at again.  */
+static void thin_pixel(skeleton_type *sk, gsize i)
+{
+  unsigned neighbors, dir;
+
+  if (!(sk->state[i] & IN_SKELETON))
+    return;
+  neighbors = skeleton_neighbors(sk, i);
+  if (!simple[neighbors] || (count_neighbors(neighbors) == 1 && on_medial_axis(sk, i)))
+    return;
+
+  sk->state[i] &= ~IN_SKELETON;
+  for (dir = 0; dir < 8; dir++) {
+    gsize j = i + sk->offset[dir];
+
+    if (neighbors & 1 << dir && !(sk->state[j] & QUEUED) && BUCKET(sk, j) <= sk->bucket) {
+      sk->state[j] |= QUEUED;
+      g_array_append_val(sk->queue, j);
+    }
+  }
+}
+
+/* Thin the pixels queued, and those they queue in turn */
+static void thin_queued(skeleton_type *sk)
+{
+  while (sk->queue->len > 0) {
+    gsize i = g_array_index(sk->queue, gsize, sk->queue->len - 1);
+
+    g_array_set_size(sk->queue, sk->queue->len - 1);
+    sk->state[i] &= ~QUEUED;
+    thin_pixel(sk, i);
+  }
+}
+
+/* The pixel after I, coming from PREVIOUS, on a chain */
+static gsize next_in_chain(const skeleton_type *sk, gsize i, gsize previous)
+{
+  unsigned neighbors = skeleton_neighbors(sk, i), dir;
+
+  for (dir = 0; dir < 8; dir++)
+    if (neighbors & 1 << dir && i + sk->offset[dir] != previous)
+      return i + sk->offset[dir];
+  return previous;
+}
+
+/* If the chain from the end I reaches a junction in fewer steps than
+   the distance there, take it out, but for the junction, and thin
+   the junction and what is around it again.  No branch is longer than
+   MAX_LENGTH.  */
+static void prune_branch(skeleton_type *sk, gsize i, float max_length)
+{
+  gsize previous = i, current, junction, next;
+  unsigned neighbors = skeleton_neighbors(sk, i), dir, length = 1;
+
+  for (dir = 0; !(neighbors & 1 << dir); dir++)
+    ;
+  current = i + sk->offset[dir];
+  while ((neighbors = count_neighbors(skeleton_neighbors(sk, current))) == 2 &&
+         length <= max_length) {
+    next = next_in_chain(sk, current, previous);
+    previous = current;
+    current = next;
+    length++;
+  }
+  if (neighbors < 3 || length > sk->d[current])
+    return;
+
+  /* Walk the branch again, taking it out: each pixel has one
+     neighbor left, the next one.  */
+  junction = current;
+  for (current = i; current != junction; current = next) {
+    next = next_in_chain(sk, current, G_MAXSIZE);
+    sk->state[current] &= ~IN_SKELETON;
+  }
+  sk->state[junction] |= QUEUED;
+  g_array_append_val(sk->queue, junction);
+  thin_queued(sk);
+}
+
+/* Add the pixel I to OUTLINE */
+static void append_pixel(skeleton_type *sk, pixel_outline_type *outline, gsize i,
+                         arena_type *arena)
+{
+  at_coord pos;
+
+  outline->data = arena_grow(arena, outline->data, &outline->capacity, outline->length + 1,
+                             sizeof(at_coord));
+  pos.x = i % sk->width;
+  pos.y = sk->height - i / sk->width - 1;
+  outline->data[outline->length++] = pos;
+}
+
+/* Start an outline at the pixel I */
+static pixel_outline_type new_outline(skeleton_type *sk, gsize i, gboolean open,
+                                      arena_type *arena)
+{
+  pixel_outline_type outline;
+
+  outline.data = NULL;
+  outline.length = 0;
+  outline.capacity = 0;
+  outline.clockwise = FALSE;
+  outline.open = open;
+  at_bitmap_get_color(sk->bitmap, i / sk->width, i % sk->width, &outline.color);
+  append_pixel(sk, &outline, i, arena);
+  return outline;
+}
+
+static void append_outline(pixel_outline_list_type *list, pixel_outline_type outline,
+                           arena_type *arena)
+{
+  list->data = arena_grow(arena, list->data, &list->capacity, list->length + 1,
+                          sizeof(pixel_outline_type));
+  list->data[list->length++] = outline;
+  LOG("#%u: %s line of %u pixels\n", list->length - 1, outline.open ? "open" : "closed",
+      outline.length);
+}
+
+/* The junction next to the junction I that lies deepest, if deeper
+   than I, or I.  Lines that cross make a knot of a few junctions: this
+   is its middle, where the lines meet.  */
+static gsize junction_middle(const skeleton_type *sk, gsize i)
+{
+  unsigned neighbors = skeleton_neighbors(sk, i), dir;
+  gsize middle = i;
+
+  if (count_neighbors(neighbors) < 3)
+    return i;
+  for (dir = 0; dir < 8; dir++) {
+    gsize j = i + sk->offset[dir];
+
+    if (neighbors & 1 << dir && sk->d[j] > sk->d[middle] &&
+        count_neighbors(skeleton_neighbors(sk, j)) >= 3)
+      middle = j;
+  }
+  return middle;
+}
+
+/* Follow the chain from the node I through its neighbor J to the next
+   node, or back to J if it is a loop.  Open chains run from and to the
+   middle of the junctions at their ends.  */
+static pixel_outline_type follow_chain(skeleton_type *sk, gsize i, gsize j, gboolean open,
+                                       arena_type *arena)
+{
+  gsize middle = open ? junction_middle(sk, i) : i;
+  pixel_outline_type outline = new_outline(sk, middle, open, arena);
+  gsize previous = i, next;
+
+  if (middle != i)
+    append_pixel(sk, &outline, i, arena);
+  while (j != i || open) {
+    append_pixel(sk, &outline, j, arena);
+    if (count_neighbors(skeleton_neighbors(sk, j)) != 2) {
+      if ((middle = junction_middle(sk, j)) != j)
+        append_pixel(sk, &outline, middle, arena);
+      break;
+    }
+    sk->state[j] |= VISITED;
+    next = next_in_chain(sk, j, previous);
+    previous = j;
+    j = next;
+  }
+  return outline;
+}
+
+pixel_outline_list_type find_medial_axis_pixels(at_bitmap *bitmap, at_color bg_color,
+                                                at_distance_map *dist,
+                                                at_progress_func notify_progress,
+                                                gpointer progress_data,
+                                                at_testcancel_func test_cancel,
+                                                gpointer testcancel_data, at_tracer *tracer,
+                                                arena_type *arena, at_exception_type *exp)
+{
+  pixel_outline_list_type list = {NULL, 0, 0};
+  unsigned width = AT_BITMAP_WIDTH(bitmap), height = AT_BITMAP_HEIGHT(bitmap);
+  unsigned spp = AT_BITMAP_PLANES(bitmap), row, col, dir, n_buckets, b;
+  guint32 bg = COLOR_CODE(bg_color);
+  gsize n_pixels = (gsize)width * height, n_colored = 0, i, *order, *start;
+  float max_distance = 0;
+  skeleton_type sk;
+
+  sk.bitmap = bitmap;
+  sk.width = width;
+  sk.height = height;
+  sk.d = dist->d[0];
+  sk.same = tracer_scratch(tracer, SCRATCH_SKELETON, 2 * n_pixels, FALSE);
+  sk.state = sk.same + n_pixels;
+  for (dir = 0; dir < 8; dir++)
+    sk.offset[dir] = (gssize)row_delta[dir] * width + col_delta[dir];
+
+  /* Which neighbors of each pixel are of its color */
+  for (row = 0; row < height; row++) {
+    if (notify_progress)
+      notify_progress((gfloat)row / (height * (gfloat)3.0), progress_data);
+    for (col = 0; col < width; col++) {
+      guint8 *p = AT_BITMAP_PIXEL(bitmap, row, col);
+      guint32 color = PIXEL_COLOR_CODE(p, spp);
+      unsigned same = 0;
+
+      i = (gsize)row * width + col;
+      if (color != bg) {
+        for (dir = 0; dir < 8; dir++) {
+          unsigned r = row + row_delta[dir], c = col + col_delta[dir];
+
+          if (r < height && c < width &&
+              PIXEL_COLOR_CODE(AT_BITMAP_PIXEL(bitmap, r, c), spp) == color)
+            same |= 1 << dir;
+        }
+        n_colored++;
+        max_distance = MAX(max_distance, sk.d[i]);
+      }
+      sk.same[i] = same;
+      sk.state[i] = color != bg ? IN_SKELETON : 0;
+    }
+  }
+
+  /* Sort the pixels by distance: count those of each bucket, then put
+     each in its place.  */
+  n_buckets = (unsigned)(max_distance * BUCKETS_PER_PIXEL) + 1;
+  start = g_new0(gsize, n_buckets + 1);
+  order = tracer_scratch(tracer, SCRATCH_SKELETON_ORDER, n_colored * sizeof(gsize), FALSE);
+  for (i = 0; i < n_pixels; i++)
+    if (sk.state[i])
+      start[BUCKET(&sk, i) + 1]++;
+  for (b = 0; b < n_buckets; b++)
+    start[b + 1] += start[b];
+  for (i = 0; i < n_pixels; i++)
+    if (sk.state[i])
+      order[start[BUCKET(&sk, i)]++] = i;
+
+  /* START now holds the end of each bucket */
+  sk.queue = g_array_new(FALSE, FALSE, sizeof(gsize));
+  for (b = 0, i = 0; b < n_buckets; b++) {
+    sk.bucket = b;
+    for (; i < start[b]; i++) {
+      thin_pixel(&sk, order[i]);
+      thin_queued(&sk);
+    }
+  }
+  g_free(start);
+  tracer_release(tracer, order);
+  if (test_cancel && test_cancel(testcancel_data))
+    goto cleanup;
+  if (notify_progress)
+    notify_progress((gfloat)(2.0 / 9.0), progress_data);
+
+  /* Take out the branches of bumps on the border */
+  for (i = 0; i < n_pixels; i++)
+    if (sk.state[i] & IN_SKELETON && count_neighbors(skeleton_neighbors(&sk, i)) == 1)
+      prune_branch(&sk, i, max_distance);
+
+  /* The chains from each node, then the loops */
+  for (i = 0; i < n_pixels; i++) {
+    unsigned neighbors;
+
+    if (!(sk.state[i] & IN_SKELETON))
+      continue;
+    neighbors = skeleton_neighbors(&sk, i);
+    if (count_neighbors(neighbors) == 2)
+      continue;
+    for (dir = 0; dir < 8; dir++) {
+      gsize j = i + sk.offset[dir];
+      unsigned count;
+
+      if (!(neighbors & 1 << dir) || sk.state[j] & VISITED)
+        continue;
+      count = count_neighbors(skeleton_neighbors(&sk, j));
+      /* Two nodes next to each other make a line only if one is an
+         end; otherwise they are parts of one junction.  */
+      if (count == 2 || (j > i && (count == 1 || count_neighbors(neighbors) == 1)))
+        append_outline(&list, follow_chain(&sk, i, j, TRUE, arena), arena);
+    }
+  }
+  for (i = 0; i < n_pixels; i++) {
+    unsigned neighbors;
+
+    if (!(sk.state[i] & IN_SKELETON) || sk.state[i] & VISITED)
+      continue;
+    neighbors = skeleton_neighbors(&sk, i);
+    if (count_neighbors(neighbors) != 2)
+      continue;
+    for (dir = 0; !(neighbors & 1 << dir); dir++)
+      ;
+    sk.state[i] |= VISITED;
+    append_outline(&list, follow_chain(&sk, i, i + sk.offset[dir], FALSE, arena), arena);
+  }
+
+  if (test_cancel && test_cancel(testcancel_data))
+    list.length = 0;
+cleanup:
+  g_array_free(sk.queue, TRUE);
+  tracer_release(tracer, sk.same);
+  return list;
+}
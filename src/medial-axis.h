@@ -0,0 +1,31 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* medial-axis.h: center lines on the medial axis of a distance map. */
+
+#ifndef MEDIAL_AXIS_H
+#define MEDIAL_AXIS_H
+
+#include "arena.h"
+#include "autotrace.h"
+#include "exception.h"
+#include "image-proc.h"
+#include "pxl-outline.h"
+
+/* Find the center lines of each color of BITMAP but BG_COLOR, as
+   find_centerline_pixels does, but without thinning BITMAP, which is
+   only read: they run along the medial axis of DIST, a map from
+   new_color_distance_map, from one end or junction to the next.
+   Lines that make a loop are closed.  The list is allocated in
+   ARENA; it is empty if the search is canceled.  The state of the
+   pixels is kept in scratch buffers of TRACER, which may be NULL.  */
+extern pixel_outline_list_type
+find_medial_axis_pixels(at_bitmap *bitmap, at_color bg_color, at_distance_map *dist,
+                        at_progress_func notify_progress, gpointer progress_data,
+                        at_testcancel_func test_cancel, gpointer testcancel_data,
+                        at_tracer *tracer, arena_type *arena, at_exception_type *exp);
+
+#endif /* not MEDIAL_AXIS_H */
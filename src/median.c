@@ -8,9 +8,11 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "logreport.h"
 #include <glib.h>
 #include "quantize.h"
+#include "tracer.h"
 
 #define MAXNUMCOLORS 256
 
@@ -43,23 +45,21 @@ typedef struct {
   long colorcount;
 } box, *boxptr;
 
+#define HISTOGRAM_SIZE (sizeof(ColorFreq) * HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS)
+
 static void zero_histogram_rgb(Histogram histogram)
 {
-  int r, g, b;
-  for (r = 0; r < HIST_R_ELEMS; r++)
-    for (g = 0; g < HIST_G_ELEMS; g++)
-      for (b = 0; b < HIST_B_ELEMS; b++)
-        histogram[r * MR + g * MG + b] = 0;
+  memset(histogram, 0, HISTOGRAM_SIZE);
 }
 
 static void generate_histogram_rgb(Histogram histogram, at_bitmap *image,
                                    const at_color *ignoreColor)
 {
   unsigned char *src = image->bitmap;
-  int num_elems;
+  gssize num_elems;
   ColorFreq *col;
 
-  num_elems = AT_BITMAP_WIDTH(image) * AT_BITMAP_HEIGHT(image);
+  num_elems = (gssize)AT_BITMAP_WIDTH(image) * AT_BITMAP_HEIGHT(image);
   zero_histogram_rgb(histogram);
 
   switch (AT_BITMAP_PLANES(image)) {
@@ -777,7 +777,7 @@ static void median_cut_pass2_rgb(QuantizeObj *quantobj, at_bitmap *image, const
       }
     }
   } else if (spp == 1) {
-    long idx = width * height;
+    long idx = (long)width * height;
     while (--idx >= 0) {
       origR = src[idx];
       R = origR >> R_SHIFT;
@@ -798,19 +798,20 @@ static void median_cut_pass2_rgb(QuantizeObj *quantobj, at_bitmap *image, const
   }
 }
 
-static QuantizeObj *initialize_median_cut(int num_colors)
+static QuantizeObj *initialize_median_cut(int num_colors, at_tracer *tracer)
 {
   QuantizeObj *quantobj = g_malloc(sizeof(QuantizeObj));
 
-  /* Initialize the data structures */
-  quantobj->histogram = g_malloc(sizeof(ColorFreq) * HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
+  /* Initialize the data structures; each pass clears the histogram */
+  quantobj->histogram = tracer_scratch(tracer, SCRATCH_HISTOGRAM, HISTOGRAM_SIZE, FALSE);
+  quantobj->tracer = tracer;
   quantobj->desired_number_of_colors = num_colors;
 
   return quantobj;
 }
 
 void quantize(at_bitmap *image, long ncolors, const at_color *bgColor, QuantizeObj **iQuant,
-              at_exception_type *exp)
+              at_tracer *tracer, at_exception_type *exp)
 {
   QuantizeObj *quantobj;
   unsigned int spp = AT_BITMAP_PLANES(image);
@@ -824,13 +825,13 @@ void quantize(at_bitmap *image, long ncolors, const at_color *bgColor, QuantizeO
   /* If a pointer was sent in, let's use it. */
   if (iQuant) {
     if (*iQuant == NULL) {
-      quantobj = initialize_median_cut(ncolors);
+      quantobj = initialize_median_cut(ncolors, tracer);
       median_cut_pass1_rgb(quantobj, image, bgColor);
       *iQuant = quantobj;
     } else
       quantobj = *iQuant;
   } else {
-    quantobj = initialize_median_cut(ncolors);
+    quantobj = initialize_median_cut(ncolors, tracer);
     median_cut_pass1_rgb(quantobj, image, NULL);
   }
 
@@ -842,6 +843,6 @@ void quantize(at_bitmap *image, long ncolors, const at_color *bgColor, QuantizeO
 
 void quantize_object_free(QuantizeObj *quantobj)
 {
-  g_free(quantobj->histogram);
+  tracer_release(quantobj->tracer, quantobj->histogram);
   g_free(quantobj);
 }
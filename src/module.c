@@ -79,47 +79,56 @@ int at_module_init(void)
 static int install_input_readers(void)
 {
 #ifdef HAVE_LIBPNG
-  at_input_add_handler("PNG", "Portable network graphics (native)", input_png_reader);
+  at_input_add_memory_handler("PNG", "Portable network graphics (native)", input_png_reader,
+                              input_png_memory_reader, NULL);
 #endif
 
 #if !HAVE_MAGICK_READERS
-  at_input_add_handler("BMP", "Microsoft Windows bitmap image (native)", input_bmp_reader);
-  at_input_add_handler("TGA", "Truevision Targa image (native, 8 bit only)", input_tga_reader);
-  at_input_add_handler_full("PBM", "Portable bitmap format (native)", input_pnm_reader, 0, "PBM",
-                            NULL);
-  at_input_add_handler_full("PGM", "Portable graymap format (native)", input_pnm_reader, 0, "PGM",
-                            NULL);
-  at_input_add_handler_full("PNM", "Portable anymap format (native)", input_pnm_reader, 0, "PNM",
-                            NULL);
-  at_input_add_handler_full("PPM", "Portable pixmap format (native)", input_pnm_reader, 0, "PPM",
-                            NULL);
+  at_input_add_memory_handler("BMP", "Microsoft Windows bitmap image (native)", input_bmp_reader,
+                              input_bmp_memory_reader, NULL);
+  at_input_add_memory_handler("TGA", "Truevision Targa image (native, 8 bit only)",
+                              input_tga_reader, input_tga_memory_reader, NULL);
+  at_input_add_memory_handler("PBM", "Portable bitmap format (native)", input_pnm_reader,
+                              input_pnm_memory_reader, "PBM");
+  at_input_add_memory_handler("PGM", "Portable graymap format (native)", input_pnm_reader,
+                              input_pnm_memory_reader, "PGM");
+  at_input_add_memory_handler("PNM", "Portable anymap format (native)", input_pnm_reader,
+                              input_pnm_memory_reader, "PNM");
+  at_input_add_memory_handler("PPM", "Portable pixmap format (native)", input_pnm_reader,
+                              input_pnm_memory_reader, "PPM");
 #endif /* HAVE_MAGICK_READERS */
 
-  at_input_add_handler("GF", "TeX raster font (native)", input_gf_reader);
+  at_input_add_memory_handler("GF", "TeX raster font (native)", input_gf_reader,
+                              input_gf_memory_reader, NULL);
 
   return install_input_magick_readers();
 }
 
 static int install_output_writers(void)
 {
-  at_output_add_handler("AI", "Adobe Illustrator", output_eps_writer);
-  at_output_add_handler("CGM", "Computer Graphics Metafile", output_cgm_writer);
-  at_output_add_handler("DR2D", "IFF DR2D format", output_dr2d_writer);
-  at_output_add_handler("DXF", "DXF format (without splines)", output_dxf12_writer);
-  at_output_add_handler("EMF", "Enhanced Metafile format", output_emf_writer);
-  at_output_add_handler("EPD", "EPD format", output_epd_writer);
-  at_output_add_handler("EPS", "Encapsulated PostScript", output_eps_writer);
-  at_output_add_handler("ER", "Elastic Reality Shape file", output_er_writer);
-  at_output_add_handler("FIG", "XFIG 3.2", output_fig_writer);
-  at_output_add_handler("ILD", "ILDA format", output_ild_writer);
-  at_output_add_handler("MIF", "FrameMaker MIF format", output_mif_writer);
-  at_output_add_handler("P2E", "pstoedit frontend format", output_p2e_writer);
-  at_output_add_handler("PDF", "PDF format", output_pdf_writer);
-  at_output_add_handler("PLT", "HPGL format", output_plt_writer);
-  at_output_add_handler("POV", "Povray format", output_pov_writer);
-  at_output_add_handler("SK", "Sketch", output_sk_writer);
-  at_output_add_handler("SVG", "Scalable Vector Graphics", output_svg_writer);
-  at_output_add_handler("UGS", "Unicode glyph source", output_ugs_writer);
+  at_output_add_stream_handler("AI", "Adobe Illustrator", output_eps_begin, output_eps_list,
+                               output_eps_end);
+  at_output_add_sink_handler("CGM", "Computer Graphics Metafile", output_cgm_writer);
+  at_output_add_sink_handler("DR2D", "IFF DR2D format", output_dr2d_writer);
+  at_output_add_sink_handler("DXF", "DXF format (without splines)", output_dxf12_writer);
+  at_output_add_sink_handler("EMF", "Enhanced Metafile format", output_emf_writer);
+  at_output_add_sink_handler("EPD", "EPD format", output_epd_writer);
+  at_output_add_stream_handler("EPS", "Encapsulated PostScript", output_eps_begin, output_eps_list,
+                               output_eps_end);
+  at_output_add_sink_handler("ER", "Elastic Reality Shape file", output_er_writer);
+  at_output_add_sink_handler("FIG", "XFIG 3.2", output_fig_writer);
+  at_output_add_sink_handler("ILD", "ILDA format", output_ild_writer);
+  at_output_add_sink_handler("MIF", "FrameMaker MIF format", output_mif_writer);
+  at_output_add_stream_handler("P2E", "pstoedit frontend format", output_p2e_begin, output_p2e_list,
+                               output_p2e_end);
+  at_output_add_stream_handler("PDF", "PDF format", output_pdf_begin, output_pdf_list,
+                               output_pdf_end);
+  at_output_add_sink_handler("PLT", "HPGL format", output_plt_writer);
+  at_output_add_sink_handler("POV", "Povray format", output_pov_writer);
+  at_output_add_sink_handler("SK", "Sketch", output_sk_writer);
+  at_output_add_stream_handler("SVG", "Scalable Vector Graphics", output_svg_begin, output_svg_list,
+                               output_svg_end);
+  at_output_add_sink_handler("UGS", "Unicode glyph source", output_ugs_writer);
 
   return install_output_pstoedit_writers();
 }
@@ -22,30 +22,30 @@
 
 /* endianess independent IO functions */
 
-static gboolean write16(FILE *fdes, uint16_t data)
+static gboolean write16(at_sink *fdes, uint16_t data)
 {
   size_t count = 0;
   uint8_t outch;
 
   outch = (uint8_t)((data >> 8) & 0x0FF);
-  count += fwrite(&outch, 1, 1, fdes);
+  count += at_sink_write(fdes, &outch, 1);
 
   outch = (uint8_t)(data & 0x0FF);
-  count += fwrite(&outch, 1, 1, fdes);
+  count += at_sink_write(fdes, &outch, 1);
 
   return (count == sizeof(uint16_t)) ? TRUE : FALSE;
 }
 
-static gboolean write8(FILE *fdes, uint8_t data)
+static gboolean write8(at_sink *fdes, uint8_t data)
 {
   size_t count = 0;
 
-  count = fwrite(&data, 1, 1, fdes);
+  count = at_sink_write(fdes, &data, 1);
 
   return (count == sizeof(uint8_t)) ? TRUE : FALSE;
 }
 
-static gboolean output_beginmetafilename(FILE *fdes, const char *string)
+static gboolean output_beginmetafilename(at_sink *fdes, const char *string)
 {
   size_t len = strlen(string);
 
@@ -69,7 +69,7 @@ static gboolean output_beginmetafilename(FILE *fdes, const char *string)
   return TRUE;
 }
 
-static gboolean output_beginpicture(FILE *fdes, const char *string)
+static gboolean output_beginpicture(at_sink *fdes, const char *string)
 {
   int len = strlen(string);
 
@@ -93,7 +93,7 @@ static gboolean output_beginpicture(FILE *fdes, const char *string)
   return TRUE;
 }
 
-static gboolean output_metafiledescription(FILE *fdes, const char *string)
+static gboolean output_metafiledescription(at_sink *fdes, const char *string)
 {
   int len = strlen(string);
 
@@ -117,7 +117,7 @@ static gboolean output_metafiledescription(FILE *fdes, const char *string)
   return TRUE;
 }
 
-int output_cgm_writer(FILE *cgm_file, gchar *name, int llx, int lly, int urx, int ury,
+int output_cgm_writer(at_sink *cgm_file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
                       gpointer msg_data, gpointer user_data)
 {
@@ -14,11 +14,14 @@
 #include "spline.h"
 #include "color.h"
 #include "output-dr2d.h"
+#include "format.h"
 
-/* Globals: Values are set by output_dr2d_writer() */
-float XFactor;
-float YFactor;
-float LineThickness;
+/* Scaling values: set up by output_dr2d_writer() for each drawing */
+struct Scale {
+  float XFactor;
+  float YFactor;
+  float LineThickness;
+};
 
 #define FIXOFFS 10
 
@@ -43,16 +46,15 @@ struct Chunk {
   unsigned char *Data;
 };
 
-static struct Chunk *BuildDRHD(int, int, int, int);
+static struct Chunk *BuildDRHD(const struct Scale *, int, int, int, int);
 static struct Chunk *BuildPPRF(char *, int, char *, float);
 static struct Chunk *BuildCMAP(spline_list_array_type);
 static struct Chunk *BuildLAYR(void);
 static struct Chunk *BuildDASH(void);
-static struct Chunk *BuildBBOX(spline_list_type, int);
-static struct Chunk *BuildATTR(at_color, int, struct Chunk *);
+static struct Chunk *BuildBBOX(const struct Scale *, spline_list_type, int);
+static struct Chunk *BuildATTR(const struct Scale *, at_color, int, struct Chunk *);
 static int GetCMAPEntry(at_color, struct Chunk *);
 static int CountSplines(spline_list_type);
-static int SizeFloat(float, char *);
 static void ShortAsBytes(int, unsigned char *);
 static void IntAsBytes(int, unsigned char *);
 static void FloatAsIEEEBytes(float, unsigned char *);
@@ -62,9 +64,10 @@ static void FreeChunk(struct Chunk *);
 static void FreeChunks(struct Chunk **, int);
 static int TotalSizeChunks(struct Chunk **, int);
 static int SizeChunk(struct Chunk *);
-static void PushPolyPoint(unsigned char *, int *, float, float);
+static void PushPolyPoint(const struct Scale *, unsigned char *, int *, float, float);
 static void PushPolyIndicator(unsigned char *, int *, unsigned int);
-static struct Chunk **GeneratexPLY(struct Chunk *, spline_list_array_type, int);
+static struct Chunk **GeneratexPLY(const struct Scale *, struct Chunk *, spline_list_array_type,
+                                   int);
 
 static struct Chunk *BuildCMAP(spline_list_array_type shape)
 {
@@ -150,7 +153,7 @@ static int GetCMAPEntry(at_color colour, struct Chunk *CMAPChunk)
   return -1;
 }
 
-static struct Chunk *BuildBBOX(spline_list_type list, int height)
+static struct Chunk *BuildBBOX(const struct Scale *Scale, spline_list_type list, int height)
 {
   unsigned this_spline;
   unsigned this_spline_length;
@@ -201,10 +204,10 @@ static struct Chunk *BuildBBOX(spline_list_type list, int height)
     }
   }
 
-  FloatAsIEEEBytes(x1 * XFactor, BBOXData);
-  FloatAsIEEEBytes(y1 * YFactor, BBOXData + 4);
-  FloatAsIEEEBytes(x2 * XFactor, BBOXData + 8);
-  FloatAsIEEEBytes(y2 * YFactor, BBOXData + 12);
+  FloatAsIEEEBytes(x1 * Scale->XFactor, BBOXData);
+  FloatAsIEEEBytes(y1 * Scale->YFactor, BBOXData + 4);
+  FloatAsIEEEBytes(x2 * Scale->XFactor, BBOXData + 8);
+  FloatAsIEEEBytes(y2 * Scale->YFactor, BBOXData + 12);
 
   memcpy(BBOXChunk->ID, "BBOX", 4);
   BBOXChunk->Size = 16;
@@ -213,7 +216,8 @@ static struct Chunk *BuildBBOX(spline_list_type list, int height)
   return BBOXChunk;
 }
 
-static struct Chunk *BuildATTR(at_color colour, int StrokeOrFill, struct Chunk *CMAPChunk)
+static struct Chunk *BuildATTR(const struct Scale *Scale, at_color colour, int StrokeOrFill,
+                               struct Chunk *CMAPChunk)
 {
   struct Chunk *ATTRChunk;
   unsigned char *ATTRData;
@@ -239,7 +243,7 @@ static struct Chunk *BuildATTR(at_color colour, int StrokeOrFill, struct Chunk *
   ShortAsBytes(ColourIndex, ATTRData + 4);
   ShortAsBytes(ColourIndex, ATTRData + 6);
   ShortAsBytes(0, ATTRData + 8);
-  FloatAsIEEEBytes(LineThickness, ATTRData + 10);
+  FloatAsIEEEBytes(Scale->LineThickness, ATTRData + 10);
 
   memcpy(ATTRChunk->ID, "ATTR", 4);
   ATTRChunk->Size = 14;
@@ -248,7 +252,7 @@ static struct Chunk *BuildATTR(at_color colour, int StrokeOrFill, struct Chunk *
   return ATTRChunk;
 }
 
-static struct Chunk *BuildDRHD(int x1, int y1, int x2, int y2)
+static struct Chunk *BuildDRHD(const struct Scale *Scale, int x1, int y1, int x2, int y2)
 {
   struct Chunk *DRHDChunk;
   unsigned char *DRHDData;
@@ -264,10 +268,10 @@ static struct Chunk *BuildDRHD(int x1, int y1, int x2, int y2)
     return NULL;
   }
 
-  FloatAsIEEEBytes(x1 * XFactor, DRHDData);
-  FloatAsIEEEBytes(y1 * YFactor, DRHDData + 4);
-  FloatAsIEEEBytes(x2 * XFactor, DRHDData + 8);
-  FloatAsIEEEBytes(y2 * YFactor, DRHDData + 12);
+  FloatAsIEEEBytes(x1 * Scale->XFactor, DRHDData);
+  FloatAsIEEEBytes(y1 * Scale->YFactor, DRHDData + 4);
+  FloatAsIEEEBytes(x2 * Scale->XFactor, DRHDData + 8);
+  FloatAsIEEEBytes(y2 * Scale->YFactor, DRHDData + 12);
 
   memcpy(DRHDChunk->ID, "DRHD", 4);
   DRHDChunk->Size = 16;
@@ -291,7 +295,7 @@ static struct Chunk *BuildPPRF(char *Units, int Portrait, char *PageType, float
   ChunkSize = strlen("Units=") + strlen(Units) + 1;
   ChunkSize += strlen("Portrait=") + (Portrait ? 4 : 5) + 1;
   ChunkSize += strlen("PageType=") + strlen(PageType) + 1;
-  ChunkSize += strlen("GridSize=") + SizeFloat(GridSize, "%f") + 1;
+  ChunkSize += strlen("GridSize=") + format_fixed(NULL, 0, GridSize, 6) + 1;
 
   if ((PPRFData = (char *)malloc(ChunkSize)) == NULL) {
     fprintf(stderr, "Insufficient memory to allocate PPRF data\n");
@@ -306,7 +310,9 @@ static struct Chunk *BuildPPRF(char *Units, int Portrait, char *PageType, float
   PPRFPos += strlen(PPRFPos) + 1;
   sprintf(PPRFPos, "PageType=%s", PageType);
   PPRFPos += strlen(PPRFPos) + 1;
-  sprintf(PPRFPos, "GridSize=%f", GridSize);
+  strcpy(PPRFPos, "GridSize=");
+  PPRFPos += strlen(PPRFPos);
+  format_fixed(PPRFPos, PPRFData + ChunkSize - PPRFPos, GridSize, 6);
 
   memcpy(PPRFChunk->ID, "PPRF", 4);
   PPRFChunk->Size = ChunkSize;
@@ -370,7 +376,8 @@ static struct Chunk *BuildDASH(void)
   return DASHChunk;
 }
 
-static struct Chunk **GeneratexPLY(struct Chunk *CMAP, spline_list_array_type shape, int height)
+static struct Chunk **GeneratexPLY(const struct Scale *Scale, struct Chunk *CMAP,
+                                   spline_list_array_type shape, int height)
 {
   unsigned this_list;
   unsigned this_list_length;
@@ -402,8 +409,8 @@ static struct Chunk **GeneratexPLY(struct Chunk *CMAP, spline_list_array_type sh
     StrokeOrFill = (shape.centerline || list.open);
     this_spline_length = SPLINE_LIST_LENGTH(list);
 
-    ChunkList[ListPoint++] = BuildBBOX(list, height);
-    ChunkList[ListPoint++] = BuildATTR(curr_color, StrokeOrFill, CMAP);
+    ChunkList[ListPoint++] = BuildBBOX(Scale, list, height);
+    ChunkList[ListPoint++] = BuildATTR(Scale, curr_color, StrokeOrFill, CMAP);
 
     if ((PolyChunk = (struct Chunk *)malloc(sizeof(struct Chunk))) == NULL) {
       fprintf(stderr, "Insufficient memory to allocate xPLY chunk\n");
@@ -432,20 +439,21 @@ static struct Chunk **GeneratexPLY(struct Chunk *CMAP, spline_list_array_type sh
     PolyPoint = 2;
 
     if (SPLINE_DEGREE(first) == LINEARTYPE) {
-      PushPolyPoint(PolyData, &PolyPoint, START_POINT(first).x, height - START_POINT(first).y);
+      PushPolyPoint(Scale, PolyData, &PolyPoint, START_POINT(first).x,
+                    height - START_POINT(first).y);
     }
 
     for (this_spline = 0; this_spline < this_spline_length; this_spline++) {
       s = SPLINE_LIST_ELT(list, this_spline);
 
       if (SPLINE_DEGREE(s) == LINEARTYPE) {
-        PushPolyPoint(PolyData, &PolyPoint, END_POINT(s).x, height - END_POINT(s).y);
+        PushPolyPoint(Scale, PolyData, &PolyPoint, END_POINT(s).x, height - END_POINT(s).y);
       } else {
         PushPolyIndicator(PolyData, &PolyPoint, IND_SPLINE);
-        PushPolyPoint(PolyData, &PolyPoint, START_POINT(s).x, height - START_POINT(s).y);
-        PushPolyPoint(PolyData, &PolyPoint, CONTROL1(s).x, height - CONTROL1(s).y);
-        PushPolyPoint(PolyData, &PolyPoint, CONTROL2(s).x, height - CONTROL2(s).y);
-        PushPolyPoint(PolyData, &PolyPoint, END_POINT(s).x, height - END_POINT(s).y);
+        PushPolyPoint(Scale, PolyData, &PolyPoint, START_POINT(s).x, height - START_POINT(s).y);
+        PushPolyPoint(Scale, PolyData, &PolyPoint, CONTROL1(s).x, height - CONTROL1(s).y);
+        PushPolyPoint(Scale, PolyData, &PolyPoint, CONTROL2(s).x, height - CONTROL2(s).y);
+        PushPolyPoint(Scale, PolyData, &PolyPoint, END_POINT(s).x, height - END_POINT(s).y);
       }
     }
   }
@@ -477,15 +485,16 @@ static int CountSplines(spline_list_type list)
   return Total;
 }
 
-static void PushPolyPoint(unsigned char *PolyData, int *PolyPoint, float x, float y)
+static void PushPolyPoint(const struct Scale *Scale, unsigned char *PolyData, int *PolyPoint,
+                          float x, float y)
 {
   int PolyLocal;
 
   PolyLocal = *PolyPoint;
 
-  FloatAsIEEEBytes(x * XFactor, PolyData + PolyLocal);
+  FloatAsIEEEBytes(x * Scale->XFactor, PolyData + PolyLocal);
   PolyLocal += 4;
-  FloatAsIEEEBytes(y * YFactor, PolyData + PolyLocal);
+  FloatAsIEEEBytes(y * Scale->YFactor, PolyData + PolyLocal);
 
   *PolyPoint = PolyLocal + 4;
 }
@@ -503,7 +512,7 @@ static void PushPolyIndicator(unsigned char *PolyData, int *PolyPoint, unsigned
   *PolyPoint = PolyLocal + 4;
 }
 
-static void WriteChunk(FILE *file, struct Chunk *Chunk)
+static void WriteChunk(at_sink *file, struct Chunk *Chunk)
 {
   unsigned char SizeBytes[4];
   int Size;
@@ -511,15 +520,15 @@ static void WriteChunk(FILE *file, struct Chunk *Chunk)
   Size = Chunk->Size;
   IntAsBytes(Size, SizeBytes);
 
-  fwrite(Chunk->ID, 4, 1, file);
-  fwrite(SizeBytes, 4, 1, file);
-  fwrite(Chunk->Data, Size, 1, file);
+  at_sink_write(file, Chunk->ID, 4);
+  at_sink_write(file, SizeBytes, 4);
+  at_sink_write(file, Chunk->Data, Size);
   if (Size & 0x01) {
-    fprintf(file, "%c", 0);
+    at_sink_printf(file, "%c", 0);
   }
 }
 
-static void WriteChunks(FILE *file, struct Chunk **ChunkList, int NumChunks)
+static void WriteChunks(at_sink *file, struct Chunk **ChunkList, int NumChunks)
 {
   int WalkChunks;
 
@@ -570,7 +579,7 @@ static void FreeChunks(struct Chunk **ChunkList, int NumChunks)
   }
 }
 
-int output_dr2d_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_dr2d_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                        at_output_opts_type *opts, spline_list_array_type shape,
                        at_msg_func msg_func, gpointer msg_data, gpointer user_data)
 {
@@ -585,26 +594,27 @@ int output_dr2d_writer(FILE *file, gchar *name, int llx, int lly, int urx, int u
   struct Chunk *CMAPChunk;
   struct Chunk **ChunkList;
   unsigned char SizeBytes[4];
+  struct Scale Scale;
 
   Portrait = width < height;
 
   if (Portrait) {
-    XFactor = ((float)11.6930 / (float)width) * (1 << FIXOFFS);
-    YFactor = XFactor;
+    Scale.XFactor = ((float)11.6930 / (float)width) * (1 << FIXOFFS);
+    Scale.YFactor = Scale.XFactor;
   } else {
-    YFactor = ((float)8.2681 / (float)height) * (1 << FIXOFFS);
-    XFactor = YFactor;
+    Scale.YFactor = ((float)8.2681 / (float)height) * (1 << FIXOFFS);
+    Scale.XFactor = Scale.YFactor;
   }
 
-  LineThickness = (float)1.0 / opts->dpi;
+  Scale.LineThickness = (float)1.0 / opts->dpi;
 
-  DRHDChunk = BuildDRHD(llx, lly, urx, ury);
+  DRHDChunk = BuildDRHD(&Scale, llx, lly, urx, ury);
   PPRFChunk = BuildPPRF("Inch", Portrait, "A4", 1.0);
   LAYRChunk = BuildLAYR();
   DASHChunk = BuildDASH();
   CMAPChunk = BuildCMAP(shape);
 
-  ChunkList = GeneratexPLY(CMAPChunk, shape, height);
+  ChunkList = GeneratexPLY(&Scale, CMAPChunk, shape, height);
 
   NumSplines = SPLINE_LIST_ARRAY_LENGTH(shape) * 3;
   FORMSize = 4 + (SizeChunk(DRHDChunk) + 8) + (SizeChunk(PPRFChunk) + 8) +
@@ -612,9 +622,9 @@ int output_dr2d_writer(FILE *file, gchar *name, int llx, int lly, int urx, int u
              TotalSizeChunks(ChunkList, NumSplines);
 
   IntAsBytes(FORMSize, SizeBytes);
-  fprintf(file, "FORM");
-  fwrite(SizeBytes, 4, 1, file);
-  fprintf(file, "DR2D");
+  at_sink_printf(file, "FORM");
+  at_sink_write(file, SizeBytes, 4);
+  at_sink_printf(file, "DR2D");
 
   WriteChunk(file, DRHDChunk);
   FreeChunk(DRHDChunk);
@@ -632,13 +642,6 @@ int output_dr2d_writer(FILE *file, gchar *name, int llx, int lly, int urx, int u
   return 0;
 }
 
-static int SizeFloat(float f, char *Format)
-{
-  char FloatString[100];
-
-  return (sprintf(FloatString, Format, f));
-}
-
 static void IntAsBytes(int value, unsigned char *bytes)
 {
   *bytes = (unsigned char)((value >> 24) & 0xFF);
@@ -22,10 +22,10 @@
 /* Output macros.  */
 
 /* This should be used for outputting a string S on a line by itself.  */
-#define OUT_LINE(s) fprintf(dxf_file, "%s\n", s)
+#define OUT_LINE(s) at_sink_printf(dxf_file, "%s\n", s)
 
 /* These output their arguments, preceded by the indentation.  */
-#define OUT(s, ...) fprintf(dxf_file, s, __VA_ARGS__)
+#define OUT(s, ...) at_sink_printf(dxf_file, s, __VA_ARGS__)
 
 #define color_check FALSE
 
@@ -545,7 +545,7 @@ int bspline_to_lines(xypnt_head_rec *vtx_list /*  */, xypnt_head_rec **new_vtx_l
 /******************************************************************************
  * This function outputs the DXF code which produces the polylines
  */
-static void out_splines(FILE *dxf_file, spline_list_array_type shape)
+static void out_splines(at_sink *dxf_file, spline_list_array_type shape)
 {
   unsigned this_list;
   double startx, starty;
@@ -579,17 +579,19 @@ static void out_splines(FILE *dxf_file, spline_list_array_type shape)
           new_layer) {
         /* must begin new polyline */
         new_layer = 0;
-        fprintf(dxf_file, "  0\nSEQEND\n  8\n%s\n", layerstr);
-        fprintf(dxf_file, "  0\nPOLYLINE\n  8\n%s\n  66\n1\n  10\n%f\n  20\n%f\n", layerstr, startx,
-                starty);
-        fprintf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr, startx, starty);
+        at_sink_printf(dxf_file, "  0\nSEQEND\n  8\n%s\n", layerstr);
+        at_sink_printf(dxf_file, "  0\nPOLYLINE\n  8\n%s\n  66\n1\n  10\n%f\n  20\n%f\n", layerstr,
+                       startx, starty);
+        at_sink_printf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr, startx,
+                       starty);
         pnt_old.xp = lround(startx * RESOLUTION);
         pnt_old.yp = lround(starty * RESOLUTION);
       }
     } else {
-      fprintf(dxf_file, "  0\nPOLYLINE\n  8\n%s\n  66\n1\n  10\n%f\n  20\n%f\n", layerstr, startx,
-              starty);
-      fprintf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr, startx, starty);
+      at_sink_printf(dxf_file, "  0\nPOLYLINE\n  8\n%s\n  66\n1\n  10\n%f\n  20\n%f\n", layerstr,
+                     startx, starty);
+      at_sink_printf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr, startx,
+                     starty);
       pnt_old.xp = lround(startx * RESOLUTION);
       pnt_old.yp = lround(starty * RESOLUTION);
     }
@@ -602,13 +604,14 @@ static void out_splines(FILE *dxf_file, spline_list_array_type shape)
             lround(starty * RESOLUTION) != pnt_old.yp || new_layer) {
           /* must begin new polyline */
           new_layer = 0;
-          fprintf(dxf_file, "  0\nSEQEND\n  8\n%s\n", layerstr);
-          fprintf(dxf_file, "  0\nPOLYLINE\n  8\n%s\n  66\n1\n  10\n%f\n  20\n%f\n", layerstr,
-                  startx, starty);
-          fprintf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr, startx, starty);
+          at_sink_printf(dxf_file, "  0\nSEQEND\n  8\n%s\n", layerstr);
+          at_sink_printf(dxf_file, "  0\nPOLYLINE\n  8\n%s\n  66\n1\n  10\n%f\n  20\n%f\n",
+                         layerstr, startx, starty);
+          at_sink_printf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr, startx,
+                         starty);
         }
-        fprintf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr, END_POINT(s).x,
-                END_POINT(s).y);
+        at_sink_printf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr,
+                       END_POINT(s).x, END_POINT(s).y);
 
         startx = END_POINT(s).x;
         starty = END_POINT(s).y;
@@ -640,17 +643,17 @@ static void out_splines(FILE *dxf_file, spline_list_array_type shape)
         if (pnt.xp != pnt_old.xp || pnt.yp != pnt_old.yp || new_layer) {
           /* must begin new polyline */
           new_layer = 0;
-          fprintf(dxf_file, "  0\nSEQEND\n  8\n%s\n", layerstr);
-          fprintf(dxf_file, "  0\nPOLYLINE\n  8\n%s\n  66\n1\n  10\n%f\n  20\n%f\n", layerstr,
-                  (double)pnt.xp / RESOLUTION, (double)pnt.yp / RESOLUTION);
-          fprintf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr,
-                  (double)pnt.xp / RESOLUTION, (double)pnt.yp / RESOLUTION);
+          at_sink_printf(dxf_file, "  0\nSEQEND\n  8\n%s\n", layerstr);
+          at_sink_printf(dxf_file, "  0\nPOLYLINE\n  8\n%s\n  66\n1\n  10\n%f\n  20\n%f\n",
+                         layerstr, (double)pnt.xp / RESOLUTION, (double)pnt.yp / RESOLUTION);
+          at_sink_printf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr,
+                         (double)pnt.xp / RESOLUTION, (double)pnt.yp / RESOLUTION);
         }
         i = 0;
         while (!fin) {
           if (i) {
-            fprintf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr,
-                    (double)pnt.xp / RESOLUTION, (double)pnt.yp / RESOLUTION);
+            at_sink_printf(dxf_file, "  0\nVERTEX\n  8\n%s\n  10\n%f\n  20\n%f\n", layerstr,
+                           (double)pnt.xp / RESOLUTION, (double)pnt.yp / RESOLUTION);
           }
           xypnt_next_pnt(res, &pnt, &fin);
           i++;
@@ -672,13 +675,13 @@ static void out_splines(FILE *dxf_file, spline_list_array_type shape)
     last_color = curr_color;
   }
 
-  fprintf(dxf_file, "  0\nSEQEND\n  8\n0\n");
+  at_sink_printf(dxf_file, "  0\nSEQEND\n  8\n0\n");
 }
 
 /******************************************************************************
  * This function outputs a complete layer table for all 255 colors.
  */
-void output_layer(FILE *dxf_file, spline_list_array_type shape)
+void output_layer(at_sink *dxf_file, spline_list_array_type shape)
 {
   int i, idx;
   char layerlist[256];
@@ -746,7 +749,7 @@ void output_layer(FILE *dxf_file, spline_list_array_type shape)
 /******************************************************************************
  * DXF output function.
  */
-int output_dxf12_writer(FILE *dxf_file, gchar *name, int llx, int lly, int urx, int ury,
+int output_dxf12_writer(at_sink *dxf_file, gchar *name, int llx, int lly, int urx, int ury,
                         at_output_opts_type *opts, spline_list_array_type shape,
                         at_msg_func msg_func, gpointer msg_data, gpointer user_data)
 {
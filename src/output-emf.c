@@ -77,14 +77,9 @@ typedef struct {
   int ncolors;
   int nrecords;
   int filesize;
+  uint32_t *color_table; /* Color table */
 } EMFStats;
 
-/* globals */
-
-static EMFColorList *color_list = NULL; /* Color list */
-static uint32_t *color_table = NULL;    /* Color table */
-static float y_offset;
-
 /* color list & table functions */
 
 static int SearchColor(EMFColorList *head, uint32_t colref)
@@ -135,43 +130,46 @@ static int ColorLookUp(uint32_t colref, uint32_t *table, int len)
 
 /* endianess independent IO functions */
 
-static gboolean write32(FILE *fdes, uint32_t data)
+static gboolean write32(at_sink *fdes, uint32_t data)
 {
   size_t count = 0;
   uint8_t outch;
 
   outch = (uint8_t)(data & 0x0FF);
-  count += fwrite(&outch, 1, 1, fdes);
+  count += at_sink_write(fdes, &outch, 1);
 
   outch = (uint8_t)((data >> 8) & 0x0FF);
-  count += fwrite(&outch, 1, 1, fdes);
+  count += at_sink_write(fdes, &outch, 1);
 
   outch = (uint8_t)((data >> 16) & 0x0FF);
-  count += fwrite(&outch, 1, 1, fdes);
+  count += at_sink_write(fdes, &outch, 1);
 
   outch = (uint8_t)((data >> 24) & 0x0FF);
-  count += fwrite(&outch, 1, 1, fdes);
+  count += at_sink_write(fdes, &outch, 1);
 
   return (count == sizeof(uint32_t)) ? TRUE : FALSE;
 }
 
-static gboolean write16(FILE *fdes, uint16_t data)
+static gboolean write16(at_sink *fdes, uint16_t data)
 {
   size_t count = 0;
   uint8_t outch;
 
   outch = (uint8_t)(data & 0x0FF);
-  count += fwrite(&outch, 1, 1, fdes);
+  count += at_sink_write(fdes, &outch, 1);
 
   outch = (uint8_t)((data >> 8) & 0x0FF);
-  count += fwrite(&outch, 1, 1, fdes);
+  count += at_sink_write(fdes, &outch, 1);
 
   return (count == sizeof(uint16_t)) ? TRUE : FALSE;
 }
 
-/* EMF record-type function definitions */
+/* EMF record-type function definitions
+
+   Records carrying y coordinates take the y_offset of the current
+   output as a parameter, which the Y_FLOAT_TO_UI* macros refer to.  */
 
-static int WriteMoveTo(FILE *fdes, at_real_coord *pt)
+static int WriteMoveTo(at_sink *fdes, float y_offset, at_real_coord *pt)
 {
   int recsize = sizeof(uint32_t) * 4;
 
@@ -184,7 +182,7 @@ static int WriteMoveTo(FILE *fdes, at_real_coord *pt)
   return recsize;
 }
 
-static int WriteLineTo(FILE *fdes, spline_type *spl)
+static int WriteLineTo(at_sink *fdes, float y_offset, spline_type *spl)
 {
   int recsize = sizeof(uint32_t) * 4;
 
@@ -199,7 +197,7 @@ static int WriteLineTo(FILE *fdes, spline_type *spl)
 
 /* CorelDraw 9 can't handle PolyLineTo nor PolyLineTo16, so we
    do not use this function but divide it to single lines instead
-int WritePolyLineTo(FILE* fdes, spline_type *spl, int nlines)
+int WritePolyLineTo(at_sink *fdes, spline_type *spl, int nlines)
 {
   int i;
   int recsize = sizeof(uint32_t) * (7 + nlines * 1);
@@ -223,14 +221,14 @@ int WritePolyLineTo(FILE* fdes, spline_type *spl, int nlines)
   return recsize;
 } */
 
-static int MyWritePolyLineTo(FILE *fdes, spline_type *spl, int nlines)
+static int MyWritePolyLineTo(at_sink *fdes, float y_offset, spline_type *spl, int nlines)
 {
   int i;
-  int recsize = nlines * WriteLineTo(NULL, NULL);
+  int recsize = nlines * WriteLineTo(NULL, y_offset, NULL);
 
   if (fdes != NULL) {
     for (i = 0; i < nlines; i++) {
-      WriteLineTo(fdes, &spl[i]);
+      WriteLineTo(fdes, y_offset, &spl[i]);
     }
   }
   return recsize;
@@ -239,7 +237,7 @@ static int MyWritePolyLineTo(FILE *fdes, spline_type *spl, int nlines)
 /* CorelDraw 9 can't handle PolyBezierTo so we do not use this
    function but use PolyBezierTo16 instead
 
-int WritePolyBezierTo(FILE *fdes, spline_type *spl, int ncurves)
+int WritePolyBezierTo(at_sink *fdes, spline_type *spl, int ncurves)
 {
   int i;
   int recsize = sizeof(uint32_t) * (7 + ncurves * 6);
@@ -267,7 +265,7 @@ int WritePolyBezierTo(FILE *fdes, spline_type *spl, int ncurves)
   return recsize;
 } */
 
-static int WritePolyBezierTo16(FILE *fdes, spline_type *spl, int ncurves)
+static int WritePolyBezierTo16(at_sink *fdes, float y_offset, spline_type *spl, int ncurves)
 {
   int i;
   int recsize = sizeof(uint32_t) * 7 + sizeof(uint16_t) * ncurves * 6;
@@ -293,7 +291,7 @@ static int WritePolyBezierTo16(FILE *fdes, spline_type *spl, int ncurves)
   return recsize;
 }
 
-static int WriteSetPolyFillMode(FILE *fdes)
+static int WriteSetPolyFillMode(at_sink *fdes)
 {
   int recsize = sizeof(uint32_t) * 3;
 
@@ -305,7 +303,7 @@ static int WriteSetPolyFillMode(FILE *fdes)
   return recsize;
 }
 
-static int WriteBeginPath(FILE *fdes)
+static int WriteBeginPath(at_sink *fdes)
 {
   int recsize = sizeof(uint32_t) * 2;
 
@@ -316,7 +314,7 @@ static int WriteBeginPath(FILE *fdes)
   return recsize;
 }
 
-static int WriteEndPath(FILE *fdes)
+static int WriteEndPath(at_sink *fdes)
 {
   int recsize = sizeof(uint32_t) * 2;
 
@@ -327,7 +325,7 @@ static int WriteEndPath(FILE *fdes)
   return recsize;
 }
 
-static int WriteFillPath(FILE *fdes)
+static int WriteFillPath(at_sink *fdes)
 {
   int recsize = sizeof(uint32_t) * 6;
 
@@ -342,7 +340,7 @@ static int WriteFillPath(FILE *fdes)
   return recsize;
 }
 
-static int WriteStrokePath(FILE *fdes)
+static int WriteStrokePath(at_sink *fdes)
 {
   int recsize = sizeof(uint32_t) * 6;
 
@@ -358,7 +356,7 @@ static int WriteStrokePath(FILE *fdes)
 }
 
 #if 0
-static int WriteSetWorldTransform(FILE * fdes, uint32_t height)
+static int WriteSetWorldTransform(at_sink *fdes, uint32_t height)
 {
   int recsize = sizeof(uint32_t) * 8;
   float fHeight;
@@ -388,7 +386,7 @@ static int WriteSetWorldTransform(FILE * fdes, uint32_t height)
 }
 #endif /* 0 */
 
-static int WriteCreateSolidPen(FILE *fdes, int hndNum, uint32_t colref)
+static int WriteCreateSolidPen(at_sink *fdes, int hndNum, uint32_t colref)
 {
   int recsize = sizeof(uint32_t) * 7;
 
@@ -404,7 +402,7 @@ static int WriteCreateSolidPen(FILE *fdes, int hndNum, uint32_t colref)
   return recsize;
 }
 
-static int WriteCreateSolidBrush(FILE *fdes, int hndNum, uint32_t colref)
+static int WriteCreateSolidBrush(at_sink *fdes, int hndNum, uint32_t colref)
 {
   int recsize = sizeof(uint32_t) * 6;
 
@@ -419,7 +417,7 @@ static int WriteCreateSolidBrush(FILE *fdes, int hndNum, uint32_t colref)
   return recsize;
 }
 
-static int WriteSelectObject(FILE *fdes, int hndNum)
+static int WriteSelectObject(at_sink *fdes, int hndNum)
 {
   int recsize = sizeof(uint32_t) * 3;
 
@@ -432,7 +430,7 @@ static int WriteSelectObject(FILE *fdes, int hndNum)
 }
 
 /* SPH: Added 10/14/04 to prevent resource overflow when large number of colors used */
-static int WriteDeleteObject(FILE *fdes, int hndNum)
+static int WriteDeleteObject(at_sink *fdes, int hndNum)
 {
   int recsize = sizeof(uint32_t) * 3;
 
@@ -444,7 +442,7 @@ static int WriteDeleteObject(FILE *fdes, int hndNum)
   return recsize;
 }
 
-static int WriteEndOfMetafile(FILE *fdes)
+static int WriteEndOfMetafile(at_sink *fdes)
 {
   int recsize = sizeof(uint32_t) * 5;
 
@@ -458,7 +456,7 @@ static int WriteEndOfMetafile(FILE *fdes)
   return recsize;
 }
 
-static int WriteHeader(FILE *fdes, gchar *name, int width, int height, int fsize, int nrec,
+static int WriteHeader(at_sink *fdes, gchar *name, int width, int height, int fsize, int nrec,
                        int nhand)
 {
   int i, recsize;
@@ -626,7 +624,7 @@ static void GetEmfStats(EMFStats *stats, gchar* name, spline_list_array_type sha
   ColorListToColorTable(&color_list, &color_table, ncolors);
 }
 
-static void OutputEmf(FILE* fdes, EMFStats *stats, gchar* name, int width, int height,
+static void OutputEmf(at_sink *fdes, EMFStats *stats, gchar* name, int width, int height,
 spline_list_array_type shape)
 {
   unsigned int i, j;
@@ -750,6 +748,7 @@ static void GetEmfStats(EMFStats *stats, gchar *name, spline_list_array_type sha
   int nrecords = 0;
   int filesize = 0;
   uint32_t last_color = 0xFFFFFFFF, curr_color;
+  EMFColorList *color_list = NULL;
   spline_list_type curr_list;
   spline_type curr_spline;
   int last_degree;
@@ -791,7 +790,7 @@ static void GetEmfStats(EMFStats *stats, gchar *name, spline_list_array_type sha
     filesize += WriteBeginPath(NULL);
     // emf stats :: MoveTo
     nrecords++;
-    filesize += WriteMoveTo(NULL, NULL);
+    filesize += WriteMoveTo(NULL, 0, NULL);
     // visit each spline
     this_spline = 0;
     last_degree = -1;
@@ -815,12 +814,12 @@ static void GetEmfStats(EMFStats *stats, gchar *name, spline_list_array_type sha
       case LINEARTYPE:
         // emf stats :: PolyLineTo
         nrecords += nlines;
-        filesize += MyWritePolyLineTo(NULL, NULL, nlines);
+        filesize += MyWritePolyLineTo(NULL, 0, NULL, nlines);
         break;
       default:
         // emf stats :: PolyBezierTo
         nrecords++;
-        filesize += WritePolyBezierTo16(NULL, NULL, nlines);
+        filesize += WritePolyBezierTo16(NULL, 0, NULL, nlines);
         break;
       }
     }
@@ -852,12 +851,12 @@ static void GetEmfStats(EMFStats *stats, gchar *name, spline_list_array_type sha
   stats->filesize = filesize;
 
   // convert the color list into a color table
-  ColorListToColorTable(&color_list, &color_table, ncolors);
+  ColorListToColorTable(&color_list, &stats->color_table, ncolors);
 }
 
 // EMF output
 
-static void OutputEmf(FILE *fdes, EMFStats *stats, gchar *name, int width, int height,
+static void OutputEmf(at_sink *fdes, EMFStats *stats, gchar *name, int width, int height,
                       spline_list_array_type shape)
 {
   unsigned int this_list, this_spline;
@@ -867,13 +866,13 @@ static void OutputEmf(FILE *fdes, EMFStats *stats, gchar *name, int width, int h
   spline_type curr_spline;
   int last_degree;
   int nlines;
+  uint32_t *color_table = stats->color_table;
+  float y_offset = SCALE * height;
 
   // output EMF header
   WriteHeader(fdes, name, width, height, stats->filesize, stats->nrecords,
               (stats->ncolors * 2) + 1);
 
-  y_offset = SCALE * height;
-
   // output fill mode
   WriteSetPolyFillMode(fdes);
 
@@ -907,7 +906,7 @@ static void OutputEmf(FILE *fdes, EMFStats *stats, gchar *name, int width, int h
 
     // output MoveTo first point
     curr_spline = SPLINE_LIST_ELT(curr_list, 0);
-    WriteMoveTo(fdes, &(START_POINT(curr_spline)));
+    WriteMoveTo(fdes, y_offset, &(START_POINT(curr_spline)));
 
     // visit each spline
     this_spline = 0;
@@ -930,11 +929,13 @@ static void OutputEmf(FILE *fdes, EMFStats *stats, gchar *name, int width, int h
       switch ((polynomial_degree)last_degree) {
       case LINEARTYPE:
         // output PolyLineTo
-        MyWritePolyLineTo(fdes, &(SPLINE_LIST_ELT(curr_list, this_spline - nlines)), nlines);
+        MyWritePolyLineTo(fdes, y_offset, &(SPLINE_LIST_ELT(curr_list, this_spline - nlines)),
+                          nlines);
         break;
       default:
         // output PolyBezierTo
-        WritePolyBezierTo16(fdes, &(SPLINE_LIST_ELT(curr_list, this_spline - nlines)), nlines);
+        WritePolyBezierTo16(fdes, y_offset, &(SPLINE_LIST_ELT(curr_list, this_spline - nlines)),
+                            nlines);
         break;
       }
     }
@@ -960,21 +961,15 @@ static void OutputEmf(FILE *fdes, EMFStats *stats, gchar *name, int width, int h
 
   // delete color table
   g_free(color_table);
+  stats->color_table = NULL;
 }
 
-int output_emf_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_emf_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
                       gpointer msg_data, gpointer user_data)
 {
   EMFStats stats;
 
-#ifdef _WINDOWS
-  if (file == stdout) {
-    fprintf(stderr, "This driver couldn't write to stdout!\n");
-    return -1;
-  }
-#endif
-
   /* Get EMF stats */
   GetEmfStats(&stats, name, shape);
 
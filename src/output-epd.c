@@ -19,17 +19,17 @@
 /* Output macros.  */
 
 /* This should be used for outputting a string S on a line by itself.  */
-#define OUT_LINE(s) fprintf(epd_file, "%s\n", s)
+#define OUT_LINE(s) at_sink_printf(epd_file, "%s\n", s)
 
 /* This output their arguments, preceded by the indentation.  */
-#define OUT(...) fprintf(epd_file, __VA_ARGS__)
+#define OUT(...) at_sink_printf(epd_file, __VA_ARGS__)
 
 /* These macros just output their arguments.  */
 #define OUT_REAL(r)                                                                                \
   do {                                                                                             \
     double _r = (r);                                                                               \
     double _frac = fabs(_r - round(_r));                                                           \
-    fprintf(epd_file, _frac < 0.0001 ? "%.0f " : "%.3f ", _r);                                     \
+    at_sink_printf(epd_file, _frac < 0.0001 ? "%.0f " : "%.3f ", _r);                              \
   } while (0)
 
 /* For a PostScript command with two real arguments, e.g., lineto.  OP
@@ -59,7 +59,7 @@
 /* This should be called before the others in this file.  It opens the
    output file `OUTPUT_NAME.ps', and writes some preliminary boilerplate. */
 
-static int output_epd_header(FILE *epd_file, gchar *name, int llx, int lly, int urx, int ury)
+static int output_epd_header(at_sink *epd_file, gchar *name, int llx, int lly, int urx, int ury)
 {
   g_autoptr(GDateTime) date = g_date_time_new_now_local();
   g_autofree gchar *time = g_date_time_format(date, "%a %b %e %H:%M:%S %Y");
@@ -76,7 +76,7 @@ static int output_epd_header(FILE *epd_file, gchar *name, int llx, int lly, int
 /* This outputs the PostScript code which produces the shape in
    SHAPE.  */
 
-static void out_splines(FILE *epd_file, spline_list_array_type shape)
+static void out_splines(at_sink *epd_file, spline_list_array_type shape)
 {
   unsigned this_list;
   spline_list_type list;
@@ -114,7 +114,7 @@ static void out_splines(FILE *epd_file, spline_list_array_type shape)
     OUT_LINE((shape.centerline || list.open) ? "S" : "f");
 }
 
-int output_epd_writer(FILE *epd_file, gchar *name, int llx, int lly, int urx, int ury,
+int output_epd_writer(at_sink *epd_file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
                       gpointer msg_data, gpointer user_data)
 {
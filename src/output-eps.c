@@ -21,17 +21,17 @@
 /* Output macros.  */
 
 /* This should be used for outputting a string S on a line by itself.  */
-#define OUT_LINE(s) fprintf(ps_file, "%s\n", s)
+#define OUT_LINE(s) at_sink_printf(ps_file, "%s\n", s)
 
 /* These output their arguments, preceded by the indentation.  */
-#define OUT(...) fprintf(ps_file, __VA_ARGS__)
+#define OUT(...) at_sink_printf(ps_file, __VA_ARGS__)
 
 /* These macros just output their arguments.  */
 #define OUT_REAL(r)                                                                                \
   do {                                                                                             \
     double _r = (r);                                                                               \
     double _frac = fabs(_r - round(_r));                                                           \
-    fprintf(ps_file, _frac < 0.0001 ? "%.0f " : "%.3f ", _r);                                      \
+    at_sink_printf(ps_file, _frac < 0.0001 ? "%.0f " : "%.3f ", _r);                               \
   } while (0)
 
 /* For a PostScript command with two real arguments, e.g., lineto.  OP
@@ -61,7 +61,7 @@
 /* This should be called before the others in this file.  It opens the
    output file `OUTPUT_NAME.ps', and writes some preliminary boilerplate. */
 
-static int output_eps_header(FILE *ps_file, gchar *name, int llx, int lly, int urx, int ury)
+static int output_eps_header(at_sink *ps_file, gchar *name, int llx, int lly, int urx, int ury)
 {
   g_autoptr(GDateTime) date = g_date_time_new_now_local();
   g_autofree gchar *time = g_date_time_format(date, "%a %b %e %H:%M:%S %Y");
@@ -103,77 +103,86 @@ static int output_eps_header(FILE *ps_file, gchar *name, int llx, int lly, int u
   return 0;
 }
 
+/* Where a stream of spline lists has got to */
+typedef struct {
+  at_sink *file;
+  gboolean centerline;
+  unsigned n_lists;
+  at_color last_color;
+} eps_state_type;
+
+gpointer output_eps_begin(at_sink *ps_file, gchar *name, int llx, int lly, int urx, int ury,
+                          at_output_opts_type *opts, spline_list_array_type *shape,
+                          at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+{
+  eps_state_type *eps = g_new0(eps_state_type, 1);
+
+  eps->file = ps_file;
+  eps->centerline = shape->centerline;
+
+  output_eps_header(ps_file, name, llx, lly, urx, ury);
+
+  OUT_LINE("1 setlinecap");  /* set shape of line ends for stroke (0=butt,1=round, 2=square) */
+  OUT_LINE("1 setlinejoin"); /* set shape of corners for stroke (0=miter,1=round, 2=bevel */
+  return eps;
+}
+
 /* This outputs the PostScript code which produces the shape in
-   SHAPE.  */
+   LIST.  */
 
-static void out_splines(FILE *ps_file, spline_list_array_type shape)
+void output_eps_list(gpointer state, spline_list_type *list)
 {
-  unsigned this_list;
-  spline_list_type list;
-
-  at_color last_color = {0, 0, 0};
-
-  for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
-    unsigned this_spline;
-    int c, m, y, k;
-    spline_type first;
-
-    list = SPLINE_LIST_ARRAY_ELT(shape, this_list);
-    first = SPLINE_LIST_ELT(list, 0);
-
-    if (this_list == 0 || !at_color_equal(&list.color, &last_color)) {
-      if (this_list > 0)
-        OUT_LINE("*U");
-      c = k = 255 - list.color.r;
-      m = 255 - list.color.g;
-      if (m < k)
-        k = m;
-      y = 255 - list.color.b;
-      if (y < k)
-        k = y;
-      c -= k;
-      m -= k;
-      y -= k;
-      /* symbol k is used for CorelDraw 3/4 compatibility */
-      OUT("%.3f %.3f %.3f %.3f %s\n", (double)c / 255.0, (double)m / 255.0, (double)y / 255.0,
-          (double)k / 255.0, (shape.centerline || list.open) ? "K" : "k");
-      OUT_LINE("*u");
-      last_color = list.color;
-    }
-    OUT_COMMAND2(START_POINT(first).x, START_POINT(first).y, "m");
-
-    for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(list); this_spline++) {
-      spline_type s = SPLINE_LIST_ELT(list, this_spline);
-
-      if (SPLINE_DEGREE(s) == LINEARTYPE)
-        OUT_COMMAND2(END_POINT(s).x, END_POINT(s).y, "l");
-      else
-        OUT_COMMAND6(CONTROL1(s).x, CONTROL1(s).y, CONTROL2(s).x, CONTROL2(s).y, END_POINT(s).x,
-                     END_POINT(s).y, "c");
-    }
-    if (SPLINE_LIST_ARRAY_LENGTH(shape) > 0)
-      OUT_LINE((shape.centerline || list.open) ? "S" : "f");
+  eps_state_type *eps = state;
+  at_sink *ps_file = eps->file;
+  unsigned this_spline;
+  int c, m, y, k;
+  spline_type first = SPLINE_LIST_ELT(*list, 0);
+
+  if (eps->n_lists == 0 || !at_color_equal(&list->color, &eps->last_color)) {
+    if (eps->n_lists > 0)
+      OUT_LINE("*U");
+    c = k = 255 - list->color.r;
+    m = 255 - list->color.g;
+    if (m < k)
+      k = m;
+    y = 255 - list->color.b;
+    if (y < k)
+      k = y;
+    c -= k;
+    m -= k;
+    y -= k;
+    /* symbol k is used for CorelDraw 3/4 compatibility */
+    OUT("%.3f %.3f %.3f %.3f %s\n", (double)c / 255.0, (double)m / 255.0, (double)y / 255.0,
+        (double)k / 255.0, (eps->centerline || list->open) ? "K" : "k");
+    OUT_LINE("*u");
+    eps->last_color = list->color;
   }
-  if (SPLINE_LIST_ARRAY_LENGTH(shape) > 0)
-    OUT_LINE("*U");
-}
+  OUT_COMMAND2(START_POINT(first).x, START_POINT(first).y, "m");
 
-int output_eps_writer(FILE *ps_file, gchar *name, int llx, int lly, int urx, int ury,
-                      at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
-                      gpointer msg_data, gpointer user_data)
-{
-  int result;
+  for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(*list); this_spline++) {
+    spline_type s = SPLINE_LIST_ELT(*list, this_spline);
 
-  result = output_eps_header(ps_file, name, llx, lly, urx, ury);
-  if (result != 0)
-    return result;
+    if (SPLINE_DEGREE(s) == LINEARTYPE)
+      OUT_COMMAND2(END_POINT(s).x, END_POINT(s).y, "l");
+    else
+      OUT_COMMAND6(CONTROL1(s).x, CONTROL1(s).y, CONTROL2(s).x, CONTROL2(s).y, END_POINT(s).x,
+                   END_POINT(s).y, "c");
+  }
+  OUT_LINE((eps->centerline || list->open) ? "S" : "f");
+  eps->n_lists++;
+}
 
-  OUT_LINE("1 setlinecap");  /* set shape of line ends for stroke (0=butt,1=round, 2=square) */
-  OUT_LINE("1 setlinejoin"); /* set shape of corners for stroke (0=miter,1=round, 2=bevel */
+int output_eps_end(gpointer state)
+{
+  eps_state_type *eps = state;
+  at_sink *ps_file = eps->file;
 
-  out_splines(ps_file, shape);
+  if (eps->n_lists > 0)
+    OUT_LINE("*U");
 
   OUT_LINE("%%Trailer");
   OUT_LINE("%%EOF");
+
+  g_free(eps);
   return 0;
 }
@@ -18,20 +18,21 @@
 /* This should be called before the others in this file.  It opens the
    output file and writes some preliminary boilerplate. */
 
-static int output_er_header(FILE *er_file, gchar *name, int llx, int lly, int urx, int ury)
+static int output_er_header(at_sink *er_file, gchar *name, int llx, int lly, int urx, int ury)
 {
   g_autoptr(GDateTime) date = g_date_time_new_now_local();
   g_autofree gchar *time = g_date_time_format(date, "%a %b %e %H:%M:%S %Y");
 
-  fprintf(er_file, "#Elastic Reality Shape File\n\n#Date: %s\n\n", time);
-  fprintf(er_file, "ImageSize = {\n\tWidth = %d\n\tHeight = %d\n}\n\n", urx - llx, ury - lly);
+  at_sink_printf(er_file, "#Elastic Reality Shape File\n\n#Date: %s\n\n", time);
+  at_sink_printf(er_file, "ImageSize = {\n\tWidth = %d\n\tHeight = %d\n}\n\n", urx - llx,
+                 ury - lly);
 
   return 0;
 }
 
 /* This outputs shape data and the point list for the shape in SHAPE. */
 
-static void out_splines(FILE *er_file, spline_list_array_type shape, unsigned width,
+static void out_splines(at_sink *er_file, spline_list_array_type shape, unsigned width,
                         unsigned height, at_output_opts_type *opts)
 {
   unsigned this_list, corresp_pt;
@@ -45,24 +46,24 @@ static void out_splines(FILE *er_file, spline_list_array_type shape, unsigned wi
     unsigned length = SPLINE_LIST_LENGTH(list);
     unsigned out_length = (list.open || length == 1 ? length + 1 : length);
 
-    fprintf(er_file, "Shape = {\n");
-    fprintf(er_file, "\t#Shape Number %d\n", this_list + 1);
-    fprintf(er_file, "\tGroup = Default\n");
-    fprintf(er_file, "\tType = Source\n");
-    fprintf(er_file, "\tRoll = A\n");
-    fprintf(er_file, "\tOpaque = True\n");
-    fprintf(er_file, "\tLocked = False\n");
-    fprintf(er_file, "\tWarp = True\n");
-    fprintf(er_file, "\tCookieCut = True\n");
-    fprintf(er_file, "\tColorCorrect = True\n");
-    fprintf(er_file, "\tPrecision = 10\n");
-    fprintf(er_file, "\tClosed = %s\n", (list.open ? "False" : "True"));
-    fprintf(er_file, "\tTween = Linear\n");
-    fprintf(er_file, "\tBPoints = %d\n", out_length);
-    fprintf(er_file, "\tCPoints = %d\n", NUM_CORRESP_POINTS);
-    fprintf(er_file, "\tFormKey = {\n");
-    fprintf(er_file, "\t\tFrame = 1\n");
-    fprintf(er_file, "\t\tPointList = {\n");
+    at_sink_printf(er_file, "Shape = {\n");
+    at_sink_printf(er_file, "\t#Shape Number %d\n", this_list + 1);
+    at_sink_printf(er_file, "\tGroup = Default\n");
+    at_sink_printf(er_file, "\tType = Source\n");
+    at_sink_printf(er_file, "\tRoll = A\n");
+    at_sink_printf(er_file, "\tOpaque = True\n");
+    at_sink_printf(er_file, "\tLocked = False\n");
+    at_sink_printf(er_file, "\tWarp = True\n");
+    at_sink_printf(er_file, "\tCookieCut = True\n");
+    at_sink_printf(er_file, "\tColorCorrect = True\n");
+    at_sink_printf(er_file, "\tPrecision = 10\n");
+    at_sink_printf(er_file, "\tClosed = %s\n", (list.open ? "False" : "True"));
+    at_sink_printf(er_file, "\tTween = Linear\n");
+    at_sink_printf(er_file, "\tBPoints = %d\n", out_length);
+    at_sink_printf(er_file, "\tCPoints = %d\n", NUM_CORRESP_POINTS);
+    at_sink_printf(er_file, "\tFormKey = {\n");
+    at_sink_printf(er_file, "\t\tFrame = 1\n");
+    at_sink_printf(er_file, "\t\tPointList = {\n");
 
     prev = PREV_SPLINE_LIST_ELT(list, 0);
     if (list.open || length == 1)
@@ -93,8 +94,8 @@ static void out_splines(FILE *er_file, spline_list_array_type shape, unsigned wi
         y2 = START_POINT(s).y;
       }
 
-      fprintf(er_file, "\t\t\t(%f, %f), (%f, %f), (%f, %f),\n", x0 / width, y0 / height, x1 / width,
-              y1 / height, x2 / width, y2 / height);
+      at_sink_printf(er_file, "\t\t\t(%f, %f), (%f, %f), (%f, %f),\n", x0 / width, y0 / height,
+                     x1 / width, y1 / height, x2 / width, y2 / height);
 
       prev = s;
     }
@@ -105,19 +106,19 @@ static void out_splines(FILE *er_file, spline_list_array_type shape, unsigned wi
       x2 = x1 = END_POINT(prev).x;
       y2 = y1 = END_POINT(prev).y;
 
-      fprintf(er_file, "\t\t\t(%f, %f), (%f, %f), (%f, %f),\n", x0 / width, y0 / height, x1 / width,
-              y1 / height, x2 / width, y2 / height);
+      at_sink_printf(er_file, "\t\t\t(%f, %f), (%f, %f), (%f, %f),\n", x0 / width, y0 / height,
+                     x1 / width, y1 / height, x2 / width, y2 / height);
     }
 
     /* Close PointList and enclosing FormKey. */
-    fprintf(er_file, "\t\t}\n\n\t}\n\n");
+    at_sink_printf(er_file, "\t\t}\n\n\t}\n\n");
 
     if (shape.centerline && shape.preserve_width) {
       gfloat w = (gfloat)1.0 / (shape.width_weight_factor);
 
-      fprintf(er_file, "\tWeightKey = {\n");
-      fprintf(er_file, "\t\tFrame = 1\n");
-      fprintf(er_file, "\t\tPointList = {\n");
+      at_sink_printf(er_file, "\tWeightKey = {\n");
+      at_sink_printf(er_file, "\t\tFrame = 1\n");
+      at_sink_printf(er_file, "\t\tPointList = {\n");
       prev = PREV_SPLINE_LIST_ELT(list, 0);
       if (list.open || length == 1)
         SPLINE_DEGREE(prev) = (polynomial_degree)-1;
@@ -138,37 +139,37 @@ static void out_splines(FILE *er_file, spline_list_array_type shape, unsigned wi
         else
           x2 = START_POINT(s).z;
 
-        fprintf(er_file, "\t\t\t%g, %g, %g,\n", x0 * w, x1 * w, x2 * w);
+        at_sink_printf(er_file, "\t\t\t%g, %g, %g,\n", x0 * w, x1 * w, x2 * w);
 
         prev = s;
       }
       if (list.open || length == 1) {
         x0 = CONTROL2(prev).z;
         x2 = x1 = END_POINT(prev).z;
-        fprintf(er_file, "\t\t\t%g, %g, %g,\n", x0 * w, x1 * w, x2 * w);
+        at_sink_printf(er_file, "\t\t\t%g, %g, %g,\n", x0 * w, x1 * w, x2 * w);
       }
       /* Close PointList and enclosing WeightKey. */
-      fprintf(er_file, "\t\t}\n\n\t}\n\n");
+      at_sink_printf(er_file, "\t\t}\n\n\t}\n\n");
     }
 
-    fprintf(er_file, "\tCorrKey = {\n");
-    fprintf(er_file, "\t\tFrame = 1\n");
-    fprintf(er_file, "\t\tPointList = {\n");
-    fprintf(er_file, "\t\t\t0");
+    at_sink_printf(er_file, "\tCorrKey = {\n");
+    at_sink_printf(er_file, "\t\tFrame = 1\n");
+    at_sink_printf(er_file, "\t\tPointList = {\n");
+    at_sink_printf(er_file, "\t\t\t0");
     corresp_length = out_length - (list.open ? 1.0 : 2.0);
     for (corresp_pt = 1; corresp_pt < NUM_CORRESP_POINTS; corresp_pt++) {
-      fprintf(er_file, ", %g",
-              corresp_length * corresp_pt / (NUM_CORRESP_POINTS - (list.open ? 1.0 : 0.0)));
+      at_sink_printf(er_file, ", %g",
+                     corresp_length * corresp_pt / (NUM_CORRESP_POINTS - (list.open ? 1.0 : 0.0)));
     }
     /* Close PointList and enclosing CorrKey. */
-    fprintf(er_file, "\n\t\t}\n\n\t}\n\n");
+    at_sink_printf(er_file, "\n\t\t}\n\n\t}\n\n");
 
     /* Close Shape. */
-    fprintf(er_file, "}\n\n");
+    at_sink_printf(er_file, "}\n\n");
   }
 }
 
-int output_er_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_er_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                      at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
                      gpointer msg_data, gpointer user_data)
 {
@@ -32,83 +32,89 @@
 #define FIG_YELLOW 6
 #define FIG_WHITE 7
 
-static gfloat bezpnt(gfloat, gfloat, gfloat, gfloat, gfloat);
-static void out_fig_splines(FILE *, spline_list_array_type, int, int, int, int,
-                            at_exception_type *);
-static int get_fig_colour(at_color, at_exception_type *);
-static void fig_col_init(void);
-
 /* colour information */
 #define fig_col_hash(col_typ) (((col_typ).r & 255) + ((col_typ).g & 161) + ((col_typ).b & 127))
 
-static struct {
-  unsigned int colour;
-  unsigned int alternate;
-} fig_hash[544];
+#define MAX_FIG_COLOUR 543
 
-static struct {
-  at_color c;
-  int alternate;
-} fig_colour_map[544];
+/* Per-output state: the colour palette being built and the bounding
+   boxes used to assign depths.  Allocated for each call of the writer
+   so that several FIG files can be written concurrently.  */
+typedef struct {
+  struct {
+    unsigned int colour;
+    unsigned int alternate;
+  } fig_hash[544];
 
-static int LAST_FIG_COLOUR = 32;
-#define MAX_FIG_COLOUR 543
+  struct {
+    at_color c;
+    int alternate;
+  } fig_colour_map[544];
+
+  int LAST_FIG_COLOUR;
 
-/* Bounding Box data and routines */
-static float glob_min_x, glob_max_x, glob_min_y, glob_max_y;
-static float loc_min_x, loc_max_x, loc_min_y, loc_max_y;
-static int glo_bbox_flag = 0, loc_bbox_flag = 0, fig_depth;
+  /* Bounding Box data */
+  float glob_min_x, glob_max_x, glob_min_y, glob_max_y;
+  float loc_min_x, loc_max_x, loc_min_y, loc_max_y;
+  int glo_bbox_flag, loc_bbox_flag, fig_depth;
+} fig_state_type;
 
-static void fig_new_depth()
+static gfloat bezpnt(gfloat, gfloat, gfloat, gfloat, gfloat);
+static void out_fig_splines(at_sink *, fig_state_type *, spline_list_array_type, int, int, int, int,
+                            at_exception_type *);
+static int get_fig_colour(fig_state_type *, at_color, at_exception_type *);
+static void fig_col_init(fig_state_type *);
+
+static void fig_new_depth(fig_state_type *st)
 {
-  if (glo_bbox_flag == 0) {
-    glob_max_y = loc_max_y;
-    glob_min_y = loc_min_y;
-    glob_max_x = loc_max_x;
-    glob_min_x = loc_min_x;
-    glo_bbox_flag = 1;
+  if (st->glo_bbox_flag == 0) {
+    st->glob_max_y = st->loc_max_y;
+    st->glob_min_y = st->loc_min_y;
+    st->glob_max_x = st->loc_max_x;
+    st->glob_min_x = st->loc_min_x;
+    st->glo_bbox_flag = 1;
   } else {
-    if ((loc_max_y <= glob_min_y) || (loc_min_y >= glob_max_y) || (loc_max_x <= glob_min_x) ||
-        (loc_min_x >= glob_max_x)) {
+    if ((st->loc_max_y <= st->glob_min_y) || (st->loc_min_y >= st->glob_max_y) ||
+        (st->loc_max_x <= st->glob_min_x) || (st->loc_min_x >= st->glob_max_x)) {
       /* outside global bounds, increase global box */
-      if (loc_max_y > glob_max_y)
-        glob_max_y = loc_max_y;
-      if (loc_min_y < glob_min_y)
-        glob_min_y = loc_min_y;
-      if (loc_max_x > glob_max_x)
-        glob_max_x = loc_max_x;
-      if (loc_min_x < glob_min_x)
-        glob_min_x = loc_min_x;
+      if (st->loc_max_y > st->glob_max_y)
+        st->glob_max_y = st->loc_max_y;
+      if (st->loc_min_y < st->glob_min_y)
+        st->glob_min_y = st->loc_min_y;
+      if (st->loc_max_x > st->glob_max_x)
+        st->glob_max_x = st->loc_max_x;
+      if (st->loc_min_x < st->glob_min_x)
+        st->glob_min_x = st->loc_min_x;
     } else {
       /* inside global bounds, decrease depth and create new bounds */
-      glob_max_y = loc_max_y;
-      glob_min_y = loc_min_y;
-      glob_max_x = loc_max_x;
-      glob_min_x = loc_min_x;
-      if (fig_depth)
-        fig_depth--; /* don't let it get < 0 */
+      st->glob_max_y = st->loc_max_y;
+      st->glob_min_y = st->loc_min_y;
+      st->glob_max_x = st->loc_max_x;
+      st->glob_min_x = st->loc_min_x;
+      if (st->fig_depth)
+        st->fig_depth--; /* don't let it get < 0 */
     }
   }
-  loc_bbox_flag = 0;
+  st->loc_bbox_flag = 0;
 }
 
-static void fig_addtobbox(float x, float y)
+static void fig_addtobbox(fig_state_type *st, float x, float y)
 {
-  if (loc_bbox_flag == 0) {
-    loc_max_y = y;
-    loc_min_y = y;
-    loc_max_x = x;
-    loc_min_x = x;
-    loc_bbox_flag = 1;
+  if (st->loc_bbox_flag == 0) {
+    st->loc_max_y = y;
+    st->loc_min_y = y;
+    st->loc_max_x = x;
+    st->loc_min_x = x;
+    st->loc_bbox_flag = 1;
   } else {
-    if (loc_max_y < y)
-      loc_max_y = y;
-    if (loc_min_y > y)
-      loc_min_y = y;
-    if (loc_max_x < x)
-      loc_max_x = x;
-    if (loc_min_x > x)
-      loc_min_x = x;
+    if (st->loc_max_y < y)
+      st->loc_max_y = y;
+    if (st->loc_min_y > y)
+      st->loc_min_y = y;
+    if (st->loc_max_x < x)
+      st->loc_max_x = x;
+    if (st->loc_min_x > x)
+      st->loc_min_x = x;
   }
 }
 
@@ -130,11 +136,11 @@ static gfloat bezpnt(gfloat t, gfloat z1, gfloat z2, gfloat z3, gfloat z4)
   return (temp);
 }
 
-static void out_fig_splines(FILE *file, spline_list_array_type shape, int llx, int lly, int urx,
-                            int ury, at_exception_type *exp)
+static void out_fig_splines(at_sink *file, fig_state_type *st, spline_list_array_type shape,
+                            int llx, int lly, int urx, int ury, at_exception_type *exp)
 {
   unsigned this_list;
-  /*    int fig_colour, fig_depth, i; */
+  /*    int fig_colour, st->fig_depth, i; */
   int fig_colour, fig_fill, fig_width, fig_subt, fig_spline_close, i;
 
   /*
@@ -146,26 +152,26 @@ static void out_fig_splines(FILE *file, spline_list_array_type shape, int llx, i
   g_autofree int *spline_colours = g_malloc(sizeof(int) * SPLINE_LIST_ARRAY_LENGTH(shape));
 
   /* Preload the big 8 */
-  fig_col_init();
+  fig_col_init(st);
 
   /*  Load the colours from the splines */
   for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
     spline_list_type list = SPLINE_LIST_ARRAY_ELT(shape, this_list);
     at_color curr_color =
         (list.clockwise && shape.background_color != NULL) ? *(shape.background_color) : list.color;
-    spline_colours[this_list] = get_fig_colour(curr_color, exp);
+    spline_colours[this_list] = get_fig_colour(st, curr_color, exp);
   }
   /* Output colours */
-  if (LAST_FIG_COLOUR > 32) {
-    for (i = 32; i < LAST_FIG_COLOUR; i++) {
-      fprintf(file, "0 %d #%.2x%.2x%.2x\n", i, fig_colour_map[i].c.r, fig_colour_map[i].c.g,
-              fig_colour_map[i].c.b);
+  if (st->LAST_FIG_COLOUR > 32) {
+    for (i = 32; i < st->LAST_FIG_COLOUR; i++) {
+      at_sink_printf(file, "0 %d #%.2x%.2x%.2x\n", i, st->fig_colour_map[i].c.r,
+                     st->fig_colour_map[i].c.g, st->fig_colour_map[i].c.b);
     }
   }
   /*	Each "spline list" in the array appears to be a group of splines */
-  fig_depth = SPLINE_LIST_ARRAY_LENGTH(shape) + 20;
-  if (fig_depth > 999) {
-    fig_depth = 999;
+  st->fig_depth = SPLINE_LIST_ARRAY_LENGTH(shape) + 20;
+  if (st->fig_depth > 999) {
+    st->fig_depth = 999;
   }
 
   for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
@@ -195,7 +201,7 @@ static void out_fig_splines(FILE *file, spline_list_array_type shape, int llx, i
         pointx[pointcount] = FIG_X(START_POINT(s).x);
         pointy[pointcount] = FIG_Y(START_POINT(s).y);
         contrl[pointcount] = (gfloat)0.0;
-        fig_addtobbox(START_POINT(s).x, START_POINT(s).y);
+        fig_addtobbox(st, START_POINT(s).x, START_POINT(s).y);
         pointcount++;
       }
       /* Apparently START_POINT for one spline section is same as END_POINT
@@ -204,7 +210,7 @@ static void out_fig_splines(FILE *file, spline_list_array_type shape, int llx, i
         pointx[pointcount] = FIG_X(END_POINT(s).x);
         pointy[pointcount] = FIG_Y(END_POINT(s).y);
         contrl[pointcount] = (gfloat)0.0;
-        fig_addtobbox(START_POINT(s).x, START_POINT(s).y);
+        fig_addtobbox(st, START_POINT(s).x, START_POINT(s).y);
         pointcount++;
       } else { /* Assume Bezier like spline */
 
@@ -221,10 +227,10 @@ static void out_fig_splines(FILE *file, spline_list_array_type shape, int llx, i
         pointx[pointcount] = FIG_X(END_POINT(s).x);
         pointy[pointcount] = FIG_Y(END_POINT(s).y);
         contrl[pointcount] = (gfloat)0.0;
-        fig_addtobbox(START_POINT(s).x, START_POINT(s).y);
-        fig_addtobbox(CONTROL1(s).x, CONTROL1(s).y);
-        fig_addtobbox(CONTROL2(s).x, CONTROL2(s).y);
-        fig_addtobbox(END_POINT(s).x, END_POINT(s).y);
+        fig_addtobbox(st, START_POINT(s).x, START_POINT(s).y);
+        fig_addtobbox(st, CONTROL1(s).x, CONTROL1(s).y);
+        fig_addtobbox(st, CONTROL2(s).x, CONTROL2(s).y);
+        fig_addtobbox(st, END_POINT(s).x, END_POINT(s).y);
         pointcount++;
         is_spline = 1;
       }
@@ -240,40 +246,40 @@ static void out_fig_splines(FILE *file, spline_list_array_type shape, int llx, i
       fig_spline_close = 5;
     }
     if (is_spline != 0) {
-      fig_new_depth();
-      fprintf(file, "3 %d 0 %d %d %d %d 0 %d 0.00 0 0 0 %d\n", fig_spline_close, fig_width,
-              fig_colour, fig_colour, fig_depth, fig_fill, pointcount);
+      fig_new_depth(st);
+      at_sink_printf(file, "3 %d 0 %d %d %d %d 0 %d 0.00 0 0 0 %d\n", fig_spline_close, fig_width,
+                     fig_colour, fig_colour, st->fig_depth, fig_fill, pointcount);
       /* Print out points */
       j = 0;
       for (i = 0; i < pointcount; i++) {
         j++;
         if (j == 1) {
-          fprintf(file, "\t");
+          at_sink_printf(file, "\t");
         }
-        fprintf(file, "%d %d ", pointx[i], pointy[i]);
+        at_sink_printf(file, "%d %d ", pointx[i], pointy[i]);
         if (j == 8) {
-          fprintf(file, "\n");
+          at_sink_printf(file, "\n");
           j = 0;
         }
       }
       if (j != 0) {
-        fprintf(file, "\n");
+        at_sink_printf(file, "\n");
       }
       j = 0;
       /* Print out control weights */
       for (i = 0; i < pointcount; i++) {
         j++;
         if (j == 1) {
-          fprintf(file, "\t");
+          at_sink_printf(file, "\t");
         }
-        fprintf(file, "%f ", contrl[i]);
+        at_sink_printf(file, "%f ", contrl[i]);
         if (j == 8) {
-          fprintf(file, "\n");
+          at_sink_printf(file, "\n");
           j = 0;
         }
       }
       if (j != 0) {
-        fprintf(file, "\n");
+        at_sink_printf(file, "\n");
       }
     } else {
       /* Polygons can be handled better as polygons */
@@ -281,24 +287,24 @@ static void out_fig_splines(FILE *file, spline_list_array_type shape, int llx, i
       if (pointcount == 2) {
         if ((pointx[0] == pointx[1]) && (pointy[0] == pointy[1])) {
           /* Point */
-          fig_new_depth();
-          fprintf(file, "2 1 0 1 %d %d %d 0 -1 0.000 0 0 -1 0 0 1\n", fig_colour, fig_colour,
-                  fig_depth);
-          fprintf(file, "\t%d %d\n", pointx[0], pointy[0]);
+          fig_new_depth(st);
+          at_sink_printf(file, "2 1 0 1 %d %d %d 0 -1 0.000 0 0 -1 0 0 1\n", fig_colour, fig_colour,
+                         st->fig_depth);
+          at_sink_printf(file, "\t%d %d\n", pointx[0], pointy[0]);
         } else {
           /* Line segment? */
-          fig_new_depth();
-          fprintf(file, "2 1 0 1 %d %d %d 0 -1 0.000 0 0 -1 0 0 2\n", fig_colour, fig_colour,
-                  fig_depth);
-          fprintf(file, "\t%d %d %d %d\n", pointx[0], pointy[0], pointx[1], pointy[1]);
+          fig_new_depth(st);
+          at_sink_printf(file, "2 1 0 1 %d %d %d 0 -1 0.000 0 0 -1 0 0 2\n", fig_colour, fig_colour,
+                         st->fig_depth);
+          at_sink_printf(file, "\t%d %d %d %d\n", pointx[0], pointy[0], pointx[1], pointy[1]);
         }
       } else {
         if ((pointcount == 3) && (pointx[0] == pointx[2]) && (pointy[0] == pointy[2])) {
           /* Line segment? */
-          fig_new_depth();
-          fprintf(file, "2 1 0 1 %d %d %d 0 -1 0.000 0 0 -1 0 0 2\n", fig_colour, fig_colour,
-                  fig_depth);
-          fprintf(file, "\t%d %d %d %d\n", pointx[0], pointy[0], pointx[1], pointy[1]);
+          fig_new_depth(st);
+          at_sink_printf(file, "2 1 0 1 %d %d %d 0 -1 0.000 0 0 -1 0 0 2\n", fig_colour, fig_colour,
+                         st->fig_depth);
+          at_sink_printf(file, "\t%d %d %d %d\n", pointx[0], pointy[0], pointx[1], pointy[1]);
         } else {
           if ((pointx[0] != pointx[pointcount - 1]) || (pointy[0] != pointy[pointcount - 1])) {
             if (shape.centerline) {
@@ -310,45 +316,47 @@ static void out_fig_splines(FILE *file, spline_list_array_type shape, int llx, i
               pointcount++;
             }
           }
-          fig_new_depth();
-          fprintf(file, "2 %d 0 %d %d %d %d 0 %d 0.00 0 0 0 0 0 %d\n", fig_subt, fig_width,
-                  fig_colour, fig_colour, fig_depth, fig_fill, pointcount);
+          fig_new_depth(st);
+          at_sink_printf(file, "2 %d 0 %d %d %d %d 0 %d 0.00 0 0 0 0 0 %d\n", fig_subt, fig_width,
+                         fig_colour, fig_colour, st->fig_depth, fig_fill, pointcount);
           /* Print out points */
           j = 0;
           for (i = 0; i < pointcount; i++) {
             j++;
             if (j == 1) {
-              fprintf(file, "\t");
+              at_sink_printf(file, "\t");
             }
-            fprintf(file, "%d %d ", pointx[i], pointy[i]);
+            at_sink_printf(file, "%d %d ", pointx[i], pointy[i]);
             if (j == 8) {
-              fprintf(file, "\n");
+              at_sink_printf(file, "\n");
               j = 0;
             }
           }
           if (j != 0) {
-            fprintf(file, "\n");
+            at_sink_printf(file, "\n");
           }
         }
       }
     }
-    /*	fig_depth--; */
-    if (fig_depth < 0) {
-      fig_depth = 0;
+    /*	st->fig_depth--; */
+    if (st->fig_depth < 0) {
+      st->fig_depth = 0;
     }
   }
 }
 
-int output_fig_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_fig_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
                       gpointer msg_data, gpointer user_data)
 {
   at_exception_type exp = at_exception_new(msg_func, msg_data);
+  g_autofree fig_state_type *st = g_new0(fig_state_type, 1);
+
   /*	Output header	*/
-  fprintf(file, "#FIG 3.2\nLandscape\nCenter\nInches\nLetter\n100.00\nSingle\n-2\n1200 2\n");
+  at_sink_printf(file, "#FIG 3.2\nLandscape\nCenter\nInches\nLetter\n100.00\nSingle\n-2\n1200 2\n");
 
   /*	Output data	*/
-  out_fig_splines(file, shape, llx, lly, urx, ury, &exp);
+  out_fig_splines(file, st, shape, llx, lly, urx, ury, &exp);
   return 0;
 }
 
@@ -359,56 +367,58 @@ int output_fig_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ur
         if alternate is 0, set next unused fig number
 */
 
-static void fig_col_init(void)
+static void fig_col_init(fig_state_type *st)
 {
   int i;
 
+  st->LAST_FIG_COLOUR = 32;
+
   for (i = 0; i < 544; i++) {
-    fig_hash[i].colour = 0;
-    fig_colour_map[i].alternate = 0;
+    st->fig_hash[i].colour = 0;
+    st->fig_colour_map[i].alternate = 0;
   }
 
   /*  populate the first 8 primary colours  */
   /* Black */
-  fig_hash[0].colour = FIG_BLACK;
-  fig_colour_map[FIG_BLACK].c.r = 0;
-  fig_colour_map[FIG_BLACK].c.g = 0;
-  fig_colour_map[FIG_BLACK].c.b = 0;
+  st->fig_hash[0].colour = FIG_BLACK;
+  st->fig_colour_map[FIG_BLACK].c.r = 0;
+  st->fig_colour_map[FIG_BLACK].c.g = 0;
+  st->fig_colour_map[FIG_BLACK].c.b = 0;
   /* White */
-  fig_hash[543].colour = FIG_WHITE;
-  fig_colour_map[FIG_WHITE].c.r = 255;
-  fig_colour_map[FIG_WHITE].c.g = 255;
-  fig_colour_map[FIG_WHITE].c.b = 255;
+  st->fig_hash[543].colour = FIG_WHITE;
+  st->fig_colour_map[FIG_WHITE].c.r = 255;
+  st->fig_colour_map[FIG_WHITE].c.g = 255;
+  st->fig_colour_map[FIG_WHITE].c.b = 255;
   /* Red */
-  fig_hash[255].colour = FIG_RED;
-  fig_colour_map[FIG_RED].c.r = 255;
-  fig_colour_map[FIG_RED].c.g = 0;
-  fig_colour_map[FIG_RED].c.b = 0;
+  st->fig_hash[255].colour = FIG_RED;
+  st->fig_colour_map[FIG_RED].c.r = 255;
+  st->fig_colour_map[FIG_RED].c.g = 0;
+  st->fig_colour_map[FIG_RED].c.b = 0;
   /* Green */
-  fig_hash[161].colour = FIG_GREEN;
-  fig_colour_map[FIG_GREEN].c.r = 0;
-  fig_colour_map[FIG_GREEN].c.g = 255;
-  fig_colour_map[FIG_GREEN].c.b = 0;
+  st->fig_hash[161].colour = FIG_GREEN;
+  st->fig_colour_map[FIG_GREEN].c.r = 0;
+  st->fig_colour_map[FIG_GREEN].c.g = 255;
+  st->fig_colour_map[FIG_GREEN].c.b = 0;
   /* Blue */
-  fig_hash[127].colour = FIG_BLUE;
-  fig_colour_map[FIG_BLUE].c.r = 0;
-  fig_colour_map[FIG_BLUE].c.g = 0;
-  fig_colour_map[FIG_BLUE].c.b = 255;
+  st->fig_hash[127].colour = FIG_BLUE;
+  st->fig_colour_map[FIG_BLUE].c.r = 0;
+  st->fig_colour_map[FIG_BLUE].c.g = 0;
+  st->fig_colour_map[FIG_BLUE].c.b = 255;
   /* Cyan */
-  fig_hash[198].colour = FIG_CYAN;
-  fig_colour_map[FIG_CYAN].c.r = 0;
-  fig_colour_map[FIG_CYAN].c.g = 255;
-  fig_colour_map[FIG_CYAN].c.b = 255;
+  st->fig_hash[198].colour = FIG_CYAN;
+  st->fig_colour_map[FIG_CYAN].c.r = 0;
+  st->fig_colour_map[FIG_CYAN].c.g = 255;
+  st->fig_colour_map[FIG_CYAN].c.b = 255;
   /* Magenta */
-  fig_hash[382].colour = FIG_MAGENTA;
-  fig_colour_map[FIG_MAGENTA].c.r = 255;
-  fig_colour_map[FIG_MAGENTA].c.g = 0;
-  fig_colour_map[FIG_MAGENTA].c.b = 255;
+  st->fig_hash[382].colour = FIG_MAGENTA;
+  st->fig_colour_map[FIG_MAGENTA].c.r = 255;
+  st->fig_colour_map[FIG_MAGENTA].c.g = 0;
+  st->fig_colour_map[FIG_MAGENTA].c.b = 255;
   /* Yellow */
-  fig_hash[416].colour = FIG_YELLOW;
-  fig_colour_map[FIG_YELLOW].c.r = 255;
-  fig_colour_map[FIG_YELLOW].c.g = 255;
-  fig_colour_map[FIG_YELLOW].c.b = 0;
+  st->fig_hash[416].colour = FIG_YELLOW;
+  st->fig_colour_map[FIG_YELLOW].c.r = 255;
+  st->fig_colour_map[FIG_YELLOW].c.g = 255;
+  st->fig_colour_map[FIG_YELLOW].c.b = 0;
 }
 
 /*
@@ -416,53 +426,53 @@ static void fig_col_init(void)
  * If unknown, create a new colour index and return that.
  */
 
-static int get_fig_colour(at_color this_colour, at_exception_type *exp)
+static int get_fig_colour(fig_state_type *st, at_color this_colour, at_exception_type *exp)
 {
   int hash, i, this_ind;
 
   hash = fig_col_hash(this_colour);
 
   /*  Special case: black _IS_ zero: */
-  if ((hash == 0) && (at_color_equal(&(fig_colour_map[0].c), &this_colour))) {
+  if ((hash == 0) && (at_color_equal(&(st->fig_colour_map[0].c), &this_colour))) {
     return (0);
   }
 
-  if (fig_hash[hash].colour == 0) {
-    fig_hash[hash].colour = LAST_FIG_COLOUR;
-    fig_colour_map[LAST_FIG_COLOUR].c.r = this_colour.r;
-    fig_colour_map[LAST_FIG_COLOUR].c.g = this_colour.g;
-    fig_colour_map[LAST_FIG_COLOUR].c.b = this_colour.b;
-    LAST_FIG_COLOUR++;
-    if (LAST_FIG_COLOUR >= MAX_FIG_COLOUR) {
-      LOG("Output-Fig: too many colours: %d", LAST_FIG_COLOUR);
+  if (st->fig_hash[hash].colour == 0) {
+    st->fig_hash[hash].colour = st->LAST_FIG_COLOUR;
+    st->fig_colour_map[st->LAST_FIG_COLOUR].c.r = this_colour.r;
+    st->fig_colour_map[st->LAST_FIG_COLOUR].c.g = this_colour.g;
+    st->fig_colour_map[st->LAST_FIG_COLOUR].c.b = this_colour.b;
+    st->LAST_FIG_COLOUR++;
+    if (st->LAST_FIG_COLOUR >= MAX_FIG_COLOUR) {
+      LOG("Output-Fig: too many colours: %d", st->LAST_FIG_COLOUR);
       at_exception_fatal(exp, "Output-Fig: too many colours");
       return 0;
     }
-    return (fig_hash[hash].colour);
+    return (st->fig_hash[hash].colour);
   } else {
     i = 0;
-    this_ind = fig_hash[hash].colour;
+    this_ind = st->fig_hash[hash].colour;
   figcolloop:
     /* If colour match return current colour */
-    if (at_color_equal(&(fig_colour_map[this_ind].c), &this_colour)) {
+    if (at_color_equal(&(st->fig_colour_map[this_ind].c), &this_colour)) {
       return (this_ind);
     }
     /* If next colour zero - set it, return */
-    if (fig_colour_map[this_ind].alternate == 0) {
-      fig_colour_map[this_ind].alternate = LAST_FIG_COLOUR;
-      fig_colour_map[LAST_FIG_COLOUR].c.r = this_colour.r;
-      fig_colour_map[LAST_FIG_COLOUR].c.g = this_colour.g;
-      fig_colour_map[LAST_FIG_COLOUR].c.b = this_colour.b;
-      LAST_FIG_COLOUR++;
-      if (LAST_FIG_COLOUR >= MAX_FIG_COLOUR) {
-        LOG("Output-Fig: too many colours: %d", LAST_FIG_COLOUR);
+    if (st->fig_colour_map[this_ind].alternate == 0) {
+      st->fig_colour_map[this_ind].alternate = st->LAST_FIG_COLOUR;
+      st->fig_colour_map[st->LAST_FIG_COLOUR].c.r = this_colour.r;
+      st->fig_colour_map[st->LAST_FIG_COLOUR].c.g = this_colour.g;
+      st->fig_colour_map[st->LAST_FIG_COLOUR].c.b = this_colour.b;
+      st->LAST_FIG_COLOUR++;
+      if (st->LAST_FIG_COLOUR >= MAX_FIG_COLOUR) {
+        LOG("Output-Fig: too many colours: %d", st->LAST_FIG_COLOUR);
         at_exception_fatal(exp, "Output-Fig: too many colours");
         return 0;
       }
-      return (fig_colour_map[this_ind].alternate);
+      return (st->fig_colour_map[this_ind].alternate);
     }
     /* Else get next colour */
-    this_ind = fig_colour_map[this_ind].alternate;
+    this_ind = st->fig_colour_map[this_ind].alternate;
     /* Sanity check ... if colour too big - abort */
     if (i++ > MAX_FIG_COLOUR) {
       LOG("Output-Fig: too many colours (loop): %d", i);
@@ -32,18 +32,6 @@
 
 #define POINT_ATTRIB_BLANKED 0x01
 
-int write3DFrames = 0;
-int trueColorWrite = 1;
-int writeTable = 0;
-int fromToZero = 1;
-int insert_anchor_points = 1;
-
-int lineDistance = 800;
-int blankDistance = 1200;
-int anchor_thresh = 40;
-
-int inserted_anchor_points = 0;
-
 typedef struct tagLaserPoint {
   void *next;
   short int x;
@@ -76,12 +64,28 @@ typedef struct tagLaserSequence {
 
 typedef LaserSequence *pLaserSequence;
 
-pLaserFrame drawframe = NULL;
-pLaserSequence drawsequence = NULL;
+/* Settings and drawing state of one output_ild_writer() call */
+typedef struct tagIldaWriter {
+  int write3DFrames;
+  int trueColorWrite;
+  int writeTable;
+  int fromToZero;
+  int insert_anchor_points;
+
+  int lineDistance;
+  int blankDistance;
+  int anchor_thresh;
+
+  int inserted_anchor_points;
+
+  pLaserFrame drawframe;
+  pLaserSequence drawsequence;
+} IldaWriter;
+
 static unsigned char ilda[4] = {'I', 'L', 'D', 'A'};
 
 // ILDA standard color palette
-static unsigned char ilda_standard_color_palette[256][3] = {
+static const unsigned char ilda_standard_color_palette[256][3] = {
     {0, 0, 0},       // Black/blanked (fixed)
     {255, 255, 255}, // White (fixed)
     {255, 0, 0},     // Red (fixed)
@@ -188,7 +192,7 @@ int rint(double x)
 }
 #endif
 
-int find_best_match_color(unsigned char r, unsigned char g, unsigned char b)
+static int find_best_match_color(unsigned char r, unsigned char g, unsigned char b)
 {
   unsigned int i, dmin = 195076, d, ret = 0;
   signed int t;
@@ -211,7 +215,7 @@ int find_best_match_color(unsigned char r, unsigned char g, unsigned char b)
   return ret;
 }
 
-pLaserPoint newLaserPoint(void)
+static pLaserPoint newLaserPoint(void)
 {
   pLaserPoint p = g_malloc(sizeof(LaserPoint));
 
@@ -223,7 +227,7 @@ pLaserPoint newLaserPoint(void)
   return (p);
 }
 
-pLaserFrame newLaserFrame(void)
+static pLaserFrame newLaserFrame(void)
 {
   pLaserFrame p = g_malloc(sizeof(LaserFrame));
 
@@ -237,7 +241,7 @@ pLaserFrame newLaserFrame(void)
   return (p);
 }
 
-pLaserPoint frame_point_add(pLaserFrame fra)
+static pLaserPoint frame_point_add(pLaserFrame fra)
 {
   pLaserPoint point = fra->point_last;
   pLaserPoint point2 = NULL;
@@ -262,12 +266,12 @@ pLaserPoint frame_point_add(pLaserFrame fra)
   return point2;
 };
 
-int frame_point_count(LaserFrame *f)
+static int frame_point_count(LaserFrame *f)
 {
   return (f->count);
 }
 
-pLaserSequence newLaserSequence(void)
+static pLaserSequence newLaserSequence(void)
 {
   pLaserSequence p = g_malloc(sizeof(LaserSequence));
 
@@ -278,12 +282,12 @@ pLaserSequence newLaserSequence(void)
   return (p);
 }
 
-int sequence_frame_count(pLaserSequence seq)
+static int sequence_frame_count(pLaserSequence seq)
 {
   return (seq->frame_count);
 }
 
-pLaserFrame sequence_frame_add(pLaserSequence seq)
+static pLaserFrame sequence_frame_add(pLaserSequence seq)
 {
 
   pLaserFrame frame1 = seq->frame_last;
@@ -310,8 +314,25 @@ pLaserFrame sequence_frame_add(pLaserSequence seq)
   return frame2;
 };
 
+static void freeLaserSequence(pLaserSequence seq)
+{
+  pLaserFrame frame, next_frame;
+  pLaserPoint point, next_point;
+
+  for (frame = seq->frame_first; frame; frame = next_frame) {
+    next_frame = frame->next;
+    for (point = frame->point_first; point; point = next_point) {
+      next_point = point->next;
+      g_free(point);
+    }
+    g_free(frame->name);
+    g_free(frame);
+  }
+  g_free(seq);
+}
+
 /** write 2D/3D Frame to file */
-int writeILDAFrame(FILE *file, LaserFrame *f, int format)
+static int writeILDAFrame(at_sink *file, LaserFrame *f, int format)
 {
   unsigned char lastr = 0, lastg = 0, lastb = 0;
   unsigned int lastc = 0;
@@ -356,11 +377,11 @@ int writeILDAFrame(FILE *file, LaserFrame *f, int format)
       cbuffer[5] = point->z & 255;
       cbuffer[6] = b;
       cbuffer[7] = c;
-      fwrite((char *)cbuffer, sizeof(char), 8, file);
+      at_sink_write(file, cbuffer, 8);
     } else {
       cbuffer[4] = b;
       cbuffer[5] = c;
-      fwrite((char *)cbuffer, sizeof(char), 6, file);
+      at_sink_write(file, cbuffer, 6);
     }
     point = point->next;
     points++;
@@ -370,7 +391,7 @@ int writeILDAFrame(FILE *file, LaserFrame *f, int format)
 }
 
 /** write new style header */
-int writeILDAHeader(FILE *file, unsigned int format, unsigned int datalength)
+static int writeILDAHeader(at_sink *file, unsigned int format, unsigned int datalength)
 {
   // write ILDA header
   unsigned char fhbuffer[12];
@@ -387,12 +408,12 @@ int writeILDAHeader(FILE *file, unsigned int format, unsigned int datalength)
   fhbuffer[10] = (datalength >> 8) & 0xFF;
   fhbuffer[11] = datalength & 0xFF;
 
-  return fwrite((char *)fhbuffer, sizeof(char), ((format > 2) ? 12 : 8), file);
+  return at_sink_write(file, fhbuffer, (format > 2) ? 12 : 8);
 }
 
 /** write old-style frame header */
-int writeILDAFrameHeader(FILE *file, LaserFrame *f, int format, unsigned int frames,
-                         unsigned int cframes)
+static int writeILDAFrameHeader(at_sink *file, LaserFrame *f, int format, unsigned int frames,
+                                unsigned int cframes)
 {
   unsigned int cpoints = 0;
   unsigned char fhbuffer[24];
@@ -401,11 +422,12 @@ int writeILDAFrameHeader(FILE *file, LaserFrame *f, int format, unsigned int fra
   writeILDAHeader(file, format, 0);
 
   if (f) {
+    /* The name has room for four digits */
 #ifdef _WINDOWS
-    _snprintf((char *)(fhbuffer), 17, "Frame #%04d     ", frames);
+    _snprintf((char *)(fhbuffer), 17, "Frame #%04u     ", frames % 10000);
 #endif
 #ifndef _WINDOWS
-    snprintf((char *)(fhbuffer), 17, "Frame #%04d     ", frames);
+    snprintf((char *)(fhbuffer), 17, "Frame #%04u     ", frames % 10000);
 #endif
   } else {
     strncpy((char *)(fhbuffer), (char *)emptys, 16);
@@ -423,11 +445,11 @@ int writeILDAFrameHeader(FILE *file, LaserFrame *f, int format, unsigned int fra
   fhbuffer[22] = 0;
   fhbuffer[23] = 0;
 
-  return fwrite((char *)fhbuffer, sizeof(char), 24, file);
+  return at_sink_write(file, fhbuffer, 24);
 }
 
 /** write ILDA True Color information to file */
-int writeILDATrueColor(FILE *file, LaserFrame *f)
+static int writeILDATrueColor(at_sink *file, LaserFrame *f)
 {
   unsigned char cbuffer[4];
   int cpoints;
@@ -443,7 +465,7 @@ int writeILDATrueColor(FILE *file, LaserFrame *f)
   cbuffer[2] = (cpoints >> 8) & 0xFF;
   cbuffer[3] = cpoints & 0xFF;
 
-  fwrite((char *)cbuffer, sizeof(char), 4, file);
+  at_sink_write(file, cbuffer, 4);
 
   point = f->point_first;
 
@@ -452,7 +474,7 @@ int writeILDATrueColor(FILE *file, LaserFrame *f)
     cbuffer[1] = point->g;
     cbuffer[2] = point->b;
 
-    fwrite((char *)cbuffer, sizeof(char), 3, file);
+    at_sink_write(file, cbuffer, 3);
 
     point = point->next;
   };
@@ -461,7 +483,7 @@ int writeILDATrueColor(FILE *file, LaserFrame *f)
 }
 
 /** write color table to file */
-int writeILDAColorTable(FILE *file)
+static int writeILDAColorTable(at_sink *file)
 {
   unsigned int i, palette = 0, colors = ILDA_COLORS_NUM;
   unsigned char fhbuffer[24];
@@ -478,26 +500,26 @@ int writeILDAColorTable(FILE *file)
   fhbuffer[21] = 0;
   fhbuffer[22] = 0;
   fhbuffer[23] = 0;
-  fwrite((char *)fhbuffer, sizeof(char), 24, file);
+  at_sink_write(file, fhbuffer, 24);
 
   for (i = 0; i < colors; i++) {
     fhbuffer[0] = ilda_standard_color_palette[i][0];
     fhbuffer[1] = ilda_standard_color_palette[i][1];
     fhbuffer[2] = ilda_standard_color_palette[i][2];
-    fwrite((char *)fhbuffer, sizeof(char), 3, file);
+    at_sink_write(file, fhbuffer, 3);
   }
 
   return 0;
 }
 
 /** write Sequence to ILDA file */
-int writeILDA(FILE *file, LaserSequence *s)
+static int writeILDA(at_sink *file, IldaWriter *w, LaserSequence *s)
 {
-  int format = (write3DFrames) ? ILDA_3D_DATA : ILDA_2D_DATA;
+  int format = (w->write3DFrames) ? ILDA_3D_DATA : ILDA_2D_DATA;
   int frames = 0, cframes, palettes = 0;
   LaserFrame *f;
 
-  if (writeTable) {
+  if (w->writeTable) {
     writeILDAColorTable(file);
   }
 
@@ -507,7 +529,7 @@ int writeILDA(FILE *file, LaserSequence *s)
 
   while (f) {
 
-    if (trueColorWrite)
+    if (w->trueColorWrite)
       writeILDATrueColor(file, f);
     // write ILDA header for frame
     writeILDAFrameHeader(file, f, format, frames, cframes);
@@ -533,7 +555,7 @@ static inline short int clip(double x)
 }
 
 /** No descriptions */
-void blankingPath(int x1, int y1, int x2, int y2)
+static void blankingPath(IldaWriter *w, int x1, int y1, int x2, int y2)
 {
   int len, steps, i;
   double lx, ly, t;
@@ -545,15 +567,15 @@ void blankingPath(int x1, int y1, int x2, int y2)
   if (!len)
     return;
 
-  if (len < blankDistance) {
+  if (len < w->blankDistance) {
     steps = 1;
   } else {
-    steps = len / blankDistance;
+    steps = len / w->blankDistance;
   }
 
   for (i = 0; i <= steps; i++) {
     t = (double)i / steps;
-    p = frame_point_add(drawframe);
+    p = frame_point_add(w->drawframe);
     p->x = clip((1 - t) * x1 + x2 * t);
     p->y = clip((1 - t) * y1 + y2 * t);
     p->z = 0;
@@ -565,33 +587,35 @@ void blankingPath(int x1, int y1, int x2, int y2)
 }
 
 /** No descriptions */
-void blankingPathTo(int x, int y)
+static void blankingPathTo(IldaWriter *w, int x, int y)
 {
-  if ((!drawframe) || (!drawframe->point_last))
+  if ((!w->drawframe) || (!w->drawframe->point_last))
     return;
-  blankingPath(drawframe->point_last->x, drawframe->point_last->y, x, y);
+  blankingPath(w, w->drawframe->point_last->x, w->drawframe->point_last->y, x, y);
 }
 
 /** No descriptions */
-void frameDrawInit(int x, int y, unsigned char r, unsigned char g, unsigned char b)
+static void frameDrawInit(IldaWriter *w, int x, int y, unsigned char r, unsigned char g,
+                          unsigned char b)
 {
-  if (!drawframe)
-    drawframe = sequence_frame_add(drawsequence); // we can't do frameInit here, because we don't
-                                                  // know where the first point will be.
-  if (!frame_point_count(drawframe)) {
-    if (drawframe->previous && ((LaserFrame *)drawframe->previous)->point_last) {
-      blankingPath(((LaserFrame *)drawframe->previous)->point_last->x,
-                   ((LaserFrame *)drawframe->previous)->point_last->y, x, y);
+  if (!w->drawframe)
+    w->drawframe = sequence_frame_add(w->drawsequence); // we can't do frameInit here, because
+                                                        // we don't know where the first point
+                                                        // will be.
+  if (!frame_point_count(w->drawframe)) {
+    if (w->drawframe->previous && ((LaserFrame *)w->drawframe->previous)->point_last) {
+      blankingPath(w, ((LaserFrame *)w->drawframe->previous)->point_last->x,
+                   ((LaserFrame *)w->drawframe->previous)->point_last->y, x, y);
     } else {
-      if (fromToZero)
-        blankingPath(0, 0, x, y);
+      if (w->fromToZero)
+        blankingPath(w, 0, 0, x, y);
     }
   } else {
-    blankingPathTo(x, y);
+    blankingPathTo(w, x, y);
   }
 }
 
-double getAngle(double b1x, double b1y, double b2x, double b2y)
+static double getAngle(double b1x, double b1y, double b2x, double b2y)
 {
   double acosa;
   double b1v = sqrt(b1x * b1x + b1y * b1y);
@@ -607,9 +631,9 @@ double getAngle(double b1x, double b1y, double b2x, double b2y)
   return acos(acosa) * 180.0 / G_PI;
 }
 
-void insertAnchorPoints()
+static void insertAnchorPoints(IldaWriter *w)
 {
-  LaserPoint *p = drawframe->point_first, *pn;
+  LaserPoint *p = w->drawframe->point_first, *pn;
   double dx, dy, dx1, dy1, a;
 
   if ((!p) || (!p->next))
@@ -632,7 +656,7 @@ void insertAnchorPoints()
 
     if (dx || dy) {
       a = getAngle(dx1, dy1, dx, dy);
-      while (a > anchor_thresh) {
+      while (a > w->anchor_thresh) {
         pn = newLaserPoint();
         pn->x = p->x;
         pn->y = p->y;
@@ -648,10 +672,10 @@ void insertAnchorPoints()
         pn->attrib = p->attrib;
         pn->next = p->next;
         p->next = pn;
-        drawframe->count += 1;
-        inserted_anchor_points++;
+        w->drawframe->count += 1;
+        w->inserted_anchor_points++;
         p = p->next;
-        a -= anchor_thresh;
+        a -= w->anchor_thresh;
       }
       dx1 = dx;
       dy1 = dy;
@@ -661,18 +685,18 @@ void insertAnchorPoints()
   }
 }
 
-void frameDrawFinish()
+static void frameDrawFinish(IldaWriter *w)
 {
   LaserPoint *p;
 
-  if (fromToZero)
-    blankingPathTo(0, 0);
+  if (w->fromToZero)
+    blankingPathTo(w, 0, 0);
 
-  if (sequence_frame_count(drawsequence) < 1) {
-    frameDrawInit(0, 0, 0, 0, 0);
+  if (sequence_frame_count(w->drawsequence) < 1) {
+    frameDrawInit(w, 0, 0, 0, 0, 0);
 
-    if (frame_point_count(drawframe) < 1) {
-      p = frame_point_add(drawframe); // add 0 point, else ILDA write will fail
+    if (frame_point_count(w->drawframe) < 1) {
+      p = frame_point_add(w->drawframe); // add 0 point, else ILDA write will fail
       p->x = 0;
       p->y = 0;
       p->z = 0;
@@ -683,12 +707,12 @@ void frameDrawFinish()
     }
   }
 
-  if (insert_anchor_points)
-    insertAnchorPoints();
+  if (w->insert_anchor_points)
+    insertAnchorPoints(w);
 }
 
-void drawLine(double x1, double y1, double x2, double y2, unsigned char r1, unsigned char g1,
-              unsigned char b1)
+static void drawLine(IldaWriter *w, double x1, double y1, double x2, double y2, unsigned char r1,
+                     unsigned char g1, unsigned char b1)
 {
   int i, len, steps;
   double t, lx, ly;
@@ -698,21 +722,21 @@ void drawLine(double x1, double y1, double x2, double y2, unsigned char r1, unsi
   printf(" color %d %d %d\n", r1, g1, b1);
 #endif
 
-  frameDrawInit(rint(x1), rint(y1), r1, g1, b1);
+  frameDrawInit(w, rint(x1), rint(y1), r1, g1, b1);
 
   lx = x2 - x1;
   ly = y2 - y1;
   len = rint(sqrt(lx * lx + ly * ly));
 
-  if (len < lineDistance) {
+  if (len < w->lineDistance) {
     steps = 1;
   } else {
-    steps = len / lineDistance;
+    steps = len / w->lineDistance;
   }
 
   for (i = 0; i <= steps; i++) {
     t = (double)i / steps;
-    p = frame_point_add(drawframe);
+    p = frame_point_add(w->drawframe);
     p->x = clip((1 - t) * x1 + x2 * t);
     p->y = clip((1 - t) * y1 + y2 * t);
     p->z = 0;
@@ -723,8 +747,9 @@ void drawLine(double x1, double y1, double x2, double y2, unsigned char r1, unsi
   }
 }
 
-void drawCubicBezier(double x1, double y1, double cx1, double cy1, double cx2, double cy2,
-                     double x2, double y2, unsigned char r1, unsigned char g1, unsigned char b1)
+static void drawCubicBezier(IldaWriter *w, double x1, double y1, double cx1, double cy1,
+                            double cx2, double cy2, double x2, double y2, unsigned char r1,
+                            unsigned char g1, unsigned char b1)
 {
   int len, steps, i;
   double t, lx, ly;
@@ -734,7 +759,7 @@ void drawCubicBezier(double x1, double y1, double cx1, double cy1, double cx2, d
   printf(" color %d %d %d\n", r1, g1, b1);
 #endif
 
-  frameDrawInit(rint(x1), rint(y1), r1, g1, b1);
+  frameDrawInit(w, rint(x1), rint(y1), r1, g1, b1);
 
   // estimate arclength by convex hull FIXME: more precision
   lx = cx1 - x1;
@@ -747,15 +772,15 @@ void drawCubicBezier(double x1, double y1, double cx1, double cy1, double cx2, d
   ly = y2 - cy2;
   len += rint(sqrt(lx * lx + ly * ly));
 
-  if (len < lineDistance) {
+  if (len < w->lineDistance) {
     steps = 1;
   } else {
-    steps = len / lineDistance;
+    steps = len / w->lineDistance;
   }
 
   for (i = 0; i <= steps; i++) {
     t = (double)i / steps;
-    p = frame_point_add(drawframe);
+    p = frame_point_add(w->drawframe);
     p->x = clip((1 - t) * (1 - t) * (1 - t) * x1 + cx1 * 3 * t * (1 - t) * (1 - t) +
                 cx2 * 3 * t * t * (1 - t) + x2 * t * t * t);
     p->y = clip((1 - t) * (1 - t) * (1 - t) * y1 + cy1 * 3 * t * (1 - t) * (1 - t) +
@@ -769,7 +794,8 @@ void drawCubicBezier(double x1, double y1, double cx1, double cy1, double cx2, d
 }
 
 /* Parses the spline data and writes out ILDA (*.ILD) formatted file */
-static void OutputILDA(FILE *fdes, int llx, int lly, int urx, int ury, spline_list_array_type shape)
+static void OutputILDA(at_sink *fdes, IldaWriter *w, int llx, int lly, int urx, int ury,
+                       spline_list_array_type shape)
 {
   unsigned int this_list, this_spline;
   spline_list_type curr_list;
@@ -786,7 +812,7 @@ static void OutputILDA(FILE *fdes, int llx, int lly, int urx, int ury, spline_li
   if (fdes == NULL)
     return;
 
-  drawsequence = newLaserSequence();
+  w->drawsequence = newLaserSequence();
 
   LastPoint.x = 0;
   LastPoint.y = 0;
@@ -806,7 +832,7 @@ static void OutputILDA(FILE *fdes, int llx, int lly, int urx, int ury, spline_li
       switch ((polynomial_degree)last_degree) {
       case LINEARTYPE:
         // output Line
-        drawLine((LastPoint.x - ox) * sx, (LastPoint.y - oy) * sy,
+        drawLine(w, (LastPoint.x - ox) * sx, (LastPoint.y - oy) * sy,
                  (END_POINT(curr_spline).x - ox) * sx, (END_POINT(curr_spline).y - oy) * sy,
                  curr_list.color.r, curr_list.color.g, curr_list.color.b);
         LastPoint = END_POINT(curr_spline);
@@ -814,7 +840,7 @@ static void OutputILDA(FILE *fdes, int llx, int lly, int urx, int ury, spline_li
 
       default:
         // output Bezier curve
-        drawCubicBezier((LastPoint.x - ox) * sx, (LastPoint.y - oy) * sy,
+        drawCubicBezier(w, (LastPoint.x - ox) * sx, (LastPoint.y - oy) * sy,
                         (CONTROL1(curr_spline).x - ox) * sx, (CONTROL1(curr_spline).y - oy) * sy,
                         (CONTROL2(curr_spline).x - ox) * sx, (CONTROL2(curr_spline).y - oy) * sy,
                         (END_POINT(curr_spline).x - ox) * sx, (END_POINT(curr_spline).y - oy) * sy,
@@ -825,44 +851,45 @@ static void OutputILDA(FILE *fdes, int llx, int lly, int urx, int ury, spline_li
     }
   }
 
-  frameDrawFinish();
-  writeILDA(fdes, drawsequence);
-  g_free(drawsequence);
+  frameDrawFinish(w);
+  writeILDA(fdes, w, w->drawsequence);
 }
 
-int output_ild_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_ild_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, at_spline_list_array_type shape,
                       at_msg_func msg_func, gpointer msg_data, gpointer user_data)
 {
-
-#ifdef _WINDOWS
-  if (file == stdout) {
-    fprintf(stderr, "This driver couldn't write to stdout!\n");
-    return -1;
-  }
-#endif
+  IldaWriter w = {0};
+  int frames, points;
 
   /* This should be user-adjustable. */
-  write3DFrames = 0;
-  trueColorWrite = 1;
-  writeTable = 0;
-  fromToZero = 1;
-  lineDistance = 800;
-  blankDistance = 1200;
-  insert_anchor_points = 1;
-  anchor_thresh = 40;
+  w.write3DFrames = 0;
+  w.trueColorWrite = 1;
+  w.writeTable = 0;
+  w.fromToZero = 1;
+  w.lineDistance = 800;
+  w.blankDistance = 1200;
+  w.insert_anchor_points = 1;
+  w.anchor_thresh = 40;
 
   /* Output ILDA */
-  OutputILDA(file, llx, lly, urx, ury, shape);
+  OutputILDA(file, &w, llx, lly, urx, ury, shape);
+
+  if (w.drawsequence == NULL)
+    return 0;
+
+  frames = sequence_frame_count(w.drawsequence);
+  points = frame_point_count(w.drawframe);
+  freeLaserSequence(w.drawsequence);
 
-  if (file == stdout)
+  /* Only output written to a file leaves the terminal free for this */
+  if (at_sink_get_file(file) == NULL || at_sink_get_file(file) == stdout)
     return 0;
 
-  printf("Wrote %d frame with %d points (%d anchors", sequence_frame_count(drawsequence),
-         frame_point_count(drawframe), inserted_anchor_points);
-  if (trueColorWrite)
+  printf("Wrote %d frame with %d points (%d anchors", frames, points, w.inserted_anchor_points);
+  if (w.trueColorWrite)
     printf(", True Color Header");
-  if (writeTable)
+  if (w.writeTable)
     printf(", Color Table");
   printf(").\n");
   return 0;
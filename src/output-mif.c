@@ -31,34 +31,29 @@ typedef struct {
   gfloat dpi;
 } BboxT;
 
-BboxT cbox;
-
 /*===========================================================================
-  Return a color name based on RGB value
+  Return a newly allocated color name based on RGB value
 ===========================================================================*/
-static const char *colorstring(int r, int g, int b)
+static gchar *colorstring(int r, int g, int b)
 {
-  static char buffer[15];
   if (r == 0 && g == 0 && b == 0)
-    return "Black";
+    return g_strdup("Black");
   else if (r == 255 && g == 0 && b == 0)
-    return "Red";
+    return g_strdup("Red");
   else if (r == 0 && g == 255 && b == 0)
-    return "Green";
+    return g_strdup("Green");
   else if (r == 0 && g == 0 && b == 255)
-    return "Blue";
+    return g_strdup("Blue");
   else if (r == 255 && g == 255 && b == 0)
-    return "Yellow";
+    return g_strdup("Yellow");
   else if (r == 255 && g == 0 && b == 255)
-    return "Magenta";
+    return g_strdup("Magenta");
   else if (r == 0 && g == 255 && b == 255)
-    return "Cyan";
+    return g_strdup("Cyan");
   else if (r == 255 && g == 255 && b == 255)
-    return "White";
-  else {
-    sprintf(buffer, "R%.3dG%.3dB%.3d", r, g, b);
-  }
-  return buffer;
+    return g_strdup("White");
+  else
+    return g_strdup_printf("R%.3dG%.3dB%.3d", r, g, b);
 }
 
 /*===========================================================================
@@ -83,15 +78,16 @@ static gfloat bezpnt(gfloat t, gfloat z1, gfloat z2, gfloat z3, gfloat z4)
 /*===========================================================================
   Print a point
 ===========================================================================*/
-static void print_coord(FILE *f, gfloat x, gfloat y)
+static void print_coord(at_sink *f, const BboxT *cbox, gfloat x, gfloat y)
 {
-  fprintf(f, "  <Point %.2f %.2f>\n", x * 72.0 / cbox.dpi, (cbox.ury - y + 1) * 72.0 / cbox.dpi);
+  at_sink_printf(f, "  <Point %.2f %.2f>\n", x * 72.0 / cbox->dpi,
+                 (cbox->ury - y + 1) * 72.0 / cbox->dpi);
 }
 
 /*===========================================================================
   Main conversion routine
 ===========================================================================*/
-int output_mif_writer(FILE *ps_file, gchar *name, int llx, int lly, int urx, int ury,
+int output_mif_writer(at_sink *ps_file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
                       gpointer msg_data, gpointer user_data)
 {
@@ -100,6 +96,7 @@ int output_mif_writer(FILE *ps_file, gchar *name, int llx, int lly, int urx, int
   ColorT col_tbl[256];
   int n_ctbl = 0;
   at_color curr_color = {0, 0, 0};
+  BboxT cbox;
 
   cbox.llx = llx;
   cbox.lly = lly;
@@ -117,7 +114,7 @@ int output_mif_writer(FILE *ps_file, gchar *name, int llx, int lly, int urx, int
         break;
 
     if (i >= n_ctbl) {
-      col_tbl[n_ctbl].tag = g_strdup(colorstring(curr_color.r, curr_color.g, curr_color.b));
+      col_tbl[n_ctbl].tag = colorstring(curr_color.r, curr_color.g, curr_color.b);
       col_tbl[n_ctbl].c = curr_color;
       n_ctbl++;
       if (n_ctbl > 255)
@@ -125,7 +122,7 @@ int output_mif_writer(FILE *ps_file, gchar *name, int llx, int lly, int urx, int
     }
   }
 
-  fprintf(ps_file, "<MIFFile 4.00> #%s\n<Units Upt>\n<ColorCatalog\n", at_version(TRUE));
+  at_sink_printf(ps_file, "<MIFFile 4.00> #%s\n<Units Upt>\n<ColorCatalog\n", at_version(TRUE));
 
   for (i = 0; i < n_ctbl; i++) {
     int c, m, y, k;
@@ -139,21 +136,21 @@ int output_mif_writer(FILE *ps_file, gchar *name, int llx, int lly, int urx, int
     c -= k;
     m -= k;
     y -= k;
-    fprintf(ps_file,
-            " <Color <ColorTag %s><ColorCyan %d><ColorMagenta %d>"
-            "<ColorYellow %d><ColorBlack %d>>\n",
-            col_tbl[i].tag, c * 100 / 255, m * 100 / 255, y * 100 / 255, k * 100 / 255);
+    at_sink_printf(ps_file,
+                   " <Color <ColorTag %s><ColorCyan %d><ColorMagenta %d>"
+                   "<ColorYellow %d><ColorBlack %d>>\n",
+                   col_tbl[i].tag, c * 100 / 255, m * 100 / 255, y * 100 / 255, k * 100 / 255);
   }
-  fprintf(ps_file, ">\n");
+  at_sink_printf(ps_file, ">\n");
 
-  fprintf(ps_file,
-          "<Frame\n"
-          " <Pen 15>\n"
-          " <Fill 15>\n"
-          " <PenWidth  0.2 pt>\n"
-          " <Separation 0>\n"
-          " <BRect  0.0 pt 0.0 pt %.1f pt %.1f pt>\n",
-          (urx - llx) * 72.0 / cbox.dpi, (ury - lly) * 72.0 / cbox.dpi);
+  at_sink_printf(ps_file,
+                 "<Frame\n"
+                 " <Pen 15>\n"
+                 " <Fill 15>\n"
+                 " <PenWidth  0.2 pt>\n"
+                 " <Separation 0>\n"
+                 " <BRect  0.0 pt 0.0 pt %.1f pt %.1f pt>\n",
+                 (urx - llx) * 72.0 / cbox.dpi, (ury - lly) * 72.0 / cbox.dpi);
 
   for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
     unsigned this_spline;
@@ -166,32 +163,32 @@ int output_mif_writer(FILE *ps_file, gchar *name, int llx, int lly, int urx, int
       if (at_color_equal(&curr_color, &col_tbl[i].c))
         break;
 
-    fprintf(ps_file, " %s\n",
-            (shape.centerline || list.open) ? "<PolyLine <Fill 15><Pen 0>"
-                                            : "<Polygon <Fill 0><Pen 15>");
-    fprintf(ps_file, "  <ObColor `%s'>\n", col_tbl[i].tag);
+    at_sink_printf(ps_file, " %s\n",
+                   (shape.centerline || list.open) ? "<PolyLine <Fill 15><Pen 0>"
+                                                   : "<Polygon <Fill 0><Pen 15>");
+    at_sink_printf(ps_file, "  <ObColor `%s'>\n", col_tbl[i].tag);
 
-    print_coord(ps_file, START_POINT(first).x, START_POINT(first).y);
+    print_coord(ps_file, &cbox, START_POINT(first).x, START_POINT(first).y);
     smooth = FALSE;
     for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(list); this_spline++) {
       spline_type s = SPLINE_LIST_ELT(list, this_spline);
 
       if (SPLINE_DEGREE(s) == LINEARTYPE) {
-        print_coord(ps_file, END_POINT(s).x, END_POINT(s).y);
+        print_coord(ps_file, &cbox, END_POINT(s).x, END_POINT(s).y);
       } else {
         gfloat temp;
         gfloat dt = (gfloat)(1.0 / 7.0);
         /*smooth = TRUE; */
         for (temp = dt; fabs(temp - (gfloat)1.0) > dt; temp += dt) {
-          print_coord(ps_file,
+          print_coord(ps_file, &cbox,
                       bezpnt(temp, START_POINT(s).x, CONTROL1(s).x, CONTROL2(s).x, END_POINT(s).x),
                       bezpnt(temp, START_POINT(s).y, CONTROL1(s).y, CONTROL2(s).y, END_POINT(s).y));
         }
       }
     }
-    fprintf(ps_file, "  <Smoothed %s>\n", smooth ? "Yes" : "No");
-    fprintf(ps_file, " >\n");
+    at_sink_printf(ps_file, "  <Smoothed %s>\n", smooth ? "Yes" : "No");
+    at_sink_printf(ps_file, " >\n");
   }
-  fprintf(ps_file, ">\n");
+  at_sink_printf(ps_file, ">\n");
   return 0;
 }
@@ -19,14 +19,17 @@
 
 /* Output macros.  */
 
+/* The header depends on all the spline lists, so they go to the
+   buffer sink OUT first.  */
+
 /* This should be used for outputting a string S on a line by itself.  */
-#define OUT_LINE(l) fprintf(ps_file, "%s\n", l)
+#define OUT_LINE(l) at_sink_printf(out, "%s\n", l)
 
 /* These output their arguments, preceded by the indentation.  */
-#define OUT(...) fprintf(ps_file, __VA_ARGS__)
+#define OUT(...) at_sink_printf(out, __VA_ARGS__)
 
 /* These macros just output their arguments.  */
-#define OUT_REAL(r) fprintf(ps_file, r == lround(r) ? "%.0f " : "%.3f ", r)
+#define OUT_REAL(r) at_sink_printf(out, r == lround(r) ? "%.0f " : "%.3f ", r)
 
 /* For a PostScript command with two real arguments, e.g., lineto.  OP
    should be a constant string.  */
@@ -54,30 +57,12 @@
     OUT(" " op "\n");                                                                              \
   } while (0)
 
-/* This should be called before the others in this file.  It opens the
-   output file `OUTPUT_NAME.ps', and writes some preliminary boilerplate. */
+/* This should be called before the others in this file.  It writes
+   some preliminary boilerplate.  WITH_CURVES tells pstoedit whether
+   it has to flatten curves.  */
 
-static int output_p2e_header(FILE *ps_file, gchar *name, int llx, int lly, int urx, int ury,
-                             spline_list_array_type shape)
+static void output_p2e_header(at_sink *out, gchar *name, unsigned with_curves)
 {
-  unsigned this_list, with_curves = 1;
-
-  for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
-    unsigned this_spline;
-
-    spline_list_type list = SPLINE_LIST_ARRAY_ELT(shape, this_list);
-
-    for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(list); this_spline++) {
-      spline_type s = SPLINE_LIST_ELT(list, this_spline);
-
-      if (SPLINE_DEGREE(s) != LINEARTYPE) {
-        with_curves = 0;
-        this_list = SPLINE_LIST_ARRAY_LENGTH(shape);
-        break;
-      }
-    }
-  }
-
   OUT_LINE("%!PS-Adobe-3.0");
   OUT("%%%%Title: flattened PostScript generated by autotrace: %s\n", name);
   OUT_LINE("%%Creator: pstoedit");
@@ -100,19 +85,41 @@ static int output_p2e_header(FILE *ps_file, gchar *name, int llx, int lly, int u
   OUT_LINE("% textastext doflatten backendconstraints  ");
   OUT("%d 0 backendconstraints\n", with_curves);
   OUT_LINE("%%EndSetup");
-
-  return 0;
 }
 
-/* This outputs the PostScript code which produces the shape in
-   SHAPE.  */
-
-static void out_splines(FILE *ps_file, spline_list_array_type shape)
+/* Where a stream of spline lists has got to */
+typedef struct {
+  at_sink *file;
+  gchar *name;
+  int llx, lly, urx, ury;
+  gboolean centerline;
+  unsigned n_lists;
+  unsigned int pathnr;
+  gboolean last_open;
+  at_color last_color;
+  /* Cleared by the first spline that is not a line */
+  unsigned with_curves;
+  /* The PostScript code for the lists, written out after the header */
+  at_sink *body;
+} p2e_state_type;
+
+gpointer output_p2e_begin(at_sink *ps_file, gchar *name, int llx, int lly, int urx, int ury,
+                          at_output_opts_type *opts, spline_list_array_type *shape,
+                          at_msg_func msg_func, gpointer msg_data, gpointer user_data)
 {
-  unsigned this_list;
-  unsigned int pathnr = 1;
-  spline_list_type list;
-  at_color last_color = {0, 0, 0};
+  p2e_state_type *p2e = g_new0(p2e_state_type, 1);
+  at_sink *out;
+
+  p2e->file = ps_file;
+  p2e->name = g_strdup(name);
+  p2e->llx = llx;
+  p2e->lly = lly;
+  p2e->urx = urx;
+  p2e->ury = ury;
+  p2e->centerline = shape->centerline;
+  p2e->pathnr = 1;
+  p2e->with_curves = 1;
+  p2e->body = out = at_sink_new_buffer();
 
   OUT_LINE(" 612 792 setPageSize");
   OUT_LINE(" 0 setlinecap");
@@ -120,80 +127,90 @@ static void out_splines(FILE *ps_file, spline_list_array_type shape)
   OUT_LINE(" 0 setlinejoin");
   OUT_LINE(" [ ] 0.0 setdash");
   OUT_LINE(" 1.0 setlinewidth");
+  return p2e;
+}
 
-  for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
-    unsigned this_spline;
-    spline_type first;
-
-    list = SPLINE_LIST_ARRAY_ELT(shape, this_list);
-    first = SPLINE_LIST_ELT(list, 0);
-
-    if (this_list == 0 || !at_color_equal(&list.color, &last_color)) {
-      int c, m, y, k;
+/* This outputs the PostScript code which produces the shape in
+   LIST.  */
 
-      OUT_LINE((shape.centerline || list.open) ? "stroke" : "fill");
-      OUT("\n\n%% %d pathnumber\n", pathnr);
-      OUT_LINE((shape.centerline || list.open) ? "% strokedpath" : "% filledpath");
-      pathnr++;
+void output_p2e_list(gpointer state, spline_list_type *list)
+{
+  p2e_state_type *p2e = state;
+  at_sink *out = p2e->body;
+  unsigned this_spline;
+  spline_type first = SPLINE_LIST_ELT(*list, 0);
+
+  if (p2e->n_lists == 0 || !at_color_equal(&list->color, &p2e->last_color)) {
+    int c, m, y, k;
+
+    OUT_LINE((p2e->centerline || list->open) ? "stroke" : "fill");
+    OUT("\n\n%% %d pathnumber\n", p2e->pathnr);
+    OUT_LINE((p2e->centerline || list->open) ? "% strokedpath" : "% filledpath");
+    p2e->pathnr++;
 #ifdef withrgbcolor
-      /* in the long term this can be removed. */
-      OUT("%.3f %.3f %.3f setrgbcolor\n", (real)list.color.r / 255.0, (real)list.color.g / 255.0,
-          (real)list.color.b / 255.0);
+    /* in the long term this can be removed. */
+    OUT("%.3f %.3f %.3f setrgbcolor\n", (real)list->color.r / 255.0, (real)list->color.g / 255.0,
+        (real)list->color.b / 255.0);
 #else
-      c = k = 255 - list.color.r;
-      m = 255 - list.color.g;
-      if (m < k)
-        k = m;
-      y = 255 - list.color.b;
-      if (y < k)
-        k = y;
-      c -= k;
-      m -= k;
-      y -= k;
-      OUT("%.3f %.3f %.3f %.3f %s\n", (double)c / 255.0, (double)m / 255.0, (double)y / 255.0,
-          (double)k / 255.0, "setcmykcolor");
+    c = k = 255 - list->color.r;
+    m = 255 - list->color.g;
+    if (m < k)
+      k = m;
+    y = 255 - list->color.b;
+    if (y < k)
+      k = y;
+    c -= k;
+    m -= k;
+    y -= k;
+    OUT("%.3f %.3f %.3f %.3f %s\n", (double)c / 255.0, (double)m / 255.0, (double)y / 255.0,
+        (double)k / 255.0, "setcmykcolor");
 #endif
-      last_color = list.color;
-    }
+    p2e->last_color = list->color;
+  }
 
-    OUT_LINE("newpath");
-    OUT_COMMAND2(START_POINT(first).x, START_POINT(first).y, "moveto");
+  OUT_LINE("newpath");
+  OUT_COMMAND2(START_POINT(first).x, START_POINT(first).y, "moveto");
 
-    for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(list); this_spline++) {
-      spline_type s = SPLINE_LIST_ELT(list, this_spline);
+  for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(*list); this_spline++) {
+    spline_type s = SPLINE_LIST_ELT(*list, this_spline);
 
-      if (SPLINE_DEGREE(s) == LINEARTYPE)
-        OUT_COMMAND2(END_POINT(s).x, END_POINT(s).y, "lineto");
-      else
-        OUT_COMMAND6(CONTROL1(s).x, CONTROL1(s).y, CONTROL2(s).x, CONTROL2(s).y, END_POINT(s).x,
-                     END_POINT(s).y, "curveto");
+    if (SPLINE_DEGREE(s) == LINEARTYPE)
+      OUT_COMMAND2(END_POINT(s).x, END_POINT(s).y, "lineto");
+    else {
+      OUT_COMMAND6(CONTROL1(s).x, CONTROL1(s).y, CONTROL2(s).x, CONTROL2(s).y, END_POINT(s).x,
+                   END_POINT(s).y, "curveto");
+      p2e->with_curves = 0;
     }
-    if (!list.open)
-      OUT_LINE("closepath");
   }
-  if (SPLINE_LIST_ARRAY_LENGTH(shape) > 0)
-    OUT_LINE((shape.centerline || list.open) ? "stroke" : "fill");
+  if (!list->open)
+    OUT_LINE("closepath");
+  p2e->last_open = list->open;
+  p2e->n_lists++;
 }
 
-int output_p2e_writer(FILE *ps_file, gchar *name, int llx, int lly, int urx, int ury,
-                      at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
-                      gpointer msg_data, gpointer user_data)
+int output_p2e_end(gpointer state)
 {
-  int result;
-
-  result = output_p2e_header(ps_file, name, llx, lly, urx, ury, shape);
-  if (result != 0)
-    return result;
+  p2e_state_type *p2e = state;
+  at_sink *out = p2e->body;
+  const guchar *data;
+  gsize length;
 
-  out_splines(ps_file, shape);
+  output_p2e_header(p2e->file, p2e->name, p2e->with_curves);
 
+  if (p2e->n_lists > 0)
+    OUT_LINE((p2e->centerline || p2e->last_open) ? "stroke" : "fill");
   OUT_LINE("showpage");
-  OUT("%%%%BoundingBox: %d %d %d %d\n", llx, lly, urx, ury);
+  OUT("%%%%BoundingBox: %d %d %d %d\n", p2e->llx, p2e->lly, p2e->urx, p2e->ury);
   OUT_LINE("%%Page: 1 1");
   OUT_LINE("% normal end reached by pstoedit.pro");
   OUT_LINE("%%Trailer");
   OUT_LINE("%%Pages: 1");
   OUT_LINE("%%EOF");
+  data = at_sink_get_data(out, &length);
+  at_sink_write(p2e->file, data, length);
 
+  at_sink_free(out);
+  g_free(p2e->name);
+  g_free(p2e);
   return 0;
 }
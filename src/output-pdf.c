@@ -10,23 +10,30 @@
  * SPDX-License-Identifier: LGPL-2.1-or-later
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* Def: HAVE_CONFIG_H */
+
 #include "spline.h"
 #include "color.h"
 #include "output-pdf.h"
 #include "autotrace.h"
 #include <math.h>
 #include <string.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif /* Def: HAVE_ZLIB */
 
 /* Output macros.  */
 
 /* This should be used for outputting a string S on a line by itself.  */
-#define OUT_LINE(s) fprintf(pdf_file, "%s\n", s)
+#define OUT_LINE(s) at_sink_printf(pdf_file, "%s\n", s)
 
 /* These output their arguments, preceded by the indentation.  */
-#define OUT(...) fprintf(pdf_file, __VA_ARGS__)
+#define OUT(...) at_sink_printf(pdf_file, __VA_ARGS__)
 
 /* These macros just output their arguments.  */
-#define OUT_REAL(r) fprintf(pdf_file, r == lround(r) ? "%.0f " : "%.3f ", r)
+#define OUT_REAL(r) at_sink_printf(pdf_file, r == lround(r) ? "%.0f " : "%.3f ", r)
 
 /* For a PostScript command with two real arguments, e.g., lineto.  OP
    should be a constant string.  */
@@ -52,26 +59,11 @@
     OUT(" " op " \n");                                                                             \
   } while (0)
 
-/* This should be used for outputting a string S on a line by itself.  */
-#define SOUT_LINE(s)                                                                               \
-  do {                                                                                             \
-    g_autofree gchar *_tmp = g_strdup_printf("%s\n", s);                                           \
-    *length += strlen(_tmp);                                                                       \
-  } while (0)
-
-/* These output their arguments, preceded by the indentation.  */
-#define SOUT(...)                                                                                  \
-  do {                                                                                             \
-    g_autofree gchar *_tmp = g_strdup_printf(__VA_ARGS__);                                         \
-    *length += strlen(_tmp);                                                                       \
-  } while (0)
-
-/* These macros just output their arguments.  */
-#define SOUT_REAL(r)                                                                               \
-  do {                                                                                             \
-    g_autofree gchar *_tmp = g_strdup_printf((r) == lround(r) ? "%.0f " : "%.3f ", (r));           \
-    *length += strlen(_tmp);                                                                       \
-  } while (0)
+/* These append their arguments to the content stream, which is kept
+   in memory until its length is known.  */
+#define SOUT_LINE(s) at_sink_printf(content, "%s\n", s)
+#define SOUT(...) at_sink_printf(content, __VA_ARGS__)
+#define SOUT_REAL(r) at_sink_printf(content, (r) == lround(r) ? "%.0f " : "%.3f ", (r))
 
 /* For a PostScript command with two real arguments, e.g., lineto.  OP
    should be a constant string.  */
@@ -97,30 +89,43 @@
     SOUT(" " op " \n");                                                                            \
   } while (0)
 
-/* This should be called before the others in this file. It opens the
-   output file `OUTPUT_NAME.pdf', and writes some preliminary boilerplate. */
+/* The objects of the file: the catalog, the outlines, the pages, the
+   page, its content and its resources, numbered from 1.  */
+#define N_OBJECTS 6
 
-static int output_pdf_header(FILE *pdf_file, gchar *name, int llx, int lly, int urx, int ury)
+/* Begin object N, and note in OFFSETS where it is.  */
+#define OUT_OBJECT(n)                                                                              \
+  do {                                                                                             \
+    offsets[n] = at_sink_tell(pdf_file);                                                           \
+    OUT("%d 0 obj\n", n);                                                                          \
+  } while (0)
+
+/* This should be called before the others in this file. It writes
+   some preliminary boilerplate, and where the objects written begin to
+   OFFSETS.  */
+
+static int output_pdf_header(at_sink *pdf_file, gsize *offsets, gchar *name, int llx, int lly,
+                             int urx, int ury)
 {
   OUT_LINE("%PDF-1.2");
-  OUT_LINE("1 0 obj");
+  OUT_OBJECT(1);
   OUT_LINE("   << /Type /Catalog");
   OUT_LINE("      /Outlines 2 0 R");
   OUT_LINE("      /Pages 3 0 R");
   OUT_LINE("   >>");
   OUT_LINE("endobj");
-  OUT_LINE("2 0 obj");
+  OUT_OBJECT(2);
   OUT_LINE("   << /Type /Outlines");
   OUT_LINE("      /Count 0");
   OUT_LINE("   >>");
   OUT_LINE("endobj");
-  OUT_LINE("3 0 obj");
+  OUT_OBJECT(3);
   OUT_LINE("   << /Type /Pages");
   OUT_LINE("      /Kids [4 0 R]");
   OUT_LINE("      /Count 1");
   OUT_LINE("   >>");
   OUT_LINE("endobj");
-  OUT_LINE("4 0 obj");
+  OUT_OBJECT(4);
   OUT_LINE("   << /Type /Page");
   OUT_LINE("      /Parent 3 0 R");
   OUT("      /MediaBox [%d %d %d %d]\n", llx, lly, urx, ury);
@@ -133,153 +138,158 @@ static int output_pdf_header(FILE *pdf_file, gchar *name, int llx, int lly, int
 }
 
 /* This should be called after the others in this file. It writes some
-   last informations. */
+   last informations: the cross-reference table from OFFSETS, which
+   has all the objects but the last.  */
 
-static int output_pdf_tailor(FILE *pdf_file, size_t length, int llx, int lly, int urx, int ury)
+static int output_pdf_tailor(at_sink *pdf_file, gsize *offsets)
 {
-  char temp[40];
-  size_t tmp;
+  gsize xref;
+  int i;
 
-  OUT_LINE("6 0 obj");
+  OUT_OBJECT(6);
   OUT_LINE("   [/PDF]");
   OUT_LINE("endobj");
+  xref = at_sink_tell(pdf_file);
   OUT_LINE("xref");
-  OUT_LINE("0 7");
+  OUT("0 %d\n", N_OBJECTS + 1);
   OUT_LINE("0000000000 65535 f ");
-  OUT_LINE("0000000009 00000 n ");
-  OUT_LINE("0000000092 00000 n ");
-  OUT_LINE("0000000150 00000 n ");
-  OUT_LINE("0000000225 00000 n ");
-  sprintf(temp, "%d", llx);
-  tmp = 366;
-  tmp += (strlen(temp));
-  sprintf(temp, "%d", lly);
-  tmp += (strlen(temp));
-  sprintf(temp, "%d", urx);
-  tmp += (strlen(temp));
-  sprintf(temp, "%d", ury);
-  tmp += (strlen(temp));
-  OUT("%010zu 00000 n \n", tmp);
-  sprintf(temp, "%zu", length);
-  tmp += 50 + length + strlen(temp);
-  OUT("%010zu 00000 n \n", tmp);
+  for (i = 1; i <= N_OBJECTS; i++)
+    OUT("%010zu 00000 n \n", offsets[i]);
   OUT_LINE("trailer");
-  OUT_LINE("   << /Size 7");
+  OUT("   << /Size %d\n", N_OBJECTS + 1);
   OUT_LINE("      /Root 1 0 R");
   OUT_LINE("   >>");
   OUT_LINE("startxref");
-  OUT("%zu\n", tmp + 25);
+  OUT("%zu\n", xref);
   OUT_LINE("%%EOF");
 
   return 0;
 }
 
-/* This outputs the PDF code which produces the shape in
-   SHAPE. */
-
-static void out_splines(FILE *pdf_file, spline_list_array_type shape, size_t *length)
+#ifdef HAVE_ZLIB
+/* The SIZE bytes at DATA compressed with Flate, to be freed with
+   g_free, and their number in *COMPRESSED_SIZE; NULL if zlib could not
+   compress them.  The fastest level already makes the text of the
+   content three or four times smaller, at a fifth of the time of the
+   default level.  */
+static guchar *flate(const guchar *data, gsize size, gsize *compressed_size)
 {
-  unsigned this_list;
-  spline_list_type list;
-
-  at_color last_color = {0, 0, 0};
-
-  for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
-    unsigned this_spline;
-    spline_type first;
-
-    list = SPLINE_LIST_ARRAY_ELT(shape, this_list);
-    first = SPLINE_LIST_ELT(list, 0);
-
-    if (this_list == 0 || !at_color_equal(&list.color, &last_color)) {
-      if (this_list > 0) {
-        SOUT_LINE((shape.centerline || list.open) ? "S" : "f");
-        /* In PDF a Stroke (S) or fill (f) causes an implicit closepath (h) -Paul Sladen */
-        /* SOUT_LINE("h"); */
-      }
-      SOUT("%.3f %.3f %.3f %s\n", (double)list.color.r / 255.0, (double)list.color.g / 255.0,
-           (double)list.color.b / 255.0, (shape.centerline || list.open) ? "RG" : "rg");
-      last_color = list.color;
-    }
-    SOUT_COMMAND2(START_POINT(first).x, START_POINT(first).y, "m");
+  uLongf n = compressBound(size);
+  guchar *compressed = g_malloc(n);
 
-    for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(list); this_spline++) {
-      spline_type s = SPLINE_LIST_ELT(list, this_spline);
-
-      if (SPLINE_DEGREE(s) == LINEARTYPE)
-        SOUT_COMMAND2(END_POINT(s).x, END_POINT(s).y, "l");
-      else
-        SOUT_COMMAND6(CONTROL1(s).x, CONTROL1(s).y, CONTROL2(s).x, CONTROL2(s).y, END_POINT(s).x,
-                      END_POINT(s).y, "c");
-    }
+  if (compress2(compressed, &n, data, size, Z_BEST_SPEED) != Z_OK) {
+    g_free(compressed);
+    return NULL;
   }
-  if (SPLINE_LIST_ARRAY_LENGTH(shape) > 0)
-    SOUT_LINE((shape.centerline || list.open) ? "S" : "f");
+  *compressed_size = n;
+  return compressed;
+}
+#endif /* Def: HAVE_ZLIB */
+
+/* Where a stream of spline lists has got to */
+typedef struct {
+  at_sink *file;
+  int llx, lly, urx, ury;
+  gboolean centerline;
+  unsigned n_lists;
+  gboolean last_open;
+  at_color last_color;
+  /* The page content, a buffer sink written out at the end */
+  at_sink *content;
+  gboolean compress;
+  gsize offsets[N_OBJECTS + 1];
+} pdf_state_type;
+
+gpointer output_pdf_begin(at_sink *pdf_file, gchar *name, int llx, int lly, int urx, int ury,
+                          at_output_opts_type *opts, spline_list_array_type *shape,
+                          at_msg_func msg_func, gpointer msg_data, gpointer user_data)
+{
+  pdf_state_type *pdf;
+
+  pdf = g_new0(pdf_state_type, 1);
+  pdf->file = pdf_file;
+  pdf->llx = llx;
+  pdf->lly = lly;
+  pdf->urx = urx;
+  pdf->ury = ury;
+  pdf->centerline = shape->centerline;
+  pdf->content = at_sink_new_buffer();
+  pdf->compress = opts->compress;
+
+  output_pdf_header(pdf_file, pdf->offsets, name, llx, lly, urx, ury);
+  return pdf;
+}
 
-  OUT_LINE("5 0 obj");
-  OUT("   << /Length %zu >>\n", *length);
-  OUT_LINE("stream");
+/* This adds the PDF code which produces the shape in LIST to the
+   content stream.  */
 
-  last_color.r = 0;
-  last_color.g = 0;
-  last_color.b = 0;
-
-  for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
-    unsigned this_spline;
-    spline_type first;
-
-    list = SPLINE_LIST_ARRAY_ELT(shape, this_list);
-    first = SPLINE_LIST_ELT(list, 0);
-
-    if (this_list == 0 || !at_color_equal(&list.color, &last_color)) {
-      if (this_list > 0) {
-        OUT_LINE((shape.centerline || list.open) ? "S" : "f");
-        /* In PDF a Stroke (S) or fill (f) causes an implicit closepath (h) -Paul Sladen */
-        /* OUT_LINE("h"); */
-      }
-      OUT("%.3f %.3f %.3f %s\n", (double)list.color.r / 255.0, (double)list.color.g / 255.0,
-          (double)list.color.b / 255.0, (shape.centerline || list.open) ? "RG" : "rg");
-      last_color = list.color;
+void output_pdf_list(gpointer state, spline_list_type *list)
+{
+  pdf_state_type *pdf = state;
+  at_sink *content = pdf->content;
+  unsigned this_spline;
+  spline_type first = SPLINE_LIST_ELT(*list, 0);
+
+  if (pdf->n_lists == 0 || !at_color_equal(&list->color, &pdf->last_color)) {
+    if (pdf->n_lists > 0) {
+      SOUT_LINE((pdf->centerline || list->open) ? "S" : "f");
+      /* In PDF a Stroke (S) or fill (f) causes an implicit closepath (h) -Paul Sladen */
+      /* SOUT_LINE("h"); */
     }
-    OUT_COMMAND2(START_POINT(first).x, START_POINT(first).y, "m");
+    SOUT("%.3f %.3f %.3f %s\n", (double)list->color.r / 255.0, (double)list->color.g / 255.0,
+         (double)list->color.b / 255.0, (pdf->centerline || list->open) ? "RG" : "rg");
+    pdf->last_color = list->color;
+  }
+  SOUT_COMMAND2(START_POINT(first).x, START_POINT(first).y, "m");
 
-    for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(list); this_spline++) {
-      spline_type s = SPLINE_LIST_ELT(list, this_spline);
+  for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(*list); this_spline++) {
+    spline_type s = SPLINE_LIST_ELT(*list, this_spline);
 
-      if (SPLINE_DEGREE(s) == LINEARTYPE)
-        OUT_COMMAND2(END_POINT(s).x, END_POINT(s).y, "l");
-      else
-        OUT_COMMAND6(CONTROL1(s).x, CONTROL1(s).y, CONTROL2(s).x, CONTROL2(s).y, END_POINT(s).x,
-                     END_POINT(s).y, "c");
-    }
+    if (SPLINE_DEGREE(s) == LINEARTYPE)
+      SOUT_COMMAND2(END_POINT(s).x, END_POINT(s).y, "l");
+    else
+      SOUT_COMMAND6(CONTROL1(s).x, CONTROL1(s).y, CONTROL2(s).x, CONTROL2(s).y, END_POINT(s).x,
+                    END_POINT(s).y, "c");
   }
-  if (SPLINE_LIST_ARRAY_LENGTH(shape) > 0)
-    OUT_LINE((shape.centerline || list.open) ? "S" : "f");
-  OUT_LINE("endstream");
-  OUT_LINE("endobj");
+  pdf->last_open = list->open;
+  pdf->n_lists++;
 }
 
-int output_pdf_writer(FILE *pdf_file, gchar *name, int llx, int lly, int urx, int ury,
-                      at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
-                      gpointer msg_data, gpointer user_data)
+int output_pdf_end(gpointer state)
 {
-  int result;
-  size_t length = 0;
-
-#ifdef _WINDOWS
-  if (pdf_file == stdout) {
-    fprintf(stderr, "This driver couldn't write to stdout!\n");
-    return -1;
-  }
-#endif
-
-  result = output_pdf_header(pdf_file, name, llx, lly, urx, ury);
-  if (result != 0)
-    return result;
-
-  out_splines(pdf_file, shape, &length);
+  pdf_state_type *pdf = state;
+  at_sink *pdf_file = pdf->file;
+  at_sink *content = pdf->content;
+  gsize *offsets = pdf->offsets;
+  const guchar *data;
+  guchar *compressed = NULL;
+  gsize length;
+
+  if (pdf->n_lists > 0)
+    SOUT_LINE((pdf->centerline || pdf->last_open) ? "S" : "f");
+
+  data = at_sink_get_data(content, &length);
+#ifdef HAVE_ZLIB
+  if (pdf->compress && (compressed = flate(data, length, &length)) != NULL)
+    data = compressed;
+#endif /* Def: HAVE_ZLIB */
+  OUT_OBJECT(5);
+  if (compressed)
+    OUT("   << /Length %zu /Filter /FlateDecode >>\n", length);
+  else
+    OUT("   << /Length %zu >>\n", length);
+  OUT_LINE("stream");
+  at_sink_write(pdf_file, data, length);
+  /* The text of the content ends with a new line already */
+  if (compressed)
+    OUT("\n");
+  OUT_LINE("endstream");
+  OUT_LINE("endobj");
 
-  output_pdf_tailor(pdf_file, length, llx, lly, urx, ury);
+  output_pdf_tailor(pdf_file, offsets);
 
+  g_free(compressed);
+  at_sink_free(content);
+  g_free(pdf);
   return 0;
 }
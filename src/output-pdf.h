@@ -16,8 +16,10 @@
 
 #include "output.h"
 
-int output_pdf_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
-                      at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
-                      gpointer msg_data, gpointer user_data);
+gpointer output_pdf_begin(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
+                          at_output_opts_type *opts, spline_list_array_type *shape,
+                          at_msg_func msg_func, gpointer msg_data, gpointer user_data);
+void output_pdf_list(gpointer state, spline_list_type *list);
+int output_pdf_end(gpointer state);
 
 #endif /* not OUTPUT_PDF_H */
@@ -11,14 +11,16 @@
 #include "spline.h"
 
 #define NUM_SPLINES 8
-#define WriteInitialize(fp) (fputs("IN;", fp))
+#define WriteInitialize(fp) (at_sink_puts(fp, "IN;"))
 #define WriteInitPt(fp, left, bottom, right, top)                                                  \
-  (fprintf(fp, "IP %d %d %d %d;", left, bottom, right, top))
+  (at_sink_printf(fp, "IP %d %d %d %d;", left, bottom, right, top))
 #define WriteScale(fp, left, right, bottom, top)                                                   \
-  (fprintf(fp, "SC %d %d %d %d;", left, right, bottom, top))
-#define WritePenDown(fp, x, y) (fprintf(fp, "PD%d %d;", X_FLOAT_TO_UI32(x), Y_FLOAT_TO_UI32(y)))
-#define WritePenUp(fp, x, y) (fprintf(fp, "PU%d %d;", X_FLOAT_TO_UI32(x), Y_FLOAT_TO_UI32(y)))
-#define WriteSelectPen(fp, iColor) (fprintf(fp, "SP%d;", iColor))
+  (at_sink_printf(fp, "SC %d %d %d %d;", left, right, bottom, top))
+#define WritePenDown(fp, x, y)                                                                     \
+  (at_sink_printf(fp, "PD%d %d;", X_FLOAT_TO_UI32(x), Y_FLOAT_TO_UI32(y)))
+#define WritePenUp(fp, x, y)                                                                       \
+  (at_sink_printf(fp, "PU%d %d;", X_FLOAT_TO_UI32(x), Y_FLOAT_TO_UI32(y)))
+#define WriteSelectPen(fp, iColor) (at_sink_printf(fp, "SP%d;", iColor))
 
 #define WDEVPIXEL 1280
 #define HDEVPIXEL 1024
@@ -104,7 +106,7 @@ static void GetSplinePts(at_real_coord *BezierPts, at_real_coord *Splines, int n
   }
 }
 
-static void WriteBezier(FILE *fdes, spline_type sp1, at_real_coord *BeginPt)
+static void WriteBezier(at_sink *fdes, spline_type sp1, at_real_coord *BeginPt)
 {
   // Bezier from begin point
   at_real_coord Splines[NUM_SPLINES];
@@ -125,7 +127,8 @@ static void WriteBezier(FILE *fdes, spline_type sp1, at_real_coord *BeginPt)
   *BeginPt = LastPoint;
 }
 
-static void OutputPlt(FILE *fdes, int llx, int lly, int urx, int ury, spline_list_array_type shape)
+static void OutputPlt(at_sink *fdes, int llx, int lly, int urx, int ury,
+                      spline_list_array_type shape)
 {
   /*
       Parses the spline data and writes out HPGL (*.PLT) formatted file
@@ -201,17 +204,10 @@ static void OutputPlt(FILE *fdes, int llx, int lly, int urx, int ury, spline_lis
 
 // PLT output
 
-int output_plt_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_plt_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, at_spline_list_array_type shape,
                       at_msg_func msg_func, gpointer msg_data, gpointer user_data)
 {
-#ifdef _WINDOWS
-  if (file == stdout) {
-    fprintf(stderr, "This driver couldn't write to stdout!\n");
-    return -1;
-  }
-#endif
-
   /* Output PLT */
   OutputPlt(file, llx, lly, urx, ury, shape);
 
@@ -14,7 +14,7 @@
 
 #include "output.h"
 
-int output_plt_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_plt_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, at_spline_list_array_type shape,
                       at_msg_func msg_func, gpointer msg_data, gpointer user_data);
 
@@ -17,15 +17,15 @@
 /* Output macros.  */
 
 /* This should be used for outputting a string S on a line by itself.  */
-#define OUT_LINE(s) fprintf(pov_file, "%s\n", s)
+#define OUT_LINE(s) at_sink_printf(pov_file, "%s\n", s)
 
 /* These output their arguments, preceded by the indentation.  */
-#define OUT(s, ...) fprintf(pov_file, s, __VA_ARGS__)
+#define OUT(s, ...) at_sink_printf(pov_file, s, __VA_ARGS__)
 
 /* This outputs the Povray code which produces the shape in
    SHAPE.  */
 
-static void out_splines(FILE *pov_file, spline_list_array_type shape)
+static void out_splines(at_sink *pov_file, spline_list_array_type shape)
 {
   unsigned this_list;
   spline_list_type list;
@@ -93,7 +93,7 @@ static void out_splines(FILE *pov_file, spline_list_array_type shape)
   }
 }
 
-int output_pov_writer(FILE *pov_file, gchar *name, int llx, int lly, int urx, int ury,
+int output_pov_writer(at_sink *pov_file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
                       gpointer msg_data, gpointer user_data)
 {
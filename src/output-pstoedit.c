@@ -66,7 +66,7 @@ extern void clearPstoeditDriverInfo_plainC(void *ptr);
 
 /* #define OUTPUT_PSTOEDIT_DEBUG */
 
-static int output_pstoedit_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+static int output_pstoedit_writer(at_sink *sink, gchar *name, int llx, int lly, int urx, int ury,
                                   at_output_opts_type *opts, at_spline_list_array_type shape,
                                   at_msg_func msg_func, gpointer msg_data, gpointer user_data);
 
@@ -78,12 +78,12 @@ static gboolean is_pstoedit_v4 = FALSE;
 
 /* This output routine uses two temporary files to keep the
    both the command line syntax of autotrace and the
-   pstoedit API.
+   pstoedit API, which only works on named files.
 
    shape -> bo file(tmpfile_name_p2e)
    -> specified formatted file(tmpfile_name_pstoedit)
-   -> file */
-static int output_pstoedit_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+   -> sink */
+static int output_pstoedit_writer(at_sink *sink, gchar *name, int llx, int lly, int urx, int ury,
                                   at_output_opts_type *opts, at_spline_list_array_type shape,
                                   at_msg_func msg_func, gpointer msg_data, gpointer user_data)
 {
@@ -93,7 +93,8 @@ static int output_pstoedit_writer(FILE *file, gchar *name, int llx, int lly, int
   const gchar *symbolicname = (const gchar *)user_data;
   FILE *tmpfile;
   int result = 0;
-  int c;
+  char buffer[BUFSIZ];
+  size_t n;
   int argc = 6;
   const char *argv[] = {
       "pstoedit", // argv[0] - program name
@@ -130,11 +131,10 @@ static int output_pstoedit_writer(FILE *file, gchar *name, int llx, int lly, int
   pstoedit_plainC(argc, argv, NULL);
 
   /*
-   * specified formatted file(tmpfile_name_pstoedit) -> file
+   * specified formatted file(tmpfile_name_pstoedit) -> sink
    */
-  /* fseek(tmpfile, 0, SEEK_SET); */
-  while (EOF != (c = fgetc(tmpfile)))
-    fputc(c, file);
+  while ((n = fread(buffer, 1, sizeof(buffer), tmpfile)) > 0)
+    at_sink_write(sink, buffer, n);
   fclose(tmpfile);
 
 remove_tmp_pstoedit:
@@ -206,12 +206,13 @@ int install_output_pstoedit_writers(void)
         continue;
       }
       if (!at_output_get_handler_by_suffix(dd_tmp->suffix))
-        at_output_add_handler_full(dd_tmp->suffix, dd_tmp->explanation, output_pstoedit_writer, 0,
-                                   g_strdup(dd_tmp->symbolicname), g_free);
+        at_output_add_sink_handler_full(dd_tmp->suffix, dd_tmp->explanation,
+                                        output_pstoedit_writer, 0, g_strdup(dd_tmp->symbolicname),
+                                        g_free);
       if (!at_output_get_handler_by_suffix(dd_tmp->symbolicname))
-        at_output_add_handler_full(dd_tmp->symbolicname, dd_tmp->explanation,
-                                   output_pstoedit_writer, 0, g_strdup(dd_tmp->symbolicname),
-                                   g_free);
+        at_output_add_sink_handler_full(dd_tmp->symbolicname, dd_tmp->explanation,
+                                        output_pstoedit_writer, 0, g_strdup(dd_tmp->symbolicname),
+                                        g_free);
       dd_tmp = dd_next(dd_tmp);
     }
   }
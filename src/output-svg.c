@@ -13,60 +13,82 @@
 #include "color.h"
 #include "output-svg.h"
 
-static void out_splines(FILE *file, spline_list_array_type shape, int height)
+/* Where a stream of spline lists has got to */
+typedef struct {
+  at_sink *file;
+  int height;
+  gboolean centerline;
+  unsigned n_lists;
+  gboolean last_open;
+  at_color last_color;
+} svg_state_type;
+
+gpointer output_svg_begin(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
+                          at_output_opts_type *opts, spline_list_array_type *shape,
+                          at_msg_func msg_func, gpointer msg_data, gpointer user_data)
 {
-  unsigned this_list;
-  spline_list_type list;
-  at_color last_color = {0, 0, 0};
+  svg_state_type *svg = g_new0(svg_state_type, 1);
+  int width = urx - llx;
+  int height = ury - lly;
 
-  for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH(shape); this_list++) {
-    unsigned this_spline;
-    spline_type first;
+  svg->file = file;
+  svg->height = height;
+  svg->centerline = shape->centerline;
+
+  at_sink_puts(file, "<?xml version=\"1.0\" standalone=\"yes\"?>\n");
+  at_sink_printf(file, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\">\n",
+                 width, height);
+  return svg;
+}
 
-    list = SPLINE_LIST_ARRAY_ELT(shape, this_list);
-    first = SPLINE_LIST_ELT(list, 0);
+void output_svg_list(gpointer state, spline_list_type *list)
+{
+  svg_state_type *svg = state;
+  at_sink *file = svg->file;
+  int height = svg->height;
+  unsigned this_spline;
+  spline_type first = SPLINE_LIST_ELT(*list, 0);
 
-    if (this_list == 0 || !at_color_equal(&list.color, &last_color)) {
-      if (this_list > 0) {
-        if (!(shape.centerline || list.open))
-          fputs("z", file);
-        fputs("\"/>\n", file);
-      }
-      fprintf(file, "<path style=\"%s:#%02x%02x%02x; %s:none;\" d=\"",
-              (shape.centerline || list.open) ? "stroke" : "fill", list.color.r, list.color.g,
-              list.color.b, (shape.centerline || list.open) ? "fill" : "stroke");
+  if (svg->n_lists == 0 || !at_color_equal(&list->color, &svg->last_color)) {
+    if (svg->n_lists > 0) {
+      if (!(svg->centerline || list->open))
+        at_sink_puts(file, "z");
+      at_sink_puts(file, "\"/>\n");
     }
-    fprintf(file, "M%g %g", START_POINT(first).x, height - START_POINT(first).y);
-    for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(list); this_spline++) {
-      spline_type s = SPLINE_LIST_ELT(list, this_spline);
+    at_sink_printf(file, "<path style=\"%s:#%02x%02x%02x; %s:none;\" d=\"",
+                   (svg->centerline || list->open) ? "stroke" : "fill", list->color.r,
+                   list->color.g, list->color.b,
+                   (svg->centerline || list->open) ? "fill" : "stroke");
+  }
+  at_sink_printf(file, "M%g %g", START_POINT(first).x, height - START_POINT(first).y);
+  for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(*list); this_spline++) {
+    spline_type s = SPLINE_LIST_ELT(*list, this_spline);
 
-      if (SPLINE_DEGREE(s) == LINEARTYPE) {
-        fprintf(file, "L%g %g", END_POINT(s).x, height - END_POINT(s).y);
-      } else {
-        fprintf(file, "C%g %g %g %g %g %g", CONTROL1(s).x, height - CONTROL1(s).y, CONTROL2(s).x,
-                height - CONTROL2(s).y, END_POINT(s).x, height - END_POINT(s).y);
-      }
-      last_color = list.color;
+    if (SPLINE_DEGREE(s) == LINEARTYPE) {
+      at_sink_printf(file, "L%g %g", END_POINT(s).x, height - END_POINT(s).y);
+    } else {
+      at_sink_printf(file, "C%g %g %g %g %g %g", CONTROL1(s).x, height - CONTROL1(s).y,
+                     CONTROL2(s).x, height - CONTROL2(s).y, END_POINT(s).x,
+                     height - END_POINT(s).y);
     }
+    svg->last_color = list->color;
   }
-  if (!(shape.centerline || list.open))
-    fputs("z", file);
-  if (SPLINE_LIST_ARRAY_LENGTH(shape) > 0)
-    fputs("\"/>\n", file);
+  svg->last_open = list->open;
+  svg->n_lists++;
 }
 
-int output_svg_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
-                      at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
-                      gpointer msg_data, gpointer user_data)
+int output_svg_end(gpointer state)
 {
-  int width = urx - llx;
-  int height = ury - lly;
-  fputs("<?xml version=\"1.0\" standalone=\"yes\"?>\n", file);
-  fprintf(file, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\">\n", width,
-          height);
+  svg_state_type *svg = state;
+  at_sink *file = svg->file;
 
-  out_splines(file, shape, height);
-  fputs("</svg>\n", file);
+  if (svg->n_lists > 0) {
+    if (!(svg->centerline || svg->last_open))
+      at_sink_puts(file, "z");
+    at_sink_puts(file, "\"/>\n");
+  }
+  at_sink_puts(file, "</svg>\n");
 
+  g_free(svg);
   return 0;
 }
@@ -13,8 +13,10 @@
 
 #include "output.h"
 
-int output_svg_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
-                      at_output_opts_type *opts, at_spline_list_array_type shape,
-                      at_msg_func msg_func, gpointer msg_data, gpointer user_data);
+gpointer output_svg_begin(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
+                          at_output_opts_type *opts, at_spline_list_array_type *shape,
+                          at_msg_func msg_func, gpointer msg_data, gpointer user_data);
+void output_svg_list(gpointer state, at_spline_list_type *list);
+int output_svg_end(gpointer state);
 
 #endif /* not OUTPUT_SVG_H */
@@ -18,7 +18,10 @@ long ugs_advance_width;
 long ugs_left_bearing, ugs_descend;
 long ugs_max_col, ugs_max_row;
 
-static long lowerx, upperx, lowery, uppery;
+/* Bounding box of the glyph, widened while the splines are written. */
+typedef struct {
+  long lowerx, upperx, lowery, uppery;
+} ugs_bbox_type;
 
 static int compute_determinant(double *det, double a, double b, double c, double d)
 {
@@ -104,11 +107,11 @@ static void cubic_to_quadratic(double ax, double ay, double bx, double by, doubl
 }
 
 #if CUBIC
-static void output_contour(FILE *file, FILE *tracer, unsigned height)
+static void output_contour(at_sink *file, FILE *tracer, unsigned height)
 {
   int x, lastx;
 
-  fprintf(file, "\tcontour\n");
+  at_sink_printf(file, "\tcontour\n");
   for (lastx = 0; (x = getc(tracer)) >= 0; lastx = x) {
     double x1, y1, x1a, y1a, x3a, y3a, x3, y3;
 
@@ -119,32 +122,33 @@ static void output_contour(FILE *file, FILE *tracer, unsigned height)
       FATAL("Autotrace format error");
     y1 = height - y1;
 
-    fprintf(file, "\t\tpath\n");
-    fprintf(file, "\t\t\tmove %g %g\n", x1, y1);
+    at_sink_printf(file, "\t\tpath\n");
+    at_sink_printf(file, "\t\t\tmove %g %g\n", x1, y1);
 
     while ((x = getc(tracer)) >= 0) {
       if (x == 'L') {
         if (fscanf(tracer, "%lg%lg", &x3, &y3) != 2)
           FATAL("Autotrace format error");
         y3 = height - y3;
-        fprintf(file, "\t\t\tline %g %g\n", x3, y3);
+        at_sink_printf(file, "\t\t\tline %g %g\n", x3, y3);
       } else if (x == 'C') {
         if (fscanf(tracer, "%lg%lg%lg%lg%lg%lg", &x1a, &y1a, &x3a, &y3a, &x3, &y3) != 6)
           FATAL("Autotrace format error");
         y1a = height - y1a;
         y3a = height - y3a;
         y3 = height - y3;
-        fprintf(file, "\t\t\tcurve %g %g %g %g %g %g\n", x1a, y1a, x3a, y3a, x3, y3);
+        at_sink_printf(file, "\t\t\tcurve %g %g %g %g %g %g\n", x1a, y1a, x3a, y3a, x3, y3);
       } else
         break;
     }
-    fprintf(file, "\t\tend path\n");
+    at_sink_printf(file, "\t\tend path\n");
   }
-  fprintf(file, "\tend contour\n");
+  at_sink_printf(file, "\tend contour\n");
 }
 #endif
 
-static void output_splines(FILE *file, spline_list_array_type shape, int height)
+static void output_splines(at_sink *file, ugs_bbox_type *bbox, spline_list_array_type shape,
+                           int height)
 {
   unsigned l, s;
   spline_list_type list;
@@ -152,7 +156,7 @@ static void output_splines(FILE *file, spline_list_array_type shape, int height)
   double x1, y1, x1a, y1a, x2, y2, x3a, y3a, x3, y3;
   int ix1, iy1, ix1a, iy1a, ix2, iy2, ix3a, iy3a, ix3, iy3;
 
-  fprintf(file, "\tcontour\n");
+  at_sink_printf(file, "\tcontour\n");
   for (l = 0; l < SPLINE_LIST_ARRAY_LENGTH(shape); l++) {
     list = SPLINE_LIST_ARRAY_ELT(shape, l);
     first = SPLINE_LIST_ELT(list, 0);
@@ -162,17 +166,17 @@ static void output_splines(FILE *file, spline_list_array_type shape, int height)
     ix1 = lround(x1);
     iy1 = lround(y1);
 
-    fprintf(file, "\t\tpath\n");
-    fprintf(file, "\t\t\tdot-on %d %d\n", ix1, iy1);
+    at_sink_printf(file, "\t\tpath\n");
+    at_sink_printf(file, "\t\t\tdot-on %d %d\n", ix1, iy1);
 
-    if (lowerx > ix1)
-      lowerx = ix1;
-    if (lowery > iy1)
-      lowery = iy1;
-    if (upperx < ix1)
-      upperx = ix1;
-    if (uppery < iy1)
-      uppery = iy1;
+    if (bbox->lowerx > ix1)
+      bbox->lowerx = ix1;
+    if (bbox->lowery > iy1)
+      bbox->lowery = iy1;
+    if (bbox->upperx < ix1)
+      bbox->upperx = ix1;
+    if (bbox->uppery < iy1)
+      bbox->uppery = iy1;
 
     for (s = 0; s < SPLINE_LIST_LENGTH(list); s++) {
       t = SPLINE_LIST_ELT(list, s);
@@ -184,16 +188,16 @@ static void output_splines(FILE *file, spline_list_array_type shape, int height)
         iy3 = lround(y3);
 
         if (!(ix3 == lround(x1) && iy3 == lround(y1)))
-          fprintf(file, "\t\t\tdot-on %d %d\n", ix3, iy3);
-
-        if (lowerx > ix3)
-          lowerx = ix3;
-        if (lowery > iy3)
-          lowery = iy3;
-        if (upperx < ix3)
-          upperx = ix3;
-        if (uppery < iy3)
-          uppery = iy3;
+          at_sink_printf(file, "\t\t\tdot-on %d %d\n", ix3, iy3);
+
+        if (bbox->lowerx > ix3)
+          bbox->lowerx = ix3;
+        if (bbox->lowery > iy3)
+          bbox->lowery = iy3;
+        if (bbox->upperx < ix3)
+          bbox->upperx = ix3;
+        if (bbox->uppery < iy3)
+          bbox->uppery = iy3;
       } else {
         x1a = CONTROL1(t).x + ugs_left_bearing;
         y1a = CONTROL1(t).y + ugs_descend;
@@ -213,81 +217,83 @@ static void output_splines(FILE *file, spline_list_array_type shape, int height)
         iy3a = lround(y3a);
 
         if (!(ix1a == lround(x1) && iy1a == lround(y1)) && !(ix1a == ix2 && iy1a == iy2))
-          fprintf(file, "\t\t\tdot-off %d %d\n", ix1a, iy1a);
+          at_sink_printf(file, "\t\t\tdot-off %d %d\n", ix1a, iy1a);
 
-        fprintf(file, "\t\t\tdot-on %d %d\n", ix2, iy2);
+        at_sink_printf(file, "\t\t\tdot-on %d %d\n", ix2, iy2);
 
         if (!(ix3a == ix2 && iy3a == iy2) && !(ix3a == ix3 && iy3a == iy3))
-          fprintf(file, "\t\t\tdot-off %d %d\n", ix3a, iy3a);
-
-        fprintf(file, "\t\t\tdot-on %d %d\n", ix3, iy3);
-
-        if (lowerx > ix1a)
-          lowerx = ix1a;
-        if (lowery > iy1a)
-          lowery = iy1a;
-        if (upperx < ix1a)
-          upperx = ix1a;
-        if (uppery < iy1a)
-          uppery = iy1a;
-
-        if (lowerx > ix2)
-          lowerx = ix2;
-        if (lowery > iy2)
-          lowery = iy2;
-        if (upperx < ix2)
-          upperx = ix2;
-        if (uppery < iy2)
-          uppery = iy2;
-
-        if (lowerx > ix3a)
-          lowerx = ix3a;
-        if (lowery > iy3a)
-          lowery = iy3a;
-        if (upperx < ix3a)
-          upperx = ix3a;
-        if (uppery < iy3a)
-          uppery = iy3a;
-
-        if (lowerx > ix3)
-          lowerx = ix3;
-        if (lowery > iy3)
-          lowery = iy3;
-        if (upperx < ix3)
-          upperx = ix3;
-        if (uppery < iy3)
-          uppery = iy3;
+          at_sink_printf(file, "\t\t\tdot-off %d %d\n", ix3a, iy3a);
+
+        at_sink_printf(file, "\t\t\tdot-on %d %d\n", ix3, iy3);
+
+        if (bbox->lowerx > ix1a)
+          bbox->lowerx = ix1a;
+        if (bbox->lowery > iy1a)
+          bbox->lowery = iy1a;
+        if (bbox->upperx < ix1a)
+          bbox->upperx = ix1a;
+        if (bbox->uppery < iy1a)
+          bbox->uppery = iy1a;
+
+        if (bbox->lowerx > ix2)
+          bbox->lowerx = ix2;
+        if (bbox->lowery > iy2)
+          bbox->lowery = iy2;
+        if (bbox->upperx < ix2)
+          bbox->upperx = ix2;
+        if (bbox->uppery < iy2)
+          bbox->uppery = iy2;
+
+        if (bbox->lowerx > ix3a)
+          bbox->lowerx = ix3a;
+        if (bbox->lowery > iy3a)
+          bbox->lowery = iy3a;
+        if (bbox->upperx < ix3a)
+          bbox->upperx = ix3a;
+        if (bbox->uppery < iy3a)
+          bbox->uppery = iy3a;
+
+        if (bbox->lowerx > ix3)
+          bbox->lowerx = ix3;
+        if (bbox->lowery > iy3)
+          bbox->lowery = iy3;
+        if (bbox->upperx < ix3)
+          bbox->upperx = ix3;
+        if (bbox->uppery < iy3)
+          bbox->uppery = iy3;
       }
       x1 = x3;
       y1 = y3;
     }
-    fprintf(file, "\t\tend path\n");
+    at_sink_printf(file, "\t\tend path\n");
   }
-  fprintf(file, "\tend contour\n");
+  at_sink_printf(file, "\tend contour\n");
 }
 
-int output_ugs_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_ugs_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, spline_list_array_type shape, at_msg_func msg_func,
                       gpointer msg_data, gpointer usar_data)
 {
+  ugs_bbox_type bbox;
+
   /* Write the header.  */
-  fprintf(file, "symbol %#lx design-size %ld\n", ugs_charcode, ugs_design_pixels);
-  fprintf(file, "\tadvance-width %ld\n", ugs_advance_width);
+  at_sink_printf(file, "symbol %#lx design-size %ld\n", ugs_charcode, ugs_design_pixels);
+  at_sink_printf(file, "\tadvance-width %ld\n", ugs_advance_width);
 
-  upperx = ugs_advance_width - ugs_max_col - 1;
-  uppery = ugs_max_row;
+  bbox.upperx = ugs_advance_width - ugs_max_col - 1;
+  bbox.uppery = ugs_max_row;
 
-  lowerx = ugs_left_bearing;
-  lowery = ugs_descend;
+  bbox.lowerx = ugs_left_bearing;
+  bbox.lowery = ugs_descend;
 
-  output_splines(file, shape, ury - lly);
+  output_splines(file, &bbox, shape, ury - lly);
 
-  fprintf(file, "\tleft-bearing %ld\n", lowerx);
-  fprintf(file, "\tright-bearing %ld\n", ugs_advance_width - upperx - 1);
-  fprintf(file, "\tascend %ld\n", uppery + 1);
-  fprintf(file, "\tdescend %ld\n", lowery);
+  at_sink_printf(file, "\tleft-bearing %ld\n", bbox.lowerx);
+  at_sink_printf(file, "\tright-bearing %ld\n", ugs_advance_width - bbox.upperx - 1);
+  at_sink_printf(file, "\tascend %ld\n", bbox.uppery + 1);
+  at_sink_printf(file, "\tdescend %ld\n", bbox.lowery);
 
   /* Write the trailer.  */
-  fputs("end symbol\n\n", file);
+  at_sink_puts(file, "end symbol\n\n");
   return 0;
 }
@@ -15,7 +15,7 @@
 
 #include "output.h"
 
-int output_ugs_writer(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+int output_ugs_writer(at_sink *file, gchar *name, int llx, int lly, int urx, int ury,
                       at_output_opts_type *opts, at_spline_list_array_type shape,
                       at_msg_func msg_func, gpointer msg_data, gpointer user_data);
 
@@ -33,6 +33,8 @@ static at_output_format_entry *at_output_format_new(const char *descr, at_output
                                                     gpointer user_data,
                                                     GDestroyNotify user_data_destroy_func);
 static void at_output_format_free(at_output_format_entry *entry);
+static int at_output_add_entry(const gchar *suffix, at_output_format_entry *entry,
+                               gboolean override);
 
 /*
  * Helper functions
@@ -61,7 +63,11 @@ static at_output_format_entry *at_output_format_new(const gchar *descr, at_outpu
   entry = g_malloc(sizeof(at_output_format_entry));
   if (entry) {
     entry->writer.func = writer;
+    entry->writer.sink_func = NULL;
     entry->writer.data = user_data;
+    entry->writer.begin = NULL;
+    entry->writer.list = NULL;
+    entry->writer.end = NULL;
     entry->descr = g_strdup(descr);
     entry->user_data_destroy_func = user_data_destroy_func;
   }
@@ -85,31 +91,82 @@ int at_output_add_handler_full(const gchar *suffix, const gchar *description, at
                                gboolean override, gpointer user_data,
                                GDestroyNotify user_data_destroy_func)
 {
-  gchar *gsuffix;
-  const gchar *gdescription;
-  at_output_format_entry *old_entry;
   at_output_format_entry *new_entry;
 
   g_return_val_if_fail(suffix, 0);
   g_return_val_if_fail(description, 0);
   g_return_val_if_fail(writer, 0);
 
+  new_entry = at_output_format_new(description, writer, user_data, user_data_destroy_func);
+  g_return_val_if_fail(new_entry, 0);
+
+  return at_output_add_entry(suffix, new_entry, override);
+}
+
+int at_output_add_sink_handler(const gchar *suffix, const gchar *description,
+                               at_output_sink_func writer)
+{
+  return at_output_add_sink_handler_full(suffix, description, writer, 0, NULL, NULL);
+}
+
+int at_output_add_sink_handler_full(const gchar *suffix, const gchar *description,
+                                    at_output_sink_func writer, gboolean override,
+                                    gpointer user_data, GDestroyNotify user_data_destroy_func)
+{
+  at_output_format_entry *new_entry;
+
+  g_return_val_if_fail(suffix, 0);
+  g_return_val_if_fail(description, 0);
+  g_return_val_if_fail(writer, 0);
+
+  new_entry = at_output_format_new(description, NULL, user_data, user_data_destroy_func);
+  g_return_val_if_fail(new_entry, 0);
+  new_entry->writer.sink_func = writer;
+
+  return at_output_add_entry(suffix, new_entry, override);
+}
+
+int at_output_add_stream_handler(const gchar *suffix, const gchar *description,
+                                 at_output_begin_func begin, at_output_list_func list,
+                                 at_output_end_func end)
+{
+  at_output_format_entry *new_entry;
+
+  g_return_val_if_fail(suffix, 0);
+  g_return_val_if_fail(description, 0);
+  g_return_val_if_fail(begin && list && end, 0);
+
+  new_entry = at_output_format_new(description, NULL, NULL, NULL);
+  g_return_val_if_fail(new_entry, 0);
+  new_entry->writer.begin = begin;
+  new_entry->writer.list = list;
+  new_entry->writer.end = end;
+
+  return at_output_add_entry(suffix, new_entry, FALSE);
+}
+
+/* Register ENTRY for SUFFIX, unless SUFFIX has a writer already and
+   OVERRIDE is false, in which case ENTRY is freed.  */
+static int at_output_add_entry(const gchar *suffix, at_output_format_entry *entry,
+                               gboolean override)
+{
+  gchar *gsuffix;
+  at_output_format_entry *old_entry;
+
   g_autofree gchar *gsuffix_raw = g_strdup((gchar *)suffix);
   g_return_val_if_fail(gsuffix_raw, 0);
   gsuffix = g_ascii_strdown(gsuffix_raw, strlen(gsuffix_raw));
 
-  gdescription = (const gchar *)description;
-
   old_entry = g_hash_table_lookup(at_output_formats, gsuffix);
   if (old_entry && !override) {
     g_free(gsuffix);
+    /* The user data stays with the caller, as it was not taken */
+    entry->user_data_destroy_func = NULL;
+    at_output_format_free(entry);
     return 1;
   }
 
-  new_entry = at_output_format_new(gdescription, writer, user_data, user_data_destroy_func);
-  g_return_val_if_fail(new_entry, 0);
-
-  g_hash_table_replace(at_output_formats, gsuffix, new_entry);
+  g_hash_table_replace(at_output_formats, gsuffix, entry);
   return 1;
 }
 
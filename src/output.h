@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include "autotrace.h"
 #include "exception.h"
+#include "sink.h"
 #include <glib.h>
 
 #ifdef __cplusplus
@@ -31,6 +32,44 @@ extern int at_output_add_handler_full(const gchar *suffix, const gchar *descript
                                       at_output_func writer, gboolean override, gpointer user_data,
                                       GDestroyNotify user_data_destroy_func);
 
+/* A writer that puts its output in a sink rather than in a FILE, which
+   lets it write to memory as well as to a file.  Writers registered
+   with at_output_add_handler are still given a FILE; for a sink with
+   no FILE of its own, that is a temporary file, copied to the sink
+   once they are done.  */
+typedef int (*at_output_sink_func)(at_sink *sink, gchar *name, int llx, int lly, int urx, int ury,
+                                   at_output_opts_type *opts, at_splines_type shape,
+                                   at_msg_func msg_func, gpointer msg_data, gpointer user_data);
+
+extern int at_output_add_sink_handler(const gchar *suffix, const gchar *description,
+                                      at_output_sink_func writer);
+
+extern int at_output_add_sink_handler_full(const gchar *suffix, const gchar *description,
+                                           at_output_sink_func writer, gboolean override,
+                                           gpointer user_data,
+                                           GDestroyNotify user_data_destroy_func);
+
+/* Streaming writers are handed the spline lists one at a time, which
+   lets at_splines_new_write pass each list on as soon as it is fitted.
+
+   BEGIN is called first.  SHAPE has everything set but the spline
+   lists, which it has none of.  BEGIN returns the state given to the
+   other two, or NULL if it cannot write at all, in which case neither
+   of them is called.  LIST is then called with each spline list in turn; the
+   list is only valid during the call.  END is called last, also when
+   tracing stopped halfway; it releases the state and returns what an
+   at_output_func would.  */
+typedef gpointer (*at_output_begin_func)(at_sink *sink, gchar *name, int llx, int lly, int urx,
+                                         int ury, at_output_opts_type *opts,
+                                         at_splines_type *shape, at_msg_func msg_func,
+                                         gpointer msg_data, gpointer user_data);
+typedef void (*at_output_list_func)(gpointer state, at_spline_list_type *list);
+typedef int (*at_output_end_func)(gpointer state);
+
+extern int at_output_add_stream_handler(const gchar *suffix, const gchar *description,
+                                        at_output_begin_func begin, at_output_list_func list,
+                                        at_output_end_func end);
+
 /* Data struct hierarchy:
    spline_list_array (splines)
    -> spline_list...
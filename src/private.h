@@ -16,12 +16,20 @@
 
 struct _at_bitmap_reader {
   at_input_func func;
+  /* NULL if the handler only reads files */
+  at_input_memory_func memory_func;
   gpointer data;
 };
 
 struct _at_spline_writer {
   at_output_func func;
+  /* Set instead of FUNC for writers to a sink */
+  at_output_sink_func sink_func;
   gpointer data;
+  /* Set instead of FUNC for streaming writers */
+  at_output_begin_func begin;
+  at_output_list_func list;
+  at_output_end_func end;
 };
 
 int at_input_init(void);
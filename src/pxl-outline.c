@@ -13,11 +13,13 @@
 /* pxl-outline.c: find the outlines of a bitmap image; each outline is made up of one or more
    pixels; and each pixel participates via one or more edges. */
 
+#include "arena.h"
 #include "autotrace.h"
 #include "color.h"
 #include "input.h"
 #include "logreport.h"
 #include "pxl-outline.h"
+#include "tracer.h"
 #include "types.h"
 #include <stdio.h>
 
@@ -59,126 +61,283 @@ typedef enum {
 
 #define COMPUTE_COL_DELTA(dir) ((dir) == WEST ? -1 : (dir) == EAST ? +1 : 0)
 
-static pixel_outline_type find_one_outline(at_bitmap *, edge_type, unsigned short, unsigned short,
-                                           at_bitmap *, gboolean, gboolean, at_exception_type *);
-static pixel_outline_type find_one_centerline(at_bitmap *, direction_type, unsigned short,
-                                              unsigned short, at_bitmap *);
-static void append_pixel_outline(pixel_outline_list_type *, pixel_outline_type);
+static pixel_outline_type find_one_outline(at_bitmap *, edge_type, unsigned, unsigned,
+                                           at_bitmap *, gboolean, gboolean, arena_type *,
+                                           at_exception_type *);
+static pixel_outline_type find_one_centerline(at_bitmap *, direction_type, unsigned, unsigned,
+                                              at_bitmap *, arena_type *);
+static void append_pixel_outline(arena_type *, pixel_outline_list_type *, pixel_outline_type);
+static pixel_outline_list_type new_pixel_outline_list(void);
 static pixel_outline_type new_pixel_outline(void);
-static void free_pixel_outline(pixel_outline_type *);
-static void concat_pixel_outline(pixel_outline_type *, const pixel_outline_type *);
-static void append_outline_pixel(pixel_outline_type *, at_coord);
-static gboolean is_marked_edge(edge_type, unsigned short, unsigned short, at_bitmap *);
-static gboolean is_outline_edge(edge_type, at_bitmap *, unsigned short, unsigned short, at_color,
+static void concat_pixel_outline(arena_type *, pixel_outline_type *, const pixel_outline_type *);
+static void append_outline_pixel(arena_type *, pixel_outline_type *, at_coord);
+static gboolean is_marked_edge(edge_type, unsigned, unsigned, at_bitmap *);
+static gboolean is_outline_edge(edge_type, at_bitmap *, unsigned, unsigned, at_color,
                                 at_exception_type *);
-static gboolean is_unmarked_outline_edge(unsigned short, unsigned short, edge_type, at_bitmap *,
-                                         at_bitmap *, at_color, at_exception_type *);
 
-static void mark_edge(edge_type e, unsigned short, unsigned short, at_bitmap *);
+static void mark_edge(edge_type e, unsigned, unsigned, at_bitmap *);
 /* static edge_type opposite_edge(edge_type); */
 
-static gboolean is_marked_dir(unsigned short, unsigned short, direction_type, at_bitmap *);
-static gboolean is_other_dir_marked(unsigned short, unsigned short, direction_type, at_bitmap *);
-static void mark_dir(unsigned short, unsigned short, direction_type, at_bitmap *);
-static gboolean next_unmarked_pixel(unsigned short *, unsigned short *, direction_type *,
-                                    at_bitmap *, at_bitmap *);
+static gboolean is_marked_dir(unsigned, unsigned, direction_type, at_bitmap *);
+static gboolean is_other_dir_marked(unsigned, unsigned, direction_type, at_bitmap *);
+static void mark_dir(unsigned, unsigned, direction_type, at_bitmap *);
+static gboolean next_unmarked_pixel(unsigned *, unsigned *, direction_type *, at_bitmap *,
+                                    at_bitmap *);
 
-gboolean is_valid_dir(unsigned short, unsigned short, direction_type, at_bitmap *, at_bitmap *);
+gboolean is_valid_dir(unsigned, unsigned, direction_type, at_bitmap *, at_bitmap *);
 
-static at_coord next_point(at_bitmap *, edge_type *, unsigned short *, unsigned short *, at_color,
+static at_coord next_point(at_bitmap *, edge_type *, unsigned *, unsigned *, at_color,
                            gboolean, at_bitmap *, at_exception_type *);
-static unsigned num_neighbors(unsigned short, unsigned short, at_bitmap *);
+static unsigned num_neighbors(unsigned, unsigned, at_bitmap *);
 
 #define CHECK_FATAL()                                                                              \
   if (at_exception_got_fatal(exp))                                                                 \
     goto cleanup;
 
-/* We go through a bitmap TOP to BOTTOM, LEFT to RIGHT, looking for each pixel with an unmarked edge
-   that we consider a starting point of an outline. */
+/* Same as at_bitmap_equal_color, but cheap enough for the inner loops
+   of the outline tracer.  */
+static inline gboolean has_color(at_bitmap *bitmap, unsigned row, unsigned col,
+                                 const at_color *color)
+{
+  const unsigned char *p = AT_BITMAP_PIXEL(bitmap, row, col);
 
-pixel_outline_list_type find_outline_pixels(at_bitmap *bitmap, at_color *bg_color,
-                                            at_progress_func notify_progress,
-                                            gpointer progress_data, at_testcancel_func test_cancel,
-                                            gpointer testcancel_data, at_exception_type *exp)
+  if (AT_BITMAP_PLANES(bitmap) >= 3)
+    return (gboolean)(p[0] == color->r && p[1] == color->g && p[2] == color->b);
+  return (gboolean)(p[0] == color->r && p[0] == color->g && p[0] == color->b);
+}
+
+/* A pixel is a possible starting point of an outline when its TOP edge,
+   or the BOTTOM edge of the pixel above it, is an outline edge.  Whether
+   that edge is still unmarked can only be told while tracing, but the
+   test against the bitmap can be done for the whole image up front, and
+   in parallel.  */
+
+#define START_TOP 1        /* TOP edge of [ROW,COL] is an outline edge */
+#define START_BOTTOM 2     /* BOTTOM edge of [ROW-1,COL] is an outline edge */
+#define START_BACKGROUND 4 /* [ROW,COL] has the background color */
+
+typedef struct {
+  unsigned row, col;
+  unsigned char flags;
+} outline_start_type;
+
+/* A band of rows scanned for starting points by one worker.  */
+typedef struct {
+  at_bitmap *bitmap;
+  at_color *bg_color;
+  unsigned first_row, end_row;
+  GArray *starts; /* of outline_start_type, in scan order */
+} outline_band_type;
+
+/* Bands smaller than this are not worth a thread.  */
+#define MIN_BAND_ROWS 64
+
+static unsigned char outline_start_flags(at_bitmap *bitmap, at_color *bg_color, unsigned row,
+                                         unsigned col)
 {
-  pixel_outline_list_type outline_list;
-  unsigned short row, col;
-  at_bitmap *marked = at_bitmap_new(AT_BITMAP_WIDTH(bitmap), AT_BITMAP_HEIGHT(bitmap), 1);
-  unsigned int max_progress = AT_BITMAP_HEIGHT(bitmap) * AT_BITMAP_WIDTH(bitmap);
+  unsigned char flags = 0;
+  at_color color, above;
 
-  O_LIST_LENGTH(outline_list) = 0;
-  outline_list.data = NULL;
+  at_bitmap_get_color(bitmap, row, col, &color);
+  if (bg_color && at_color_equal(&color, bg_color))
+    flags |= START_BACKGROUND;
+
+  /* A valid edge can be TOP for an outside outline. */
+  if (!(flags & START_BACKGROUND) &&
+      (row == 0 || !has_color(bitmap, row - 1, col, &color)))
+    flags |= START_TOP;
+
+  /* A valid edge can be BOTTOM for an inside outline. */
+  if (row != 0 && !has_color(bitmap, row - 1, col, &color)) {
+    at_bitmap_get_color(bitmap, row - 1, col, &above);
+    if (!(bg_color && at_color_equal(&above, bg_color)))
+      flags |= START_BOTTOM;
+  }
+  return flags;
+}
 
-  for (row = 0; row < AT_BITMAP_HEIGHT(bitmap); row++) {
-    for (col = 0; col < AT_BITMAP_WIDTH(bitmap); col++) {
-      edge_type edge;
-      at_color color;
-      gboolean is_background;
+/* Trace the outlines starting at ROW/COL whose edges FLAGS says are
+   outline edges, unless they have been marked by an earlier outline. */
 
-      if (notify_progress)
-        notify_progress((gfloat)(row * AT_BITMAP_WIDTH(bitmap) + col) /
-                            ((gfloat)max_progress * (gfloat)3.0),
-                        progress_data);
+static void trace_outline_start(at_bitmap *bitmap, unsigned row, unsigned col, unsigned char flags,
+                                at_bitmap *marked, arena_type *arena,
+                                pixel_outline_list_type *outline_list, at_exception_type *exp)
+{
+  pixel_outline_type outline;
 
-      /* A valid edge can be TOP for an outside outline.
-         Outside outlines are traced counterclockwise */
-      at_bitmap_get_color(bitmap, row, col, &color);
-      if (!(is_background = (gboolean)(bg_color && at_color_equal(&color, bg_color))) &&
-          is_unmarked_outline_edge(row, col, edge = TOP, bitmap, marked, color, exp)) {
-        pixel_outline_type outline;
+  /* Outside outlines are traced counterclockwise */
+  if ((flags & START_TOP) && !is_marked_edge(TOP, row, col, marked)) {
+    LOG("#%u: (counterclockwise)", O_LIST_LENGTH(*outline_list));
 
-        CHECK_FATAL(); /* FREE(DONE) outline_list */
+    outline = find_one_outline(bitmap, TOP, row, col, marked, FALSE, FALSE, arena, exp);
+    if (at_exception_got_fatal(exp))
+      return;
 
-        LOG("#%u: (counterclockwise)", O_LIST_LENGTH(outline_list));
+    O_CLOCKWISE(outline) = FALSE;
+    append_pixel_outline(arena, outline_list, outline);
 
-        outline = find_one_outline(bitmap, edge, row, col, marked, FALSE, FALSE, exp);
-        CHECK_FATAL(); /* FREE(DONE) outline_list */
+    LOG(" [%u].\n", O_LENGTH(outline));
+  }
 
-        O_CLOCKWISE(outline) = FALSE;
-        append_pixel_outline(&outline_list, outline);
+  /* Inside outlines are traced clockwise */
+  if ((flags & START_BOTTOM) && !is_marked_edge(BOTTOM, row - 1, col, marked)) {
+    /* This lines are for debugging only: */
+    if (flags & START_BACKGROUND) {
+      LOG("#%u: (clockwise)", O_LIST_LENGTH(*outline_list));
 
-        LOG(" [%u].\n", O_LENGTH(outline));
-      } else
-        CHECK_FATAL(); /* FREE(DONE) outline_list */
+      outline = find_one_outline(bitmap, BOTTOM, row - 1, col, marked, TRUE, FALSE, arena, exp);
+      if (at_exception_got_fatal(exp))
+        return;
 
-      /* A valid edge can be BOTTOM for an inside outline.
-         Inside outlines are traced clockwise */
-      if (row != 0) {
-        at_bitmap_get_color(bitmap, row - 1, col, &color);
-        if (!(bg_color && at_color_equal(&color, bg_color)) &&
-            is_unmarked_outline_edge(row - 1, col, edge = BOTTOM, bitmap, marked, color, exp)) {
-          pixel_outline_type outline;
+      O_CLOCKWISE(outline) = TRUE;
+      append_pixel_outline(arena, outline_list, outline);
 
-          CHECK_FATAL(); /* FREE(DONE) outline_list */
+      LOG(" [%u].\n", O_LENGTH(outline));
+    } else
+      find_one_outline(bitmap, BOTTOM, row - 1, col, marked, TRUE, TRUE, arena, exp);
+  }
+}
 
-          /* This lines are for debugging only: */
-          if (is_background) {
-            LOG("#%u: (clockwise)", O_LIST_LENGTH(outline_list));
+static void scan_band(gpointer data, gpointer user_data)
+{
+  outline_band_type *band = data;
+  unsigned row, col;
+
+  for (row = band->first_row; row < band->end_row; row++)
+    for (col = 0; col < AT_BITMAP_WIDTH(band->bitmap); col++) {
+      outline_start_type start;
+
+      start.flags = outline_start_flags(band->bitmap, band->bg_color, row, col);
+      if (start.flags & (START_TOP | START_BOTTOM)) {
+        start.row = row;
+        start.col = col;
+        g_array_append_val(band->starts, start);
+      }
+    }
+}
 
-            outline = find_one_outline(bitmap, edge, row - 1, col, marked, TRUE, FALSE, exp);
-            CHECK_FATAL(); /* FREE(DONE) outline_list */
+/* Scan the bitmap for starting points in N_BANDS horizontal bands on
+   N_THREADS threads.  The bands are returned in top to bottom order.  */
 
-            O_CLOCKWISE(outline) = TRUE;
-            append_pixel_outline(&outline_list, outline);
+static outline_band_type *scan_bands(at_bitmap *bitmap, at_color *bg_color, unsigned n_bands,
+                                     unsigned n_threads)
+{
+  outline_band_type *bands = g_new(outline_band_type, n_bands);
+  unsigned height = AT_BITMAP_HEIGHT(bitmap);
+  GThreadPool *workers = g_thread_pool_new(scan_band, NULL, n_threads, TRUE, NULL);
+  unsigned i;
+
+  for (i = 0; i < n_bands; i++) {
+    bands[i].bitmap = bitmap;
+    bands[i].bg_color = bg_color;
+    bands[i].first_row = (guint64)height * i / n_bands;
+    bands[i].end_row = (guint64)height * (i + 1) / n_bands;
+    bands[i].starts = g_array_new(FALSE, FALSE, sizeof(outline_start_type));
+    g_thread_pool_push(workers, &bands[i], NULL);
+  }
+  g_thread_pool_free(workers, FALSE, TRUE);
+  return bands;
+}
 
-            LOG(" [%u].\n", O_LENGTH(outline));
-          } else {
-            outline = find_one_outline(bitmap, edge, row - 1, col, marked, TRUE, TRUE, exp);
-            CHECK_FATAL(); /* FREE(DONE) outline_list */
-          }
-        } else
-          CHECK_FATAL(); /* FREE(DONE) outline_list */
+/* A bitmap the size of BITMAP with nothing marked on it, in a scratch
+   buffer of TRACER.  */
+static at_bitmap new_marked_bitmap(at_bitmap *bitmap, at_tracer *tracer)
+{
+  unsigned width = AT_BITMAP_WIDTH(bitmap), height = AT_BITMAP_HEIGHT(bitmap);
+  at_bitmap marked =
+    at_bitmap_init(tracer_scratch(tracer, SCRATCH_MARKED, (gsize)width * height, TRUE), width,
+                   height, 1);
+
+  marked.destroy = NULL;
+  return marked;
+}
+
+/* We go through a bitmap TOP to BOTTOM, LEFT to RIGHT, looking for each pixel with an unmarked edge
+   that we consider a starting point of an outline.
+
+   With N_THREADS other than 1 (0 meaning one per processor), large bitmaps
+   are first scanned for the possible starting points in bands, in
+   parallel.  The outlines are then still traced from those points in
+   the same order as before: which way an outline turns where two pixels
+   of its color touch only diagonally depends on the outlines traced
+   before it, so the result is the same as with the plain scan.  */
+
+pixel_outline_list_type find_outline_pixels(at_bitmap *bitmap, at_color *bg_color,
+                                            unsigned n_threads, at_progress_func notify_progress,
+                                            gpointer progress_data, at_testcancel_func test_cancel,
+                                            gpointer testcancel_data, at_tracer *tracer,
+                                            arena_type *arena, at_exception_type *exp)
+{
+  pixel_outline_list_type outline_list = new_pixel_outline_list();
+  unsigned row, col;
+  at_bitmap marked_bitmap = new_marked_bitmap(bitmap, tracer);
+  at_bitmap *marked = &marked_bitmap;
+  gfloat max_progress = (gfloat)AT_BITMAP_HEIGHT(bitmap) * AT_BITMAP_WIDTH(bitmap);
+  outline_band_type *bands = NULL;
+  unsigned n_bands = 0, band, i;
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors();
+  if (n_threads > 1 && AT_BITMAP_HEIGHT(bitmap) >= 2 * MIN_BAND_ROWS) {
+    /* A few bands per thread even out the load */
+    n_bands = MIN(4 * n_threads, AT_BITMAP_HEIGHT(bitmap) / MIN_BAND_ROWS);
+    bands = scan_bands(bitmap, bg_color, n_bands, n_threads);
+  }
+
+  if (bands) {
+    for (band = 0; band < n_bands; band++) {
+      GArray *starts = bands[band].starts;
+      for (i = 0; i < starts->len; i++) {
+        outline_start_type *start = &g_array_index(starts, outline_start_type, i);
+
+        if (notify_progress)
+          notify_progress(((gfloat)start->row * AT_BITMAP_WIDTH(bitmap) + start->col) /
+                              (max_progress * (gfloat)3.0),
+                          progress_data);
+
+        trace_outline_start(bitmap, start->row, start->col, start->flags, marked, arena,
+                            &outline_list, exp);
+        CHECK_FATAL();
+
+        if (test_cancel && test_cancel(testcancel_data)) {
+          outline_list = new_pixel_outline_list();
+          goto cleanup;
+        }
       }
+    }
+    goto cleanup;
+  }
+
+  for (row = 0; row < AT_BITMAP_HEIGHT(bitmap); row++) {
+    for (col = 0; col < AT_BITMAP_WIDTH(bitmap); col++) {
+      unsigned char flags;
+
+      if (notify_progress)
+        notify_progress(((gfloat)row * AT_BITMAP_WIDTH(bitmap) + col) /
+                            (max_progress * (gfloat)3.0),
+                        progress_data);
+
+      flags = outline_start_flags(bitmap, bg_color, row, col);
+      if (flags & (START_TOP | START_BOTTOM)) {
+        trace_outline_start(bitmap, row, col, flags, marked, arena, &outline_list, exp);
+        CHECK_FATAL();
+      }
+
       if (test_cancel && test_cancel(testcancel_data)) {
-        free_pixel_outline_list(&outline_list);
+        outline_list = new_pixel_outline_list();
         goto cleanup;
       }
     }
   }
 cleanup:
-  at_bitmap_free(marked);
+  if (bands) {
+    for (band = 0; band < n_bands; band++)
+      g_array_free(bands[band].starts, TRUE);
+    g_free(bands);
+  }
+  tracer_release(tracer, marked->bitmap);
   if (at_exception_got_fatal(exp))
-    free_pixel_outline_list(&outline_list);
+    outline_list = new_pixel_outline_list();
   return outline_list;
 }
 
@@ -187,12 +346,12 @@ cleanup:
    to the coordinate list. */
 
 static pixel_outline_type find_one_outline(at_bitmap *bitmap, edge_type original_edge,
-                                           unsigned short original_row, unsigned short original_col,
+                                           unsigned original_row, unsigned original_col,
                                            at_bitmap *marked, gboolean clockwise, gboolean ignore,
-                                           at_exception_type *exp)
+                                           arena_type *arena, at_exception_type *exp)
 {
   pixel_outline_type outline = {0};
-  unsigned short row = original_row, col = original_col;
+  unsigned row = original_row, col = original_col;
   edge_type edge = original_edge;
   at_coord pos;
 
@@ -207,8 +366,8 @@ static pixel_outline_type find_one_outline(at_bitmap *bitmap, edge_type original
   do {
     /* Put this edge into the output list */
     if (!ignore) {
-      LOG(" (%d,%d)", pos.x, pos.y);
-      append_outline_pixel(&outline, pos);
+      LOG(" (%u,%u)", pos.x, pos.y);
+      append_outline_pixel(arena, &outline, pos);
     }
 
     mark_edge(edge, row, col, marked);
@@ -217,12 +376,10 @@ static pixel_outline_type find_one_outline(at_bitmap *bitmap, edge_type original
   } while (edge != NO_EDGE);
 
 cleanup:
-  if (at_exception_got_fatal(exp))
-    free_pixel_outline(&outline);
   return outline;
 }
 
-gboolean is_valid_dir(unsigned short row, unsigned short col, direction_type dir, at_bitmap *bitmap,
+gboolean is_valid_dir(unsigned row, unsigned col, direction_type dir, at_bitmap *bitmap,
                       at_bitmap *marked)
 {
 
@@ -246,15 +403,14 @@ pixel_outline_list_type find_centerline_pixels(at_bitmap *bitmap, at_color bg_co
                                                at_progress_func notify_progress,
                                                gpointer progress_data,
                                                at_testcancel_func test_cancel,
-                                               gpointer testcancel_data, at_exception_type *exp)
+                                               gpointer testcancel_data, at_tracer *tracer,
+                                               arena_type *arena, at_exception_type *exp)
 {
-  pixel_outline_list_type outline_list;
+  pixel_outline_list_type outline_list = new_pixel_outline_list();
   unsigned int row, col;
-  at_bitmap *marked = at_bitmap_new(AT_BITMAP_WIDTH(bitmap), AT_BITMAP_HEIGHT(bitmap), 1);
-  unsigned int max_progress = AT_BITMAP_HEIGHT(bitmap) * AT_BITMAP_WIDTH(bitmap);
-
-  O_LIST_LENGTH(outline_list) = 0;
-  outline_list.data = NULL;
+  at_bitmap marked_bitmap = new_marked_bitmap(bitmap, tracer);
+  at_bitmap *marked = &marked_bitmap;
+  gfloat max_progress = (gfloat)AT_BITMAP_HEIGHT(bitmap) * AT_BITMAP_WIDTH(bitmap);
 
   for (row = 0; row < AT_BITMAP_HEIGHT(bitmap); row++) {
     for (col = 0; col < AT_BITMAP_WIDTH(bitmap);) {
@@ -263,8 +419,8 @@ pixel_outline_list_type find_centerline_pixels(at_bitmap *bitmap, at_color bg_co
       gboolean clockwise = FALSE;
 
       if (notify_progress)
-        notify_progress((gfloat)(row * AT_BITMAP_WIDTH(bitmap) + col) /
-                            ((gfloat)max_progress * (gfloat)3.0),
+        notify_progress(((gfloat)row * AT_BITMAP_WIDTH(bitmap) + col) /
+                            (max_progress * (gfloat)3.0),
                         progress_data);
 
       if (at_bitmap_equal_color(bitmap, row, col, &bg_color)) {
@@ -323,7 +479,7 @@ pixel_outline_list_type find_centerline_pixels(at_bitmap *bitmap, at_color bg_co
 
       LOG("#%u: (%sclockwise) ", O_LIST_LENGTH(outline_list), clockwise ? "" : "counter");
 
-      outline = find_one_centerline(bitmap, dir, row, col, marked);
+      outline = find_one_centerline(bitmap, dir, row, col, marked, arena);
 
       /* If the outline is open (i.e., we didn't return to the
          starting pixel), search from the starting pixel in the
@@ -371,10 +527,8 @@ pixel_outline_list_type find_centerline_pixels(at_bitmap *bitmap, at_color bg_co
           }
         }
         if (okay) {
-          partial_outline = find_one_centerline(bitmap, dir, row, col, marked);
-          concat_pixel_outline(&outline, &partial_outline);
-          if (partial_outline.data)
-            g_free(partial_outline.data);
+          partial_outline = find_one_centerline(bitmap, dir, row, col, marked, arena);
+          concat_pixel_outline(arena, &outline, &partial_outline);
         } else
           col++;
       }
@@ -385,31 +539,28 @@ pixel_outline_list_type find_centerline_pixels(at_bitmap *bitmap, at_color bg_co
          the order in which we look at the edges. */
       O_CLOCKWISE(outline) = clockwise;
       if (O_LENGTH(outline) > 1)
-        append_pixel_outline(&outline_list, outline);
+        append_pixel_outline(arena, &outline_list, outline);
       LOG("(%s)", (outline.open ? " open" : " closed"));
       LOG(" [%u].\n", O_LENGTH(outline));
-      if (O_LENGTH(outline) == 1)
-        free_pixel_outline(&outline);
     }
   }
   if (test_cancel && test_cancel(testcancel_data)) {
-    if (O_LIST_LENGTH(outline_list) != 0)
-      free_pixel_outline_list(&outline_list);
+    outline_list = new_pixel_outline_list();
     goto cleanup;
   }
 cleanup:
-  at_bitmap_free(marked);
+  tracer_release(tracer, marked->bitmap);
   return outline_list;
 }
 
 static pixel_outline_type find_one_centerline(at_bitmap *bitmap, direction_type search_dir,
-                                              unsigned short original_row,
-                                              unsigned short original_col, at_bitmap *marked)
+                                              unsigned original_row, unsigned original_col,
+                                              at_bitmap *marked, arena_type *arena)
 {
   pixel_outline_type outline = new_pixel_outline();
   direction_type original_dir = search_dir;
-  unsigned short row = original_row, col = original_col;
-  unsigned short prev_row, prev_col;
+  unsigned row = original_row, col = original_col;
+  unsigned prev_row, prev_col;
   at_coord pos;
 
   outline.open = FALSE;
@@ -420,8 +571,8 @@ static pixel_outline_type find_one_centerline(at_bitmap *bitmap, direction_type
      the coordinates won't be adjusted. */
   pos.x = col;
   pos.y = AT_BITMAP_HEIGHT(bitmap) - row - 1;
-  LOG(" (%d,%d)", pos.x, pos.y);
-  append_outline_pixel(&outline, pos);
+  LOG(" (%u,%u)", pos.x, pos.y);
+  append_outline_pixel(arena, &outline, pos);
 
   for (;;) {
     prev_row = row;
@@ -447,8 +598,8 @@ static pixel_outline_type find_one_centerline(at_bitmap *bitmap, direction_type
     /* Add the new pixel to the output list. */
     pos.x = col;
     pos.y = AT_BITMAP_HEIGHT(bitmap) - row - 1;
-    LOG(" (%d,%d)", pos.x, pos.y);
-    append_outline_pixel(&outline, pos);
+    LOG(" (%u,%u)", pos.x, pos.y);
+    append_outline_pixel(arena, &outline, pos);
   }
   mark_dir(original_row, original_col, original_dir, marked);
   return outline;
@@ -456,27 +607,26 @@ static pixel_outline_type find_one_centerline(at_bitmap *bitmap, direction_type
 
 /* Add an outline to an outline list. */
 
-static void append_pixel_outline(pixel_outline_list_type *outline_list, pixel_outline_type outline)
+static void append_pixel_outline(arena_type *arena, pixel_outline_list_type *outline_list,
+                                 pixel_outline_type outline)
 {
+  outline_list->data = arena_grow(arena, outline_list->data, &outline_list->capacity,
+                                  O_LIST_LENGTH(*outline_list) + 1, sizeof(pixel_outline_type));
   O_LIST_LENGTH(*outline_list)++;
-  outline_list->data =
-      g_realloc(outline_list->data, outline_list->length * sizeof(pixel_outline_type));
   O_LIST_OUTLINE(*outline_list, O_LIST_LENGTH(*outline_list) - 1) = outline;
 }
 
-/* Free the list of outline lists. */
+/* Return an empty list of outlines.  */
 
-void free_pixel_outline_list(pixel_outline_list_type *outline_list)
+static pixel_outline_list_type new_pixel_outline_list(void)
 {
-  unsigned this_outline;
+  pixel_outline_list_type outline_list;
 
-  for (this_outline = 0; this_outline < outline_list->length; this_outline++) {
-    pixel_outline_type o = outline_list->data[this_outline];
-    free_pixel_outline(&o);
-  }
-  g_free(outline_list->data);
-  outline_list->data = NULL;
-  outline_list->length = 0;
+  O_LIST_LENGTH(outline_list) = 0;
+  outline_list.capacity = 0;
+  outline_list.data = NULL;
+
+  return outline_list;
 }
 
 /* Return an empty list of pixels.  */
@@ -486,23 +636,18 @@ static pixel_outline_type new_pixel_outline(void)
   pixel_outline_type pixel_outline;
 
   O_LENGTH(pixel_outline) = 0;
+  pixel_outline.capacity = 0;
   pixel_outline.data = NULL;
   pixel_outline.open = FALSE;
 
   return pixel_outline;
 }
 
-static void free_pixel_outline(pixel_outline_type *outline)
-{
-  g_free(outline->data);
-  outline->data = NULL;
-  outline->length = 0;
-}
-
 /* Concatenate two pixel lists. The two lists are assumed to have the
    same starting pixel and to proceed in opposite directions therefrom. */
 
-static void concat_pixel_outline(pixel_outline_type *o1, const pixel_outline_type *o2)
+static void concat_pixel_outline(arena_type *arena, pixel_outline_type *o1,
+                                 const pixel_outline_type *o2)
 {
   int src, dst;
   unsigned o1_length, o2_length;
@@ -514,7 +659,7 @@ static void concat_pixel_outline(pixel_outline_type *o1, const pixel_outline_typ
   O_LENGTH(*o1) += o2_length - 1;
   /* Resize o1 to the sum of the lengths of o1 and o2 minus one (because
      the two lists are assumed to share the same starting pixel). */
-  o1->data = g_realloc(o1->data, O_LENGTH(*o1) * sizeof(at_coord));
+  o1->data = arena_grow(arena, o1->data, &o1->capacity, O_LENGTH(*o1), sizeof(at_coord));
   /* Shift the contents of o1 to the end of the new array to make room
      to prepend o2. */
   for (src = o1_length - 1, dst = O_LENGTH(*o1) - 1; src >= 0; src--, dst--)
@@ -526,46 +671,36 @@ static void concat_pixel_outline(pixel_outline_type *o1, const pixel_outline_typ
 
 /* Add a point to the pixel list. */
 
-static void append_outline_pixel(pixel_outline_type *o, at_coord c)
+static void append_outline_pixel(arena_type *arena, pixel_outline_type *o, at_coord c)
 {
+  o->data = arena_grow(arena, o->data, &o->capacity, O_LENGTH(*o) + 1, sizeof(at_coord));
   O_LENGTH(*o)++;
-  o->data = g_realloc(o->data, O_LENGTH(*o) * sizeof(at_coord));
   O_COORDINATE(*o, O_LENGTH(*o) - 1) = c;
 }
 
-/* Is this really an edge and is it still unmarked? */
-
-static gboolean is_unmarked_outline_edge(unsigned short row, unsigned short col, edge_type edge,
-                                         at_bitmap *bitmap, at_bitmap *marked, at_color color,
-                                         at_exception_type *exp)
-{
-  return (gboolean)(!is_marked_edge(edge, row, col, marked) &&
-                    is_outline_edge(edge, bitmap, row, col, color, exp));
-}
-
 /* We check to see if the edge of the pixel at position ROW and COL
    is an outline edge */
 
-static gboolean is_outline_edge(edge_type edge, at_bitmap *bitmap, unsigned short row,
-                                unsigned short col, at_color color, at_exception_type *exp)
+static gboolean is_outline_edge(edge_type edge, at_bitmap *bitmap, unsigned row, unsigned col,
+                                at_color color, at_exception_type *exp)
 {
   /* If this pixel isn't of the same color, it's not part of the outline. */
-  if (!at_bitmap_equal_color(bitmap, row, col, &color))
+  if (!has_color(bitmap, row, col, &color))
     return FALSE;
 
   switch (edge) {
   case LEFT:
-    return (gboolean)(col == 0 || !at_bitmap_equal_color(bitmap, row, col - 1, &color));
+    return (gboolean)(col == 0 || !has_color(bitmap, row, col - 1, &color));
   case TOP:
-    return (gboolean)(row == 0 || !at_bitmap_equal_color(bitmap, row - 1, col, &color));
+    return (gboolean)(row == 0 || !has_color(bitmap, row - 1, col, &color));
 
   case RIGHT:
     return (gboolean)(col == AT_BITMAP_WIDTH(bitmap) - 1 ||
-                      !at_bitmap_equal_color(bitmap, row, col + 1, &color));
+                      !has_color(bitmap, row, col + 1, &color));
 
   case BOTTOM:
     return (gboolean)(row == AT_BITMAP_HEIGHT(bitmap) - 1 ||
-                      !at_bitmap_equal_color(bitmap, row + 1, col, &color));
+                      !has_color(bitmap, row + 1, col, &color));
 
   case NO_EDGE:
     g_assert_not_reached();
@@ -579,37 +714,36 @@ static gboolean is_outline_edge(edge_type edge, at_bitmap *bitmap, unsigned shor
    The position ROW and COL should be inside the bitmap MARKED. EDGE can be
    NO_EDGE. */
 
-static void mark_edge(edge_type edge, unsigned short row, unsigned short col, at_bitmap *marked)
+static void mark_edge(edge_type edge, unsigned row, unsigned col, at_bitmap *marked)
 {
   *AT_BITMAP_PIXEL(marked, row, col) |= 1 << edge;
 }
 
 /* Mark the direction of the pixel ROW/COL in MARKED. */
 
-static void mark_dir(unsigned short row, unsigned short col, direction_type dir, at_bitmap *marked)
+static void mark_dir(unsigned row, unsigned col, direction_type dir, at_bitmap *marked)
 {
   *AT_BITMAP_PIXEL(marked, row, col) |= 1 << dir;
 }
 
 /* Test if the direction of pixel at ROW/COL in MARKED is marked. */
 
-static gboolean is_marked_dir(unsigned short row, unsigned short col, direction_type dir,
-                              at_bitmap *marked)
+static gboolean is_marked_dir(unsigned row, unsigned col, direction_type dir, at_bitmap *marked)
 {
   return (gboolean)((*AT_BITMAP_PIXEL(marked, row, col) & 1 << dir) != 0);
 }
 
-static gboolean is_other_dir_marked(unsigned short row, unsigned short col, direction_type dir,
+static gboolean is_other_dir_marked(unsigned row, unsigned col, direction_type dir,
                                     at_bitmap *marked)
 {
   return (gboolean)((*AT_BITMAP_PIXEL(marked, row, col) &
                      (255 - (1 << dir) - (1 << ((dir + 4) % 8)))) != 0);
 }
 
-static gboolean next_unmarked_pixel(unsigned short *row, unsigned short *col, direction_type *dir,
+static gboolean next_unmarked_pixel(unsigned *row, unsigned *col, direction_type *dir,
                                     at_bitmap *bitmap, at_bitmap *marked)
 {
-  unsigned short orig_row = *row, orig_col = *col;
+  unsigned orig_row = *row, orig_col = *col;
   direction_type orig_dir = *dir, test_dir = *dir;
 
   do {
@@ -646,7 +780,7 @@ static gboolean next_unmarked_pixel(unsigned short *row, unsigned short *col, di
 
 /* Return the number of pixels adjacent to pixel ROW/COL that are black. */
 
-static unsigned num_neighbors(unsigned short row, unsigned short col, at_bitmap *bitmap)
+static unsigned num_neighbors(unsigned row, unsigned col, at_bitmap *bitmap)
 {
   unsigned dir, count = 0;
   at_color color;
@@ -666,16 +800,15 @@ static unsigned num_neighbors(unsigned short row, unsigned short col, at_bitmap
 
 /* Test if the edge EDGE at ROW/COL in MARKED is marked.  */
 
-static gboolean is_marked_edge(edge_type edge, unsigned short row, unsigned short col,
-                               at_bitmap *marked)
+static gboolean is_marked_edge(edge_type edge, unsigned row, unsigned col, at_bitmap *marked)
 {
   return (gboolean)(edge == NO_EDGE ? FALSE
                                     : (*AT_BITMAP_PIXEL(marked, row, col) & (1 << edge)) != 0);
 }
 
-static at_coord next_point(at_bitmap *bitmap, edge_type *edge, unsigned short *row,
-                           unsigned short *col, at_color color, gboolean clockwise,
-                           at_bitmap *marked, at_exception_type *exp)
+static at_coord next_point(at_bitmap *bitmap, edge_type *edge, unsigned *row, unsigned *col,
+                           at_color color, gboolean clockwise, at_bitmap *marked,
+                           at_exception_type *exp)
 {
   at_coord pos = {0, 0};
 
@@ -11,6 +11,7 @@
 #ifndef PXL_OUTLINE_H
 #define PXL_OUTLINE_H
 
+#include "arena.h"
 #include "autotrace.h"
 #include "exception.h"
 #include "color.h"
@@ -19,6 +20,7 @@
 typedef struct {
   at_coord *data;
   unsigned length;
+  unsigned capacity;
   gboolean clockwise;
   at_color color;
   gboolean open;
@@ -43,6 +45,7 @@ typedef struct {
 typedef struct {
   pixel_outline_type *data;
   unsigned length;
+  unsigned capacity;
 } pixel_outline_list_type;
 
 /* The Nth list in the list of lists.  */
@@ -51,19 +54,23 @@ typedef struct {
 /* The length of the list of lists.  */
 #define O_LIST_LENGTH(p_o_l) ((p_o_l).length)
 
-/* Find all pixels on the outline in the character C.  */
+/* Find all pixels on the outline in the character C.  N_THREADS threads
+   scan large bitmaps for outlines, 0 meaning one per processor.  The
+   list is allocated in ARENA; it is empty if the search is canceled or
+   fails.  The edges traced so far are marked in a scratch buffer of
+   TRACER, which may be NULL.  */
 extern pixel_outline_list_type
-find_outline_pixels(at_bitmap *bitmap, at_color *bg_color, at_progress_func notify_progress,
-                    gpointer progress_data, at_testcancel_func test_cancel,
-                    gpointer testcancel_data, at_exception_type *exp);
+find_outline_pixels(at_bitmap *bitmap, at_color *bg_color, unsigned n_threads,
+                    at_progress_func notify_progress, gpointer progress_data,
+                    at_testcancel_func test_cancel, gpointer testcancel_data, at_tracer *tracer,
+                    arena_type *arena, at_exception_type *exp);
 
-/* Find all pixels on the center line of the character C.  */
+/* Find all pixels on the center line of the character C, in the same
+   way.  */
 extern pixel_outline_list_type
 find_centerline_pixels(at_bitmap *bitmap, at_color bg_color, at_progress_func notify_progress,
                        gpointer progress_data, at_testcancel_func test_cancel,
-                       gpointer testcancel_data, at_exception_type *exp);
-
-/* Free the memory in the list.  */
-extern void free_pixel_outline_list(pixel_outline_list_type *);
+                       gpointer testcancel_data, at_tracer *tracer, arena_type *arena,
+                       at_exception_type *exp);
 
 #endif /* not PXL_OUTLINE_H */
@@ -36,10 +36,13 @@ typedef struct {
   at_color cmap[256];           /* colormap created by quantization */
   ColorFreq freq[256];
   Histogram histogram; /* holds the histogram */
+  at_tracer *tracer;   /* that lent the histogram, or NULL */
 } QuantizeObj;
 
+/* The histogram is taken from TRACER, which may be NULL; it is given
+   back by quantize_object_free.  */
 void quantize(at_bitmap *, long ncolors, const at_color *bgColor, QuantizeObj **,
-              at_exception_type *exp);
+              at_tracer *tracer, at_exception_type *exp);
 
 void quantize_object_free(QuantizeObj *obj);
 #endif /* NOT QUANTIZE_H */
@@ -0,0 +1,524 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* sink.c: FILE, buffer and callback sinks. */
+
+#include "sink.h"
+#include "format.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* What a FILE or a callback sink holds before handing it on */
+#define SINK_CHUNK 65536
+
+typedef enum { SINK_FILE, SINK_BUFFER, SINK_CALLBACK } sink_kind;
+
+struct _at_sink {
+  sink_kind kind;
+  FILE *file;
+  at_sink_func func;
+  gpointer user_data;
+  /* All the output of a buffer sink; what the other sinks have not
+     handed on yet.  Always followed by a 0.  */
+  guchar *data;
+  gsize length, allocated;
+  /* Bytes taken in all along */
+  gsize written;
+  gboolean failed;
+};
+
+static at_sink *sink_new(sink_kind kind)
+{
+  at_sink *sink = g_new0(at_sink, 1);
+
+  sink->kind = kind;
+  sink->allocated = kind == SINK_BUFFER ? 4096 : SINK_CHUNK;
+  sink->data = g_malloc(sink->allocated);
+  sink->data[0] = '\0';
+  return sink;
+}
+
+at_sink *at_sink_new_file(FILE *file)
+{
+  at_sink *sink;
+
+  g_return_val_if_fail(file, NULL);
+
+  sink = sink_new(SINK_FILE);
+  sink->file = file;
+  return sink;
+}
+
+at_sink *at_sink_new_buffer(void)
+{
+  return sink_new(SINK_BUFFER);
+}
+
+at_sink *at_sink_new_callback(at_sink_func func, gpointer user_data)
+{
+  at_sink *sink;
+
+  g_return_val_if_fail(func, NULL);
+
+  sink = sink_new(SINK_CALLBACK);
+  sink->func = func;
+  sink->user_data = user_data;
+  return sink;
+}
+
+/* Hand the SIZE bytes at DATA on to the FILE or the function of
+   SINK.  */
+static void sink_pass(at_sink *sink, gconstpointer data, gsize size)
+{
+  if (sink->kind == SINK_FILE) {
+    if (fwrite(data, 1, size, sink->file) != size)
+      sink->failed = TRUE;
+  } else if (!sink->func(data, size, sink->user_data))
+    sink->failed = TRUE;
+}
+
+/* Hand what a FILE or a callback sink holds on.  */
+static void sink_drain(at_sink *sink)
+{
+  if (sink->length > 0)
+    sink_pass(sink, sink->data, sink->length);
+  sink->length = 0;
+  sink->data[0] = '\0';
+}
+
+gboolean at_sink_flush(at_sink *sink)
+{
+  if (sink->failed)
+    return FALSE;
+  if (sink->kind != SINK_BUFFER)
+    sink_drain(sink);
+  if (sink->kind == SINK_FILE && !sink->failed && fflush(sink->file) != 0)
+    sink->failed = TRUE;
+  return !sink->failed;
+}
+
+void at_sink_free(at_sink *sink)
+{
+  if (!sink)
+    return;
+  if (sink->kind != SINK_BUFFER && !sink->failed)
+    sink_drain(sink);
+  g_free(sink->data);
+  g_free(sink);
+}
+
+const guchar *at_sink_get_data(at_sink *sink, gsize *size)
+{
+  if (sink->kind != SINK_BUFFER) {
+    *size = 0;
+    return NULL;
+  }
+  *size = sink->length;
+  return sink->data;
+}
+
+FILE *at_sink_get_file(at_sink *sink)
+{
+  return sink->file;
+}
+
+gsize at_sink_tell(at_sink *sink)
+{
+  return sink->written;
+}
+
+gboolean at_sink_failed(at_sink *sink)
+{
+  return sink->failed;
+}
+
+/* Make room for SIZE more bytes and the 0 after them, and return
+   where they go.  */
+static gchar *sink_reserve(at_sink *sink, gsize size)
+{
+  if (sink->allocated - sink->length <= size) {
+    while (sink->allocated - sink->length <= size)
+      sink->allocated *= 2;
+    sink->data = g_realloc(sink->data, sink->allocated);
+  }
+  return (gchar *)sink->data + sink->length;
+}
+
+/* Account for the SIZE bytes just put at the end of the data.  */
+static void sink_taken(at_sink *sink, gsize size)
+{
+  sink->length += size;
+  sink->data[sink->length] = '\0';
+  sink->written += size;
+  if (sink->kind != SINK_BUFFER && sink->length >= SINK_CHUNK)
+    sink_drain(sink);
+}
+
+gboolean at_sink_write(at_sink *sink, gconstpointer data, gsize size)
+{
+  if (sink->failed)
+    return FALSE;
+  if (sink->kind != SINK_BUFFER && size >= SINK_CHUNK) {
+    /* Large blocks go straight on, after what is held */
+    sink_drain(sink);
+    if (!sink->failed)
+      sink_pass(sink, data, size);
+    if (!sink->failed)
+      sink->written += size;
+    return !sink->failed;
+  }
+  memcpy(sink_reserve(sink, size), data, size);
+  sink_taken(sink, size);
+  return !sink->failed;
+}
+
+/* Append what printf makes of FORMAT, for the conversions that do
+   not depend on the locale.  */
+static void sink_append_printf(at_sink *sink, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+static void sink_append_printf(at_sink *sink, const gchar *format, ...)
+{
+  gsize room = sink->allocated - sink->length;
+  va_list args;
+  int n;
+
+  /* Most of the time the text fits in the room left, and is formatted
+     only once.  */
+  va_start(args, format);
+  n = g_vsnprintf(sink_reserve(sink, 0), room, format, args);
+  va_end(args);
+  if (n < 0) {
+    sink->failed = TRUE;
+    return;
+  }
+  if ((gsize)n >= room) {
+    va_start(args, format);
+    g_vsnprintf(sink_reserve(sink, n), n + 1, format, args);
+    va_end(args);
+  }
+  sink_taken(sink, n);
+}
+
+/* Append VALUE as g_ascii_formatd writes it with FORMAT.  */
+static void sink_append_real(at_sink *sink, const gchar *format, gdouble value)
+{
+  gsize room = 400, n;
+
+  /* The text might have been cut short if it fills the room */
+  for (;;) {
+    g_ascii_formatd(sink_reserve(sink, room), room, format, value);
+    n = strlen((gchar *)sink->data + sink->length);
+    if (n < room - 1)
+      break;
+    room *= 2;
+  }
+  sink_taken(sink, n);
+}
+
+/* Append VALUE as FORMAT, format_fixed or format_general, writes it
+   with PRECISION.  */
+static void sink_append_number(at_sink *sink, gsize (*format)(gchar *, gsize, gdouble, int),
+                               gdouble value, int precision)
+{
+  gsize n = format(sink_reserve(sink, 63), 64, value, precision);
+
+  if (n >= 64)
+    format(sink_reserve(sink, n), n + 1, value, precision);
+  sink_taken(sink, n);
+}
+
+/* What a conversion of at_sink_vprintf takes */
+typedef enum {
+  ARG_INT,
+  ARG_CHAR,
+  ARG_SHORT,
+  ARG_LONG,
+  ARG_LONG_LONG,
+  ARG_SIZE,
+  ARG_INTMAX,
+  ARG_PTRDIFF,
+  ARG_LONG_DOUBLE
+} arg_size;
+
+/* Put together in SPEC the conversion CONVERSION, with FLAGS, WIDTH
+   and PRECISION unless they are negative, for g_snprintf or
+   g_ascii_formatd.  Return SPEC.  */
+static const gchar *make_spec(gchar *spec, gsize size, const gchar *flags, int width,
+                              int precision, const gchar *conversion)
+{
+  gchar width_text[16] = "", precision_text[16] = "";
+
+  if (width >= 0)
+    g_snprintf(width_text, sizeof(width_text), "%d", width);
+  if (precision >= 0)
+    g_snprintf(precision_text, sizeof(precision_text), ".%d", precision);
+  g_snprintf(spec, size, "%%%s%s%s%s", flags, width_text, precision_text, conversion);
+  return spec;
+}
+
+/* printf, but for the numbers, which are written by format.c: most of
+   them much faster, and all of them as in the C locale.  */
+void at_sink_vprintf(at_sink *sink, const gchar *format, va_list args)
+{
+  const gchar *p = format, *literal;
+  /* The conversion, put back together for the cases left to
+     g_snprintf and g_ascii_formatd */
+  gchar spec[64], flags[8], conversion[4];
+  int width, precision, n_flags;
+  gboolean plain;
+  arg_size size;
+  gint64 integer;
+  guint64 natural;
+  gdouble real;
+  gchar c;
+
+  while (*p && !sink->failed) {
+    if (*p != '%') {
+      literal = p;
+      while (*p && *p != '%')
+        p++;
+      at_sink_write(sink, literal, p - literal);
+      continue;
+    }
+    p++;
+    if (*p == '%') {
+      at_sink_putc(sink, '%');
+      p++;
+      continue;
+    }
+
+    /* The ' flag groups the digits as the locale says, which the C
+       locale does not */
+    n_flags = 0;
+    while (*p && strchr("-+ #0'", *p)) {
+      if (*p != '\'' && n_flags < (int)sizeof(flags) - 2)
+        flags[n_flags++] = *p;
+      p++;
+    }
+
+    width = -1;
+    if (*p == '*') {
+      width = va_arg(args, int);
+      if (width < 0) {
+        width = -width;
+        flags[n_flags++] = '-';
+      }
+      p++;
+    } else if (g_ascii_isdigit(*p))
+      for (width = 0; g_ascii_isdigit(*p); p++)
+        width = width * 10 + (*p - '0');
+    flags[n_flags] = '\0';
+    plain = n_flags == 0 && width < 0;
+
+    precision = -1;
+    if (*p == '.') {
+      p++;
+      if (*p == '*') {
+        precision = va_arg(args, int);
+        p++;
+      } else
+        for (precision = 0; g_ascii_isdigit(*p); p++)
+          precision = precision * 10 + (*p - '0');
+    }
+
+    size = ARG_INT;
+    switch (*p) {
+    case 'h':
+      size = ARG_SHORT;
+      if (*++p == 'h') {
+        size = ARG_CHAR;
+        p++;
+      }
+      break;
+    case 'l':
+      size = ARG_LONG;
+      if (*++p == 'l') {
+        size = ARG_LONG_LONG;
+        p++;
+      }
+      break;
+    case 'q':
+      size = ARG_LONG_LONG;
+      p++;
+      break;
+    case 'z':
+      size = ARG_SIZE;
+      p++;
+      break;
+    case 'j':
+      size = ARG_INTMAX;
+      p++;
+      break;
+    case 't':
+      size = ARG_PTRDIFF;
+      p++;
+      break;
+    case 'L':
+      size = ARG_LONG_DOUBLE;
+      p++;
+      break;
+    }
+
+    c = *p++;
+    switch (c) {
+    case 'd':
+    case 'i':
+      switch (size) {
+      case ARG_CHAR:
+        integer = (signed char)va_arg(args, int);
+        break;
+      case ARG_SHORT:
+        integer = (short)va_arg(args, int);
+        break;
+      case ARG_LONG:
+        integer = va_arg(args, long);
+        break;
+      case ARG_LONG_LONG:
+        integer = va_arg(args, long long);
+        break;
+      case ARG_SIZE:
+        integer = va_arg(args, gssize);
+        break;
+      case ARG_INTMAX:
+        integer = va_arg(args, intmax_t);
+        break;
+      case ARG_PTRDIFF:
+        integer = va_arg(args, ptrdiff_t);
+        break;
+      default:
+        integer = va_arg(args, int);
+        break;
+      }
+      if (plain && precision < 0)
+        sink_taken(sink, format_integer(sink_reserve(sink, FORMAT_INTEGER_SIZE), integer));
+      else
+        sink_append_printf(sink, make_spec(spec, sizeof(spec), flags, width, precision, "lld"),
+                           (long long)integer);
+      break;
+
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      switch (size) {
+      case ARG_CHAR:
+        natural = (unsigned char)va_arg(args, unsigned);
+        break;
+      case ARG_SHORT:
+        natural = (unsigned short)va_arg(args, unsigned);
+        break;
+      case ARG_LONG:
+        natural = va_arg(args, unsigned long);
+        break;
+      case ARG_LONG_LONG:
+        natural = va_arg(args, unsigned long long);
+        break;
+      case ARG_SIZE:
+        natural = va_arg(args, gsize);
+        break;
+      case ARG_INTMAX:
+        natural = va_arg(args, uintmax_t);
+        break;
+      case ARG_PTRDIFF:
+        natural = va_arg(args, ptrdiff_t);
+        break;
+      default:
+        natural = va_arg(args, unsigned);
+        break;
+      }
+      if (c == 'u' && plain && precision < 0)
+        sink_taken(sink, format_unsigned(sink_reserve(sink, FORMAT_INTEGER_SIZE), natural));
+      else {
+        conversion[0] = 'l';
+        conversion[1] = 'l';
+        conversion[2] = c;
+        conversion[3] = '\0';
+        sink_append_printf(sink, make_spec(spec, sizeof(spec), flags, width, precision, conversion),
+                           (unsigned long long)natural);
+      }
+      break;
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      if (size == ARG_LONG_DOUBLE)
+        /* Written with the precision of a double */
+        real = va_arg(args, long double);
+      else
+        real = va_arg(args, double);
+      if (plain && c == 'f')
+        sink_append_number(sink, format_fixed, real, precision);
+      else if (plain && c == 'g')
+        sink_append_number(sink, format_general, real, precision);
+      else {
+        conversion[0] = c;
+        conversion[1] = '\0';
+        make_spec(spec, sizeof(spec), flags, width, precision, conversion);
+        if (c == 'a' || c == 'A')
+          sink_append_printf(sink, spec, real);
+        else
+          sink_append_real(sink, spec, real);
+      }
+      break;
+
+    case 'c':
+      if (plain)
+        at_sink_putc(sink, va_arg(args, int));
+      else
+        sink_append_printf(sink, make_spec(spec, sizeof(spec), flags, width, precision, "c"),
+                           va_arg(args, int));
+      break;
+
+    case 's':
+      if (plain && precision < 0) {
+        const gchar *string = va_arg(args, const gchar *);
+
+        at_sink_puts(sink, string ? string : "(null)");
+      } else
+        sink_append_printf(sink, make_spec(spec, sizeof(spec), flags, width, precision, "s"),
+                           va_arg(args, const gchar *));
+      break;
+
+    case 'p':
+      sink_append_printf(sink, make_spec(spec, sizeof(spec), flags, width, precision, "p"),
+                         va_arg(args, gpointer));
+      break;
+
+    default:
+      /* Not a conversion: nothing is taken for it */
+      g_warning("at_sink_vprintf: unknown conversion in \"%s\"", format);
+      if (c == '\0')
+        return;
+      break;
+    }
+  }
+}
+
+void at_sink_printf(at_sink *sink, const gchar *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  at_sink_vprintf(sink, format, args);
+  va_end(args);
+}
+
+void at_sink_puts(at_sink *sink, const gchar *string)
+{
+  at_sink_write(sink, string, strlen(string));
+}
+
+void at_sink_putc(at_sink *sink, int c)
+{
+  guchar byte = c;
+
+  at_sink_write(sink, &byte, 1);
+}
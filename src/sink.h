@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* sink.h: where the writers put their output. */
+
+#ifndef AT_SINK_H
+#define AT_SINK_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include "autotrace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* A sink takes the bytes of a writer in order, and only ever appends:
+   writers never seek back or read what they wrote.  There are three
+   kinds of sink:
+
+   - a FILE sink writes to a FILE opened by the caller, which is
+     closed by the caller, and flushed only by at_sink_flush,
+   - a buffer sink keeps everything in a block of memory that grows as
+     needed, for at_sink_get_data,
+   - a callback sink hands the bytes on to a function of the caller.
+
+   FILE and callback sinks hold the bytes until they have 64
+   kilobytes, and hand them on in one piece.
+
+   Once a write has failed, the sink drops everything written to it
+   after, and at_sink_failed returns TRUE.  A sink must not be used by
+   two threads at the same time.  */
+
+/* Called by a callback sink with the next SIZE bytes of output, which
+   are only valid during the call.  Return FALSE if they could not be
+   taken.  */
+typedef gboolean (*at_sink_func)(const guchar *data, gsize size, gpointer user_data);
+
+at_sink *at_sink_new_file(FILE *file);
+at_sink *at_sink_new_buffer(void);
+at_sink *at_sink_new_callback(at_sink_func func, gpointer user_data);
+
+/* Hand what a FILE or a callback sink still holds on, and flush the
+   FILE of a FILE sink.  Return FALSE if the sink has failed.  */
+gboolean at_sink_flush(at_sink *sink);
+
+/* Flush SINK and free it.  */
+void at_sink_free(at_sink *sink);
+
+/* The bytes written to a buffer sink so far, and their number in
+   *SIZE; NULL for other sinks.  The data belong to the sink and
+   are followed by a 0, which is not counted.  */
+const guchar *at_sink_get_data(at_sink *sink, gsize *size);
+
+/* The FILE of a FILE sink, or NULL.  Flush the sink before writing
+   to the FILE other than through it.  */
+FILE *at_sink_get_file(at_sink *sink);
+
+/* The number of bytes written to SINK so far, which is where the next
+   byte goes in the output.  */
+gsize at_sink_tell(at_sink *sink);
+
+gboolean at_sink_failed(at_sink *sink);
+
+/* Used by writers.  at_sink_printf takes the conversions of printf,
+   and writes numbers as in the C locale, whatever the locale of the
+   calling thread: the ' flag is ignored.  at_sink_write returns FALSE
+   if the sink has failed.  */
+gboolean at_sink_write(at_sink *sink, gconstpointer data, gsize size);
+void at_sink_printf(at_sink *sink, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+void at_sink_vprintf(at_sink *sink, const gchar *format, va_list args) G_GNUC_PRINTF(2, 0);
+void at_sink_puts(at_sink *sink, const gchar *string);
+void at_sink_putc(at_sink *sink, int c);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* Not def: AT_SINK_H */
@@ -10,6 +10,7 @@
 /* spline.c: spline and spline list (represented as arrays) manipulation. */
 
 #include "types.h"
+#include "array.h"
 #include "spline.h"
 #include "logreport.h"
 #include "vector.h"
@@ -105,11 +106,14 @@ void free_spline_list(spline_list_type spline_list)
 
 void append_spline(spline_list_type *l, spline_type s)
 {
+  unsigned capacity;
+
   assert(l != NULL);
 
+  capacity = array_implicit_capacity(SPLINE_LIST_LENGTH(*l));
+  SPLINE_LIST_DATA(*l) = array_grow(SPLINE_LIST_DATA(*l), &capacity, SPLINE_LIST_LENGTH(*l) + 1,
+                                    sizeof(spline_type));
   SPLINE_LIST_LENGTH(*l)++;
-  SPLINE_LIST_DATA(*l) =
-      g_realloc(SPLINE_LIST_DATA(*l), SPLINE_LIST_LENGTH(*l) * sizeof(spline_type));
   LAST_SPLINE_LIST_ELT(*l) = s;
 }
 
@@ -120,12 +124,15 @@ void concat_spline_lists(spline_list_type *s1, spline_list_type s2)
 {
   unsigned this_spline;
   unsigned new_length;
+  unsigned capacity;
 
   assert(s1 != NULL);
 
   new_length = SPLINE_LIST_LENGTH(*s1) + SPLINE_LIST_LENGTH(s2);
 
-  SPLINE_LIST_DATA(*s1) = g_realloc(SPLINE_LIST_DATA(*s1), new_length * sizeof(spline_type));
+  capacity = array_implicit_capacity(SPLINE_LIST_LENGTH(*s1));
+  SPLINE_LIST_DATA(*s1) =
+      array_grow(SPLINE_LIST_DATA(*s1), &capacity, new_length, sizeof(spline_type));
 
   for (this_spline = 0; this_spline < SPLINE_LIST_LENGTH(s2); this_spline++)
     SPLINE_LIST_ELT(*s1, SPLINE_LIST_LENGTH(*s1)++) = SPLINE_LIST_ELT(s2, this_spline);
@@ -159,8 +166,11 @@ void free_spline_list_array(spline_list_array_type *spline_list_array)
 
 void append_spline_list(spline_list_array_type *l, spline_list_type s)
 {
+  unsigned capacity = array_implicit_capacity(SPLINE_LIST_ARRAY_LENGTH(*l));
+
+  SPLINE_LIST_ARRAY_DATA(*l) =
+      array_grow(SPLINE_LIST_ARRAY_DATA(*l), &capacity, SPLINE_LIST_ARRAY_LENGTH(*l) + 1,
+                 sizeof(spline_list_type));
   SPLINE_LIST_ARRAY_LENGTH(*l)++;
-  SPLINE_LIST_ARRAY_DATA(*l) = g_realloc(SPLINE_LIST_ARRAY_DATA(*l),
-                                         SPLINE_LIST_ARRAY_LENGTH(*l) * sizeof(spline_list_type));
   LAST_SPLINE_LIST_ARRAY_ELT(*l) = s;
 }
@@ -41,7 +41,11 @@ extern at_real_coord evaluate_spline(spline_type spline, gfloat t);
 #endif
 
 /* Each outline in a character is typically represented by many
-   splines.  So, here is a list structure for that:  */
+   splines.  So, here is a list structure for that.  The structure has
+   no room to record the allocated size of `data', so the functions
+   below always allocate it in blocks of a power of two elements; a list
+   given to `append_spline' or `concat_spline_lists' must have been made
+   and grown by them.  */
 typedef at_spline_list_type spline_list_type;
 
 /* An empty list will have length zero (and null data).  */
@@ -76,6 +80,8 @@ extern void append_spline(spline_list_type *s_list, spline_type s);
 extern void concat_spline_lists(spline_list_type *s1, spline_list_type s2);
 #endif
 
+/* The same goes for the data of a `spline_list_array_type' given to
+   `append_spline_list'.  */
 typedef at_spline_list_array_type spline_list_array_type;
 
 /* Turns out we can use the same definitions for lists of lists as for
@@ -9,6 +9,7 @@
 
 #include "thin-image.h"
 #include "logreport.h"
+#include "tracer.h"
 #include <glib.h>
 #include <string.h>
 
@@ -17,8 +18,8 @@
 
 typedef unsigned char Pixel[3]; /* RGB pixel data type */
 
-void thin3(at_bitmap *image, Pixel colour);
-void thin1(at_bitmap *image, unsigned char colour);
+static void thin3(at_bitmap *image, Pixel colour, Pixel bg_color);
+static void thin1(at_bitmap *image, unsigned char colour, unsigned char bg_color);
 
 /* -------------------------------- ThinImage - Thin binary image. --------------------------- *
  *
@@ -63,9 +64,7 @@ static unsigned char todelete[512] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1,
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
 
-static at_color background = {0xff, 0xff, 0xff};
-
-void thin_image(at_bitmap *image, const at_color *bg, at_exception_type *exp)
+void thin_image(at_bitmap *image, const at_color *bg, at_tracer *tracer, at_exception_type *exp)
 {
   /* This is nasty as we need to call thin once for each
    * colour in the image the way I do this is to keep a second
@@ -74,9 +73,9 @@ void thin_image(at_bitmap *image, const at_color *bg, at_exception_type *exp)
    * trades time for pathological case memory.....*/
   long m, n, num_pixels;
   at_bitmap bm;
-  g_autofree unsigned char *bm_data = NULL; // Autofree pointer
   unsigned int spp = AT_BITMAP_PLANES(image), width = AT_BITMAP_WIDTH(image),
                height = AT_BITMAP_HEIGHT(image);
+  at_color background = {0xff, 0xff, 0xff};
 
   if (bg)
     background = *bg;
@@ -84,12 +83,13 @@ void thin_image(at_bitmap *image, const at_color *bg, at_exception_type *exp)
   bm.height = image->height;
   bm.width = image->width;
   bm.np = image->np;
-  bm_data = g_malloc((gsize)height * width * spp);
-  bm.bitmap = bm_data; // Point struct member to autofree'd memory
-  memcpy(bm.bitmap, image->bitmap, height * width * spp);
+  bm.stride = width * spp;
+  bm.destroy = NULL;
+  bm.bitmap = tracer_scratch(tracer, SCRATCH_THIN_COLORS, (gsize)height * width * spp, FALSE);
+  memcpy(bm.bitmap, image->bitmap, (gsize)height * width * spp);
   /* that clones the image */
 
-  num_pixels = height * width;
+  num_pixels = (long)height * width;
   switch (spp) {
   case 3: {
     Pixel *ptr = (Pixel *)AT_BITMAP_BITS(&bm);
@@ -109,7 +109,7 @@ void thin_image(at_bitmap *image, const at_color *bg, at_exception_type *exp)
           if (PIXEL_EQUAL(ptr[m], p))
             PIXEL_SET(ptr[m], bg_color);
         }
-        thin3(image, p);
+        thin3(image, p, bg_color);
       }
     }
     break;
@@ -131,7 +131,7 @@ void thin_image(at_bitmap *image, const at_color *bg, at_exception_type *exp)
         for (m = n - 1; m >= 0L; --m)
           if (ptr[m] == c)
             ptr[m] = bg_color;
-        thin1(image, c);
+        thin1(image, c, bg_color);
       }
     }
     break;
@@ -143,12 +143,12 @@ void thin_image(at_bitmap *image, const at_color *bg, at_exception_type *exp)
     break;
   }
   }
+  tracer_release(tracer, bm.bitmap);
 }
 
-void thin3(at_bitmap *image, Pixel colour)
+static void thin3(at_bitmap *image, Pixel colour, Pixel bg_color)
 {
   Pixel *ptr, *y_ptr, *y1_ptr;
-  Pixel bg_color;
   unsigned int xsize, ysize; /* Image resolution             */
   unsigned int x, y;         /* Pixel location               */
   unsigned int i;            /* Pass index           */
@@ -160,10 +160,6 @@ void thin3(at_bitmap *image, Pixel colour)
   /* scanline                     */
   unsigned int m; /* Deletion direction mask      */
 
-  bg_color[0] = background.r;
-  bg_color[1] = background.g;
-  bg_color[2] = background.b;
-
   LOG(" Thinning image.....\n ");
   xsize = AT_BITMAP_WIDTH(image);
   ysize = AT_BITMAP_HEIGHT(image);
@@ -216,7 +212,7 @@ void thin3(at_bitmap *image, Pixel colour)
         q = qb[0];
         p = ((q << 2) & 0330);
 
-        y_ptr = ptr + xsize * (ysize - 1);
+        y_ptr = ptr + (gsize)xsize * (ysize - 1);
         for (x = 0; x < xsize; x++) {
           q = qb[x];
           p = ((p << 1) & 0666) | ((q << 3) & 0110);
@@ -231,10 +227,9 @@ void thin3(at_bitmap *image, Pixel colour)
   }
 }
 
-void thin1(at_bitmap *image, unsigned char colour)
+static void thin1(at_bitmap *image, unsigned char colour, unsigned char bg_color)
 {
   unsigned char *ptr, *y_ptr, *y1_ptr;
-  unsigned char bg_color;
   unsigned int xsize, ysize; /* Image resolution             */
   unsigned int x, y;         /* Pixel location               */
   unsigned int i;            /* Pass index           */
@@ -246,11 +241,6 @@ void thin1(at_bitmap *image, unsigned char colour)
   /* scanline                     */
   unsigned int m; /* Deletion direction mask      */
 
-  if (background.r == background.g && background.g == background.b)
-    bg_color = background.r;
-  else
-    bg_color = at_color_luminance(&background);
-
   LOG(" Thinning image.....\n ");
   xsize = AT_BITMAP_WIDTH(image);
   ysize = AT_BITMAP_HEIGHT(image);
@@ -300,7 +290,7 @@ void thin1(at_bitmap *image, unsigned char colour)
       q = qb[0];
       p = ((q << 2) & 0330);
 
-      y_ptr = ptr + xsize * (ysize - 1);
+      y_ptr = ptr + (gsize)xsize * (ysize - 1);
       for (x = 0; x < xsize; x++) {
         q = qb[x];
         p = ((p << 1) & 0666) | ((q << 3) & 0110);
@@ -22,6 +22,10 @@
 #include "input.h"
 #include "exception.h"
 
-void thin_image(at_bitmap *image, const at_color *bg_color, at_exception_type *exp);
+/* Thin the lines of each color of IMAGE but BG_COLOR to one pixel.
+   A copy of IMAGE is kept in a scratch buffer of TRACER, which may be
+   NULL.  */
+void thin_image(at_bitmap *image, const at_color *bg_color, at_tracer *tracer,
+                at_exception_type *exp);
 
 #endif /* not THIN_IMAGE_H */
@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* trace-stats.c: timing the stages of a trace. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* Def: HAVE_CONFIG_H */
+
+#include "trace-stats.h"
+
+#include <time.h>
+#ifdef HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif /* Def: HAVE_GETRUSAGE */
+
+static const char *stage_names[AT_N_STAGES] = {
+    "despeckle", "quantize", "distance_map", "thin", "outlines", "split", "fit", "write",
+};
+
+const char *at_trace_stage_name(at_trace_stage stage)
+{
+  return (unsigned)stage < AT_N_STAGES ? stage_names[stage] : NULL;
+}
+
+/* Read the CPU time and the peak resident memory of the process.  */
+static void read_clocks(stage_mark_type *mark)
+{
+#ifdef HAVE_GETRUSAGE
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    mark->cpu = (gint64)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC +
+                usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#ifdef __APPLE__
+    mark->peak = usage.ru_maxrss;
+#else
+    /* Kilobytes everywhere else */
+    mark->peak = (guint64)usage.ru_maxrss * 1024;
+#endif /* Def: __APPLE__ */
+    return;
+  }
+#endif /* Def: HAVE_GETRUSAGE */
+  mark->cpu = (gint64)((double)clock() * G_USEC_PER_SEC / CLOCKS_PER_SEC);
+  mark->peak = 0;
+}
+
+void stage_begin(at_trace_stats *stats, stage_mark_type *mark)
+{
+  if (!stats)
+    return;
+  read_clocks(mark);
+  mark->wall = g_get_monotonic_time();
+}
+
+void stage_end(at_trace_stats *stats, at_trace_stage stage, stage_mark_type *mark)
+{
+  at_stage_stats *stage_stats;
+  stage_mark_type now;
+
+  if (!stats)
+    return;
+  now.wall = g_get_monotonic_time();
+  read_clocks(&now);
+  stage_stats = &stats->stages[stage];
+  stage_stats->run = TRUE;
+  stage_stats->wall_usec += now.wall - mark->wall;
+  stage_stats->cpu_usec += now.cpu - mark->cpu;
+  if (now.peak > mark->peak)
+    stage_stats->peak_bytes += now.peak - mark->peak;
+}
+
+void stage_exclude(at_trace_stats *stats, at_trace_stage outer, at_trace_stage inner)
+{
+  at_stage_stats *outer_stats, *inner_stats;
+
+  if (!stats)
+    return;
+  outer_stats = &stats->stages[outer];
+  inner_stats = &stats->stages[inner];
+  outer_stats->wall_usec -= MIN(inner_stats->wall_usec, outer_stats->wall_usec);
+  outer_stats->cpu_usec -= MIN(inner_stats->cpu_usec, outer_stats->cpu_usec);
+  outer_stats->peak_bytes -= MIN(inner_stats->peak_bytes, outer_stats->peak_bytes);
+}
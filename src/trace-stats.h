@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* trace-stats.h: timing the stages of a trace. */
+
+#ifndef TRACE_STATS_H
+#define TRACE_STATS_H
+
+#include <glib.h>
+#include "autotrace.h"
+
+/* Where the clocks stood when a stage began.  */
+typedef struct {
+  gint64 wall;
+  gint64 cpu;
+  guint64 peak;
+} stage_mark_type;
+
+/* Mark the beginning of a stage.  Nothing is done if STATS is NULL,
+   here and below.  */
+extern void stage_begin(at_trace_stats *stats, stage_mark_type *mark);
+
+/* Add what has been spent since MARK to STAGE of STATS.  */
+extern void stage_end(at_trace_stats *stats, at_trace_stage stage, stage_mark_type *mark);
+
+/* Take what STATS has so far for INNER, a stage that ran within
+   OUTER, out of OUTER.  */
+extern void stage_exclude(at_trace_stats *stats, at_trace_stage outer, at_trace_stage inner);
+
+#endif /* not TRACE_STATS_H */
@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* tracer.c: scratch buffers kept from one trace to the next. */
+
+#include "tracer.h"
+#include <string.h>
+
+at_tracer *at_tracer_new(void)
+{
+  return g_new0(at_tracer, 1);
+}
+
+void at_tracer_free(at_tracer *tracer)
+{
+  int id;
+
+  if (!tracer)
+    return;
+  for (id = 0; id < N_SCRATCH; id++)
+    g_free(tracer->scratch[id]);
+  g_free(tracer);
+}
+
+gpointer tracer_scratch(at_tracer *tracer, scratch_id id, gsize size, gboolean zero)
+{
+  if (!tracer)
+    return zero ? g_malloc0(size) : g_malloc(size);
+
+  if (tracer->scratch_size[id] < size) {
+    /* What the buffer held is not needed: no point in copying it */
+    g_free(tracer->scratch[id]);
+    tracer->scratch[id] = g_malloc(size);
+    tracer->scratch_size[id] = size;
+  }
+  if (zero && size > 0)
+    memset(tracer->scratch[id], 0, size);
+  return tracer->scratch[id];
+}
+
+void tracer_release(at_tracer *tracer, gpointer data)
+{
+  if (!tracer)
+    g_free(data);
+}
@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* tracer.h: scratch buffers kept from one trace to the next. */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <glib.h>
+#include "autotrace.h"
+
+/* The large buffers the stages of a trace work in, apart from what
+   they return.  */
+typedef enum {
+  SCRATCH_MARKED,         /* the edges traced so far, in find_*_pixels */
+  SCRATCH_DESPECKLE_MASK, /* the pixels seen at one level of despeckle */
+  SCRATCH_HISTOGRAM,      /* the color histogram of quantize */
+  SCRATCH_THIN_COLORS,    /* the colors thin_image has still to thin */
+  SCRATCH_DISTANCE,       /* the distances of new_*distance_map */
+  SCRATCH_DISTANCE_ROWS,  /* and its rows */
+  SCRATCH_WEIGHT,         /* the weights of new_distance_map */
+  SCRATCH_WEIGHT_ROWS,    /* and its rows */
+  SCRATCH_SKELETON,       /* the state of each pixel in find_medial_axis_pixels */
+  SCRATCH_SKELETON_ORDER, /* and the order it thins them in */
+  N_SCRATCH
+} scratch_id;
+
+struct _at_tracer {
+  gpointer scratch[N_SCRATCH];
+  gsize scratch_size[N_SCRATCH];
+};
+
+/* Return a buffer of SIZE bytes for ID, all zero if ZERO.  With a
+   TRACER, it is the one TRACER keeps for ID, grown if need be, and
+   is only valid until the next call for ID; otherwise it is a new
+   one.  Either way, give it back with `tracer_release' when done.  */
+extern gpointer tracer_scratch(at_tracer *tracer, scratch_id id, gsize size, gboolean zero);
+
+/* Give back DATA, a buffer from `tracer_scratch' with TRACER.  */
+extern void tracer_release(at_tracer *tracer, gpointer data);
+
+#endif /* not TRACER_H */
@@ -20,7 +20,7 @@ extern "C" {
 
 /* Cartesian points.  */
 typedef struct _at_coord {
-  gushort x, y;
+  guint x, y;
 } at_coord;
 
 typedef struct _at_real_coord {
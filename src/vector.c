@@ -129,8 +129,8 @@ at_coord Vadd_int_point(const at_coord c, const vector_type v)
 {
   at_coord a;
 
-  a.x = (unsigned short)lround((gfloat)c.x + v.dx);
-  a.y = (unsigned short)lround((gfloat)c.y + v.dy);
+  a.x = (unsigned)lround((gfloat)c.x + v.dx);
+  a.y = (unsigned)lround((gfloat)c.y + v.dy);
   return a;
 }
 
@@ -185,8 +185,8 @@ vector_type IPsubtract(const at_coord coord1, const at_coord coord2)
 {
   vector_type v;
 
-  v.dx = (gfloat)(coord1.x - coord2.x);
-  v.dy = (gfloat)(coord1.y - coord2.y);
+  v.dx = (gfloat)((gint64)coord1.x - coord2.x);
+  v.dy = (gfloat)((gint64)coord1.y - coord2.y);
   v.dz = 0.0;
 
   return v;
@@ -216,8 +216,8 @@ at_coord IPmult_scalar(const at_coord c, const int i)
 {
   at_coord a;
 
-  a.x = (unsigned short)(c.x * i);
-  a.y = (unsigned short)(c.y * i);
+  a.x = (unsigned)(c.x * i);
+  a.y = (unsigned)(c.y * i);
 
   return a;
 }
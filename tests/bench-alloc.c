@@ -0,0 +1,156 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Benchmark for the memory allocations done while tracing.
+
+   A gear with many fine teeth, whose outline is a single long and
+   detailed curve, is traced with at_splines_new.  The number of calls
+   to the allocator made by the tracing and its time are reported.
+   Only the public API is used, so that the figures of two versions of
+   the library can be compared by running this program against each.
+
+   The allocator is counted by wrapping the glibc one; elsewhere only
+   the time is reported.
+
+   Usage: bench-alloc [-s SIZE] [-n TEETH] [-r REPEAT]  */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "autotrace.h"
+#include "logreport.h"
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static gint n_allocs, n_reallocs;
+
+void *malloc(size_t size)
+{
+  g_atomic_int_inc(&n_allocs);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+  g_atomic_int_inc(&n_allocs);
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  g_atomic_int_inc(&n_allocs);
+  g_atomic_int_inc(&n_reallocs);
+  return __libc_realloc(ptr, size);
+}
+#define COUNTING_ALLOCS 1
+#endif /* __GLIBC__ */
+
+/* A black gear on white: the radius swings by a tenth between the
+   tips of the teeth and their roots.  */
+static at_bitmap *make_gear(unsigned short size, unsigned n_teeth)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 1);
+  double center = size / 2.0, radius = size * 0.45;
+  unsigned row, col;
+
+  for (row = 0; row < size; row++)
+    for (col = 0; col < size; col++) {
+      double dx = col + 0.5 - center, dy = row + 0.5 - center;
+      double angle = atan2(dy, dx);
+      double edge = radius * (0.95 + 0.05 * sin(n_teeth * angle));
+
+      bitmap->bitmap[(size_t)row * size + col] = dx * dx + dy * dy < edge * edge ? 0 : 255;
+    }
+  return bitmap;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned size = 2000, n_teeth = 500;
+  int repeat = 3, c, i;
+  at_bitmap *bitmap;
+  at_fitting_opts_type *opts;
+  double best = 0;
+  unsigned n_splines = 0;
+  gint allocs = 0, reallocs = 0;
+
+  while ((c = getopt(argc, argv, "s:n:r:")) != -1) {
+    switch (c) {
+    case 's':
+      size = atoi(optarg);
+      break;
+    case 'n':
+      n_teeth = atoi(optarg);
+      break;
+    case 'r':
+      repeat = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-s SIZE] [-n TEETH] [-r REPEAT]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (size < 16 || size > 65535 || n_teeth < 1 || repeat < 1) {
+    fprintf(stderr, "Usage: %s [-s SIZE] [-n TEETH] [-r REPEAT]\n", argv[0]);
+    return 2;
+  }
+
+  init_logging();
+  autotrace_init();
+
+  bitmap = make_gear(size, n_teeth);
+  opts = at_fitting_opts_new();
+  opts->background_color = at_color_new(255, 255, 255);
+
+  for (i = 0; i < repeat; i++) {
+    at_splines_type *splines;
+    gint64 start;
+    double elapsed;
+
+#ifdef COUNTING_ALLOCS
+    g_atomic_int_set(&n_allocs, 0);
+    g_atomic_int_set(&n_reallocs, 0);
+#endif
+    start = g_get_monotonic_time();
+    splines = at_splines_new(bitmap, opts, NULL, NULL);
+    elapsed = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+#ifdef COUNTING_ALLOCS
+    allocs = g_atomic_int_get(&n_allocs);
+    reallocs = g_atomic_int_get(&n_reallocs);
+#endif
+    if (!splines) {
+      fprintf(stderr, "bench-alloc: tracing failed\n");
+      return 1;
+    }
+
+    if (i == 0 || elapsed < best)
+      best = elapsed;
+    n_splines = 0;
+    for (c = 0; c < (int)splines->length; c++)
+      n_splines += splines->data[c].length;
+    at_splines_free(splines);
+  }
+
+  printf("# %ux%u gear, %u teeth, %u splines\n", size, size, n_teeth, n_splines);
+#ifdef COUNTING_ALLOCS
+  printf("allocations  reallocations  seconds\n");
+  printf("%11d  %13d  %7.3f\n", allocs, reallocs, best);
+#else
+  printf("seconds\n%7.3f\n", best);
+#endif
+
+  at_fitting_opts_free(opts);
+  at_bitmap_free(bitmap);
+  return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Benchmark for the two ways of finding center lines.
+
+   Synthetic line-art scans, strokes of a few widths with a little
+   noise on their borders, are made at each SIZE, and the images of
+   the files given are read; each is traced with -centerline, by
+   thinning each color and tracing what is left, then by the medial
+   axis of one distance map.  The best time over REPEAT traces of the
+   stages that differ, and of the whole trace, is reported with the
+   number of lines found and of splines fitted.  With -w, the width of
+   the lines is kept as well, which the thinning pays a distance map
+   for.
+
+   Usage: bench-centerline [-w] [-s SIZE,...] [-r REPEAT] [FILE...]  */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "autotrace.h"
+#include "input.h"
+#include "logreport.h"
+
+#define USAGE "Usage: %s [-w] [-s SIZE,...] [-r REPEAT] [FILE...]\n"
+
+/* Stamp a disc of RADIUS centered on X, Y, in black.  */
+static void stamp(at_bitmap *bitmap, double x, double y, double radius)
+{
+  int row, col;
+
+  for (row = (int)floor(y - radius); row <= (int)ceil(y + radius); row++)
+    for (col = (int)floor(x - radius); col <= (int)ceil(x + radius); col++)
+      if (row >= 0 && col >= 0 && row < (int)AT_BITMAP_HEIGHT(bitmap) &&
+          col < (int)AT_BITMAP_WIDTH(bitmap) &&
+          (col - x) * (col - x) + (row - y) * (row - y) <= radius * radius)
+        *AT_BITMAP_PIXEL(bitmap, row, col) = 0;
+}
+
+/* Straight and bent strokes, one to eight pixels wide, black on
+   white; the pen wobbles a little, as the border of a scanned line
+   does.  */
+static at_bitmap *make_scan(unsigned size, GRand *rand)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 1);
+  unsigned i, n_strokes = size / 8;
+
+  memset(AT_BITMAP_BITS(bitmap), 255, (gsize)size * size);
+  for (i = 0; i < n_strokes; i++) {
+    double x = g_rand_double_range(rand, 0, size), y = g_rand_double_range(rand, 0, size);
+    double radius = g_rand_double_range(rand, 0.5, 4);
+    double length = g_rand_double_range(rand, size / 16.0, size / 4.0);
+    double angle = g_rand_double_range(rand, 0, 2 * G_PI);
+    double bend = g_rand_boolean(rand) ? g_rand_double_range(rand, -3, 3) / length : 0;
+    double t;
+
+    for (t = 0; t < length; t += 0.5) {
+      stamp(bitmap, x, y, radius + g_rand_double_range(rand, -0.3, 0.3));
+      x += cos(angle) * 0.5;
+      y += sin(angle) * 0.5;
+      angle += bend * 0.5;
+    }
+  }
+  return bitmap;
+}
+
+/* Trace BITMAP REPEAT times, with the medial axis if MEDIAL_AXIS,
+   and print the best times.  */
+static void run(const char *name, at_bitmap *bitmap, gboolean medial_axis,
+                gboolean preserve_width, unsigned repeat)
+{
+  static const at_trace_stage stages[] = {AT_STAGE_DISTANCE_MAP, AT_STAGE_THIN,
+                                          AT_STAGE_OUTLINES, AT_STAGE_FIT};
+  double best[G_N_ELEMENTS(stages) + 1];
+  at_fitting_opts_type *opts = at_fitting_opts_new();
+  at_trace_stats stats;
+  unsigned r, s;
+
+  opts->centerline = TRUE;
+  opts->medial_axis = medial_axis;
+  opts->preserve_width = preserve_width;
+  opts->background_color = at_color_new(255, 255, 255);
+  for (s = 0; s <= G_N_ELEMENTS(stages); s++)
+    best[s] = HUGE_VAL;
+  for (r = 0; r < repeat; r++) {
+    at_splines_type *splines;
+    gint64 total = 0;
+
+    splines = at_splines_new_stats(bitmap, opts, &stats, NULL, NULL, NULL, NULL, NULL, NULL);
+    if (!splines) {
+      fprintf(stderr, "bench-centerline: tracing %s failed\n", name);
+      exit(1);
+    }
+    at_splines_free(splines);
+    for (s = 0; s < AT_N_STAGES; s++)
+      total += stats.stages[s].wall_usec;
+    for (s = 0; s < G_N_ELEMENTS(stages); s++)
+      best[s] = MIN(best[s], stats.stages[stages[s]].wall_usec / 1000.0);
+    best[s] = MIN(best[s], total / 1000.0);
+  }
+  printf("%-16s %-11s %9.2f %9.2f %9.2f %9.2f %9.2f %8u %8u\n", name,
+         medial_axis ? "medial-axis" : "thin", best[0], best[1], best[2], best[3], best[4],
+         stats.outlines, stats.splines);
+  at_fitting_opts_free(opts);
+}
+
+int main(int argc, char *argv[])
+{
+  gchar **sizes = NULL;
+  unsigned repeat = 5, i;
+  gboolean preserve_width = FALSE;
+  int c;
+
+  while ((c = getopt(argc, argv, "ws:r:")) != -1) {
+    switch (c) {
+    case 'w':
+      preserve_width = TRUE;
+      break;
+    case 's':
+      g_strfreev(sizes);
+      sizes = g_strsplit(optarg, ",", 0);
+      break;
+    case 'r':
+      repeat = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, USAGE, argv[0]);
+      return 2;
+    }
+  }
+  if (repeat < 1) {
+    fprintf(stderr, USAGE, argv[0]);
+    return 2;
+  }
+  if (!sizes && optind == argc)
+    sizes = g_strsplit("1024,2048,4096", ",", 0);
+
+  init_logging();
+  autotrace_init();
+
+  printf("# best of %u, milliseconds%s\n", repeat, preserve_width ? ", preserving width" : "");
+  printf("%-16s %-11s %9s %9s %9s %9s %9s %8s %8s\n", "image", "engine", "distance", "thin",
+         "outlines", "fit", "total", "lines", "splines");
+  for (i = 0; sizes && sizes[i]; i++) {
+    unsigned size = atoi(sizes[i]);
+    GRand *rand = g_rand_new_with_seed(size);
+    at_bitmap *bitmap;
+    gchar *name;
+
+    if (size < 16 || size > 65535) {
+      fprintf(stderr, USAGE, argv[0]);
+      return 2;
+    }
+    bitmap = make_scan(size, rand);
+    name = g_strdup_printf("scan-%u", size);
+    run(name, bitmap, FALSE, preserve_width, repeat);
+    run(name, bitmap, TRUE, preserve_width, repeat);
+    g_free(name);
+    at_bitmap_free(bitmap);
+    g_rand_free(rand);
+  }
+  for (; optind < argc; optind++) {
+    const char *file = argv[optind];
+    at_bitmap_reader *reader = at_input_get_handler((gchar *)file);
+    at_input_opts_type *input_opts;
+    at_bitmap *bitmap;
+    gchar *name;
+
+    if (!reader) {
+      fprintf(stderr, "bench-centerline: cannot read %s\n", file);
+      return 1;
+    }
+    input_opts = at_input_opts_new();
+    input_opts->background_color = at_color_new(255, 255, 255);
+    bitmap = at_bitmap_read(reader, (gchar *)file, input_opts, NULL, NULL);
+    at_input_opts_free(input_opts);
+    if (!bitmap) {
+      fprintf(stderr, "bench-centerline: cannot read %s\n", file);
+      return 1;
+    }
+    name = g_path_get_basename(file);
+    run(name, bitmap, FALSE, preserve_width, repeat);
+    run(name, bitmap, TRUE, preserve_width, repeat);
+    g_free(name);
+    at_bitmap_free(bitmap);
+  }
+  g_strfreev(sizes);
+  return 0;
+}
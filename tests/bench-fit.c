@@ -0,0 +1,278 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Benchmark for the loops of least-squares fitting.
+
+   Random curves of LENGTH points are run through the loops of
+   fit-kernels.c at each level the processor has, and the best time
+   over REPEAT runs of each loop, in nanoseconds a point, is reported.
+   The images of the files given are then traced at each level, and
+   the best time of the fitting stage is reported with it.  Then they
+   are traced at the best level with each count of ITERATIONS of
+   reparameterization, and the splines and the time of the fitting
+   stage are reported against those of the first count.
+
+   Usage: bench-fit [-i ITERATIONS,...] [-l LENGTH,...] [-r REPEAT] [FILE...]  */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "arena.h"
+#include "autotrace.h"
+#include "curve.h"
+#include "fit-kernels.h"
+#include "input.h"
+#include "logreport.h"
+
+#define USAGE "Usage: %s [-i ITERATIONS,...] [-l LENGTH,...] [-r REPEAT] [FILE...]\n"
+
+/* So many points a run, in curves of the length asked for */
+#define POINTS_A_RUN 1000000
+
+static guint64 random_state = 88172645463325252u;
+
+static gfloat random_range(double low, double high)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return (gfloat)(low + (random_state >> 11) * (1.0 / 9007199254740992.0) * (high - low));
+}
+
+/* Time the loops on curves of LENGTH points.  */
+static void run_loops(unsigned length, unsigned repeat)
+{
+  arena_type *arena = new_arena();
+  curve_type curve = new_curve(arena);
+  curve_points_type points = EMPTY_CURVE_POINTS;
+  spline_type spline = {0};
+  vector_type t1_hat = {0.6f, 0.8f, 0}, t2_hat = {-0.8f, 0.6f, 0};
+  unsigned n_curves = MAX(1, POINTS_A_RUN / length), i, r, c;
+  fit_kernels_level level;
+  volatile gfloat sink = 0;
+
+  for (i = 0; i < length; i++) {
+    at_real_coord p = {random_range(0, 1000), random_range(0, 1000), 0};
+
+    append_point(arena, curve, p);
+    CURVE_T(curve, i) = length > 1 ? (gfloat)i / (length - 1) : 0;
+  }
+  gather_curve_points(&points, curve);
+  START_POINT(spline) = CURVE_POINT(curve, 0);
+  CONTROL1(spline) = CURVE_POINT(curve, length / 3);
+  CONTROL2(spline) = CURVE_POINT(curve, 2 * length / 3);
+  END_POINT(spline) = LAST_CURVE_POINT(curve);
+  SPLINE_DEGREE(spline) = CUBICTYPE;
+
+  for (level = 0; level < FIT_KERNELS_N_LEVELS; level++) {
+    double best[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+
+    if (!fit_kernels_set_level(level))
+      continue;
+    for (r = 0; r < repeat; r++) {
+      gint64 start;
+      gfloat C[2][2], X[2];
+
+      start = g_get_monotonic_time();
+      for (c = 0; c < n_curves; c++) {
+        fit_normal_equations(&points, t1_hat, t2_hat, START_POINT(spline), END_POINT(spline), C,
+                             X);
+        sink += X[0];
+      }
+      best[0] = MIN(best[0], (g_get_monotonic_time() - start) * 1000.0 / n_curves / length);
+      start = g_get_monotonic_time();
+      for (c = 0; c < n_curves; c++) {
+        fit_point_errors(&points, &spline);
+        sink += points.result[0];
+      }
+      best[1] = MIN(best[1], (g_get_monotonic_time() - start) * 1000.0 / n_curves / length);
+      start = g_get_monotonic_time();
+      for (c = 0; c < n_curves; c++) {
+        fit_line_distances(&points, &spline);
+        sink += points.result[0];
+      }
+      best[2] = MIN(best[2], (g_get_monotonic_time() - start) * 1000.0 / n_curves / length);
+    }
+    printf("%-16u %-7s %9.3f %9.3f %9.3f\n", length, fit_kernels_level_name(level), best[0],
+           best[1], best[2]);
+  }
+  free_curve_points(&points);
+  free_arena(arena);
+}
+
+/* Trace BITMAP at each level, and print the best times of fitting.  */
+static void run_trace(const char *name, at_bitmap *bitmap, unsigned repeat)
+{
+  at_fitting_opts_type *opts = at_fitting_opts_new();
+  fit_kernels_level level;
+
+  opts->background_color = at_color_new(255, 255, 255);
+  for (level = 0; level < FIT_KERNELS_N_LEVELS; level++) {
+    double best = HUGE_VAL;
+    at_trace_stats stats;
+    unsigned r;
+
+    if (!fit_kernels_set_level(level))
+      continue;
+    for (r = 0; r < repeat; r++) {
+      at_splines_type *splines =
+          at_splines_new_stats(bitmap, opts, &stats, NULL, NULL, NULL, NULL, NULL, NULL);
+
+      if (!splines) {
+        fprintf(stderr, "bench-fit: tracing %s failed\n", name);
+        exit(1);
+      }
+      at_splines_free(splines);
+      best = MIN(best, stats.stages[AT_STAGE_FIT].wall_usec / 1000.0);
+    }
+    printf("%-16s %-7s %9.2f %8u\n", name, fit_kernels_level_name(level), best, stats.splines);
+  }
+  at_fitting_opts_free(opts);
+}
+
+/* Trace BITMAP with each count of ITERATIONS, and print the splines
+   and the best times of fitting against those of the first.  */
+static void run_reparameterize(const char *name, at_bitmap *bitmap, gchar **iterations,
+                               unsigned repeat)
+{
+  at_fitting_opts_type *opts = at_fitting_opts_new();
+  unsigned first_splines = 0, i;
+  double first_fit = 0;
+
+  opts->background_color = at_color_new(255, 255, 255);
+  for (i = 0; iterations[i]; i++) {
+    double best = HUGE_VAL;
+    at_trace_stats stats;
+    unsigned r;
+
+    opts->reparameterize_iterations = atoi(iterations[i]);
+    for (r = 0; r < repeat; r++) {
+      at_splines_type *splines =
+          at_splines_new_stats(bitmap, opts, &stats, NULL, NULL, NULL, NULL, NULL, NULL);
+
+      if (!splines) {
+        fprintf(stderr, "bench-fit: tracing %s failed\n", name);
+        exit(1);
+      }
+      at_splines_free(splines);
+      best = MIN(best, stats.stages[AT_STAGE_FIT].wall_usec / 1000.0);
+    }
+    if (i == 0) {
+      first_splines = stats.splines;
+      first_fit = best;
+    }
+    printf("%-16s %10u %9.2f %+7.1f%% %8u %+7.1f%%\n", name, opts->reparameterize_iterations, best,
+           first_fit > 0 ? (best - first_fit) * 100 / first_fit : 0.0, stats.splines,
+           first_splines ? ((double)stats.splines - first_splines) * 100 / first_splines : 0.0);
+  }
+  at_fitting_opts_free(opts);
+}
+
+int main(int argc, char *argv[])
+{
+  gchar **lengths = NULL, **iterations = NULL;
+  unsigned repeat = 5, i;
+  fit_kernels_level best = fit_kernels_get_level();
+  int c, f;
+
+  while ((c = getopt(argc, argv, "i:l:r:")) != -1) {
+    switch (c) {
+    case 'i':
+      g_strfreev(iterations);
+      iterations = g_strsplit(optarg, ",", 0);
+      break;
+    case 'l':
+      g_strfreev(lengths);
+      lengths = g_strsplit(optarg, ",", 0);
+      break;
+    case 'r':
+      repeat = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, USAGE, argv[0]);
+      return 2;
+    }
+  }
+  if (repeat < 1) {
+    fprintf(stderr, USAGE, argv[0]);
+    return 2;
+  }
+  if (!lengths)
+    lengths = g_strsplit("8,32,128,1024", ",", 0);
+  if (!iterations)
+    iterations = g_strsplit("0,4", ",", 0);
+
+  init_logging();
+  autotrace_init();
+
+  printf("# best of %u, nanoseconds a point\n", repeat);
+  printf("%-16s %-7s %9s %9s %9s\n", "length", "level", "normal", "errors", "linearity");
+  for (i = 0; lengths[i]; i++) {
+    int length = atoi(lengths[i]);
+
+    if (length < 2) {
+      fprintf(stderr, USAGE, argv[0]);
+      return 2;
+    }
+    run_loops(length, repeat);
+  }
+
+  if (optind < argc) {
+    printf("# best of %u, milliseconds\n", repeat);
+    printf("%-16s %-7s %9s %8s\n", "image", "level", "fit", "splines");
+  }
+  for (f = optind; f < argc; f++) {
+    const char *file = argv[f];
+    at_bitmap_reader *reader = at_input_get_handler((gchar *)file);
+    at_input_opts_type *input_opts;
+    at_bitmap *bitmap;
+    gchar *name;
+
+    if (!reader) {
+      fprintf(stderr, "bench-fit: cannot read %s\n", file);
+      return 1;
+    }
+    input_opts = at_input_opts_new();
+    bitmap = at_bitmap_read(reader, (gchar *)file, input_opts, NULL, NULL);
+    at_input_opts_free(input_opts);
+    if (!bitmap) {
+      fprintf(stderr, "bench-fit: cannot read %s\n", file);
+      return 1;
+    }
+    name = g_path_get_basename(file);
+    run_trace(name, bitmap, repeat);
+    g_free(name);
+    at_bitmap_free(bitmap);
+  }
+  fit_kernels_set_level(best);
+
+  if (optind < argc) {
+    printf("# best of %u at %s, milliseconds, against %s iterations\n", repeat,
+           fit_kernels_level_name(best), iterations[0]);
+    printf("%-16s %10s %9s %8s %8s %8s\n", "image", "iterations", "fit", "change", "splines",
+           "change");
+  }
+  for (f = optind; f < argc; f++) {
+    const char *file = argv[f];
+    at_bitmap_reader *reader = at_input_get_handler((gchar *)file);
+    at_input_opts_type *input_opts = at_input_opts_new();
+    at_bitmap *bitmap = at_bitmap_read(reader, (gchar *)file, input_opts, NULL, NULL);
+    gchar *name = g_path_get_basename(file);
+
+    at_input_opts_free(input_opts);
+    run_reparameterize(name, bitmap, iterations, repeat);
+    g_free(name);
+    at_bitmap_free(bitmap);
+  }
+  g_strfreev(lengths);
+  g_strfreev(iterations);
+  return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Benchmark for the cost of the tracing log.
+
+   A gear with many fine teeth, whose outline is a single long and
+   detailed curve, is traced twice: at the default log level, where
+   LOG and DEBUG must cost next to nothing, and at the debug level
+   with every message thrown away once formatted, which is what each
+   trace used to pay when the level was only checked by the log
+   handler.  With configure --disable-trace-log, no message is left
+   to format in the second run either.
+
+   Usage: bench-log [-s SIZE] [-n TEETH] [-r REPEAT]  */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "autotrace.h"
+#include "logreport.h"
+
+static gint n_messages;
+
+static void count_message(const gchar *log_domain, GLogLevelFlags log_level,
+                          const gchar *message, gpointer user_data)
+{
+  g_atomic_int_inc(&n_messages);
+}
+
+/* A black gear on white: the radius swings by a tenth between the
+   tips of the teeth and their roots.  */
+static at_bitmap *make_gear(unsigned size, unsigned n_teeth)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 1);
+  double center = size / 2.0, radius = size * 0.45;
+  unsigned row, col;
+
+  for (row = 0; row < size; row++)
+    for (col = 0; col < size; col++) {
+      double dx = col + 0.5 - center, dy = row + 0.5 - center;
+      double angle = atan2(dy, dx);
+      double edge = radius * (0.95 + 0.05 * sin(n_teeth * angle));
+
+      bitmap->bitmap[(size_t)row * size + col] = dx * dx + dy * dy < edge * edge ? 0 : 255;
+    }
+  return bitmap;
+}
+
+/* Best wall time of REPEAT traces of BITMAP, in seconds.  */
+static double run(at_bitmap *bitmap, at_fitting_opts_type *opts, int repeat)
+{
+  double best = 0;
+  int i;
+
+  for (i = 0; i < repeat; i++) {
+    gint64 start = g_get_monotonic_time();
+    at_splines_type *splines = at_splines_new_const(bitmap, opts, NULL, NULL, NULL, NULL, NULL,
+                                                    NULL);
+    double elapsed = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+
+    if (!splines) {
+      fprintf(stderr, "bench-log: tracing failed\n");
+      exit(1);
+    }
+    at_splines_free(splines);
+    if (i == 0 || elapsed < best)
+      best = elapsed;
+  }
+  return best;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned size = 2000, n_teeth = 500;
+  int repeat = 3, c;
+  at_bitmap *bitmap;
+  at_fitting_opts_type *opts;
+  double quiet, formatted;
+
+  while ((c = getopt(argc, argv, "s:n:r:")) != -1) {
+    switch (c) {
+    case 's':
+      size = atoi(optarg);
+      break;
+    case 'n':
+      n_teeth = atoi(optarg);
+      break;
+    case 'r':
+      repeat = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-s SIZE] [-n TEETH] [-r REPEAT]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (size < 16 || n_teeth < 1 || repeat < 1) {
+    fprintf(stderr, "Usage: %s [-s SIZE] [-n TEETH] [-r REPEAT]\n", argv[0]);
+    return 2;
+  }
+
+  autotrace_init();
+  g_log_set_default_handler(count_message, NULL);
+
+  bitmap = make_gear(size, n_teeth);
+  opts = at_fitting_opts_new();
+  opts->background_color = at_color_new(255, 255, 255);
+
+  set_log_level("warning");
+  quiet = run(bitmap, opts, repeat);
+  set_log_level("debug");
+  g_atomic_int_set(&n_messages, 0);
+  formatted = run(bitmap, opts, repeat);
+
+  printf("# %ux%u gear, %u teeth, %d messages per trace at the debug level\n", size, size,
+         n_teeth, g_atomic_int_get(&n_messages) / repeat);
+  printf("level    seconds\n");
+  printf("warning  %7.3f\n", quiet);
+  printf("debug    %7.3f  (%.2fx)\n", formatted, formatted / quiet);
+
+  at_fitting_opts_free(opts);
+  at_bitmap_free(bitmap);
+  return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Benchmark for the outline extraction (find_outline_pixels).
+
+   A synthetic poster-like image, made of overlapping rectangles in a
+   few colors, is scanned with 1, 2, 4, ... threads.  Each run must
+   yield exactly the outlines of the single threaded one.
+
+   Usage: bench-outline [-s SIZE] [-c COLORS] [-t MAX_THREADS] [-r REPEAT]  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "arena.h"
+#include "autotrace.h"
+#include "exception.h"
+#include "input.h"
+#include "logreport.h"
+#include "pxl-outline.h"
+
+static at_bitmap *make_poster(unsigned short size, unsigned n_colors)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 3);
+  GRand *rand = g_rand_new_with_seed(1);
+  unsigned char palette[256][3];
+  unsigned i, n_rects = (unsigned)size * size / 256;
+
+  for (i = 0; i < n_colors; i++) {
+    palette[i][0] = g_rand_int_range(rand, 0, 256);
+    palette[i][1] = g_rand_int_range(rand, 0, 256);
+    palette[i][2] = g_rand_int_range(rand, 0, 256);
+  }
+
+  for (i = 0; i < n_rects; i++) {
+    unsigned char *color = palette[g_rand_int_range(rand, 0, n_colors)];
+    unsigned row0 = g_rand_int_range(rand, 0, size), col0 = g_rand_int_range(rand, 0, size);
+    unsigned row1 = row0 + g_rand_int_range(rand, 1, 64);
+    unsigned col1 = col0 + g_rand_int_range(rand, 1, 64);
+    unsigned row, col;
+
+    row1 = MIN(row1, size);
+    col1 = MIN(col1, size);
+
+    for (row = row0; row < row1; row++)
+      for (col = col0; col < col1; col++)
+        memcpy(AT_BITMAP_PIXEL(bitmap, row, col), color, 3);
+  }
+  g_rand_free(rand);
+  return bitmap;
+}
+
+static gboolean same_outlines(pixel_outline_list_type *a, pixel_outline_list_type *b)
+{
+  unsigned i;
+
+  if (O_LIST_LENGTH(*a) != O_LIST_LENGTH(*b))
+    return FALSE;
+  for (i = 0; i < O_LIST_LENGTH(*a); i++) {
+    pixel_outline_type *oa = &O_LIST_OUTLINE(*a, i), *ob = &O_LIST_OUTLINE(*b, i);
+    if (O_LENGTH(*oa) != O_LENGTH(*ob) || O_CLOCKWISE(*oa) != O_CLOCKWISE(*ob) ||
+        !at_color_equal(&oa->color, &ob->color) ||
+        memcmp(oa->data, ob->data, O_LENGTH(*oa) * sizeof(at_coord)) != 0)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* Best wall time of REPEAT runs with N_THREADS, in seconds.  The
+   outlines of the first run are left in ARENA.  */
+static double run(at_bitmap *bitmap, unsigned n_threads, int repeat, arena_type *arena,
+                  pixel_outline_list_type *result)
+{
+  double best = 0;
+  int i;
+
+  for (i = 0; i < repeat; i++) {
+    at_exception_type exp = at_exception_new(NULL, NULL);
+    arena_type *run_arena = i == 0 ? arena : new_arena();
+    gint64 start = g_get_monotonic_time();
+    pixel_outline_list_type outlines =
+        find_outline_pixels(bitmap, NULL, n_threads, NULL, NULL, NULL, NULL, NULL, run_arena,
+                            &exp);
+    double elapsed = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+
+    if (i == 0 || elapsed < best)
+      best = elapsed;
+    if (i == 0)
+      *result = outlines;
+    else
+      free_arena(run_arena);
+  }
+  return best;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned size = 4000, n_colors = 8, max_threads = g_get_num_processors(), n_threads;
+  int repeat = 3, c, status = 0;
+  at_bitmap *bitmap;
+  arena_type *reference_arena;
+  pixel_outline_list_type reference;
+  double serial;
+
+  while ((c = getopt(argc, argv, "s:c:t:r:")) != -1) {
+    switch (c) {
+    case 's':
+      size = atoi(optarg);
+      break;
+    case 'c':
+      n_colors = atoi(optarg);
+      break;
+    case 't':
+      max_threads = atoi(optarg);
+      break;
+    case 'r':
+      repeat = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-s SIZE] [-c COLORS] [-t MAX_THREADS] [-r REPEAT]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (size < 1 || size > 65535 || n_colors < 2 || n_colors > 256 || max_threads < 1 ||
+      repeat < 1) {
+    fprintf(stderr, "Usage: %s [-s SIZE] [-c COLORS] [-t MAX_THREADS] [-r REPEAT]\n", argv[0]);
+    return 2;
+  }
+
+  init_logging();
+  autotrace_init();
+
+  bitmap = make_poster(size, n_colors);
+  reference_arena = new_arena();
+  serial = run(bitmap, 1, repeat, reference_arena, &reference);
+  printf("# %ux%u pixels, %u colors, %u outlines\n", size, size, n_colors,
+         O_LIST_LENGTH(reference));
+  printf("threads  seconds  speedup\n");
+  printf("%7u  %7.3f  %7.2f\n", 1, serial, 1.0);
+
+  for (n_threads = 2; n_threads <= max_threads; n_threads *= 2) {
+    arena_type *arena = new_arena();
+    pixel_outline_list_type outlines;
+    double elapsed = run(bitmap, n_threads, repeat, arena, &outlines);
+
+    printf("%7u  %7.3f  %7.2f\n", n_threads, elapsed, serial / elapsed);
+    if (!same_outlines(&reference, &outlines)) {
+      fprintf(stderr, "bench-outline: %u threads give different outlines\n", n_threads);
+      status = 1;
+    }
+    free_arena(arena);
+  }
+
+  free_arena(reference_arena);
+  at_bitmap_free(bitmap);
+  return status;
+}
@@ -0,0 +1,481 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Benchmark for the stages of a trace.
+
+   Synthetic images of a few kinds (line art, dense text, posterised
+   photos and noisy scans) are made at several sizes and run through
+   the same stages as at_splines_new_full, one at a time, each one
+   timed on its own: despeckle, quantize, new_distance_map,
+   thin_image, find_outline_pixels or find_centerline_pixels,
+   split_at_corners and fit_curve_list.  The splines are then written
+   with each output format.  The median time of each stage over the
+   repeats is written as JSON to FILE, bench.json by default; some
+   writers print to stdout.
+
+   Usage: bench-stages [-s SIZE,...] [-k KIND,...] [-r REPEAT] [-o FILE]  */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "arena.h"
+#include "autotrace.h"
+#include "despeckle.h"
+#include "exception.h"
+#include "fit.h"
+#include "image-proc.h"
+#include "input.h"
+#include "logreport.h"
+#include "pxl-outline.h"
+#include "quantize.h"
+#include "thin-image.h"
+
+#define USAGE "Usage: %s [-s SIZE,...] [-k KIND,...] [-r REPEAT] [-o FILE]\n"
+
+typedef enum {
+  STAGE_DESPECKLE,
+  STAGE_QUANTIZE,
+  STAGE_DISTANCE_MAP,
+  STAGE_THIN_IMAGE,
+  STAGE_OUTLINES,
+  STAGE_SPLIT_AT_CORNERS,
+  STAGE_FIT_CURVE_LIST,
+  N_STAGES
+} stage_type;
+
+static const char *stage_names[N_STAGES] = {"despeckle",           "quantize",
+                                            "new_distance_map",    "thin_image",
+                                            "find_outline_pixels", "split_at_corners",
+                                            "fit_curve_list"};
+
+/* The native writers; those not registered are skipped.  */
+static const char *formats[] = {"ai",  "cgm", "dr2d", "dxf", "emf", "epd", "eps", "er", "fig",
+                                "ild", "mif", "p2e",  "pdf", "plt", "pov", "sk",  "svg", "ugs",
+                                NULL};
+
+typedef struct {
+  const char *name;
+  at_bitmap *(*make)(unsigned size, GRand *rand);
+  void (*set_options)(at_fitting_opts_type *opts);
+} kind_type;
+
+/* Stamp a disc of RADIUS and VALUE centered on X, Y.  */
+static void stamp(at_bitmap *bitmap, double x, double y, double radius, unsigned char value)
+{
+  int row, col;
+
+  for (row = (int)floor(y - radius); row <= (int)ceil(y + radius); row++)
+    for (col = (int)floor(x - radius); col <= (int)ceil(x + radius); col++)
+      if (row >= 0 && col >= 0 && row < (int)AT_BITMAP_HEIGHT(bitmap) &&
+          col < (int)AT_BITMAP_WIDTH(bitmap) &&
+          (col - x) * (col - x) + (row - y) * (row - y) <= radius * radius)
+        *AT_BITMAP_PIXEL(bitmap, row, col) = value;
+}
+
+/* Strokes of a few pixels wide on white: straight lines and arcs.  */
+static at_bitmap *make_line_art(unsigned size, GRand *rand)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 1);
+  unsigned i, n_strokes = size / 8;
+
+  memset(AT_BITMAP_BITS(bitmap), 255, (gsize)size * size);
+  for (i = 0; i < n_strokes; i++) {
+    double x = g_rand_double_range(rand, 0, size), y = g_rand_double_range(rand, 0, size);
+    double radius = g_rand_double_range(rand, 1, 2.5);
+    double length = g_rand_double_range(rand, size / 16.0, size / 4.0);
+    double angle = g_rand_double_range(rand, 0, 2 * G_PI);
+    double bend = g_rand_boolean(rand) ? g_rand_double_range(rand, -3, 3) / length : 0;
+    double t;
+
+    for (t = 0; t < length; t += 0.5) {
+      stamp(bitmap, x, y, radius, 0);
+      x += cos(angle) * 0.5;
+      y += sin(angle) * 0.5;
+      angle += bend * 0.5;
+    }
+  }
+  return bitmap;
+}
+
+/* Lines of 5x7 dot matrix glyphs of random shapes, black on white.  */
+static at_bitmap *make_text(unsigned size, GRand *rand)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 1);
+  unsigned row, col, dot_row, dot_col, scale = 2;
+
+  memset(AT_BITMAP_BITS(bitmap), 255, (gsize)size * size);
+  for (row = 2; row + 7 * scale < size; row += 9 * scale)
+    for (col = 2; col + 5 * scale < size; col += 6 * scale) {
+      if (g_rand_int_range(rand, 0, 8) == 0)
+        continue; /* A space */
+      for (dot_row = 0; dot_row < 7; dot_row++) {
+        guint32 dots = g_rand_int(rand);
+
+        for (dot_col = 0; dot_col < 5; dot_col++)
+          if (dots & (1 << dot_col)) {
+            unsigned r, c;
+
+            for (r = 0; r < scale; r++)
+              for (c = 0; c < scale; c++)
+                *AT_BITMAP_PIXEL(bitmap, row + dot_row * scale + r, col + dot_col * scale + c) = 0;
+          }
+      }
+    }
+  return bitmap;
+}
+
+/* A smooth color field with a little grain, like a photograph.  */
+static at_bitmap *make_photo(unsigned size, GRand *rand)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 3);
+  double freq[3][2], phase[3];
+  unsigned row, col, plane;
+
+  for (plane = 0; plane < 3; plane++) {
+    freq[plane][0] = g_rand_double_range(rand, 2, 9) * G_PI / size;
+    freq[plane][1] = g_rand_double_range(rand, 2, 9) * G_PI / size;
+    phase[plane] = g_rand_double_range(rand, 0, 2 * G_PI);
+  }
+  for (row = 0; row < size; row++)
+    for (col = 0; col < size; col++)
+      for (plane = 0; plane < 3; plane++) {
+        double v = sin(col * freq[plane][0] + phase[plane]) * cos(row * freq[plane][1]);
+
+        v = 128 + 110 * v + g_rand_double_range(rand, -8, 8);
+        AT_BITMAP_PIXEL(bitmap, row, col)[plane] = (unsigned char)CLAMP(v, 0, 255);
+      }
+  return bitmap;
+}
+
+/* Text on gray paper, with grain and specks.  */
+static at_bitmap *make_scan(unsigned size, GRand *rand)
+{
+  at_bitmap *bitmap = make_text(size, rand);
+  unsigned char *p = AT_BITMAP_BITS(bitmap);
+  gsize i;
+
+  for (i = 0; i < (gsize)size * size; i++) {
+    int v = p[i] ? 220 : 40;
+
+    if (g_rand_int_range(rand, 0, 100) == 0)
+      v = 255 - v;
+    v += g_rand_int_range(rand, -30, 31);
+    p[i] = (unsigned char)CLAMP(v, 0, 255);
+  }
+  return bitmap;
+}
+
+static void line_art_options(at_fitting_opts_type *opts)
+{
+  opts->centerline = TRUE;
+  opts->preserve_width = TRUE;
+  opts->background_color = at_color_new(255, 255, 255);
+}
+
+static void text_options(at_fitting_opts_type *opts)
+{
+  opts->background_color = at_color_new(255, 255, 255);
+}
+
+static void photo_options(at_fitting_opts_type *opts)
+{
+  opts->color_count = 16;
+  opts->despeckle_level = 2;
+}
+
+static void scan_options(at_fitting_opts_type *opts)
+{
+  opts->color_count = 2;
+  opts->despeckle_level = 4;
+}
+
+static const kind_type kinds[] = {{"line-art", make_line_art, line_art_options},
+                                  {"text", make_text, text_options},
+                                  {"photo", make_photo, photo_options},
+                                  {"scan", make_scan, scan_options},
+                                  {NULL, NULL, NULL}};
+
+static double seconds_since(gint64 start)
+{
+  return (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+static double median(double *times, int n)
+{
+  qsort(times, n, sizeof(double), compare_doubles);
+  return n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+}
+
+typedef struct {
+  unsigned n_outlines, n_curves, n_splines;
+} counts_type;
+
+#define CHECK_FATAL(stage)                                                                         \
+  if (at_exception_got_fatal(&exp)) {                                                              \
+    fprintf(stderr, "bench-stages: %s failed\n", stage_names[stage]);                              \
+    exit(1);                                                                                       \
+  }
+
+/* Run the stages of at_splines_new_full that OPTS asks for on a copy
+   of IMAGE, adding the time of each to TIMES, or -1 for those not run.
+   Return the splines.  */
+static at_splines_type *run_stages(at_bitmap *image, at_fitting_opts_type *opts, double *times,
+                                   counts_type *counts)
+{
+  at_exception_type exp = at_exception_new(NULL, NULL);
+  at_bitmap *bitmap = at_bitmap_copy(image);
+  at_splines_type *splines = g_new0(at_splines_type, 1);
+  at_distance_map dist_map, *dist = NULL;
+  arena_type *arena = new_arena();
+  pixel_outline_list_type pixels;
+  curve_list_array_type curve_array;
+  unsigned i;
+  gint64 start;
+
+  for (i = 0; i < N_STAGES; i++)
+    times[i] = -1;
+
+  if (opts->despeckle_level > 0) {
+    start = g_get_monotonic_time();
+    despeckle(bitmap, opts->despeckle_level, opts->despeckle_tightness, opts->noise_removal, NULL,
+              &exp);
+    times[STAGE_DESPECKLE] = seconds_since(start);
+    CHECK_FATAL(STAGE_DESPECKLE);
+  }
+
+  if (opts->color_count > 0) {
+    QuantizeObj *quant = NULL;
+
+    start = g_get_monotonic_time();
+    quantize(bitmap, opts->color_count, opts->background_color, &quant, NULL, &exp);
+    times[STAGE_QUANTIZE] = seconds_since(start);
+    if (quant)
+      quantize_object_free(quant);
+    CHECK_FATAL(STAGE_QUANTIZE);
+  }
+
+  if (opts->centerline) {
+    if (opts->preserve_width) {
+      start = g_get_monotonic_time();
+      dist_map = new_distance_map(bitmap, 255, TRUE, NULL, &exp);
+      times[STAGE_DISTANCE_MAP] = seconds_since(start);
+      dist = &dist_map;
+      CHECK_FATAL(STAGE_DISTANCE_MAP);
+    }
+    start = g_get_monotonic_time();
+    thin_image(bitmap, opts->background_color, NULL, &exp);
+    times[STAGE_THIN_IMAGE] = seconds_since(start);
+    CHECK_FATAL(STAGE_THIN_IMAGE);
+  }
+
+  start = g_get_monotonic_time();
+  if (opts->centerline)
+    pixels = find_centerline_pixels(bitmap, *opts->background_color, NULL, NULL, NULL, NULL,
+                                    NULL, arena, &exp);
+  else
+    pixels = find_outline_pixels(bitmap, opts->background_color, 1, NULL, NULL, NULL, NULL, NULL,
+                                 arena, &exp);
+  times[STAGE_OUTLINES] = seconds_since(start);
+  CHECK_FATAL(STAGE_OUTLINES);
+
+  start = g_get_monotonic_time();
+  curve_array = split_at_corners(pixels, opts, arena, &exp);
+  times[STAGE_SPLIT_AT_CORNERS] = seconds_since(start);
+  CHECK_FATAL(STAGE_SPLIT_AT_CORNERS);
+
+  /* Put together what fitted_splines would return */
+  *splines = new_spline_list_array();
+  splines->width = AT_BITMAP_WIDTH(bitmap);
+  splines->height = AT_BITMAP_HEIGHT(bitmap);
+  splines->background_color =
+      opts->background_color ? at_color_copy(opts->background_color) : NULL;
+  splines->centerline = opts->centerline;
+  splines->preserve_width = opts->preserve_width;
+  splines->width_weight_factor = opts->width_weight_factor;
+
+  counts->n_outlines = O_LIST_LENGTH(pixels);
+  counts->n_curves = 0;
+  counts->n_splines = 0;
+  times[STAGE_FIT_CURVE_LIST] = 0;
+  for (i = 0; i < CURVE_LIST_ARRAY_LENGTH(curve_array); i++) {
+    curve_list_type curves = CURVE_LIST_ARRAY_ELT(curve_array, i);
+    spline_list_type list;
+
+    start = g_get_monotonic_time();
+    list = fit_curve_list(curves, opts, dist, arena, NULL, &exp);
+    times[STAGE_FIT_CURVE_LIST] += seconds_since(start);
+    CHECK_FATAL(STAGE_FIT_CURVE_LIST);
+
+    list.clockwise = curves.clockwise;
+    list.color = O_LIST_OUTLINE(pixels, i).color;
+    counts->n_curves += CURVE_LIST_LENGTH(curves);
+    counts->n_splines += SPLINE_LIST_LENGTH(list);
+    append_spline_list(splines, list);
+  }
+
+  free_arena(arena);
+  if (dist)
+    free_distance_map(dist);
+  at_bitmap_free(bitmap);
+  return splines;
+}
+
+/* Median time of writing SPLINES with WRITER REPEAT times.  */
+static double time_writer(at_spline_writer *writer, at_splines_type *splines, int repeat)
+{
+  double *times = g_new(double, repeat), result;
+  int i;
+
+  for (i = 0; i < repeat; i++) {
+    FILE *fp = fopen("/dev/null", "w");
+    gint64 start = g_get_monotonic_time();
+
+    at_splines_write(writer, fp, "bench", NULL, splines, NULL, NULL);
+    fclose(fp);
+    times[i] = seconds_since(start);
+  }
+  result = median(times, repeat);
+  g_free(times);
+  return result;
+}
+
+static gboolean wanted(gchar **list, const char *name)
+{
+  return !list || g_strv_contains((const gchar *const *)list, name);
+}
+
+int main(int argc, char *argv[])
+{
+  gchar *size_arg = g_strdup("256,512,1024"), **sizes, **kind_list = NULL;
+  const char *json_file = "bench.json";
+  int repeat = 5, c, i, s, run = 0;
+  const kind_type *kind;
+  FILE *out;
+
+  while ((c = getopt(argc, argv, "s:k:r:o:")) != -1) {
+    switch (c) {
+    case 's':
+      g_free(size_arg);
+      size_arg = g_strdup(optarg);
+      break;
+    case 'k':
+      g_strfreev(kind_list);
+      kind_list = g_strsplit(optarg, ",", -1);
+      break;
+    case 'r':
+      repeat = atoi(optarg);
+      break;
+    case 'o':
+      json_file = optarg;
+      break;
+    default:
+      fprintf(stderr, USAGE, argv[0]);
+      return 2;
+    }
+  }
+  sizes = g_strsplit(size_arg, ",", -1);
+  g_free(size_arg);
+  for (s = 0; sizes[s]; s++)
+    if (atoi(sizes[s]) < 16) {
+      fprintf(stderr, USAGE, argv[0]);
+      return 2;
+    }
+  if (repeat < 1) {
+    fprintf(stderr, USAGE, argv[0]);
+    return 2;
+  }
+  if (!(out = fopen(json_file, "w"))) {
+    perror(json_file);
+    return 1;
+  }
+
+  init_logging();
+  autotrace_init();
+
+  fprintf(out, "{\n  \"version\": \"%s\",\n  \"repeat\": %d,\n  \"runs\": [", at_version(FALSE),
+          repeat);
+  for (kind = kinds; kind->name; kind++) {
+    if (!wanted(kind_list, kind->name))
+      continue;
+    for (s = 0; sizes[s]; s++) {
+      unsigned size = atoi(sizes[s]);
+      GRand *rand = g_rand_new_with_seed(size);
+      at_bitmap *image = kind->make(size, rand);
+      at_fitting_opts_type *opts = at_fitting_opts_new();
+      double *times = g_new(double, (gsize)N_STAGES * repeat), stage_times[N_STAGES];
+      at_splines_type *splines = NULL;
+      counts_type counts;
+      gboolean first;
+      int stage;
+
+      g_rand_free(rand);
+      kind->set_options(opts);
+      for (i = 0; i < repeat; i++) {
+        if (splines)
+          at_splines_free(splines);
+        splines = run_stages(image, opts, stage_times, &counts);
+        for (stage = 0; stage < N_STAGES; stage++)
+          times[stage * repeat + i] = stage_times[stage];
+      }
+
+      fprintf(stderr, "%s %ux%u: %u outlines, %u curves, %u splines\n", kind->name, size, size,
+              counts.n_outlines, counts.n_curves, counts.n_splines);
+      fprintf(out, "%s\n    {\n      \"input\": \"%s\",\n      \"width\": %u,\n", run++ ? "," : "",
+              kind->name, size);
+      fprintf(out, "      \"height\": %u,\n      \"outlines\": %u,\n", size, counts.n_outlines);
+      fprintf(out, "      \"curves\": %u,\n      \"splines\": %u,\n", counts.n_curves,
+              counts.n_splines);
+      fprintf(out, "      \"stages\": {");
+      first = TRUE;
+      for (stage = 0; stage < N_STAGES; stage++) {
+        const char *name = stage_names[stage];
+
+        if (times[stage * repeat] < 0)
+          continue;
+        if (stage == STAGE_OUTLINES && opts->centerline)
+          name = "find_centerline_pixels";
+        fprintf(out, "%s\n        \"%s\": %.6f", first ? "" : ",", name,
+                median(&times[stage * repeat], repeat));
+        first = FALSE;
+      }
+      fprintf(out, "\n      },\n      \"writers\": {");
+      first = TRUE;
+      for (i = 0; formats[i]; i++) {
+        at_spline_writer *writer = at_output_get_handler_by_suffix((gchar *)formats[i]);
+
+        /* The POV writer aborts on centerline traces */
+        if (!writer || (opts->centerline && strcmp(formats[i], "pov") == 0))
+          continue;
+        fprintf(out, "%s\n        \"%s\": %.6f", first ? "" : ",", formats[i],
+                time_writer(writer, splines, repeat));
+        first = FALSE;
+      }
+      fprintf(out, "\n      }\n    }");
+
+      at_splines_free(splines);
+      g_free(times);
+      at_fitting_opts_free(opts);
+      at_bitmap_free(image);
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  g_strfreev(sizes);
+  g_strfreev(kind_list);
+  fclose(out);
+  return 0;
+}
@@ -0,0 +1,323 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Benchmark for tracing many images of the same size with a tracer.
+
+   A run of images, each of the same size but different, is traced
+   once with at_splines_new_full, which allocates the scratch buffers
+   of each stage anew for every image, and once with at_tracer_trace
+   and a single tracer, which keeps them.  Two sets of options are
+   tried: color images with despeckling and color reduction, and line
+   drawings traced along their centerlines with their widths kept.
+   For each, the wall time, the minor page faults, and the number and
+   time of the calls to the allocator made while tracing, frees
+   included, are reported, and both ways are checked to give the same
+   splines.
+
+   The allocator is counted by wrapping the glibc one; elsewhere only
+   the time and the page faults are reported.
+
+   Usage: bench-tracer [-s SIZE] [-n IMAGES]  */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "autotrace.h"
+#include "logreport.h"
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+/* Only the calls made while COUNTING are counted and timed */
+static gint counting, n_allocs;
+static gsize alloc_nsec;
+
+static gint64 now_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#define COUNTED(call)                                                                              \
+  do {                                                                                             \
+    if (g_atomic_int_get(&counting)) {                                                             \
+      gint64 start = now_nsec();                                                                   \
+      call;                                                                                        \
+      g_atomic_int_inc(&n_allocs);                                                                 \
+      g_atomic_pointer_add(&alloc_nsec, now_nsec() - start);                                       \
+    } else                                                                                         \
+      call;                                                                                        \
+  } while (0)
+
+void *malloc(size_t size)
+{
+  void *ptr;
+
+  COUNTED(ptr = __libc_malloc(size));
+  return ptr;
+}
+
+void *calloc(size_t n, size_t size)
+{
+  void *ptr;
+
+  COUNTED(ptr = __libc_calloc(n, size));
+  return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  void *new_ptr;
+
+  COUNTED(new_ptr = __libc_realloc(ptr, size));
+  return new_ptr;
+}
+
+void free(void *ptr)
+{
+  if (ptr)
+    COUNTED(__libc_free(ptr));
+}
+#define COUNTING_ALLOCS 1
+#endif /* __GLIBC__ */
+
+/* What tracing a run of images cost */
+typedef struct {
+  double seconds;
+  long page_faults;
+  gint allocs;
+  double alloc_seconds;
+} cost_type;
+
+/* Image I of a run: discs of a few colors on white, sprinkled with
+   specks for despeckle to remove.  */
+static at_bitmap *make_color(unsigned size, unsigned i)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 3);
+  GRand *rand = g_rand_new_with_seed(i + 1);
+  unsigned n, row, col;
+
+  memset(bitmap->bitmap, 255, (size_t)size * size * 3);
+  for (n = 0; n < 12; n++) {
+    double cx = g_rand_double(rand) * size, cy = g_rand_double(rand) * size;
+    double r = (0.05 + 0.15 * g_rand_double(rand)) * size;
+    unsigned char rgb[3] = {g_rand_int_range(rand, 0, 256), g_rand_int_range(rand, 0, 256),
+                            g_rand_int_range(rand, 0, 256)};
+
+    for (row = 0; row < size; row++)
+      for (col = 0; col < size; col++) {
+        double dx = col + 0.5 - cx, dy = row + 0.5 - cy;
+
+        if (dx * dx + dy * dy < r * r)
+          memcpy(bitmap->bitmap + ((size_t)row * size + col) * 3, rgb, 3);
+      }
+  }
+  for (n = 0; n < size * size / 200; n++) {
+    row = g_rand_int_range(rand, 0, size);
+    col = g_rand_int_range(rand, 0, size);
+    memset(bitmap->bitmap + ((size_t)row * size + col) * 3, 0, 3);
+  }
+  g_rand_free(rand);
+  return bitmap;
+}
+
+/* Image I of a run: black rings of different widths on white.  */
+static at_bitmap *make_lines(unsigned size, unsigned i)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 1);
+  GRand *rand = g_rand_new_with_seed(i + 1);
+  unsigned n, row, col;
+
+  memset(bitmap->bitmap, 255, (size_t)size * size);
+  for (n = 0; n < 6; n++) {
+    double cx = g_rand_double(rand) * size, cy = g_rand_double(rand) * size;
+    double r = (0.1 + 0.2 * g_rand_double(rand)) * size;
+    double width = 2 + 6 * g_rand_double(rand);
+
+    for (row = 0; row < size; row++)
+      for (col = 0; col < size; col++) {
+        double dx = col + 0.5 - cx, dy = row + 0.5 - cy;
+
+        if (fabs(sqrt(dx * dx + dy * dy) - r) < width / 2)
+          bitmap->bitmap[(size_t)row * size + col] = 0;
+      }
+  }
+  g_rand_free(rand);
+  return bitmap;
+}
+
+static gboolean splines_equal(at_splines_type *a, at_splines_type *b)
+{
+  unsigned i;
+
+  if (a->length != b->length)
+    return FALSE;
+  for (i = 0; i < a->length; i++) {
+    at_spline_list_type *la = &a->data[i], *lb = &b->data[i];
+
+    if (la->length != lb->length || la->clockwise != lb->clockwise || la->open != lb->open
+        || !at_color_equal(&la->color, &lb->color)
+        || memcmp(la->data, lb->data, la->length * sizeof(at_spline_type)) != 0)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* Trace the N_IMAGES images of IMAGES with OPTS, with TRACER if it
+   is not NULL, into SPLINES.  */
+static cost_type trace_run(at_bitmap **images, unsigned n_images, at_fitting_opts_type *opts,
+                           at_tracer *tracer, at_splines_type **splines)
+{
+  cost_type cost = {0, 0, 0, 0};
+  unsigned i;
+
+  for (i = 0; i < n_images; i++) {
+    /* Tracing works in place: give it a copy, made outside the count */
+    at_bitmap *bitmap = at_bitmap_copy(images[i]);
+    struct rusage before, after;
+    gint64 start;
+
+    getrusage(RUSAGE_SELF, &before);
+#ifdef COUNTING_ALLOCS
+    g_atomic_int_set(&counting, 1);
+#endif
+    start = g_get_monotonic_time();
+    if (tracer)
+      splines[i] = at_tracer_trace(tracer, bitmap, opts, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    else
+      splines[i] = at_splines_new_full(bitmap, opts, NULL, NULL, NULL, NULL, NULL, NULL);
+    cost.seconds += (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+#ifdef COUNTING_ALLOCS
+    g_atomic_int_set(&counting, 0);
+#endif
+    getrusage(RUSAGE_SELF, &after);
+    cost.page_faults += after.ru_minflt - before.ru_minflt;
+    at_bitmap_free(bitmap);
+    if (!splines[i]) {
+      fprintf(stderr, "bench-tracer: tracing failed\n");
+      exit(1);
+    }
+  }
+#ifdef COUNTING_ALLOCS
+  cost.allocs = g_atomic_int_get(&n_allocs);
+  cost.alloc_seconds = g_atomic_pointer_get(&alloc_nsec) / 1e9;
+  g_atomic_int_set(&n_allocs, 0);
+  g_atomic_pointer_set(&alloc_nsec, 0);
+#endif
+  return cost;
+}
+
+static void print_cost(const char *name, cost_type *cost)
+{
+#ifdef COUNTING_ALLOCS
+  printf("%-8s %8.3f %11ld %11d %9.3f\n", name, cost->seconds, cost->page_faults, cost->allocs,
+         cost->alloc_seconds);
+#else
+  printf("%-8s %8.3f %11ld\n", name, cost->seconds, cost->page_faults);
+#endif
+}
+
+/* Trace the run of images made by MAKE both ways with OPTS, print
+   what each cost and return FALSE if they give different splines.  */
+static gboolean compare(const char *title, at_bitmap *(*make)(unsigned, unsigned), unsigned size,
+                        unsigned n_images, at_fitting_opts_type *opts)
+{
+  at_bitmap **images = g_new(at_bitmap *, n_images);
+  at_splines_type **plain = g_new(at_splines_type *, n_images);
+  at_splines_type **pooled = g_new(at_splines_type *, n_images);
+  at_tracer *tracer = at_tracer_new();
+  cost_type plain_cost, pooled_cost;
+  gboolean same = TRUE;
+  unsigned i;
+
+  for (i = 0; i < n_images; i++)
+    images[i] = make(size, i);
+  plain_cost = trace_run(images, n_images, opts, NULL, plain);
+  pooled_cost = trace_run(images, n_images, opts, tracer, pooled);
+
+  printf("# %u %ux%u %s\n", n_images, size, size, title);
+#ifdef COUNTING_ALLOCS
+  printf("tracer    seconds page-faults alloc-calls alloc-sec\n");
+#else
+  printf("tracer    seconds page-faults\n");
+#endif
+  print_cost("none", &plain_cost);
+  print_cost("kept", &pooled_cost);
+
+  for (i = 0; i < n_images; i++) {
+    if (!splines_equal(plain[i], pooled[i])) {
+      fprintf(stderr, "bench-tracer: image %u of %s traced differently with a tracer\n", i, title);
+      same = FALSE;
+    }
+    at_splines_free(plain[i]);
+    at_splines_free(pooled[i]);
+    at_bitmap_free(images[i]);
+  }
+  at_tracer_free(tracer);
+  g_free(images);
+  g_free(plain);
+  g_free(pooled);
+  return same;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned size = 1024, n_images = 20;
+  int c;
+  at_fitting_opts_type *opts;
+  gboolean same;
+
+  while ((c = getopt(argc, argv, "s:n:")) != -1) {
+    switch (c) {
+    case 's':
+      size = atoi(optarg);
+      break;
+    case 'n':
+      n_images = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-s SIZE] [-n IMAGES]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (size < 16 || size > 65535 || n_images < 1) {
+    fprintf(stderr, "Usage: %s [-s SIZE] [-n IMAGES]\n", argv[0]);
+    return 2;
+  }
+
+  init_logging();
+  autotrace_init();
+
+  opts = at_fitting_opts_new();
+  opts->background_color = at_color_new(255, 255, 255);
+  opts->despeckle_level = 4;
+  opts->color_count = 8;
+  same = compare("color images, despeckled and reduced to 8 colors", make_color, size, n_images,
+                 opts);
+  at_fitting_opts_free(opts);
+
+  opts = at_fitting_opts_new();
+  opts->background_color = at_color_new(255, 255, 255);
+  opts->centerline = TRUE;
+  opts->preserve_width = TRUE;
+  same = compare("line drawings, traced along their centerlines", make_lines, size, n_images, opts)
+         && same;
+  at_fitting_opts_free(opts);
+
+  return same ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Benchmark for the writers.
+
+   First, the time a number takes to be written with at_sink_printf
+   is compared with snprintf, for the conversions the writers use
+   most.  Then a large image, many discs of a few colors,
+   is traced once, and the result is written in each of the text
+   formats to a buffer sink, REPEATS times.  For each format the best
+   time, the size of the output and the time against that of the trace
+   are reported.  With -c, the writers are asked to compress their
+   output, which only the PDF writer does.
+
+   Usage: bench-write [-c] [-s SIZE] [-r REPEATS] [FORMAT...]  */
+
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "autotrace.h"
+#include "output.h"
+#include "logreport.h"
+
+static const char *text_formats[] = {"svg", "eps", "ai",  "pdf", "mif", "fig", "sk",
+                                     "er",  "epd", "pov", "plt", "dxf", "p2e", NULL};
+
+#define N_NUMBERS 1000000
+
+/* Random coordinates of an image of a thousand pixels or so */
+static double *make_numbers(void)
+{
+  double *numbers = g_new(double, N_NUMBERS);
+  GRand *rand = g_rand_new_with_seed(1);
+  unsigned i;
+
+  for (i = 0; i < N_NUMBERS; i++)
+    numbers[i] = g_rand_double_range(rand, 0, 1000);
+  g_rand_free(rand);
+  return numbers;
+}
+
+static gboolean drop_data(const guchar *data, gsize size, gpointer user_data)
+{
+  return TRUE;
+}
+
+/* Nanoseconds a number takes with FORMAT, through at_sink_printf to
+   a sink that drops what it is given if SINK, or snprintf.  */
+static double time_numbers(const char *format, const double *numbers, gboolean sink)
+{
+  char text[64];
+  at_sink *buffer = at_sink_new_callback(drop_data, NULL);
+  gint64 start = g_get_monotonic_time();
+  unsigned i;
+
+  for (i = 0; i < N_NUMBERS; i++)
+    if (sink)
+      at_sink_printf(buffer, format, numbers[i]);
+    else
+      snprintf(text, sizeof(text), format, numbers[i]);
+  start = g_get_monotonic_time() - start;
+  at_sink_free(buffer);
+  return start * 1000.0 / N_NUMBERS;
+}
+
+/* Many overlapping discs of a few colors.  */
+static at_bitmap *make_discs(unsigned size)
+{
+  at_bitmap *bitmap = at_bitmap_new(size, size, 3);
+  GRand *rand = g_rand_new_with_seed(2);
+  unsigned n, row, col;
+
+  memset(bitmap->bitmap, 255, (size_t)size * size * 3);
+  for (n = 0; n < size / 2; n++) {
+    double cx = g_rand_double(rand) * size, cy = g_rand_double(rand) * size;
+    double r = (0.01 + 0.04 * g_rand_double(rand)) * size;
+    /* 64 colors at most, which MIF takes */
+    unsigned char rgb[3] = {g_rand_int_range(rand, 0, 4) * 85, g_rand_int_range(rand, 0, 4) * 85,
+                            g_rand_int_range(rand, 0, 4) * 85};
+
+    for (row = 0; row < size; row++)
+      for (col = 0; col < size; col++) {
+        double dx = col + 0.5 - cx, dy = row + 0.5 - cy;
+
+        if (dx * dx + dy * dy < r * r)
+          memcpy(bitmap->bitmap + ((size_t)row * size + col) * 3, rgb, 3);
+      }
+  }
+  g_rand_free(rand);
+  return bitmap;
+}
+
+int main(int argc, char *argv[])
+{
+  static const char *conversions[] = {"%.3f ", "%.0f ", "%g ", "%f "};
+  unsigned size = 2048, repeats = 5, i, r, n_points = 0;
+  const char **formats = text_formats;
+  at_fitting_opts_type *opts;
+  at_output_opts_type *output_opts = at_output_opts_new();
+  at_splines_type *splines;
+  at_bitmap *bitmap;
+  double *numbers, trace_seconds;
+  gint64 start;
+  int c;
+
+  while ((c = getopt(argc, argv, "cs:r:")) != -1) {
+    switch (c) {
+    case 'c':
+      output_opts->compress = TRUE;
+      break;
+    case 's':
+      size = atoi(optarg);
+      break;
+    case 'r':
+      repeats = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-c] [-s SIZE] [-r REPEATS] [FORMAT...]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (size < 16 || size > 65535 || repeats < 1) {
+    fprintf(stderr, "Usage: %s [-c] [-s SIZE] [-r REPEATS] [FORMAT...]\n", argv[0]);
+    return 2;
+  }
+  if (optind < argc)
+    formats = (const char **)argv + optind;
+
+  init_logging();
+  autotrace_init();
+  setlocale(LC_NUMERIC, "C");
+
+  numbers = make_numbers();
+  printf("# a number, nanoseconds\n");
+  printf("conversion at_sink_printf snprintf\n");
+  for (i = 0; i < G_N_ELEMENTS(conversions); i++)
+    printf("%-10s %14.1f %8.1f\n", conversions[i], time_numbers(conversions[i], numbers, TRUE),
+           time_numbers(conversions[i], numbers, FALSE));
+  g_free(numbers);
+
+  bitmap = make_discs(size);
+  opts = at_fitting_opts_new();
+  opts->background_color = at_color_new(255, 255, 255);
+  start = g_get_monotonic_time();
+  splines = at_splines_new(bitmap, opts, NULL, NULL);
+  trace_seconds = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+  if (!splines) {
+    fprintf(stderr, "bench-write: tracing failed\n");
+    return 1;
+  }
+  for (i = 0; i < splines->length; i++)
+    n_points += splines->data[i].length;
+
+  printf("# %ux%u discs: %u spline lists, %u splines, traced in %.3f seconds\n", size, size,
+         splines->length, n_points, trace_seconds);
+  printf("format  seconds      bytes  of-trace\n");
+  for (i = 0; formats[i]; i++) {
+    at_spline_writer *writer = at_output_get_handler_by_suffix((gchar *)formats[i]);
+    double best = HUGE_VAL;
+    gsize bytes = 0;
+
+    if (!writer) {
+      fprintf(stderr, "bench-write: no writer for %s\n", formats[i]);
+      continue;
+    }
+    for (r = 0; r < repeats; r++) {
+      at_sink *sink = at_sink_new_buffer();
+      double seconds;
+
+      start = g_get_monotonic_time();
+      at_splines_write_sink(writer, sink, "bench", output_opts, splines, NULL, NULL);
+      seconds = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+      best = MIN(best, seconds);
+      at_sink_get_data(sink, &bytes);
+      at_sink_free(sink);
+    }
+    printf("%-6s %8.4f %10lu %9.3f\n", formats[i], best, (unsigned long)bytes,
+           best / trace_seconds);
+  }
+
+  at_splines_free(splines);
+  at_fitting_opts_free(opts);
+  at_output_opts_free(output_opts);
+  return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Test for at_bitmap_wrap and at_splines_new_const.
+
+   Every image given on the command line is copied into a buffer with
+   padded rows, wrapped with at_bitmap_wrap and traced with a few
+   option sets, first with at_splines_new_const, which must leave the
+   buffer alone, then with at_splines_new, which must leave the
+   padding between the rows alone.  The results must be byte-identical
+   to tracing the image as read, and the buffer must be released
+   exactly once.
+
+   Usage: bitmap-wrap IMAGE...  */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "autotrace.h"
+#include "input.h"
+#include "logreport.h"
+
+#define N_OPTION_SETS 4
+
+/* Bytes added at the end of each row */
+#define ROW_PADDING 13
+
+static int n_destroyed;
+
+static void destroy_pixels(gpointer data)
+{
+  n_destroyed++;
+  g_free(data);
+}
+
+static void set_options(at_fitting_opts_type *opts, int option_set)
+{
+  switch (option_set) {
+  case 1:
+    opts->centerline = TRUE;
+    break;
+  case 2:
+    opts->color_count = 8;
+    opts->despeckle_level = 2;
+    break;
+  case 3:
+    opts->threads = 4;
+    break;
+  default:
+    break;
+  }
+}
+
+/* Trace BITMAP with at_splines_new_const if KEEP, or at_splines_new,
+   and write the result as SVG.  */
+static GBytes *trace(at_bitmap *bitmap, int option_set, gboolean keep)
+{
+  at_spline_writer *writer = at_output_get_handler_by_suffix("svg");
+  at_fitting_opts_type *opts = at_fitting_opts_new();
+  at_splines_type *splines;
+  FILE *fp;
+  long size;
+  gchar *data;
+
+  set_options(opts, option_set);
+  if (keep)
+    splines = at_splines_new_const(bitmap, opts, NULL, NULL, NULL, NULL, NULL, NULL);
+  else
+    splines = at_splines_new(bitmap, opts, NULL, NULL);
+  at_fitting_opts_free(opts);
+  if (!splines)
+    return NULL;
+
+  fp = tmpfile();
+  if (!fp) {
+    at_splines_free(splines);
+    return NULL;
+  }
+  at_splines_write(writer, fp, "wrap", NULL, splines, NULL, NULL);
+  at_splines_free(splines);
+  fflush(fp);
+  size = ftell(fp);
+  data = g_malloc(size > 0 ? size : 1);
+  rewind(fp);
+  if (size > 0 && fread(data, size, 1, fp) != 1)
+    size = 0;
+  fclose(fp);
+  return g_bytes_new_take(data, size);
+}
+
+/* Copy BITMAP into a buffer whose rows are ROW_PADDING bytes apart
+   more than needed, with garbage in between.  */
+static at_bitmap *wrap_padded(at_bitmap *bitmap)
+{
+  unsigned width = at_bitmap_get_width(bitmap), height = at_bitmap_get_height(bitmap);
+  unsigned planes = at_bitmap_get_planes(bitmap);
+  unsigned stride = width * planes + ROW_PADDING, row;
+  unsigned char *data = g_malloc((gsize)stride * height + 1);
+
+  memset(data, 0x5a, (gsize)stride * height + 1);
+  for (row = 0; row < height; row++)
+    memcpy(data + (gsize)row * stride, AT_BITMAP_PIXEL(bitmap, row, 0), width * planes);
+  return at_bitmap_wrap(data, width, height, planes, stride, destroy_pixels);
+}
+
+/* Whether the garbage wrap_padded put between the rows of WRAPPED is
+   still there.  */
+static gboolean padding_intact(at_bitmap *wrapped)
+{
+  unsigned row_size = at_bitmap_get_width(wrapped) * at_bitmap_get_planes(wrapped), row, i;
+  unsigned stride = row_size + ROW_PADDING;
+
+  if (AT_BITMAP_STRIDE(wrapped) != stride)
+    return FALSE;
+  for (row = 0; row < at_bitmap_get_height(wrapped); row++)
+    for (i = row_size; i < stride; i++)
+      if (AT_BITMAP_BITS(wrapped)[(gsize)row * stride + i] != 0x5a)
+        return FALSE;
+  return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+  int i, option_set, failures = 0, n_wrapped = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s IMAGE...\n", argv[0]);
+    return 2;
+  }
+
+  init_logging();
+  autotrace_init();
+
+  for (i = 1; i < argc; i++) {
+    at_bitmap_reader *reader = at_input_get_handler(argv[i]);
+
+    if (!reader) {
+      fprintf(stderr, "bitmap-wrap: cannot read %s\n", argv[i]);
+      return 1;
+    }
+    for (option_set = 0; option_set < N_OPTION_SETS; option_set++) {
+      at_bitmap *bitmap = at_bitmap_read(reader, argv[i], NULL, NULL, NULL);
+      at_bitmap *wrapped = wrap_padded(bitmap);
+      gsize size = (gsize)AT_BITMAP_STRIDE(wrapped) * AT_BITMAP_HEIGHT(wrapped) + 1;
+      unsigned char *pixels = g_malloc(size);
+      GBytes *expected, *kept, *result;
+
+      memcpy(pixels, AT_BITMAP_BITS(wrapped), size);
+      expected = trace(bitmap, option_set, FALSE);
+      kept = trace(wrapped, option_set, TRUE);
+      if (memcmp(pixels, AT_BITMAP_BITS(wrapped), size) != 0) {
+        fprintf(stderr, "bitmap-wrap: %s (option set %d) modified by at_splines_new_const\n",
+                argv[i], option_set);
+        failures++;
+      }
+      result = trace(wrapped, option_set, FALSE);
+      if (!padding_intact(wrapped)) {
+        fprintf(stderr, "bitmap-wrap: %s (option set %d) rows moved by at_splines_new\n",
+                argv[i], option_set);
+        failures++;
+      }
+      if (!expected || !kept || !result || !g_bytes_equal(expected, kept) ||
+          !g_bytes_equal(expected, result)) {
+        fprintf(stderr, "bitmap-wrap: %s (option set %d) differs when wrapped\n", argv[i],
+                option_set);
+        failures++;
+      }
+      if (expected)
+        g_bytes_unref(expected);
+      if (kept)
+        g_bytes_unref(kept);
+      if (result)
+        g_bytes_unref(result);
+      g_free(pixels);
+      at_bitmap_free(bitmap);
+      at_bitmap_free(wrapped);
+      n_wrapped++;
+    }
+  }
+
+  if (n_destroyed != n_wrapped) {
+    fprintf(stderr, "bitmap-wrap: %d of %d wrapped buffers released\n", n_destroyed, n_wrapped);
+    failures++;
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,319 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Test for the loops of fit-kernels.c.
+
+   Random curves of every length up to a few hundred points, with
+   random tangents and splines, are run through the loops at each
+   level the processor has.  The normal equations must be within a
+   small part of the size of their terms of the sums made one point at
+   a time with the functions of vector.c, as fit.c made them; the
+   distances must be within rounding of evaluate_spline's.  All the
+   levels must give the very same numbers, and so must the distances
+   of a curve worked out a part at a time.  Points on a spline, with
+   t values a little off, must come much closer to it after a few
+   steps of reparameterization.
+
+   Usage: fit-kernels [COUNT]  */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "arena.h"
+#include "curve.h"
+#include "fit-kernels.h"
+#include "spline.h"
+#include "vector.h"
+
+/* How far the sums may be from the sums one point at a time, as a
+   part of the sum of the sizes of their terms */
+#define SUM_TOLERANCE 1e-4
+/* How far a distance may be from the one of evaluate_spline */
+#define DISTANCE_TOLERANCE 1e-5
+
+/* What the loops gave at one level */
+typedef struct {
+  gfloat C[2][2], X[2];
+  gfloat *errors, *distances;
+} results_type;
+
+static unsigned long checks, failures;
+
+static guint64 random_state = 88172645463325252u;
+
+static guint64 random_bits(void)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return random_state;
+}
+
+/* A number between LOW and HIGH */
+static gfloat random_range(double low, double high)
+{
+  return (gfloat)(low + (random_bits() >> 11) * (1.0 / 9007199254740992.0) * (high - low));
+}
+
+static at_real_coord random_point(gboolean flat)
+{
+  at_real_coord p;
+
+  p.x = random_range(0, 1000);
+  p.y = random_range(0, 1000);
+  p.z = flat ? 0 : random_range(0, 255);
+  return p;
+}
+
+static vector_type random_tangent(gboolean flat)
+{
+  vector_type v;
+
+  v.dx = random_range(-1, 1);
+  v.dy = random_range(-1, 1);
+  v.dz = flat ? 0 : random_range(-1, 1);
+  return normalize(v);
+}
+
+/* A curve of LENGTH points near SPLINE, with increasing t values from
+   0 to 1 */
+static curve_type random_curve(arena_type *arena, spline_type spline, unsigned length,
+                               gboolean flat)
+{
+  curve_type curve = new_curve(arena);
+  unsigned i;
+
+  for (i = 0; i < length; i++) {
+    gfloat t = length > 1 ? (gfloat)i / (length - 1) : 0;
+    at_real_coord p = evaluate_spline(spline, t);
+
+    p.x += random_range(-2, 2);
+    p.y += random_range(-2, 2);
+    if (!flat)
+      p.z += random_range(-2, 2);
+    append_point(arena, curve, p);
+    /* Not evenly spaced, as from the lengths of the chords */
+    CURVE_T(curve, i) = i == 0 || i == length - 1 ? t : t + random_range(-0.2, 0.2) / length;
+  }
+  return curve;
+}
+
+static void check(gboolean ok, const char *what, unsigned length, const char *level)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures <= 20)
+      fprintf(stderr, "fit-kernels: %s of %u points wrong at %s\n", what, length, level);
+  }
+}
+
+/* The normal equations of CURVE one point at a time, and the sizes of
+   their terms in SIZE: of C[0][0], C[0][1], C[1][1], X[0] and X[1].  */
+static void reference_sums(curve_type curve, vector_type t1_hat, vector_type t2_hat,
+                           gfloat C[2][2], gfloat X[2], double size[5])
+{
+  vector_type start_vector = make_vector(CURVE_POINT(curve, 0));
+  vector_type end_vector = make_vector(LAST_CURVE_POINT(curve));
+  unsigned i;
+
+  memset(C, 0, sizeof(gfloat[2][2]));
+  memset(X, 0, sizeof(gfloat[2]));
+  memset(size, 0, sizeof(double[5]));
+  for (i = 0; i < CURVE_LENGTH(curve); i++) {
+    gfloat t = CURVE_T(curve, i), u = (gfloat)1.0 - t;
+    vector_type Ai[2], temp;
+
+    Ai[0] = Vmult_scalar(t1_hat, (gfloat)3.0 * t * (u * u));
+    Ai[1] = Vmult_scalar(t2_hat, (gfloat)3.0 * (t * t) * u);
+    temp = make_vector(Vsubtract_point(
+        CURVE_POINT(curve, i),
+        Vadd(Vmult_scalar(start_vector, u * u * u),
+             Vadd(Vmult_scalar(start_vector, (gfloat)3.0 * t * (u * u)),
+                  Vadd(Vmult_scalar(end_vector, (gfloat)3.0 * (t * t) * u),
+                       Vmult_scalar(end_vector, t * t * t))))));
+    C[0][0] += Vdot(Ai[0], Ai[0]);
+    C[0][1] += Vdot(Ai[0], Ai[1]);
+    C[1][1] += Vdot(Ai[1], Ai[1]);
+    X[0] += Vdot(temp, Ai[0]);
+    X[1] += Vdot(temp, Ai[1]);
+    size[0] += fabs(Vdot(Ai[0], Ai[0]));
+    size[1] += fabs(Vdot(Ai[0], Ai[1]));
+    size[2] += fabs(Vdot(Ai[1], Ai[1]));
+    size[3] += fabs(Vdot(temp, Ai[0]));
+    size[4] += fabs(Vdot(temp, Ai[1]));
+  }
+  C[1][0] = C[0][1];
+}
+
+static gboolean near(double value, double reference, double size, double tolerance)
+{
+  return fabs(value - reference) <= tolerance * size + 1e-30;
+}
+
+static gboolean same(const gfloat *a, const gfloat *b, unsigned n)
+{
+  return memcmp(a, b, n * sizeof(gfloat)) == 0;
+}
+
+/* Check one curve at each level.  */
+static void check_curve(curve_type curve, spline_type spline, vector_type t1_hat,
+                        vector_type t2_hat, curve_points_type *points)
+{
+  unsigned n = CURVE_LENGTH(curve), i;
+  gfloat C[2][2], X[2];
+  double size[5];
+  gfloat *errors = g_new(gfloat, n), *distances = g_new(gfloat, n);
+  results_type results[FIT_KERNELS_N_LEVELS];
+  fit_kernels_level level, first = FIT_KERNELS_N_LEVELS;
+  at_real_coord start = START_POINT(spline), end = END_POINT(spline);
+  gfloat A = end.x - start.x, B = end.y - start.y, Cz = end.z - start.z;
+  gfloat start_end_dist = A * A + B * B + Cz * Cz;
+
+  reference_sums(curve, t1_hat, t2_hat, C, X, size);
+  for (i = 0; i < n; i++) {
+    at_real_coord p = CURVE_POINT(curve, i), s = evaluate_spline(spline, CURVE_T(curve, i));
+    gfloat a = s.x - start.x, b = s.y - start.y, c = s.z - start.z;
+    gfloat w = (A * a + B * b + Cz * c) / start_end_dist;
+
+    errors[i] = (gfloat)sqrt((p.x - s.x) * (p.x - s.x) + (p.y - s.y) * (p.y - s.y) +
+                             (p.z - s.z) * (p.z - s.z));
+    distances[i] = (gfloat)sqrt((a - A * w) * (a - A * w) + (b - B * w) * (b - B * w) +
+                                (c - Cz * w) * (c - Cz * w));
+  }
+
+  gather_curve_points(points, curve);
+  for (level = 0; level < FIT_KERNELS_N_LEVELS; level++) {
+    results_type *r = &results[level];
+    const char *name = fit_kernels_level_name(level);
+
+    if (!fit_kernels_set_level(level))
+      continue;
+    fit_normal_equations(points, t1_hat, t2_hat, CURVE_POINT(curve, 0), LAST_CURVE_POINT(curve),
+                         r->C, r->X);
+    check(near(r->C[0][0], C[0][0], size[0], SUM_TOLERANCE), "C[0][0]", n, name);
+    check(near(r->C[0][1], C[0][1], size[1], SUM_TOLERANCE), "C[0][1]", n, name);
+    check(r->C[1][0] == r->C[0][1], "C[1][0]", n, name);
+    check(near(r->C[1][1], C[1][1], size[2], SUM_TOLERANCE), "C[1][1]", n, name);
+    check(near(r->X[0], X[0], size[3], SUM_TOLERANCE), "X[0]", n, name);
+    check(near(r->X[1], X[1], size[4], SUM_TOLERANCE), "X[1]", n, name);
+
+    r->errors = g_new(gfloat, n);
+    r->distances = g_new(gfloat, n);
+    /* A part at a time, from odd places, must give the same */
+    for (i = 0; i < n; i += 1 + 7 * (i % 5))
+      fit_point_errors_part(points, &spline, i, MIN(1 + 7 * (i % 5), n - i));
+    memcpy(r->errors, points->result, n * sizeof(gfloat));
+    fit_point_errors(points, &spline);
+    check(same(r->errors, points->result, n), "errors by parts", n, name);
+    fit_line_distances(points, &spline);
+    memcpy(r->distances, points->result, n * sizeof(gfloat));
+    for (i = 0; i < n; i++) {
+      check(near(r->errors[i], errors[i], 1 + errors[i], DISTANCE_TOLERANCE), "error", n, name);
+      check(near(r->distances[i], distances[i], 1 + distances[i], DISTANCE_TOLERANCE), "distance",
+            n, name);
+    }
+
+    if (first == FIT_KERNELS_N_LEVELS)
+      first = level;
+    else {
+      results_type *f = &results[first];
+
+      check(same(&r->C[0][0], &f->C[0][0], 4) && same(r->X, f->X, 2), "normal equations", n,
+            name);
+      check(same(r->errors, f->errors, n), "errors", n, name);
+      check(same(r->distances, f->distances, n), "distances", n, name);
+    }
+  }
+  for (level = 0; level < FIT_KERNELS_N_LEVELS; level++)
+    if (fit_kernels_set_level(level)) {
+      g_free(results[level].errors);
+      g_free(results[level].distances);
+    }
+  g_free(errors);
+  g_free(distances);
+}
+
+/* The distance of POINTS from SPLINE at their t values, all told */
+static double total_error(curve_points_type *points, spline_type spline)
+{
+  double total = 0;
+  unsigned i;
+
+  fit_point_errors(points, &spline);
+  for (i = 0; i < points->length; i++)
+    total += points->result[i];
+  return total;
+}
+
+/* Check reparameterizing LENGTH points on SPLINE.  */
+static void check_reparameterize(arena_type *arena, spline_type spline, unsigned length,
+                                 curve_points_type *points)
+{
+  curve_type curve = new_curve(arena);
+  double before, after;
+  unsigned i, step;
+
+  for (i = 0; i < length; i++) {
+    gfloat t = (gfloat)i / (length - 1);
+
+    append_point(arena, curve, evaluate_spline(spline, t));
+    CURVE_T(curve, i) = i == 0 || i == length - 1 ? t : t + random_range(-0.2, 0.2) / length;
+  }
+  gather_curve_points(points, curve);
+  before = total_error(points, spline);
+  for (step = 0; step < 3; step++) {
+    gfloat *t = points->t;
+
+    fit_reparameterize(points, &spline);
+    points->t = points->next_t;
+    points->next_t = t;
+  }
+  after = total_error(points, spline);
+  check(after <= before * 0.1 + 1e-3 * length, "reparameterization", length, "any level");
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 20;
+  curve_points_type points = EMPTY_CURVE_POINTS;
+  fit_kernels_level level, best = fit_kernels_get_level();
+  unsigned length, r;
+
+  printf("levels:");
+  for (level = 0; level < FIT_KERNELS_N_LEVELS; level++)
+    if (fit_kernels_set_level(level))
+      printf(" %s", fit_kernels_level_name(level));
+  printf("\n");
+
+  for (length = 2; length <= 300; length += length < 40 ? 1 : 7)
+    for (r = 0; r < count; r++) {
+      arena_type *arena = new_arena();
+      gboolean flat = r % 2 == 0;
+      spline_type spline = {0};
+      vector_type t1_hat = random_tangent(flat), t2_hat = random_tangent(flat);
+      curve_type curve;
+
+      START_POINT(spline) = random_point(flat);
+      CONTROL1(spline) = random_point(flat);
+      CONTROL2(spline) = random_point(flat);
+      END_POINT(spline) = random_point(flat);
+      SPLINE_DEGREE(spline) = CUBICTYPE;
+      curve = random_curve(arena, spline, length, flat);
+      check_curve(curve, spline, t1_hat, t2_hat, &points);
+      check_reparameterize(arena, spline, length, &points);
+      free_arena(arena);
+    }
+  fit_kernels_set_level(best);
+  free_curve_points(&points);
+
+  printf("%lu checks, %lu failures\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Test for writing to sinks.
+
+   Every image given on the command line is traced, and the result is
+   written in every output format with at_splines_write_sink, to a
+   buffer sink and to a callback sink, and with at_splines_write, to a
+   temporary file.  The image is also traced and written at once with
+   at_splines_new_write_sink to a callback sink.  All four outputs must
+   be the same, but for the lines giving the date, which may have
+   changed between them, and must not be empty.  A writer to a FILE
+   is registered for the test, which gives a temporary file to write
+   to a buffer or a callback.
+
+   Last, a callback that refuses its data must make the sink fail and
+   at_splines_new_write_sink return FALSE.
+
+   Usage: output-sink IMAGE...  */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "autotrace.h"
+#include "output.h"
+#include "logreport.h"
+
+/* A writer of the kind registered with at_output_add_handler */
+static int write_to_stream(FILE *file, gchar *name, int llx, int lly, int urx, int ury,
+                           at_output_opts_type *opts, at_splines_type shape, at_msg_func msg_func,
+                           gpointer msg_data, gpointer user_data)
+{
+  unsigned i;
+
+  fprintf(file, "%s %d %d %d %d\n", name, llx, lly, urx, ury);
+  for (i = 0; i < shape.length; i++)
+    fprintf(file, "%u splines\n", shape.data[i].length);
+  return 0;
+}
+
+static gboolean append_data(const guchar *data, gsize size, gpointer user_data)
+{
+  g_byte_array_append(user_data, data, size);
+  return TRUE;
+}
+
+static gboolean refuse_data(const guchar *data, gsize size, gpointer user_data)
+{
+  return FALSE;
+}
+
+/* The SIZE bytes at DATA up to the next new line, the new line
+   included, and where the line after starts in *NEXT.  */
+static gsize line_length(const guchar *data, gsize size, const guchar **next)
+{
+  const guchar *end = memchr(data, '\n', size);
+  gsize length = end ? (gsize)(end - data) + 1 : size;
+
+  *next = data + length;
+  return length;
+}
+
+static gboolean dated(const guchar *line, gsize length)
+{
+  return g_strstr_len((const gchar *)line, length, "Date") != NULL;
+}
+
+/* Whether the output in A and B is the same, but for lines with a date */
+static gboolean same_output(const guchar *a, gsize a_size, const guchar *b, gsize b_size)
+{
+  const guchar *a_end = a + a_size, *b_end = b + b_size;
+
+  if (a_size == b_size && memcmp(a, b, a_size) == 0)
+    return TRUE;
+  while (a < a_end && b < b_end) {
+    const guchar *a_next, *b_next;
+    gsize a_length = line_length(a, a_end - a, &a_next);
+    gsize b_length = line_length(b, b_end - b, &b_next);
+
+    if ((a_length != b_length || memcmp(a, b, a_length) != 0)
+        && !(dated(a, a_length) && dated(b, b_length)))
+      return FALSE;
+    a = a_next;
+    b = b_next;
+  }
+  return a == a_end && b == b_end;
+}
+
+static GByteArray *write_to_file(at_spline_writer *writer, at_splines_type *splines)
+{
+  GByteArray *output = g_byte_array_new();
+  FILE *fp = tmpfile();
+  guchar buffer[BUFSIZ];
+  size_t n;
+
+  if (!fp)
+    return output;
+  at_splines_write(writer, fp, "sink", NULL, splines, NULL, NULL);
+  rewind(fp);
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+    g_byte_array_append(output, buffer, n);
+  fclose(fp);
+  return output;
+}
+
+/* Write SPLINES, traced from BITMAP, in the format of SUFFIX in all
+   the ways, and return the number of failures.  */
+static int check_format(const char *name, at_bitmap *bitmap, at_fitting_opts_type *opts,
+                        at_splines_type *splines, const char *suffix)
+{
+  at_spline_writer *writer = at_output_get_handler_by_suffix((gchar *)suffix);
+  GByteArray *called = g_byte_array_new(), *traced = g_byte_array_new(), *filed;
+  at_sink *buffer = at_sink_new_buffer();
+  at_sink *callback = at_sink_new_callback(append_data, called);
+  at_sink *tracing = at_sink_new_callback(append_data, traced);
+  at_bitmap *copy = at_bitmap_copy(bitmap);
+  const guchar *data;
+  gsize size;
+  int failures = 0;
+
+  at_splines_write_sink(writer, buffer, "sink", NULL, splines, NULL, NULL);
+  at_splines_write_sink(writer, callback, "sink", NULL, splines, NULL, NULL);
+  filed = write_to_file(writer, splines);
+  if (!at_splines_new_write_sink(copy, opts, writer, tracing, "sink", NULL, NULL, NULL, NULL, NULL,
+                                 NULL, NULL, NULL)) {
+    fprintf(stderr, "output-sink: %s could not be traced and written as %s\n", name, suffix);
+    failures++;
+  }
+
+  data = at_sink_get_data(buffer, &size);
+  if (size == 0 || at_sink_tell(buffer) != size || data[size] != '\0') {
+    fprintf(stderr, "output-sink: %s written as %s: %lu bytes in the buffer, %lu told\n", name,
+            suffix, (unsigned long)size, (unsigned long)at_sink_tell(buffer));
+    failures++;
+  }
+  if (!same_output(data, size, called->data, called->len)) {
+    fprintf(stderr, "output-sink: %s written as %s differs through a callback\n", name, suffix);
+    failures++;
+  }
+  if (!same_output(data, size, filed->data, filed->len)) {
+    fprintf(stderr, "output-sink: %s written as %s differs in a file\n", name, suffix);
+    failures++;
+  }
+  if (!same_output(data, size, traced->data, traced->len)) {
+    fprintf(stderr, "output-sink: %s written as %s differs when written while tracing\n", name,
+            suffix);
+    failures++;
+  }
+
+  at_sink_free(buffer);
+  at_sink_free(callback);
+  at_sink_free(tracing);
+  g_byte_array_free(called, TRUE);
+  g_byte_array_free(traced, TRUE);
+  g_byte_array_free(filed, TRUE);
+  at_bitmap_free(copy);
+  return failures;
+}
+
+/* A sink whose callback refuses its data must fail.  */
+static int check_failure(at_bitmap *bitmap, at_fitting_opts_type *opts)
+{
+  at_sink *sink = at_sink_new_callback(refuse_data, NULL);
+  at_bitmap *copy = at_bitmap_copy(bitmap);
+  gboolean written;
+  int failures = 0;
+
+  written = at_splines_new_write_sink(copy, opts, at_output_get_handler_by_suffix("svg"), sink,
+                                      "sink", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+  if (written || !at_sink_failed(sink)) {
+    fprintf(stderr, "output-sink: a refused write went unnoticed\n");
+    failures++;
+  }
+  at_sink_free(sink);
+  at_bitmap_free(copy);
+  return failures;
+}
+
+int main(int argc, char *argv[])
+{
+  at_fitting_opts_type *opts;
+  const char **formats;
+  int i, j, failures = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s IMAGE...\n", argv[0]);
+    return 2;
+  }
+
+  init_logging();
+  autotrace_init();
+  at_output_add_handler("stream", "Test writer to a FILE", write_to_stream);
+  opts = at_fitting_opts_new();
+  formats = at_output_list_new();
+
+  for (i = 1; i < argc; i++) {
+    at_bitmap_reader *reader = at_input_get_handler(argv[i]);
+    at_bitmap *bitmap;
+    at_splines_type *splines;
+
+    if (!reader) {
+      fprintf(stderr, "output-sink: cannot read %s\n", argv[i]);
+      return 1;
+    }
+    bitmap = at_bitmap_read(reader, argv[i], NULL, NULL, NULL);
+    splines = at_splines_new_const(bitmap, opts, NULL, NULL, NULL, NULL, NULL, NULL);
+    if (!splines) {
+      fprintf(stderr, "output-sink: cannot trace %s\n", argv[i]);
+      return 1;
+    }
+    /* The list holds a suffix and a description for each format */
+    for (j = 0; formats[j]; j += 2)
+      failures += check_format(argv[i], bitmap, opts, splines, formats[j]);
+    if (i == 1)
+      failures += check_failure(bitmap, opts);
+    at_splines_free(splines);
+    at_bitmap_free(bitmap);
+  }
+
+  at_output_list_free(formats);
+  at_fitting_opts_free(opts);
+  return failures ? 1 : 0;
+}
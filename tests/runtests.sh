@@ -18,6 +18,16 @@ echo
 
 # Export custom location Autotrace binary if supplied.
 export AUTOTRACE
+# Likewise for the thread stress test binary.
+export THREAD_STRESS
+# And for the bitmap wrapping test binary.
+export BITMAP_WRAP
+# And for the output sink test binary.
+export OUTPUT_SINK
+# And for the sink printf test binary.
+export SINK_PRINTF
+# And for the fitting loops test binary.
+export FIT_KERNELS
 # Set flag that we want verbose exit codes.
 export VERBOSE_EXITSTATUS=1
 
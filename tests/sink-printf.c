@@ -0,0 +1,198 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Test for the numbers written by at_sink_printf.
+
+   Random numbers, and numbers picked to be hard to round, are written
+   with the conversions the writers use, and more, by at_sink_printf
+   to a buffer sink, and by snprintf in the C locale.  The two must be
+   the same.  at_sink_printf runs in a locale whose decimal point is a
+   comma, when there is one, to check that it does not depend on it.
+
+   Usage: sink-printf [COUNT]  */
+
+#include <float.h>
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "sink.h"
+
+static const char *real_formats[] = {"%g",    "%.3f", "%.0f",   "%f",     "%.1f",  "%.2f",
+                                     "%.4f",  "%.6g", "%.3g",   "%.15g",  "%.17g", "%.10f",
+                                     "%e",    "%.3e", "%8.3f|", "%-10g|", "%+.2f", "%#g",
+                                     "%G",    "%.0g", "%F",     "%lf",    "%5.1g"};
+
+/* The locale at_sink_printf runs in, or NULL for "C" */
+static const char *comma_locale;
+static unsigned long checks, failures;
+
+static guint64 random_state = 88172645463325252u;
+
+static guint64 random_bits(void)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return random_state;
+}
+
+/* A number between 0 and 1 */
+static double random_unit(void)
+{
+  return (random_bits() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void compare(const char *expected, at_sink *sink, const char *format)
+{
+  const guchar *data;
+  gsize size;
+
+  checks++;
+  data = at_sink_get_data(sink, &size);
+  if (size != strlen(expected) || memcmp(data, expected, size) != 0) {
+    if (failures++ < 20)
+      fprintf(stderr, "sink-printf: \"%s\" gives \"%s\", not \"%s\"\n", format, (const char *)data,
+              expected);
+  }
+  at_sink_free(sink);
+}
+
+static void use_comma_locale(void)
+{
+  if (comma_locale)
+    setlocale(LC_NUMERIC, comma_locale);
+}
+
+static void check_real(const char *format, double value)
+{
+  char expected[512];
+  at_sink *sink = at_sink_new_buffer();
+
+  setlocale(LC_NUMERIC, "C");
+  snprintf(expected, sizeof(expected), format, value);
+  use_comma_locale();
+  at_sink_printf(sink, format, value);
+  compare(expected, sink, format);
+}
+
+static void check_reals(double value)
+{
+  unsigned i;
+
+  for (i = 0; i < G_N_ELEMENTS(real_formats); i++) {
+    check_real(real_formats[i], value);
+    check_real(real_formats[i], -value);
+  }
+}
+
+/* The conversions other than of reals, all in one format */
+static void check_others(long long n)
+{
+  const char *format = "%d %ld %zu %u %02x %.2x %.3d %010zu %#lx %c%s|%5s|%-4d|%*d %.*f %% %hhd "
+                       "%lld %llu %i %o %X %+d % d %.1s";
+  char expected[512];
+  at_sink *sink = at_sink_new_buffer();
+  int i = (int)n;
+  char c = 'a' + (n & 15);
+
+  setlocale(LC_NUMERIC, "C");
+  snprintf(expected, sizeof(expected), format, i, (long)n, (size_t)(n & 0xffffff), (unsigned)i,
+           i & 0xff, i & 0xff, i % 1000, (size_t)(n & 0xffff), (unsigned long)n, c, "text", "ab",
+           i % 100, (int)(n & 7), i, (int)(n & 3), n * 1e-3, i, n, (unsigned long long)n, i,
+           (unsigned)i, (unsigned)i, i, i, "xyz");
+  use_comma_locale();
+  at_sink_printf(sink, format, i, (long)n, (size_t)(n & 0xffffff), (unsigned)i, i & 0xff, i & 0xff,
+                 i % 1000, (size_t)(n & 0xffff), (unsigned long)n, c, "text", "ab", i % 100,
+                 (int)(n & 7), i, (int)(n & 3), n * 1e-3, i, n, (unsigned long long)n, i,
+                 (unsigned)i, (unsigned)i, i, i, "xyz");
+  compare(expected, sink, format);
+}
+
+/* A 0 byte goes through %c, and long text is not cut short */
+static void check_specials(void)
+{
+  at_sink *sink = at_sink_new_buffer();
+  const guchar *data;
+  gsize size;
+
+  at_sink_printf(sink, "a%cb", 0);
+  data = at_sink_get_data(sink, &size);
+  checks++;
+  if (size != 3 || memcmp(data, "a\0b", 3) != 0) {
+    fprintf(stderr, "sink-printf: a 0 byte is lost\n");
+    failures++;
+  }
+  at_sink_free(sink);
+
+  check_real("%f", DBL_MAX);
+  check_real("%.100f", 1.0 / 3);
+  check_real("%.60g", 0.1);
+  check_real("%g", INFINITY);
+  check_real("%f", -INFINITY);
+  check_real("%g", NAN);
+  check_real("%.3f", 0.0);
+  check_real("%.3f", -0.0);
+  check_real("%g", -0.0);
+  check_real("%.3f", -0.0001);
+}
+
+int main(int argc, char *argv[])
+{
+  static const char *commas[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8",
+                                 "de_DE",       "fr_FR",      "nl_NL.UTF-8"};
+  long count = argc > 1 ? atol(argv[1]) : 2000;
+  long i;
+  int k;
+
+  if (count <= 0) {
+    fprintf(stderr, "Usage: %s [COUNT]\n", argv[0]);
+    return 2;
+  }
+
+  for (k = 0; k < (int)G_N_ELEMENTS(commas) && !comma_locale; k++)
+    if (setlocale(LC_NUMERIC, commas[k]) && strcmp(localeconv()->decimal_point, ",") == 0)
+      comma_locale = commas[k];
+
+  check_specials();
+  for (k = -20; k <= 20; k++) {
+    double power = pow(10, k);
+
+    check_reals(power);
+    check_reals(nextafter(power, 0));
+    check_reals(nextafter(power, INFINITY));
+  }
+  /* Where %g switches to an exponent, after rounding */
+  check_reals(999999.5);
+  check_reals(0.000099999995);
+  for (i = 0; i < count; i++) {
+    double unit = random_unit();
+    guint64 bits = random_bits();
+    double value;
+
+    /* Coordinates */
+    check_reals(unit * 10000);
+    check_reals(unit * 10);
+    /* Halves of the last digit kept, a little off or not */
+    value = floor(unit * 1e7) / 1000 + 0.0005;
+    check_reals(value);
+    check_reals(nextafter(value, 0));
+    check_reals(floor(unit * 1e6) / 8);
+    /* All magnitudes */
+    check_reals(unit * pow(10, (int)(bits % 50) - 25));
+    memcpy(&value, &bits, sizeof(value));
+    check_reals(value);
+    check_others((long long)bits >> (bits % 60));
+  }
+
+  printf("sink-printf: %lu of %lu differ%s\n", failures, checks,
+         comma_locale ? "" : " (no locale with a decimal comma)");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+/*
+ * SPDX-FileCopyrightText: © 2026 Autotrace contributors
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/* Thread stress test for libautotrace.
+
+   Every image given on the command line is traced with a few option
+   sets and written in a number of output formats, first serially and
+   then from several threads at once.  The concurrent results must be
+   byte-identical to the serial ones.  Tracing straight to the first
+   format with at_splines_new_write must give the same bytes too.
+
+   Usage: thread-stress [-t THREADS] [-n ROUNDS] IMAGE...  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "autotrace.h"
+#include "logreport.h"
+
+/* Formats whose output does not depend on the time of day and that
+   support centerline tracing.  */
+static const char *formats[] = {"svg", "pdf",  "fig", "sk",  "mif", "emf", "dxf",
+                                "cgm", "dr2d", "plt", "ild", "p2e", NULL};
+
+#define N_OPTION_SETS 4
+
+typedef struct {
+  gchar *image;
+  int option_set;
+  /* Serial result, one buffer per format */
+  GBytes *expected[G_N_ELEMENTS(formats)];
+} job_type;
+
+typedef struct {
+  job_type *jobs;
+  int n_jobs;
+  int rounds;
+  int offset;
+  int mismatches;
+} worker_type;
+
+static void set_options(at_fitting_opts_type *opts, int option_set)
+{
+  switch (option_set) {
+  case 1:
+    opts->centerline = TRUE;
+    break;
+  case 2:
+    opts->color_count = 8;
+    opts->despeckle_level = 2;
+    break;
+  case 3:
+    /* Fitting threads nested inside the tracing threads */
+    opts->color_count = 8;
+    opts->threads = 4;
+    break;
+  default:
+    break;
+  }
+}
+
+static GBytes *read_back(FILE *fp)
+{
+  long size;
+  gchar *data;
+
+  fflush(fp);
+  size = ftell(fp);
+  data = g_malloc(size > 0 ? size : 1);
+  rewind(fp);
+  if (size > 0 && fread(data, size, 1, fp) != 1)
+    size = 0;
+  fclose(fp);
+  return g_bytes_new_take(data, size);
+}
+
+static GBytes *write_splines(at_splines_type *splines, const char *format)
+{
+  at_spline_writer *writer = at_output_get_handler_by_suffix((gchar *)format);
+  FILE *fp;
+
+  if (!writer)
+    return NULL;
+
+  fp = tmpfile();
+  if (!fp)
+    return NULL;
+  at_splines_write(writer, fp, "stress", NULL, splines, NULL, NULL);
+  return read_back(fp);
+}
+
+/* Trace BITMAP with OPTS and write it as FORMAT at the same time.  */
+static GBytes *trace_and_write(at_bitmap *bitmap, at_fitting_opts_type *opts, const char *format)
+{
+  at_spline_writer *writer = at_output_get_handler_by_suffix((gchar *)format);
+  FILE *fp;
+
+  if (!writer)
+    return NULL;
+
+  fp = tmpfile();
+  if (!fp)
+    return NULL;
+  if (!at_splines_new_write(bitmap, opts, writer, fp, "stress", NULL, NULL, NULL, NULL, NULL, NULL,
+                            NULL, NULL)) {
+    fclose(fp);
+    return NULL;
+  }
+  return read_back(fp);
+}
+
+/* Read, trace and write JOB; fill RESULTS with one buffer per format.  */
+static gboolean run_job(job_type *job, GBytes **results)
+{
+  at_bitmap_reader *reader = at_input_get_handler(job->image);
+  at_fitting_opts_type *opts;
+  at_bitmap *bitmap, *copy;
+  at_splines_type *splines;
+  GBytes *streamed;
+  gboolean same;
+  int i;
+
+  if (!reader)
+    return FALSE;
+
+  bitmap = at_bitmap_read(reader, job->image, NULL, NULL, NULL);
+  if (!bitmap)
+    return FALSE;
+  copy = at_bitmap_copy(bitmap);
+
+  opts = at_fitting_opts_new();
+  set_options(opts, job->option_set);
+  splines = at_splines_new(bitmap, opts, NULL, NULL);
+  streamed = trace_and_write(copy, opts, formats[0]);
+  at_fitting_opts_free(opts);
+  at_bitmap_free(bitmap);
+  at_bitmap_free(copy);
+  if (!splines) {
+    if (streamed)
+      g_bytes_unref(streamed);
+    return FALSE;
+  }
+
+  for (i = 0; formats[i]; i++)
+    results[i] = write_splines(splines, formats[i]);
+
+  at_splines_free(splines);
+
+  same = streamed && results[0] && g_bytes_equal(streamed, results[0]);
+  if (!same)
+    fprintf(stderr, "thread-stress: %s (option set %d, %s) differs when streamed\n", job->image,
+            job->option_set, formats[0]);
+  if (streamed)
+    g_bytes_unref(streamed);
+  return same;
+}
+
+static gpointer worker(gpointer data)
+{
+  worker_type *w = data;
+  int round, j, i;
+
+  for (round = 0; round < w->rounds; round++) {
+    for (j = 0; j < w->n_jobs; j++) {
+      /* Let each thread walk the jobs in a different order */
+      job_type *job = &w->jobs[(j + w->offset) % w->n_jobs];
+      GBytes *results[G_N_ELEMENTS(formats)] = {NULL};
+
+      if (!run_job(job, results)) {
+        w->mismatches++;
+        continue;
+      }
+      for (i = 0; formats[i]; i++) {
+        if (!results[i] || !job->expected[i] || !g_bytes_equal(results[i], job->expected[i])) {
+          fprintf(stderr, "thread-stress: %s (option set %d, %s) differs from serial run\n",
+                  job->image, job->option_set, formats[i]);
+          w->mismatches++;
+        }
+        if (results[i])
+          g_bytes_unref(results[i]);
+      }
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  int n_threads = 8, rounds = 2;
+  int n_jobs, n_images, c, i, j, mismatches = 0;
+  job_type *jobs;
+  worker_type *workers;
+  GThread **threads;
+
+  while ((c = getopt(argc, argv, "t:n:")) != -1) {
+    switch (c) {
+    case 't':
+      n_threads = atoi(optarg);
+      break;
+    case 'n':
+      rounds = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-t THREADS] [-n ROUNDS] IMAGE...\n", argv[0]);
+      return 2;
+    }
+  }
+  n_images = argc - optind;
+  if (n_images < 1 || n_threads < 1 || rounds < 1) {
+    fprintf(stderr, "Usage: %s [-t THREADS] [-n ROUNDS] IMAGE...\n", argv[0]);
+    return 2;
+  }
+
+  init_logging();
+  autotrace_init();
+
+  /* Serial reference run */
+  n_jobs = n_images * N_OPTION_SETS;
+  jobs = g_new0(job_type, n_jobs);
+  for (i = 0; i < n_images; i++) {
+    for (j = 0; j < N_OPTION_SETS; j++) {
+      job_type *job = &jobs[i * N_OPTION_SETS + j];
+      job->image = argv[optind + i];
+      job->option_set = j;
+      if (!run_job(job, job->expected)) {
+        fprintf(stderr, "thread-stress: cannot trace %s\n", job->image);
+        return 1;
+      }
+    }
+  }
+
+  /* Concurrent runs */
+  workers = g_new0(worker_type, n_threads);
+  threads = g_new0(GThread *, n_threads);
+  for (i = 0; i < n_threads; i++) {
+    workers[i].jobs = jobs;
+    workers[i].n_jobs = n_jobs;
+    workers[i].rounds = rounds;
+    workers[i].offset = i;
+    threads[i] = g_thread_new("thread-stress", worker, &workers[i]);
+  }
+  for (i = 0; i < n_threads; i++) {
+    g_thread_join(threads[i]);
+    mismatches += workers[i].mismatches;
+  }
+
+  for (i = 0; i < n_jobs; i++)
+    for (j = 0; formats[j]; j++)
+      if (jobs[i].expected[j])
+        g_bytes_unref(jobs[i].expected[j]);
+  g_free(jobs);
+  g_free(workers);
+  g_free(threads);
+
+  if (mismatches) {
+    fprintf(stderr, "thread-stress: %d mismatches\n", mismatches);
+    return 1;
+  }
+  return 0;
+}